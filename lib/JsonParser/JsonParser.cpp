@@ -0,0 +1,240 @@
+#include "JsonParser.h"
+#include <ctype.h>
+#include <stdlib.h>
+
+void JsonParser::begin(void (*onEvent)(JsonParser &parser, int event)) {
+  handler = onEvent;
+  depth = 0;
+  inArray[0] = false;
+  index[0] = 0;
+  key[0][0] = '\0';
+  length = 0;
+  failed = false;
+  state = JSON_STATE_VALUE;
+  highSurrogate = 0;
+  skipDepth = 0;
+  skipArrays = 0;
+}
+
+void JsonParser::feed(const char* data, size_t size) {
+  for (size_t i = 0; i < size && !failed; i++) {
+    char c = data[i];
+    
+    if (state == JSON_STATE_LITERAL) {
+      if (isalnum((unsigned char)c) || c == '-' || c == '+' || c == '.') {
+        append(c);
+        continue;
+      }
+      endLiteral(); // The character after a number still has to be handled below
+      if (failed) return;
+    }
+    
+    switch (state) {
+      case JSON_STATE_STRING:
+        if (c == '"') endString();
+        else if (c == '\\') state = JSON_STATE_ESCAPE;
+        else if ((uint8_t)c < 0x20) failed = true;
+        else append(c);
+        break;
+        
+      case JSON_STATE_ESCAPE:
+        state = JSON_STATE_STRING;
+        switch (c) {
+          case '"': case '\\': case '/': append(c); break;
+          case 'b': append('\b'); break;
+          case 'f': append('\f'); break;
+          case 'n': append('\n'); break;
+          case 'r': append('\r'); break;
+          case 't': append('\t'); break;
+          case 'u': unicode = 0; unicodeDigits = 0; state = JSON_STATE_UNICODE; break;
+          default: failed = true;
+        }
+        break;
+        
+      case JSON_STATE_UNICODE:
+        if (!isxdigit((unsigned char)c)) {
+          failed = true;
+          break;
+        }
+        unicode = (unicode << 4) | (isdigit((unsigned char)c) ? c - '0' : (tolower(c) - 'a' + 10));
+        if (++unicodeDigits == 4) {
+          appendCodepoint(unicode);
+          state = JSON_STATE_STRING;
+        }
+        break;
+        
+      default:
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') break;
+        structural(c);
+    }
+  }
+}
+
+bool JsonParser::finish() {
+  if (state == JSON_STATE_LITERAL && depth == 0 && !failed) endLiteral();
+  return !failed && state == JSON_STATE_DONE;
+}
+
+void JsonParser::appendCodepoint(uint32_t cp) {
+  if (cp >= 0xD800 && cp <= 0xDBFF) {
+    highSurrogate = cp; // Combined with the low half in the next \u escape
+    return;
+  }
+  if (cp >= 0xDC00 && cp <= 0xDFFF) {
+    if (!highSurrogate) return;
+    cp = 0x10000 + ((highSurrogate - 0xD800) << 10) + (cp - 0xDC00);
+  }
+  highSurrogate = 0;
+  
+  if (cp < 0x80) {
+    append(cp);
+  } else if (cp < 0x800) {
+    append(0xC0 | (cp >> 6));
+    append(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    append(0xE0 | (cp >> 12));
+    append(0x80 | ((cp >> 6) & 0x3F));
+    append(0x80 | (cp & 0x3F));
+  } else {
+    append(0xF0 | (cp >> 18));
+    append(0x80 | ((cp >> 12) & 0x3F));
+    append(0x80 | ((cp >> 6) & 0x3F));
+    append(0x80 | (cp & 0x3F));
+  }
+}
+
+void JsonParser::structural(char c) {
+  switch (state) {
+    case JSON_STATE_VALUE_OR_END:
+      if (c == ']') {
+        close(true);
+        return;
+      }
+      // Anything else starts the first element
+      // Fall through
+    case JSON_STATE_VALUE:
+      if (c == '{') {
+        open(false);
+      } else if (c == '[') {
+        open(true);
+      } else if (c == '"') {
+        readingKey = false;
+        length = 0;
+        state = JSON_STATE_STRING;
+      } else if (c == '-' || isdigit((unsigned char)c) || c == 't' || c == 'f' || c == 'n') {
+        length = 0;
+        append(c);
+        state = JSON_STATE_LITERAL;
+      } else {
+        failed = true;
+      }
+      break;
+      
+    case JSON_STATE_KEY_OR_END:
+      if (c == '}') {
+        close(false);
+        return;
+      }
+      // Fall through
+    case JSON_STATE_KEY:
+      if (c == '"') {
+        readingKey = true;
+        length = 0;
+        state = JSON_STATE_STRING;
+      } else {
+        failed = true;
+      }
+      break;
+      
+    case JSON_STATE_COLON:
+      if (c == ':') state = JSON_STATE_VALUE;
+      else failed = true;
+      break;
+      
+    case JSON_STATE_AFTER:
+      if (c == ',') {
+        if (arrayOpen()) {
+          if (!skipDepth) index[depth]++;
+          state = JSON_STATE_VALUE;
+        } else {
+          state = JSON_STATE_KEY;
+        }
+      } else if (c == ']' && arrayOpen()) {
+        close(true);
+      } else if (c == '}' && !arrayOpen()) {
+        close(false);
+      } else {
+        failed = true;
+      }
+      break;
+      
+    default:
+      failed = true; // Text after the document
+  }
+}
+
+void JsonParser::open(bool array) {
+  if (depth >= JSON_MAX_DEPTH) {
+    // Too deep to track keys and indexes, only the brackets are matched
+    if (skipDepth >= JSON_SKIP_DEPTH) {
+      failed = true;
+      return;
+    }
+    skipArrays = (skipArrays & ~(1UL << skipDepth)) | ((uint32_t)array << skipDepth);
+    skipDepth++;
+    state = array ? JSON_STATE_VALUE_OR_END : JSON_STATE_KEY_OR_END;
+    return;
+  }
+  length = 0;
+  emit(array ? JSON_ARRAY_START : JSON_OBJECT_START);
+  depth++;
+  inArray[depth] = array;
+  index[depth] = 0;
+  key[depth][0] = '\0';
+  state = array ? JSON_STATE_VALUE_OR_END : JSON_STATE_KEY_OR_END;
+}
+
+void JsonParser::close(bool array) {
+  if (skipDepth) {
+    skipDepth--;
+    afterValue();
+    return;
+  }
+  depth--;
+  length = 0;
+  emit(array ? JSON_ARRAY_END : JSON_OBJECT_END);
+  afterValue();
+}
+
+void JsonParser::endString() {
+  if (readingKey) {
+    state = JSON_STATE_COLON;
+    if (skipDepth) return;
+    size_t keyLength = (length < (size_t)JSON_KEY_SIZE) ? length : (size_t)JSON_KEY_SIZE - 1;
+    memcpy(key[depth], value, keyLength);
+    key[depth][keyLength] = '\0';
+    return;
+  }
+  emit(JSON_STRING);
+  afterValue();
+}
+
+void JsonParser::endLiteral() {
+  value[length] = '\0';
+  if (strcmp(value, "true") == 0) {
+    emit(JSON_TRUE);
+  } else if (strcmp(value, "false") == 0) {
+    emit(JSON_FALSE);
+  } else if (strcmp(value, "null") == 0) {
+    emit(JSON_NULL);
+  } else {
+    char* end;
+    strtod(value, &end);
+    if (*end != '\0' || length == JSON_VALUE_SIZE) {
+      failed = true;
+      return;
+    }
+    emit(JSON_NUMBER);
+  }
+  afterValue();
+}
@@ -0,0 +1,59 @@
+// Push parser for request bodies and RTDB payloads: bytes go in as they arrive, values come out through a
+// callback together with the key or array index of every open container. Memory use is
+// fixed, string values longer than the buffer are cut. Containers nested deeper than
+// JSON_MAX_DEPTH are read over to their end without events.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+enum JsonEvent {
+  JSON_STRING, JSON_NUMBER, JSON_TRUE, JSON_FALSE, JSON_NULL,
+  JSON_OBJECT_START, JSON_OBJECT_END, JSON_ARRAY_START, JSON_ARRAY_END
+};
+
+enum JsonState {
+  JSON_STATE_VALUE, JSON_STATE_VALUE_OR_END, JSON_STATE_KEY, JSON_STATE_KEY_OR_END, JSON_STATE_COLON,
+  JSON_STATE_STRING, JSON_STATE_ESCAPE, JSON_STATE_UNICODE, JSON_STATE_LITERAL, JSON_STATE_AFTER,
+  JSON_STATE_DONE
+};
+
+const int JSON_MAX_DEPTH = 4;
+const int JSON_SKIP_DEPTH = 32; // Nesting levels below JSON_MAX_DEPTH that can be skipped
+const int JSON_KEY_SIZE = 24;
+const int JSON_VALUE_SIZE = 244; // A little over a 240 byte sentence, the firmware cuts at a character
+
+struct JsonParser {
+  void (*handler)(JsonParser &parser, int event);
+  int depth;                                    // Containers open around the current value
+  bool inArray[JSON_MAX_DEPTH + 1];
+  int index[JSON_MAX_DEPTH + 1];                // Element index in each open array
+  char key[JSON_MAX_DEPTH + 1][JSON_KEY_SIZE];  // Member name in each open object
+  char value[JSON_VALUE_SIZE + 1];              // Text of the current string or number
+  size_t length;
+  bool failed;
+  uint8_t state;
+  bool readingKey;
+  uint32_t unicode;
+  uint8_t unicodeDigits;
+  uint32_t highSurrogate;
+  uint8_t skipDepth;   // Containers open below JSON_MAX_DEPTH
+  uint32_t skipArrays; // Bit per skipped container, set for an array
+
+  void begin(void (*onEvent)(JsonParser &parser, int event));
+  void feed(const char* data, size_t size);
+  bool finish(); // True if one complete document was parsed
+  bool at(int level, const char* name) const { return !inArray[level] && strcmp(key[level], name) == 0; }
+
+private:
+  void append(char c) { if (length < JSON_VALUE_SIZE) value[length++] = c; }
+  void appendCodepoint(uint32_t cp);
+  void structural(char c);
+  void open(bool array);
+  void close(bool array);
+  void endString();
+  void endLiteral();
+  void emit(int event) { value[length] = '\0'; if (!skipDepth) handler(*this, event); }
+  bool arrayOpen() const { return skipDepth ? (skipArrays >> (skipDepth - 1)) & 1 : inArray[depth]; }
+  void afterValue() { state = (depth == 0) ? JSON_STATE_DONE : JSON_STATE_AFTER; }
+};
@@ -0,0 +1,181 @@
+// LZSS for the message store: a flag byte for every 8 tokens (bit set = match), a literal is
+// 1 byte, a match 2 bytes with a 10-bit distance and a 6-bit length. Both sides stream, RAM use
+// is the 1 KB window plus a few small buffers, whatever the length of the text.
+//
+// Output is anything that takes the compressed bytes:
+//   bool write(const uint8_t* data, int size);
+// Input gives them back, 0 at the end of the data:
+//   int read(uint8_t* data, int size);
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+const int LZ_WINDOW = 1024;
+const int LZ_MIN_MATCH = 3;
+const int LZ_MAX_MATCH = LZ_MIN_MATCH + 63;
+
+template <class Output>
+class LzssEncoder {
+ public:
+  Output output;
+  uint32_t total;  // Text bytes encoded so far
+  uint32_t packed; // Compressed bytes handed to output
+  bool failed;     // output.write() returned false
+
+  void begin() {
+    total = 0;
+    packed = 0;
+    aheadLength = 0;
+    group[0] = 0;
+    groupLength = 1;
+    groupTokens = 0;
+    failed = false;
+  }
+
+  void put(uint8_t byte) {
+    ahead[aheadLength++] = byte;
+    if (aheadLength == LZ_MAX_MATCH) encodeNext();
+  }
+
+  // Encodes the lookahead and writes the last group, false if output failed
+  bool finish() {
+    while (aheadLength > 0 && !failed) encodeNext();
+    if (!failed) flushGroup();
+    return !failed;
+  }
+
+ private:
+  uint8_t history[LZ_WINDOW];
+  uint8_t ahead[LZ_MAX_MATCH]; // Lookahead not encoded yet
+  int aheadLength;
+  uint8_t group[1 + 8 * 2];    // Flag byte and up to 8 tokens
+  int groupLength;
+  int groupTokens;
+
+  // Longest match for the lookahead within the last LZ_WINDOW bytes, or one literal
+  void encodeNext() {
+    int bestLength = 0;
+    int bestDistance = 0;
+    int maxDistance = total < (uint32_t)LZ_WINDOW ? total : LZ_WINDOW;
+
+    for (int distance = 1; distance <= maxDistance && bestLength < aheadLength; distance++) {
+      int length = 0;
+      while (length < aheadLength) {
+        // Past the window end the match runs on into the lookahead
+        uint8_t byte = (length < distance) ? history[(total - distance + length) % LZ_WINDOW] : ahead[length - distance];
+        if (byte != ahead[length]) break;
+        length++;
+      }
+      if (length > bestLength) {
+        bestLength = length;
+        bestDistance = distance;
+      }
+    }
+
+    int used = 1;
+    if (bestLength >= LZ_MIN_MATCH) {
+      uint16_t code = bestDistance - 1;
+      group[0] |= 1 << groupTokens;
+      group[groupLength++] = code & 0xFF;
+      group[groupLength++] = ((code >> 8) << 6) | (bestLength - LZ_MIN_MATCH);
+      used = bestLength;
+    } else {
+      group[groupLength++] = ahead[0];
+    }
+
+    for (int i = 0; i < used; i++) {
+      history[(total + i) % LZ_WINDOW] = ahead[i];
+    }
+    total += used;
+    aheadLength -= used;
+    memmove(ahead, ahead + used, aheadLength);
+
+    if (++groupTokens == 8) flushGroup();
+  }
+
+  void flushGroup() {
+    if (groupTokens == 0) return;
+    if (!output.write(group, groupLength)) failed = true;
+    packed += groupLength;
+    group[0] = 0;
+    groupLength = 1;
+    groupTokens = 0;
+  }
+};
+
+template <class Input>
+class LzssDecoder {
+ public:
+  Input input;
+  uint32_t remaining; // Text bytes still to come
+
+  void begin(uint32_t length) {
+    historyPos = 0;
+    inputLength = 0;
+    inputPos = 0;
+    remaining = length;
+    flagBits = 0;
+    matchLeft = 0;
+  }
+
+  // Up to size text bytes, fewer only at the end of the text or of the input
+  int read(char* out, int size) {
+    int count = 0;
+    while (count < size && remaining > 0) {
+      if (matchLeft == 0) {
+        if (flagBits == 0) {
+          int value = inputByte();
+          if (value < 0) break;
+          flags = value;
+          flagBits = 8;
+        }
+        bool match = flags & 1;
+        flags >>= 1;
+        flagBits--;
+
+        if (!match) {
+          int value = inputByte();
+          if (value < 0) break;
+          history[historyPos++ % LZ_WINDOW] = value;
+          out[count++] = value;
+          remaining--;
+          continue;
+        }
+        int low = inputByte();
+        int high = inputByte();
+        if (low < 0 || high < 0) break;
+        matchDistance = (low | ((high >> 6) << 8)) + 1;
+        matchLeft = (high & 0x3F) + LZ_MIN_MATCH;
+      }
+
+      // Byte by byte, a match may overlap the bytes it produces
+      uint8_t value = history[(historyPos - matchDistance) % LZ_WINDOW];
+      history[historyPos++ % LZ_WINDOW] = value;
+      out[count++] = value;
+      remaining--;
+      matchLeft--;
+    }
+    return count;
+  }
+
+ private:
+  uint8_t history[LZ_WINDOW]; // Last decoded bytes, matches copy from here
+  uint32_t historyPos;
+  uint8_t buffer[64];
+  uint8_t inputLength;
+  uint8_t inputPos;
+  uint8_t flags;
+  uint8_t flagBits;
+  uint16_t matchDistance;
+  uint8_t matchLeft;
+
+  int inputByte() {
+    if (inputPos == inputLength) {
+      int count = input.read(buffer, sizeof(buffer));
+      if (count <= 0) return -1;
+      inputLength = count;
+      inputPos = 0;
+    }
+    return buffer[inputPos++];
+  }
+};
@@ -0,0 +1,138 @@
+// Panel geometry, the back buffer all drawing goes to, and the text band window that only
+// writes changed pixels. Templates on the grid size, so every size is a compile time constant
+// and any display with setPixel() and clear() can be presented to.
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <TextRender.h>
+
+// Geometry of a grid of P10 panels, all compile time constants
+template <int WIDE, int HIGH>
+struct PanelGrid {
+  static_assert(WIDE > 0 && HIGH > 0, "At least one panel is needed");
+  static constexpr int PANEL_WIDTH = 32;
+  static constexpr int PANEL_HEIGHT = 16;
+  static constexpr int WIDTH = WIDE * PANEL_WIDTH;
+  static constexpr int HEIGHT = HIGH * PANEL_HEIGHT;
+  static constexpr int TEXT_HEIGHT = 12; // ElektronMart6x12
+  static constexpr int TEXT_Y = (HEIGHT - TEXT_HEIGHT) / 2; // Text and clock are vertically centered
+  static constexpr int CENTER_X = WIDTH / 2; // Scrolling starts here
+  static constexpr int MESSAGE_Y = HEIGHT / 2 - 4;
+};
+
+// Back buffer that all drawing goes to, 1 bit per pixel. DMDESP scans its own buffer from
+// Disp.loop(), so present() runs between two scans and the panel only ever shows whole frames.
+template <class Grid>
+struct FrameBuffer {
+  static constexpr int STRIDE = (Grid::WIDTH + 7) / 8; // Bytes per row
+  static constexpr int SIZE = STRIDE * Grid::HEIGHT;
+  uint8_t back[SIZE];  // Frame being drawn
+  uint8_t shown[SIZE]; // Frame the panel is showing
+  bool dirty = false;  // Back differs from shown, present() has work to do
+  uint32_t presents = 0; // Frames that reached the panel
+
+  void setPixel(int x, int y, bool on) {
+    if (x < 0 || x >= Grid::WIDTH || y < 0 || y >= Grid::HEIGHT) return;
+    uint8_t &byte = back[y * STRIDE + x / 8];
+    uint8_t value = on ? (byte | (1 << (x % 8))) : (byte & ~(1 << (x % 8)));
+    if (value != byte) {
+      byte = value;
+      dirty = true;
+    }
+  }
+
+  bool pixel(int x, int y) const { return (back[y * STRIDE + x / 8] >> (x % 8)) & 1; }
+
+  void clear() {
+    memset(back, 0, sizeof(back));
+    dirty = true;
+  }
+
+  // Copies the pixels that changed since the last frame to the panel
+  template <class Display>
+  void present(Display &display) {
+    if (!dirty) return;
+
+    for (int i = 0; i < SIZE; i++) {
+      uint8_t changed = back[i] ^ shown[i];
+      if (!changed) continue;
+
+      int x = (i % STRIDE) * 8;
+      int y = i / STRIDE;
+      for (int bit = 0; changed; bit++, changed >>= 1) {
+        if (changed & 1) {
+          display.setPixel(x + bit, y, (back[i] >> bit) & 1);
+        }
+      }
+      shown[i] = back[i];
+    }
+    dirty = false;
+    presents++;
+  }
+
+  // After something drew on the display directly
+  template <class Display>
+  void resync(Display &display) {
+    display.clear();
+    memset(shown, 0, sizeof(shown));
+    dirty = true;
+  }
+
+  // Draws UTF-8 text glyph by glyph without shaping. Only the glyphs that are on the
+  // panel are decoded. Returns the x after the text.
+  int drawText(int x, int y, const char* text) {
+    uint16_t glyph[32];
+    uint8_t flags;
+    const char* p = text;
+
+    while (*p && x < Grid::WIDTH) {
+      uint32_t cp = utf8Next(p);
+      if (isZeroWidth(cp)) continue;
+      int glyphWidth = glyphColumns(cp, glyph, flags);
+      if (glyphWidth <= 0) continue;
+
+      int glyphX = (flags & ATLAS_OVERLAY) ? x - 1 - glyphWidth : x;
+      if (glyphX + glyphWidth > 0) {
+        for (int col = 0; col < glyphWidth; col++) {
+          for (uint16_t column = glyph[col], row = 0; column; row++, column >>= 1) {
+            if (column & 1) setPixel(glyphX + col, y + row, true);
+          }
+        }
+      }
+      if (!(flags & ATLAS_OVERLAY)) x += glyphWidth + 1;
+    }
+    return x;
+  }
+};
+
+// Text band of the panel as it is currently lit, one column per pixel like the scroll strip.
+// A frame only writes the pixels that differ, so the cost does not grow with the chain
+// length beyond one 16-bit compare per column.
+template <class Grid>
+struct ScrollWindow {
+  uint16_t columns[Grid::WIDTH];
+  bool valid = false; // False after anything else drew on the panel
+
+  void invalidate() { valid = false; }
+
+  void blit(FrameBuffer<Grid> &frame, int32_t textX, uint16_t (*source)(int32_t)) {
+    if (!valid) {
+      frame.clear();
+      memset(columns, 0, sizeof(columns));
+      valid = true;
+    }
+
+    for (int32_t px = 0; px < Grid::WIDTH; px++) {
+      uint16_t column = source(px - textX);
+      uint16_t changed = column ^ columns[px];
+      if (!changed) continue;
+
+      for (int row = 0; changed; row++, changed >>= 1) {
+        if (changed & 1) {
+          frame.setPixel(px, Grid::TEXT_Y + row, (column >> row) & 1);
+        }
+      }
+      columns[px] = column;
+    }
+  }
+};
@@ -0,0 +1,103 @@
+// Playlist from /display/playlist: rotates through sentences on the device, each item for
+// a number of scroll passes and/or a dwell time, optionally only inside a time-of-day window.
+// The items are compiled into a table of spans when they arrive, so which items run at a given
+// minute of the week is one binary search. Nothing here knows about the clock or the display.
+#pragma once
+#include <stdint.h>
+
+struct PlaylistItem {
+  uint8_t sentence;
+  uint8_t repeat;    // Scroll passes before the next item, at least 1
+  uint8_t days;      // Bit 0 = Sunday
+  uint8_t flags;
+  uint16_t from;     // Minute of day the window opens
+  uint16_t to;       // Minute of day it closes, before from = past midnight, same as from = all day
+  uint16_t dwell;    // Seconds the item stays at least
+  uint16_t reserved2;
+};
+
+const int PLAYLIST_MAX_ITEMS = 16; // One bit each in a span mask
+const uint8_t PLAYLIST_MESSAGE = 0x01; // sentence is a message store id
+const int MINUTES_PER_DAY = 1440;
+const int MINUTES_PER_WEEK = 7 * MINUTES_PER_DAY;
+
+// Rule check for one item, only used to compile the table
+inline bool playlistItemActive(const PlaylistItem &item, int minuteOfWeek) {
+  int day = minuteOfWeek / MINUTES_PER_DAY;
+  int minute = minuteOfWeek % MINUTES_PER_DAY;
+  int previousDay = (day + 6) % 7;
+
+  if (item.from == item.to) return item.days & (1 << day);
+  if (item.from < item.to) return (item.days & (1 << day)) && minute >= item.from && minute < item.to;
+
+  // Window past midnight belongs to the day it opened on
+  return ((item.days & (1 << day)) && minute >= item.from) ||
+         ((item.days & (1 << previousDay)) && minute < item.to);
+}
+
+// Compiled schedule: the week cut into spans at every window edge, sorted by start minute.
+// Each span holds the items active until the next one.
+struct PlaylistSpan {
+  uint16_t start; // Minute of week, 0 = Sunday 00:00
+  uint16_t mask;
+};
+
+struct PlaylistSchedule {
+  static const int MAX_SPANS = 7 * (1 + 2 * PLAYLIST_MAX_ITEMS);
+
+  PlaylistSpan spans[MAX_SPANS];
+  int spanCount = 0;
+  uint16_t alwaysMask = 0; // Items without a window, all that runs while the clock is not set
+
+  // Cut the week at every midnight and window edge, then record which items run in each span
+  void compile(const PlaylistItem* items, int count) {
+    uint16_t starts[MAX_SPANS];
+    int startCount = 0;
+    alwaysMask = 0;
+
+    for (int day = 0; day < 7; day++) {
+      starts[startCount++] = day * MINUTES_PER_DAY;
+      for (int i = 0; i < count; i++) {
+        if (items[i].from == items[i].to) continue;
+        starts[startCount++] = day * MINUTES_PER_DAY + items[i].from;
+        starts[startCount++] = day * MINUTES_PER_DAY + items[i].to;
+      }
+    }
+    for (int i = 0; i < count; i++) {
+      if (items[i].from == items[i].to && items[i].days == 0x7F) alwaysMask |= 1 << i;
+    }
+
+    // Insertion sort, at most a few hundred entries and only when the playlist changes
+    for (int i = 1; i < startCount; i++) {
+      uint16_t start = starts[i];
+      int j = i;
+      for (; j > 0 && starts[j - 1] > start; j--) starts[j] = starts[j - 1];
+      starts[j] = start;
+    }
+
+    // Spans with the same items as the one before are merged
+    spanCount = 0;
+    for (int i = 0; i < startCount; i++) {
+      if (i > 0 && starts[i] == starts[i - 1]) continue;
+      uint16_t mask = 0;
+      for (int item = 0; item < count; item++) {
+        if (playlistItemActive(items[item], starts[i])) mask |= 1 << item;
+      }
+      if (spanCount > 0 && spans[spanCount - 1].mask == mask) continue;
+      spans[spanCount++] = { starts[i], mask };
+    }
+  }
+
+  // Items active at this minute of the week
+  uint16_t maskAt(int minuteOfWeek) const {
+    // Last span starting at or before the minute, the first one always starts at 0
+    int low = 0;
+    int high = spanCount - 1;
+    while (low < high) {
+      int mid = (low + high + 1) / 2;
+      if (spans[mid].start <= minuteOfWeek) low = mid;
+      else high = mid - 1;
+    }
+    return (spanCount > 0) ? spans[low].mask : 0;
+  }
+};
@@ -0,0 +1,165 @@
+// Append-only log of small records in a ring of flash sectors, for settings and text that change
+// now and then. Every record carries a generation and a crc32, so a record cut short by a power
+// loss is found and skipped. A sector is only erased when the log wraps around to it, and the
+// caller writes a full snapshot after the sector record, so older sectors can be reused.
+//
+// Flash is anything with the SDK's word aligned calls:
+//   bool read(uint32_t addr, uint32_t* data, uint32_t size);
+//   bool write(uint32_t addr, uint32_t* data, uint32_t size);
+//   bool eraseSector(uint32_t sector);
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <coredecls.h>
+#include <flash_hal.h>
+
+const uint16_t RECORD_MAGIC = 0x5031;
+const uint8_t RECORD_SECTOR = 0; // First record of every sector, index = sector in the ring
+
+struct RecordHeader {
+  uint16_t magic;
+  uint8_t type;
+  uint8_t index;
+  uint32_t generation; // Increases with every record, never reused
+  uint16_t length;     // Payload bytes, padded to 4 in flash
+  uint16_t reserved;
+  uint32_t crc;        // crc32 of header (with crc = 0) and payload
+};
+
+template <class Flash, int SECTORS, int MAX_PAYLOAD>
+class RecordStore {
+ public:
+  static_assert(SECTORS >= 2, "The ring needs a sector to move on to");
+  static constexpr uint32_t SECTOR_SIZE = FLASH_SECTOR_SIZE;
+
+  Flash flash;
+  uint32_t base;       // Address of the first sector
+  int sector = -1;     // Sector being appended to, -1 = none valid
+  uint32_t offset = 0; // Next free byte in sector
+  uint32_t generation = 0;
+  bool torn = false;   // load() found bytes after the last valid record
+  uint32_t bytesWritten = 0;
+  uint32_t erases = 0;
+
+  explicit RecordStore(uint32_t baseAddress) : base(baseAddress) {}
+
+  static uint32_t recordSize(uint16_t length) { return sizeof(RecordHeader) + ((length + 3) & ~3); }
+
+  // A change of this many bytes can go into the current sector
+  bool fits(uint32_t bytes) const { return sector >= 0 && offset + bytes <= SECTOR_SIZE; }
+
+  // Replays the valid sectors oldest first, so later records win. visit(header, payload) gets
+  // every record but the sector records. Returns false if no sector is valid.
+  template <class Visit>
+  bool load(Visit visit) {
+    uint32_t sectorGeneration[SECTORS];
+    bool sectorValid[SECTORS];
+    RecordHeader header;
+    for (int s = 0; s < SECTORS; s++) {
+      sectorValid[s] = readRecord(sectorAddress(s), header, nullptr) && header.type == RECORD_SECTOR;
+      sectorGeneration[s] = header.generation;
+    }
+
+    static uint8_t payload[MAX_PAYLOAD];
+    bool found = false;
+    for (int pass = 0; pass < SECTORS; pass++) {
+      int s = -1;
+      for (int i = 0; i < SECTORS; i++) {
+        if (sectorValid[i] && (s < 0 || sectorGeneration[i] < sectorGeneration[s])) s = i;
+      }
+      if (s < 0) break;
+      sectorValid[s] = false;
+      found = true;
+
+      uint32_t at = 0;
+      while (at + sizeof(RecordHeader) <= SECTOR_SIZE && readRecord(sectorAddress(s) + at, header, payload)) {
+        if (header.type != RECORD_SECTOR) visit(header, payload);
+        if (header.generation > generation) generation = header.generation;
+        at += recordSize(header.length);
+      }
+      sector = s;
+      offset = at;
+    }
+
+    // Anything after the last valid record must still be erased, otherwise a write was torn
+    torn = false;
+    if (sector >= 0) {
+      uint32_t word;
+      for (uint32_t at = offset; at < SECTOR_SIZE; at += sizeof(word)) {
+        flash.read(sectorAddress(sector) + at, &word, sizeof(word));
+        if (word != 0xFFFFFFFF) {
+          torn = true;
+          offset = SECTOR_SIZE; // Next save starts a fresh sector
+          break;
+        }
+      }
+    }
+    return found;
+  }
+
+  bool append(uint8_t type, uint8_t index, const void* payload, uint16_t length) {
+    static uint32_t buffer[(sizeof(RecordHeader) + MAX_PAYLOAD + 3) / 4];
+    if (sector < 0 || length > MAX_PAYLOAD) return false;
+    uint32_t padded = (length + 3) & ~3;
+    uint32_t size = sizeof(RecordHeader) + padded;
+    if (offset + size > SECTOR_SIZE) return false;
+
+    RecordHeader *header = (RecordHeader*)buffer;
+    header->magic = RECORD_MAGIC;
+    header->type = type;
+    header->index = index;
+    header->generation = ++generation;
+    header->length = length;
+    header->reserved = 0xFFFF;
+    header->crc = 0;
+
+    uint8_t *data = (uint8_t*)buffer + sizeof(RecordHeader);
+    if (length > 0) memcpy(data, payload, length);
+    memset(data + length, 0xFF, padded - length);
+    header->crc = crc32(header, sizeof(RecordHeader));
+    header->crc = crc32(data, length, header->crc);
+
+    if (!flash.write(sectorAddress(sector) + offset, buffer, size)) {
+      offset = SECTOR_SIZE; // Force a fresh sector next time
+      return false;
+    }
+    offset += size;
+    bytesWritten += size;
+    return true;
+  }
+
+  // Erases the next sector in the ring and starts it with a sector record. The caller follows
+  // up with a snapshot of everything it keeps, the oldest sector is gone after the next rotate.
+  bool rotate() {
+    int next = (sector + 1) % SECTORS;
+    if (!flash.eraseSector(sectorAddress(next) / SECTOR_SIZE)) return false;
+    erases++;
+    sector = next;
+    offset = 0;
+    return append(RECORD_SECTOR, next, nullptr, 0);
+  }
+
+  // Reads and checks one record, payload may be null to check the header only
+  bool readRecord(uint32_t addr, RecordHeader &header, uint8_t* payload) {
+    if (!flash.read(addr, (uint32_t*)&header, sizeof(header))) return false;
+    if (header.magic != RECORD_MAGIC || header.length > MAX_PAYLOAD) return false;
+
+    uint32_t padded = (header.length + 3) & ~3;
+    if ((addr % SECTOR_SIZE) + sizeof(header) + padded > SECTOR_SIZE) return false;
+
+    static uint32_t buffer[(MAX_PAYLOAD + 3) / 4];
+    if (padded > 0 && !flash.read(addr + sizeof(header), buffer, padded)) return false;
+
+    uint32_t crc = header.crc;
+    header.crc = 0;
+    uint32_t check = crc32(&header, sizeof(header));
+    check = crc32(buffer, header.length, check);
+    header.crc = crc;
+    if (check != crc) return false;
+
+    if (payload) memcpy(payload, buffer, header.length);
+    return true;
+  }
+
+  uint32_t sectorAddress(int s) const { return base + s * SECTOR_SIZE; }
+};
@@ -0,0 +1,32 @@
+// Fixed timestep scroll clock: the position follows elapsed time, so a stalled loop() is caught
+// up by skipping pixels instead of slowing the scroll down. Time is kept in pixel microseconds
+// at a resolution of 1/1000 pixel per second, so a fractional speed does not drift over hours.
+#pragma once
+#include <stdint.h>
+
+struct ScrollClock {
+  static constexpr uint64_t PIXEL = 1000000000ULL; // One pixel in microseconds x millipixels per second
+
+  uint32_t lastUs = 0;
+  uint64_t remainder = 0; // Elapsed time not yet turned into a whole pixel, in PIXEL units
+  bool running = false;
+
+  // Whole pixels to move since the last call
+  uint32_t advance(uint32_t nowUs, float pixelsPerSecond) {
+    if (!running) {
+      running = true;
+      lastUs = nowUs;
+      remainder = 0;
+      return 0;
+    }
+    uint32_t elapsedUs = nowUs - lastUs; // Wrap-safe
+    lastUs = nowUs;
+    remainder += (uint64_t)elapsedUs * (uint32_t)(pixelsPerSecond * 1000 + 0.5f);
+    uint32_t steps = remainder / PIXEL;
+    remainder -= steps * PIXEL;
+    return steps;
+  }
+
+  // Next advance() starts from zero, used when scrolling resumes after the clock
+  void reset() { running = false; }
+};
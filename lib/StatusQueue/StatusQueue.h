@@ -0,0 +1,90 @@
+// Status messages: notices such as the portal address or a lost connection, queued with a
+// priority and a time to live. The most important message is shown, the oldest first within a
+// priority. A message with the same tag replaces the queued one, a full queue pushes out its
+// least important message. Nothing here draws or reads a clock, times are millis() readings.
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+enum StatusPriority { STATUS_INFO, STATUS_WARNING, STATUS_ALERT };
+const uint8_t STATUS_TAG_NONE = 0; // Never replaces another message
+const int STATUS_QUEUE_SIZE = 8;
+const int STATUS_TEXT_MAX = 48;
+
+struct StatusMessage {
+  char text[STATUS_TEXT_MAX + 1];
+  uint8_t priority;
+  uint8_t tag;
+  uint32_t sequence; // Posting order, oldest is shown first within a priority
+  uint32_t postedAt;
+  uint32_t ttl;      // ms after postedAt
+};
+
+struct StatusQueue {
+  StatusMessage messages[STATUS_QUEUE_SIZE];
+  int count = 0;
+  uint32_t sequence = 0;
+  uint32_t posted = 0;
+  uint32_t dropped = 0; // Pushed out of a full queue, or not let in
+
+  // Returns false if the queue was full of more important messages
+  bool post(const char* text, uint8_t priority, uint32_t ttlMs, uint8_t tag, uint32_t now) {
+    int slot = -1;
+    for (int i = 0; tag != STATUS_TAG_NONE && i < count; i++) {
+      if (messages[i].tag == tag) slot = i;
+    }
+    if (slot < 0 && count < STATUS_QUEUE_SIZE) slot = count++;
+    if (slot < 0) {
+      // Lowest priority, the oldest of those
+      int victim = 0;
+      for (int i = 1; i < count; i++) {
+        const StatusMessage &m = messages[i];
+        if (m.priority < messages[victim].priority ||
+            (m.priority == messages[victim].priority && m.sequence < messages[victim].sequence)) {
+          victim = i;
+        }
+      }
+      dropped++;
+      if (messages[victim].priority > priority) return false; // The new one is the least important
+      slot = victim;
+    }
+
+    StatusMessage &m = messages[slot];
+    size_t length = strlen(text);
+    if (length > STATUS_TEXT_MAX) {
+      // Cut before a UTF-8 continuation byte so no character is split
+      length = STATUS_TEXT_MAX;
+      while (length > 0 && ((uint8_t)text[length] & 0xC0) == 0x80) length--;
+    }
+    memcpy(m.text, text, length);
+    m.text[length] = '\0';
+    m.priority = priority;
+    m.tag = tag;
+    m.sequence = ++sequence;
+    m.postedAt = now;
+    m.ttl = ttlMs;
+    posted++;
+    return true;
+  }
+
+  // Drops expired messages and returns the one to show, null if none. The message with sequence
+  // hold stays past its TTL, the caller holds one that has not scrolled through yet.
+  const StatusMessage* top(uint32_t now, uint32_t hold) {
+    int best = -1;
+    for (int i = count - 1; i >= 0; i--) {
+      StatusMessage &m = messages[i];
+      if (now - m.postedAt >= m.ttl && m.sequence != hold) {
+        messages[i] = messages[--count];
+        if (best == count) best = i; // The best message just moved into this slot
+        continue;
+      }
+      if (best < 0 || before(m, messages[best])) best = i;
+    }
+    return (best >= 0) ? &messages[best] : nullptr;
+  }
+
+  // a is shown before b
+  static bool before(const StatusMessage &a, const StatusMessage &b) {
+    return a.priority > b.priority || (a.priority == b.priority && a.sequence < b.sequence);
+  }
+};
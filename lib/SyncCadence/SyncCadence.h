@@ -0,0 +1,42 @@
+// Sync cadence for stream resubscribes, fallback polls and local pushes. The wait starts at the
+// base interval (settings/updateInterval) and doubles after every failed or idle attempt, up to
+// 16x. Content changes reset it. +-20% jitter keeps displays that lost the backend together
+// from coming back in lockstep.
+#pragma once
+#include <stdint.h>
+
+struct SyncCadence {
+  static constexpr uint32_t INTERVAL_DEFAULT = 10000;
+  static constexpr uint32_t INTERVAL_MIN = 2000;
+  static constexpr uint32_t INTERVAL_MAX = 600000;
+  static constexpr int MAX_SHIFT = 4;
+
+  uint32_t base = INTERVAL_DEFAULT; // ms
+  int shift = 0;
+  uint32_t delay = INTERVAL_DEFAULT; // Wait after the last attempt in ms, jitter included
+
+  // False if the interval did not change. A shorter interval applies to the wait already running.
+  bool setInterval(uint32_t ms) {
+    if (ms < INTERVAL_MIN) ms = INTERVAL_MIN;
+    if (ms > INTERVAL_MAX) ms = INTERVAL_MAX;
+    if (ms == base) return false;
+    base = ms;
+    uint32_t longest = base << shift;
+    if (delay > longest) delay = longest;
+    return true;
+  }
+
+  // Next wait: the base interval if the last attempt got somewhere, else backed off further.
+  // roll is any random number, it picks the jitter.
+  uint32_t schedule(bool progressed, uint32_t roll) {
+    if (progressed) {
+      shift = 0;
+    } else if (shift < MAX_SHIFT) {
+      shift++;
+    }
+    uint32_t wait = base << shift;
+    uint32_t jitter = wait / 5;
+    delay = wait - jitter + roll % (2 * jitter + 1);
+    return delay;
+  }
+};
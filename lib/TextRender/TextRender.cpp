@@ -0,0 +1,557 @@
+#include "TextRender.h"
+#include <string.h>
+#include <pgmspace.h>
+
+const uint8_t* textFont = nullptr;
+
+//--------------------------
+// FONT
+
+// Font layout used by DMDESP (same as DMD): 2 bytes length, fixed width, height,
+// first char, char count, width table, then column data one byte row at a time
+int fontGlyphColumns(const uint8_t* font, unsigned char c, uint16_t* columns) {
+  uint8_t height = pgm_read_byte(font + 3);
+  uint8_t firstChar = pgm_read_byte(font + 4);
+  uint8_t charCount = pgm_read_byte(font + 5);
+  uint8_t bytes = (height + 7) / 8;
+  
+  // Space is usually not in the font, it is drawn blank with the width of 'n'
+  bool blank = (c == ' ');
+  if (blank) c = 'n';
+  if (c < firstChar || c >= firstChar + charCount) return 0;
+  c -= firstChar;
+  
+  uint8_t glyphWidth;
+  uint16_t index = 0;
+  if (pgm_read_byte(font) == 0 && pgm_read_byte(font + 1) == 0) {
+    // Fixed width font, no width table
+    glyphWidth = pgm_read_byte(font + 2);
+    index = c * bytes * glyphWidth + 6;
+  } else {
+    for (uint8_t i = 0; i < c; i++) {
+      index += pgm_read_byte(font + 6 + i);
+    }
+    index = index * bytes + charCount + 6;
+    glyphWidth = pgm_read_byte(font + 6 + c);
+  }
+  
+  for (uint8_t j = 0; j < glyphWidth; j++) {
+    uint16_t column = 0;
+    if (!blank) {
+      for (uint8_t i = 0; i < bytes; i++) {
+        uint8_t data = pgm_read_byte(font + index + j + (i * glyphWidth));
+        // Last byte row is bottom aligned to the glyph height
+        int offset = (i == bytes - 1 && bytes > 1) ? height - 8 : i * 8;
+        for (uint8_t k = 0; k < 8; k++) {
+          int row = offset + k;
+          if (row >= i * 8 && row < height && (data & (1 << k))) {
+            column |= (1 << row);
+          }
+        }
+      }
+    }
+    columns[j] = column;
+  }
+  return glyphWidth;
+}
+
+//--------------------------
+// UTF-8 TEXT AND GLYPH ATLAS
+// ElektronMart6x12 only covers ASCII. Everything else is decoded from UTF-8 and looked
+// up in a small PROGMEM atlas sorted by code point. Glyph columns use the scroll strip
+// format (bit 0 = top row, 12 rows). Missing glyphs are drawn as a box.
+// Bangla letters hang from the headline on row 2 and sit on row 8 like the ASCII capitals,
+// rows 0-1 hold the signs above it and rows 9-11 the ones below and stacked conjuncts.
+
+
+struct AtlasGlyph {
+  uint32_t codepoint;
+  uint16_t offset; // Into atlasColumns
+  uint8_t width;
+  uint8_t flags;
+};
+
+const uint16_t atlasColumns[] PROGMEM = {
+  0x00C, 0x012, 0x012, 0x00C,                      //   0 degree
+  0x060, 0x0F0, 0x0F0, 0x060,                      //   4 bullet
+  0x200, 0x000, 0x200, 0x000, 0x200,               //   8 ellipsis
+  0x040, 0x0E0, 0x150, 0x040, 0x040, 0x040, 0x040, //  13 left arrow
+  0x040, 0x040, 0x040, 0x040, 0x150, 0x0E0, 0x040, //  20 right arrow
+  0x020, 0x360, 0x1F0, 0x0FC, 0x1F0, 0x360, 0x020, //  27 star
+  0x038, 0x07C, 0x0FC, 0x1F8, 0x0FC, 0x07C, 0x038, //  34 heart
+  0x020, 0x040, 0x080, 0x040, 0x020, 0x010, 0x008, //  41 check mark
+  0x1FC,                                           //  48 danda
+  0x1FC, 0x000, 0x1FC,                             //  49 double danda
+  0x000, 0x800, 0x400,                             //  52 hasanta
+  0x000, 0x001, 0x003,                             //  55 reph
+  0x002, 0x004, 0x005, 0x004, 0x002,               //  58 candrabindu
+  0x094, 0x14C, 0x0B4, 0x024, 0x1FC,               //  63 অ
+  0x094, 0x14C, 0x0B4, 0x024, 0x1FC, 0x004, 0x1FC, //  68 আ
+  0x0C4, 0x124, 0x115, 0x12D, 0x0C6,               //  75 ই
+  0x0D4, 0x12C, 0x155, 0x085, 0x07E, 0x004,        //  80 ঈ
+  0x014, 0x02C, 0x124, 0x0A4, 0x144,               //  86 উ
+  0x014, 0x02C, 0x124, 0x0A4, 0x144, 0x064,        //  91 ঊ
+  0x024, 0x054, 0x024, 0x1FC, 0x104, 0x084,        //  97 ঋ
+  0x024, 0x154, 0x10C, 0x094, 0x064,               // 103 ঌ
+  0x18C, 0x154, 0x124, 0x144, 0x184,               // 108 এ
+  0x18E, 0x155, 0x125, 0x146, 0x184,               // 113 ঐ
+  0x0E4, 0x114, 0x14C, 0x144, 0x084,               // 118 ও
+  0x0E4, 0x114, 0x14C, 0x144, 0x085, 0x006, 0x1FC, // 123 ঔ
+  0x064, 0x094, 0x1FC, 0x014, 0x0E4, 0x004,        // 130 ক
+  0x068, 0x010, 0x024, 0x044, 0x1FC,               // 136 খ
+  0x114, 0x0AC, 0x044, 0x004, 0x1FC,               // 141 গ
+  0x01C, 0x024, 0x024, 0x09C, 0x044, 0x1FC,        // 146 ঘ
+  0x094, 0x12C, 0x114, 0x0E4, 0x004,               // 152 ঙ
+  0x07C, 0x084, 0x124, 0x124, 0x0E4,               // 157 চ
+  0x0B4, 0x14C, 0x094, 0x024, 0x1FC, 0x004,        // 162 ছ
+  0x064, 0x094, 0x04C, 0x094, 0x164, 0x0C4,        // 168 জ
+  0x00C, 0x014, 0x0CC, 0x134, 0x004, 0x064, 0x1BC, // 174 ঝ
+  0x014, 0x02C, 0x054, 0x084, 0x0F4, 0x10C, 0x1F4, // 181 ঞ
+  0x064, 0x094, 0x10C, 0x104, 0x084,               // 188 ট
+  0x0E4, 0x114, 0x11C, 0x114, 0x0E4,               // 193 ঠ
+  0x004, 0x094, 0x12C, 0x124, 0x0C4,               // 198 ড
+  0x004, 0x094, 0x12C, 0x114, 0x0D4, 0x024,        // 203 ঢ
+  0x094, 0x04C, 0x054, 0x064, 0x084, 0x1FC,        // 209 ণ
+  0x064, 0x094, 0x114, 0x00C, 0x0F4,               // 215 ত
+  0x030, 0x048, 0x014, 0x024, 0x044, 0x1FC,        // 220 থ
+  0x024, 0x014, 0x12C, 0x0A4, 0x044,               // 226 দ
+  0x030, 0x048, 0x010, 0x024, 0x1FC,               // 231 ধ
+  0x064, 0x094, 0x0CC, 0x004, 0x1FC,               // 236 ন
+  0x03C, 0x040, 0x020, 0x010, 0x1FC,               // 241 প
+  0x03C, 0x040, 0x020, 0x010, 0x1FC, 0x104,        // 246 ফ
+  0x044, 0x0A4, 0x114, 0x10C, 0x1FC,               // 252 ব
+  0x0DC, 0x124, 0x114, 0x12C, 0x0C4,               // 257 ভ
+  0x034, 0x04C, 0x094, 0x024, 0x1FC,               // 262 ম
+  0x08C, 0x054, 0x024, 0x044, 0x084, 0x1FC,        // 267 য
+  0x044, 0x0A4, 0x514, 0x10C, 0x1FC,               // 273 র
+  0x064, 0x094, 0x12C, 0x144, 0x1FC,               // 278 ল
+  0x01C, 0x024, 0x09C, 0x064, 0x104, 0x1FC,        // 283 শ
+  0x03C, 0x044, 0x02C, 0x014, 0x1FC,               // 289 ষ
+  0x024, 0x054, 0x08C, 0x014, 0x024, 0x1FC,        // 294 স
+  0x044, 0x024, 0x114, 0x12C, 0x0C4,               // 300 হ
+  0x060, 0x090, 0x110, 0x288, 0x070,               // 305 ৎ
+  0x004, 0x094, 0x52C, 0x124, 0x0C4,               // 310 ড়
+  0x004, 0x094, 0x52C, 0x114, 0x0D4, 0x024,        // 315 ঢ়
+  0x08C, 0x054, 0x424, 0x044, 0x084, 0x1FC,        // 321 য়
+  0x0E0, 0x110, 0x120, 0x0C0,                      // 327 ং
+  0x0D8, 0x0D8,                                    // 331 ঃ
+  0x000, 0x400, 0x000,                             // 333 ়
+  0x004, 0x1FC,                                    // 336 া
+  0x1FE, 0x005, 0x005,                             // 338 ি
+  0x005, 0x005, 0x1FE,                             // 341 ী
+  0x600, 0x800, 0x400,                             // 344 ু
+  0x400, 0xA00, 0xC00,                             // 347 ূ
+  0x000, 0xA00, 0x600,                             // 350 ৃ
+  0xC00, 0xA00, 0x600,                             // 353 ৄ
+  0x072, 0x08A, 0x104,                             // 356 ে
+  0x073, 0x08A, 0x105,                             // 359 ৈ
+  0x005, 0x006, 0x1FC,                             // 362 ৗ
+  0x0F8, 0x104, 0x104, 0x104, 0x0F8,               // 365 ০
+  0x018, 0x124, 0x104, 0x088, 0x070,               // 370 ১
+  0x008, 0x084, 0x144, 0x124, 0x118,               // 375 ২
+  0x088, 0x104, 0x124, 0x158, 0x080,               // 380 ৩
+  0x088, 0x154, 0x124, 0x154, 0x088,               // 385 ৪
+  0x078, 0x084, 0x108, 0x090, 0x060,               // 390 ৫
+  0x044, 0x028, 0x110, 0x0A0, 0x040,               // 395 ৬
+  0x01C, 0x060, 0x180, 0x060, 0x01C,               // 400 ৭
+  0x1F0, 0x008, 0x004, 0x008, 0x1F0,               // 405 ৮
+  0x018, 0x024, 0x024, 0x124, 0x0F8,               // 410 ৯
+  0x200, 0x400, 0x800,                             // 415 Ra-phala (shaped from ্র)
+  0x044, 0x024, 0x1FC,                             // 418 Ya-phala (shaped from ্য)
+  0xC00, 0xA00, 0xC00,                             // 421 Ba-phala (shaped from ্ব)
+  0x224, 0x554, 0xFFC, 0x114, 0x264, 0x004,        // 424 ক্ক
+  0x624, 0x954, 0x8FC, 0x514, 0x264, 0x004,        // 430 ক্ত
+  0x024, 0x054, 0x1FC, 0x014, 0x064, 0x044, 0x1FC, // 436 ক্ষ
+  0x094, 0x12C, 0x114, 0x0E4, 0x004, 0x3FC,        // 443 ঙ্গ
+  0x3BC, 0x444, 0x554, 0x554, 0x334,               // 449 চ্চ
+  0x13C, 0x2C4, 0x154, 0x254, 0x7B4, 0x004,        // 454 চ্ছ
+  0x064, 0x094, 0x04C, 0x094, 0x074, 0x08C, 0x1F4, // 460 জ্ঞ
+  0x124, 0x2D4, 0x44C, 0x424, 0x204,               // 467 ট্ট
+  0x224, 0x554, 0x594, 0x44C, 0x334,               // 472 ত্ত
+  0x124, 0x294, 0x12C, 0x064, 0x084, 0x3FC,        // 477 দ্ধ
+  0x224, 0x554, 0x5AC, 0x404, 0x37C,               // 483 ন্ত
+  0x024, 0x054, 0x0AC, 0x284, 0x17C, 0x004,        // 488 ন্দ
+  0x1B4, 0x24C, 0x214, 0x124, 0x3FC, 0x004,        // 494 ম্প
+  0x21C, 0x564, 0x48C, 0x414, 0x27C,               // 500 ষ্ট
+  0x224, 0x554, 0x58C, 0x414, 0x3A4, 0x07C,        // 505 স্ত
+  0x224, 0x154, 0x08C, 0x094, 0x124, 0x3FC         // 511 স্থ
+};
+
+// Sorted by code point for binary search. Emoji map onto the closest monochrome symbol.
+const AtlasGlyph atlasGlyphs[] PROGMEM = {
+  {0x00B0, 0, 4, 0},               // °
+  {0x0964, 48, 1, 0},              // ।
+  {0x0965, 49, 3, 0},              // ॥
+  {0x0981, 58, 5, ATLAS_OVERLAY},  // ঁ
+  {0x0982, 327, 4, 0},             // ং
+  {0x0983, 331, 2, 0},             // ঃ
+  {0x0985, 63, 5, 0},              // অ
+  {0x0986, 68, 7, 0},              // আ
+  {0x0987, 75, 5, 0},              // ই
+  {0x0988, 80, 6, 0},              // ঈ
+  {0x0989, 86, 5, 0},              // উ
+  {0x098A, 91, 6, 0},              // ঊ
+  {0x098B, 97, 6, 0},              // ঋ
+  {0x098C, 103, 5, 0},             // ঌ
+  {0x098F, 108, 5, 0},             // এ
+  {0x0990, 113, 5, 0},             // ঐ
+  {0x0993, 118, 5, 0},             // ও
+  {0x0994, 123, 7, 0},             // ঔ
+  {0x0995, 130, 6, 0},             // ক
+  {0x0996, 136, 5, 0},             // খ
+  {0x0997, 141, 5, 0},             // গ
+  {0x0998, 146, 6, 0},             // ঘ
+  {0x0999, 152, 5, 0},             // ঙ
+  {0x099A, 157, 5, 0},             // চ
+  {0x099B, 162, 6, 0},             // ছ
+  {0x099C, 168, 6, 0},             // জ
+  {0x099D, 174, 7, 0},             // ঝ
+  {0x099E, 181, 7, 0},             // ঞ
+  {0x099F, 188, 5, 0},             // ট
+  {0x09A0, 193, 5, 0},             // ঠ
+  {0x09A1, 198, 5, 0},             // ড
+  {0x09A2, 203, 6, 0},             // ঢ
+  {0x09A3, 209, 6, 0},             // ণ
+  {0x09A4, 215, 5, 0},             // ত
+  {0x09A5, 220, 6, 0},             // থ
+  {0x09A6, 226, 5, 0},             // দ
+  {0x09A7, 231, 5, 0},             // ধ
+  {0x09A8, 236, 5, 0},             // ন
+  {0x09AA, 241, 5, 0},             // প
+  {0x09AB, 246, 6, 0},             // ফ
+  {0x09AC, 252, 5, 0},             // ব
+  {0x09AD, 257, 5, 0},             // ভ
+  {0x09AE, 262, 5, 0},             // ম
+  {0x09AF, 267, 6, 0},             // য
+  {0x09B0, 273, 5, 0},             // র
+  {0x09B2, 278, 5, 0},             // ল
+  {0x09B6, 283, 6, 0},             // শ
+  {0x09B7, 289, 5, 0},             // ষ
+  {0x09B8, 294, 6, 0},             // স
+  {0x09B9, 300, 5, 0},             // হ
+  {0x09BC, 333, 3, ATLAS_OVERLAY}, // ়
+  {0x09BE, 336, 2, 0},             // া
+  {0x09BF, 338, 3, 0},             // ি
+  {0x09C0, 341, 3, 0},             // ী
+  {0x09C1, 344, 3, ATLAS_OVERLAY}, // ু
+  {0x09C2, 347, 3, ATLAS_OVERLAY}, // ূ
+  {0x09C3, 350, 3, ATLAS_OVERLAY}, // ৃ
+  {0x09C4, 353, 3, ATLAS_OVERLAY}, // ৄ
+  {0x09C7, 356, 3, 0},             // ে
+  {0x09C8, 359, 3, 0},             // ৈ
+  {0x09CD, 52, 3, 0},              // ্
+  {0x09CE, 305, 5, 0},             // ৎ
+  {0x09D7, 362, 3, 0},             // ৗ
+  {0x09DC, 310, 5, 0},             // ড়
+  {0x09DD, 315, 6, 0},             // ঢ়
+  {0x09DF, 321, 6, 0},             // য়
+  {0x09E6, 365, 5, 0},             // ০
+  {0x09E7, 370, 5, 0},             // ১
+  {0x09E8, 375, 5, 0},             // ২
+  {0x09E9, 380, 5, 0},             // ৩
+  {0x09EA, 385, 5, 0},             // ৪
+  {0x09EB, 390, 5, 0},             // ৫
+  {0x09EC, 395, 5, 0},             // ৬
+  {0x09ED, 400, 5, 0},             // ৭
+  {0x09EE, 405, 5, 0},             // ৮
+  {0x09EF, 410, 5, 0},             // ৯
+  {0x2022, 4, 4, 0},               // •
+  {0x2026, 8, 5, 0},               // …
+  {0x2190, 13, 7, 0},              // ←
+  {0x2192, 20, 7, 0},              // →
+  {0x2605, 27, 7, 0},              // ★
+  {0x2665, 34, 7, 0},              // ♥
+  {0x2705, 41, 7, 0},              // ✅
+  {0x2713, 41, 7, 0},              // ✓
+  {0x2714, 41, 7, 0},              // ✔
+  {0x2728, 27, 7, 0},              // ✨
+  {0x2764, 34, 7, 0},              // ❤
+  {0x27A1, 20, 7, 0},              // ➡
+  {0x2B05, 13, 7, 0},              // ⬅
+  {0x2B50, 27, 7, 0},              // ⭐
+  {CP_REPH, 55, 3, ATLAS_OVERLAY}, // Reph (shaped from র্)
+  {CP_RA_PHALA, 415, 3, ATLAS_OVERLAY},// Ra-phala (shaped from ্র)
+  {CP_YA_PHALA, 418, 3, 0},        // Ya-phala (shaped from ্য)
+  {CP_BA_PHALA, 421, 3, ATLAS_OVERLAY},// Ba-phala (shaped from ্ব)
+  {CP_CONJUNCT + 0, 424, 6, 0},    // ক্ক
+  {CP_CONJUNCT + 1, 430, 6, 0},    // ক্ত
+  {CP_CONJUNCT + 2, 436, 7, 0},    // ক্ষ
+  {CP_CONJUNCT + 3, 443, 6, 0},    // ঙ্গ
+  {CP_CONJUNCT + 4, 449, 5, 0},    // চ্চ
+  {CP_CONJUNCT + 5, 454, 6, 0},    // চ্ছ
+  {CP_CONJUNCT + 6, 460, 7, 0},    // জ্ঞ
+  {CP_CONJUNCT + 7, 467, 5, 0},    // ট্ট
+  {CP_CONJUNCT + 8, 472, 5, 0},    // ত্ত
+  {CP_CONJUNCT + 9, 477, 6, 0},    // দ্ধ
+  {CP_CONJUNCT + 10, 483, 5, 0},   // ন্ত
+  {CP_CONJUNCT + 11, 488, 6, 0},   // ন্দ
+  {CP_CONJUNCT + 12, 494, 6, 0},   // ম্প
+  {CP_CONJUNCT + 13, 500, 5, 0},   // ষ্ট
+  {CP_CONJUNCT + 14, 505, 6, 0},   // স্ত
+  {CP_CONJUNCT + 15, 511, 6, 0},   // স্থ
+  {0x1F31F, 27, 7, 0},             // 🌟
+  {0x1F496, 34, 7, 0}              // 💖
+};
+const int ATLAS_GLYPH_COUNT = sizeof(atlasGlyphs) / sizeof(atlasGlyphs[0]);
+
+// Conjuncts with a ligature, CP_CONJUNCT + index is its glyph in the atlas
+struct BanglaConjunct {
+  uint16_t first;
+  uint16_t second;
+};
+
+const BanglaConjunct banglaConjuncts[] PROGMEM = {
+  {0x0995, 0x0995}, // ক্ক
+  {0x0995, 0x09A4}, // ক্ত
+  {0x0995, 0x09B7}, // ক্ষ
+  {0x0999, 0x0997}, // ঙ্গ
+  {0x099A, 0x099A}, // চ্চ
+  {0x099A, 0x099B}, // চ্ছ
+  {0x099C, 0x099E}, // জ্ঞ
+  {0x099F, 0x099F}, // ট্ট
+  {0x09A4, 0x09A4}, // ত্ত
+  {0x09A6, 0x09A7}, // দ্ধ
+  {0x09A8, 0x09A4}, // ন্ত
+  {0x09A8, 0x09A6}, // ন্দ
+  {0x09AE, 0x09AA}, // ম্প
+  {0x09B7, 0x099F}, // ষ্ট
+  {0x09B8, 0x09A4}, // স্ত
+  {0x09B8, 0x09A5}  // স্থ
+};
+const int BANGLA_CONJUNCT_COUNT = sizeof(banglaConjuncts) / sizeof(banglaConjuncts[0]);
+
+const uint16_t fallbackBox[] = {0x7FC, 0x404, 0x404, 0x404, 0x7FC};
+const int FALLBACK_BOX_WIDTH = sizeof(fallbackBox) / sizeof(fallbackBox[0]);
+
+// Decode one code point and advance p. Malformed or overlong sequences give U+FFFD
+// and skip a single byte, so a bad byte never swallows the following text.
+uint32_t utf8Next(const char*& p) {
+  const uint8_t* s = (const uint8_t*)p;
+  uint8_t lead = s[0];
+  if (lead < 0x80) {
+    p++;
+    return lead;
+  }
+  
+  int extra;
+  uint32_t cp;
+  uint32_t minimum;
+  if ((lead & 0xE0) == 0xC0) { extra = 1; cp = lead & 0x1F; minimum = 0x80; }
+  else if ((lead & 0xF0) == 0xE0) { extra = 2; cp = lead & 0x0F; minimum = 0x800; }
+  else if ((lead & 0xF8) == 0xF0) { extra = 3; cp = lead & 0x07; minimum = 0x10000; }
+  else { p++; return CP_INVALID; }
+  
+  for (int i = 1; i <= extra; i++) {
+    if ((s[i] & 0xC0) != 0x80) { p++; return CP_INVALID; } // Also stops at the terminator
+    cp = (cp << 6) | (s[i] & 0x3F);
+  }
+  p += extra + 1;
+  if (cp < minimum || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return CP_INVALID;
+  return cp;
+}
+
+// Joiners, variation selectors and skin tone modifiers take no space on the panel
+bool isZeroWidth(uint32_t cp) {
+  return (cp >= 0x200B && cp <= 0x200D) || (cp >= 0xFE00 && cp <= 0xFE0F) ||
+         (cp >= 0x1F3FB && cp <= 0x1F3FF) || (cp >= 0xE0020 && cp <= 0xE007F);
+}
+
+// Glyph columns for any code point: font for ASCII, atlas, then the fallback box
+int glyphColumns(uint32_t cp, uint16_t* columns, uint8_t &flags) {
+  flags = 0;
+  if (cp < 0x20) return 0; // Control characters are skipped like drawText() does
+  if (cp < 0x100 && textFont) {
+    int width = fontGlyphColumns(textFont, (unsigned char)cp, columns);
+    if (width > 0) return width;
+  }
+  
+  int low = 0;
+  int high = ATLAS_GLYPH_COUNT - 1;
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    AtlasGlyph glyph;
+    memcpy_P(&glyph, &atlasGlyphs[mid], sizeof(glyph));
+    if (glyph.codepoint == cp) {
+      for (uint8_t i = 0; i < glyph.width; i++) {
+        columns[i] = pgm_read_word(&atlasColumns[glyph.offset + i]);
+      }
+      flags = glyph.flags;
+      return glyph.width;
+    }
+    if (glyph.codepoint < cp) low = mid + 1;
+    else high = mid - 1;
+  }
+  
+  memcpy(columns, fallbackBox, sizeof(fallbackBox));
+  return FALLBACK_BOX_WIDTH;
+}
+
+bool isBanglaConsonant(uint32_t cp) {
+  return (cp >= 0x0995 && cp <= 0x09B9) || (cp >= 0x09DC && cp <= 0x09DF);
+}
+
+bool isBanglaMark(uint32_t cp) {
+  return (cp >= 0x0981 && cp <= 0x0983) || (cp >= 0x09BE && cp <= 0x09CD) ||
+         cp == 0x09D7 || cp == 0x09E2 || cp == 0x09E3;
+}
+
+// Ligature for first + hasanta + second, 0 if the atlas has none
+uint32_t banglaConjunct(uint32_t first, uint32_t second) {
+  for (int i = 0; i < BANGLA_CONJUNCT_COUNT; i++) {
+    BanglaConjunct conjunct;
+    memcpy_P(&conjunct, &banglaConjuncts[i], sizeof(conjunct));
+    if (conjunct.first == first && conjunct.second == second) return CP_CONJUNCT + i;
+  }
+  return 0;
+}
+
+// Bangla shaping into visual order: pre-base vowel signs (ি ে ৈ) move in front of the
+// consonant cluster, ো and ৌ split into their two halves around it, and র্ before a
+// consonant becomes a reph drawn over the end of the cluster. Inside the cluster the
+// conjuncts in banglaConjuncts[] become one ligature and ্র ্য ্ব become phalas, any other
+// pair keeps a visible hasanta. Other text is passed through unchanged.
+// Returns the number of code points, or -1 if they do not fit in maxOut.
+int shapeText(const char* text, uint32_t* out, int maxOut) {
+  int count = 0;
+  const char* p = text;
+  
+  while (*p && count < maxOut) {
+    const char* q = p;
+    uint32_t cp = utf8Next(q);
+    if (!isBanglaConsonant(cp)) {
+      out[count++] = cp;
+      p = q;
+      continue;
+    }
+    
+    bool reph = false;
+    if (cp == 0x09B0) {
+      const char* r = q;
+      if (utf8Next(r) == 0x09CD) {
+        const char* next = r;
+        if (isBanglaConsonant(utf8Next(next))) {
+          reph = true;
+          q = r;
+          cp = utf8Next(q);
+        }
+      }
+    }
+    
+    // Consonant cluster: C (nukta) (hasanta C (nukta))*, shaped as it is read
+    uint32_t cluster[12];
+    int clusterLength = 0;
+    cluster[clusterLength++] = cp;
+    while (clusterLength < 10) {
+      const char* r = q;
+      uint32_t next = utf8Next(r);
+      if (next == 0x09BC) {
+        cluster[clusterLength++] = next;
+        q = r;
+        continue;
+      }
+      if (next == 0x09CD) {
+        const char* s = r;
+        uint32_t consonant = utf8Next(s);
+        if (isBanglaConsonant(consonant)) {
+          uint32_t ligature = banglaConjunct(cluster[clusterLength - 1], consonant);
+          if (ligature) {
+            cluster[clusterLength - 1] = ligature;
+          } else if (consonant == 0x09B0) {
+            cluster[clusterLength++] = CP_RA_PHALA;
+          } else if (consonant == 0x09AF) {
+            cluster[clusterLength++] = CP_YA_PHALA;
+          } else if (consonant == 0x09AC) {
+            cluster[clusterLength++] = CP_BA_PHALA;
+          } else {
+            cluster[clusterLength++] = next;
+            cluster[clusterLength++] = consonant;
+          }
+          q = s;
+          continue;
+        }
+      }
+      break;
+    }
+    
+    // Dependent vowel signs and other marks
+    uint32_t preBase = 0;
+    uint32_t postBase[4];
+    int postLength = 0;
+    while (*q) {
+      const char* r = q;
+      uint32_t mark = utf8Next(r);
+      if (!isBanglaMark(mark) || postLength >= 3) break;
+      q = r;
+      if (mark == 0x09BF || mark == 0x09C7 || mark == 0x09C8) {
+        preBase = mark;
+      } else if (mark == 0x09CB) {
+        preBase = 0x09C7;
+        postBase[postLength++] = 0x09BE;
+      } else if (mark == 0x09CC) {
+        preBase = 0x09C7;
+        postBase[postLength++] = 0x09D7;
+      } else {
+        postBase[postLength++] = mark;
+      }
+    }
+    
+    int needed = (preBase ? 1 : 0) + clusterLength + postLength + (reph ? 1 : 0);
+    if (count + needed > maxOut) break;
+    if (preBase) out[count++] = preBase;
+    for (int i = 0; i < clusterLength; i++) out[count++] = cluster[i];
+    for (int i = 0; i < postLength; i++) out[count++] = postBase[i];
+    if (reph) out[count++] = CP_REPH;
+    p = q;
+  }
+  return *p ? -1 : count; // -1 if the text did not fit
+}
+
+//--------------------------
+// STRIP
+
+// Shapes text into strip, returns the width in columns or -1 if it does not fit
+int32_t renderStrip(const char* text, uint16_t* strip, uint32_t capacity) {
+  static uint32_t shaped[RENDER_MAX_CODEPOINTS];
+  uint16_t glyph[32]; // Widest glyph is GLYPH_MAX_COLUMNS
+  uint8_t flags;
+  uint32_t col = 0;
+  
+  int count = shapeText(text, shaped, RENDER_MAX_CODEPOINTS);
+  if (count < 0) return -1;
+  for (int i = 0; i < count; i++) {
+    if (isZeroWidth(shaped[i])) continue;
+    int glyphWidth = glyphColumns(shaped[i], glyph, flags);
+    if (glyphWidth <= 0) continue;
+    
+    if ((flags & ATLAS_OVERLAY) && col > 0) {
+      // Marks are right aligned over the previous glyph, skipping its trailing gap
+      uint32_t end = col - 1;
+      uint32_t start = (end > (uint32_t)glyphWidth) ? end - glyphWidth : 0;
+      for (int j = 0; j < glyphWidth; j++) {
+        strip[start + j] |= glyph[j];
+      }
+      continue;
+    }
+    if (col + glyphWidth + 1 > capacity) return -1;
+    
+    memcpy(&strip[col], glyph, glyphWidth * sizeof(uint16_t));
+    col += glyphWidth;
+    strip[col++] = 0; // 1 pixel gap between characters
+  }
+  return col;
+}
+
+// Width in columns as drawn glyph by glyph, without shaping
+int glyphTextWidth(const char* text) {
+  uint16_t glyph[32];
+  uint8_t flags;
+  int width = 0;
+  
+  for (const char* p = text; *p; ) {
+    uint32_t cp = utf8Next(p);
+    if (isZeroWidth(cp)) continue;
+    int glyphWidth = glyphColumns(cp, glyph, flags);
+    if (glyphWidth > 0 && !(flags & ATLAS_OVERLAY)) width += glyphWidth + 1;
+  }
+  return width;
+}
@@ -0,0 +1,39 @@
+// UTF-8 text to glyph columns: DMD font lookup, a PROGMEM atlas for symbols and Bangla,
+// Bangla shaping into visual order with conjuncts, and rendering into a strip of columns. A
+// column is 16 bits, bit 0 = top row, 12 rows of ElektronMart6x12. Nothing here touches the
+// panel.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+const uint8_t ATLAS_OVERLAY = 0x01; // Mark drawn over the previous glyph instead of after it
+const uint32_t CP_REPH = 0xE000;    // Private use code point for reph after shaping
+const uint32_t CP_RA_PHALA = 0xE001; // ্র after a consonant, drawn under it
+const uint32_t CP_YA_PHALA = 0xE002; // ্য after a consonant
+const uint32_t CP_BA_PHALA = 0xE003; // ্ব after a consonant, drawn under it
+const uint32_t CP_CONJUNCT = 0xE010; // First conjunct ligature, see banglaConjuncts[]
+const uint32_t CP_INVALID = 0xFFFD;
+const int RENDER_MAX_CODEPOINTS = 240; // renderStrip() text, a sentence never has more
+const int GLYPH_MAX_COLUMNS = 7; // Widest glyph of the font and the atlas, the gap comes on top
+
+// Font for code points below 0x100, in the DMD layout. Set before anything is drawn.
+extern const uint8_t* textFont;
+
+// Character width straight from the font table, only for compile time use (PROGMEM
+// can not be read byte by byte at run time). Space is drawn with the width of 'n'.
+constexpr uint8_t fontCharWidth(const uint8_t* font, unsigned char c) {
+  return (c == ' ') ? fontCharWidth(font, 'n') :
+         (c < font[4] || c >= font[4] + font[5]) ? 0 :
+         (font[0] == 0 && font[1] == 0) ? font[2] : font[6 + c - font[4]];
+}
+
+int fontGlyphColumns(const uint8_t* font, unsigned char c, uint16_t* columns);
+uint32_t utf8Next(const char*& p);
+bool isZeroWidth(uint32_t cp);
+int glyphColumns(uint32_t cp, uint16_t* columns, uint8_t &flags);
+bool isBanglaConsonant(uint32_t cp);
+bool isBanglaMark(uint32_t cp);
+uint32_t banglaConjunct(uint32_t first, uint32_t second);
+int shapeText(const char* text, uint32_t* out, int maxOut);
+int32_t renderStrip(const char* text, uint16_t* strip, uint32_t capacity);
+int glyphTextWidth(const char* text);
@@ -0,0 +1,141 @@
+// Device clock: runs on the local microsecond counter from a reference point and is corrected for
+// the crystal drift measured between SNTP answers. Offsets below a second are slewed in rather
+// than stepped, so minutes never jump back. The state fits an RtcTimeRecord, which the caller
+// keeps in RTC user memory, so a reset without network still has the right time.
+// Nothing here reads a clock, every call takes the micros64() reading it is for.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <coredecls.h>
+
+const int64_t TIME_VALID_US = 1600000000LL * 1000000; // Anything earlier means the clock is not set
+const int64_t TIME_STEP_LIMIT_US = 1000000;           // Larger SNTP offsets are stepped
+const int64_t TIME_SLEW_PPM = 500;                     // Slew rate limit, the same as adjtime()
+const int32_t TIME_DRIFT_LIMIT_PPB = 500000;           // A real crystal is within 500 ppm
+const uint64_t TIME_DRIFT_MIN_US = 600000000ULL;       // Samples closer than 10 minutes are too noisy for drift
+const uint64_t TIME_ANCHOR_US = 3600000000ULL;         // Move the reference hourly, keeps the drift term small
+const uint32_t TIME_RTC_MAGIC = 0x50313054;
+const uint64_t TIME_RTC_MAX_GAP_US = 3600000000ULL;    // A reset longer than this is not trusted
+
+// Written on every new second, read back once at boot
+struct RtcTimeRecord {
+  uint32_t magic;
+  uint32_t rtcCycles; // system_get_rtc_time(), keeps counting through a reset
+  uint32_t rtcPeriod; // system_rtc_clock_cali_proc(), us per cycle in Q12
+  int32_t driftPpb;
+  int64_t epochUs;
+  int64_t slewUs;
+  uint32_t crc;
+  uint32_t reserved;
+};
+
+struct TimeKeeper {
+  uint64_t refLocalUs = 0;    // micros64() at the reference point
+  int64_t refEpochUs = 0;     // Clock at the reference point, 0 = not set
+  int64_t slewUs = 0;         // Correction still to be applied from the reference point on
+  int32_t driftPpb = 0;       // Rate correction, positive when the local clock runs slow
+  uint64_t sampleLocalUs = 0; // micros64() of the last SNTP answer, 0 = none since boot
+  int64_t lastOffsetUs = 0;   // Last SNTP answer minus the clock
+  uint32_t samples = 0;
+  uint32_t steps = 0;
+
+  // Clock in us since epoch at a micros64() reading, 0 while it is not set
+  int64_t epochUs(uint64_t localUs) const {
+    if (!refEpochUs) return 0;
+    int64_t elapsed = localUs - refLocalUs;
+    return refEpochUs + elapsed + elapsed * driftPpb / 1000000000 + slewApplied(elapsed);
+  }
+
+  // Part of the pending slew that is applied after elapsed us from the reference point
+  int64_t slewApplied(int64_t elapsed) const {
+    int64_t limit = elapsed * TIME_SLEW_PPM / 1000000;
+    if (slewUs < 0) return (slewUs > -limit) ? slewUs : -limit;
+    return (slewUs < limit) ? slewUs : limit;
+  }
+
+  // Takes one SNTP answer: updates the drift estimate and slews (or steps) towards it.
+  // Returns the offset of the answer against the clock.
+  int64_t sample(int64_t sntpUs, uint64_t localUs) {
+    samples++;
+    if (!refEpochUs) {
+      refLocalUs = localUs;
+      refEpochUs = sntpUs;
+      slewUs = 0;
+      sampleLocalUs = localUs;
+      lastOffsetUs = 0;
+      return 0;
+    }
+
+    int64_t now = epochUs(localUs);
+    int64_t offset = sntpUs - now;
+    lastOffsetUs = offset;
+    bool step = (offset >= TIME_STEP_LIMIT_US || offset <= -TIME_STEP_LIMIT_US);
+
+    // What is left after the pending slew is the error the drift built up since the last answer.
+    // Half of it goes into the estimate, which averages out the network jitter.
+    int64_t residual = offset - (slewUs - slewApplied(localUs - refLocalUs));
+    uint64_t interval = localUs - sampleLocalUs;
+    if (sampleLocalUs && interval >= TIME_DRIFT_MIN_US && !step) {
+      int64_t drift = driftPpb + residual * 1000000000 / (int64_t)interval / 2;
+      if (drift > TIME_DRIFT_LIMIT_PPB) drift = TIME_DRIFT_LIMIT_PPB;
+      if (drift < -TIME_DRIFT_LIMIT_PPB) drift = -TIME_DRIFT_LIMIT_PPB;
+      driftPpb = drift;
+    }
+    sampleLocalUs = localUs;
+
+    refLocalUs = localUs;
+    if (step) {
+      refEpochUs = sntpUs;
+      slewUs = 0;
+      steps++;
+    } else {
+      refEpochUs = now;
+      slewUs = offset;
+    }
+    return offset;
+  }
+
+  // Moves the reference point to localUs without changing the clock
+  void anchor(uint64_t localUs) {
+    int64_t now = epochUs(localUs);
+    slewUs -= slewApplied(localUs - refLocalUs);
+    refLocalUs = localUs;
+    refEpochUs = now;
+  }
+
+  // The clock at localUs, with the RTC counter reading that goes with it
+  void save(RtcTimeRecord &record, uint64_t localUs, uint32_t rtcCycles, uint32_t rtcPeriod) const {
+    record.magic = TIME_RTC_MAGIC;
+    record.rtcCycles = rtcCycles;
+    record.rtcPeriod = rtcPeriod;
+    record.driftPpb = driftPpb;
+    record.epochUs = epochUs(localUs);
+    record.slewUs = slewUs - slewApplied(localUs - refLocalUs);
+    record.reserved = 0;
+    record.crc = crc32(&record, offsetof(RtcTimeRecord, crc));
+  }
+
+  // Sets the clock from a record saved before a reset, the RTC counter tells how long the device
+  // was away. Returns the gap in us, 0 if the record is not valid or too old to trust.
+  uint64_t restore(const RtcTimeRecord &record, uint64_t localUs, uint32_t rtcCycles) {
+    if (record.magic != TIME_RTC_MAGIC || record.crc != crc32(&record, offsetof(RtcTimeRecord, crc))) return 0;
+    if (record.epochUs < TIME_VALID_US) return 0;
+
+    uint32_t cycles = rtcCycles - record.rtcCycles;
+    uint64_t gapUs = ((uint64_t)cycles * record.rtcPeriod) >> 12;
+    if (gapUs > TIME_RTC_MAX_GAP_US) return 0;
+    if (gapUs < localUs) gapUs = localUs; // Counter restarted, at least the time since boot passed
+    if (gapUs == 0) gapUs = 1;
+
+    int32_t drift = record.driftPpb;
+    if (drift > TIME_DRIFT_LIMIT_PPB) drift = TIME_DRIFT_LIMIT_PPB;
+    if (drift < -TIME_DRIFT_LIMIT_PPB) drift = -TIME_DRIFT_LIMIT_PPB;
+
+    refLocalUs = localUs;
+    refEpochUs = record.epochUs + gapUs;
+    slewUs = record.slewUs;
+    driftPpb = drift;
+    sampleLocalUs = 0;
+    return gapUs;
+  }
+};
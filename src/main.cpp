@@ -11,12 +11,27 @@
 
 #include <DMDESP.h>
 #include <fonts/ElektronMart6x12.h>
+#include <TextRender.h>
+#include <PanelFrame.h>
+#include <RecordStore.h>
+#include <ScrollClock.h>
+#include <SyncCadence.h>
+#include <Playlist.h>
+#include <Lzss.h>
+#include <TimeKeeper.h>
+#include <StatusQueue.h>
+#include <JsonParser.h>
 #include <ESP8266WiFi.h>
 #include <WiFiManager.h>
 #include <Firebase_ESP_Client.h>
 #include <ESP8266WebServer.h>
 #include <EEPROM.h>
+#include <flash_hal.h>
+#include <LittleFS.h>
+#include <coredecls.h>
+#include <user_interface.h>
 #include <time.h>
+#include <sys/time.h>
 
 // Provide the token generation process info.
 #include <addons/TokenHelper.h>
@@ -30,72 +45,588 @@ String firebase_url = ""; // For persistent storage
 
 // Firebase objects
 FirebaseData fbdo;
+FirebaseData stream; // Dedicated connection for the /display stream
 FirebaseAuth auth;
 FirebaseConfig config;
 
 // WiFiManager
 WiFiManager wm;
 
+// HTTP server for metrics and the local control API
+ESP8266WebServer server(80);
+
 // Function declarations
-bool ScrollingText(int y, uint8_t speed);
+bool ScrollingText(float pixelsPerSecond);
+bool renderScrollStrip(const char* text);
+uint16_t scrollColumn(int32_t stripX);
+uint16_t statusColumn(int32_t stripX);
+void postStatus(const char* text, uint8_t priority, uint32_t ttlMs, uint8_t tag = 0);
+void statusOverlayFrame();
+bool initMessageStore();
+bool readMessageEntry(int id, struct MessageIndexEntry &entry);
+bool writeMessageEntry(int id, const struct MessageIndexEntry &entry);
+bool messageExists(int id);
+bool deleteMessage(int id);
+bool compactMessages();
+int messageChunkEnd(const char* text, int length, bool last);
+uint32_t textColumns(const char* text, uint32_t columns);
+bool showStoredMessage(int id);
 void displayDigitalClock();
+void drawClockCell(int x, char c, uint8_t width);
 void initTimeSync();
+void onTimeSet();
+void timeTick();
+time_t clockNow();
+void saveTimeToRtc(uint64_t localUs);
+bool restoreTimeFromRtc();
 void initWiFiManager();
 void initFirebase();
-void updateTextFromFirebase();
+bool updateTextFromFirebase();
+void scheduleNextSync(bool progressed);
+bool setSyncInterval(unsigned long intervalMs);
 void startFirebaseStream();
 void handleFirebaseStream();
-void saveDataToEEPROM();
+void applyStreamEvent(FirebaseData &data);
+bool setSentence(int index, const char* text, size_t length);
+bool writeSentence(int index, const char* text, size_t length);
+bool setDisplayText(const char* text);
+bool showingPlaceholder();
+bool setSelectedSentence(int newSelected);
+int activeSentence();
+int activeMessage();
+bool showActiveSentence();
+void compilePlaylist();
+int currentMinuteOfWeek();
+bool playlistNext();
+bool applyPlaylistText(const char* text, size_t length);
+bool commitPlaylistUpload();
+void onPlaylistJson(struct JsonParser &parser, int event);
+int parseMinuteOfDay(const char* text);
+bool syncPlaylist(int &requestCount, size_t &bytesTransferred);
+bool readDisplayJson(const String &payload, const char* node, uint8_t mode);
+void beginDisplayJson(const char* node, uint8_t mode);
+bool finishDisplayJson();
+void onDisplayJson(struct JsonParser &parser, int event);
+int displayIndex(const struct JsonParser &parser, int depth);
+bool setScrollSpeed(float pixelsPerSecond);
+bool syncSettings(int &requestCount, size_t &bytesTransferred);
+bool syncFullDisplay(int &requestCount, size_t &bytesTransferred);
+bool syncChangedSentences(int &requestCount, size_t &bytesTransferred);
+uint32_t sentenceHash(const char* text, size_t length);
+bool saveDataToEEPROM();
 void loadDataFromEEPROM();
-void displayMessage(String message, bool clearFirst = true);
+void loadLegacyEEPROM();
+bool storeAppend(uint8_t type, uint8_t index, const void* payload, uint16_t length);
+bool storeRotate();
 void checkWiFiConnection();
+void setWiFiState(int state);
+void onWiFiReconnected();
+void onWiFiConnected();
+void bootMark(uint32_t &stage, const char* name);
+void printBootTimeline();
+void drawStatusOverlay();
+void scanTask();
+void displayTask();
+void firebaseTask();
+void saveTask();
+void clockTick();
+void printTaskStats();
+void initScheduler();
+void runScheduler();
+bool taskBefore(uint8_t a, uint8_t b);
+void taskSiftDown(int i);
+void webTask();
+void initMetricsServer();
+void initLocalApi();
+uint64_t apiRequestTime();
+bool localChangeWins(uint64_t updatedAt);
+bool remoteChangeWins(uint64_t updatedAt);
+void acceptRemoteTime(uint64_t updatedAt);
+void commitLocalChange(uint64_t updatedAt);
+void apiReply(int status, const char* error);
+void handleApiState();
+void handleApiSentences();
+void handleApiSentencesBody();
+void handleApiSelected();
+void handleApiMessages();
+void handleApiMessagePut();
+void handleApiMessageBody();
+void handleApiMessageDelete();
+void apiSendJsonString(const char* text);
+bool pushLocalChanges();
+void telemetryEvent(uint8_t type, int16_t value);
+void telemetryTask();
+bool uploadTelemetry();
+void recordTiming(struct TimingMetric &metric, uint32_t us);
+void recordLoopTime(uint32_t us);
+bool recordFirebaseRequest(uint32_t startUs, bool ok);
+void handleMetricsPrometheus();
+void handleMetricsJson();
+void metricsBegin(const char* contentType);
+void metricsAppend(const char* format, ...);
+void metricsEnd();
+void metricsAppendTiming(const char* name, const char* help, const struct TimingMetric &metric);
+void metricsAppendTimingJson(const char* name, const struct TimingMetric &metric);
 void saveConfigCallback();
 void configModeCallback(WiFiManager *myWiFiManager);
+uint32_t storeContentCrc();
+#ifdef P10_FAULTS
+void initFaults();
+void saveFaults();
+bool faultHit(uint32_t percent);
+void faultTask();
+bool faultFirebaseRequest(bool ok);
+bool faultTakeStreamDrop();
+void faultPowerCut(uint32_t addr, uint32_t* record, uint32_t size);
+void handleApiFaults();
+void handleApiFaultsPut();
+#endif
 
 // Global variables
-String displayText = "Starting P10 Display..."; // Default text
-String sentences[10]; // Array to store sentences from Firebase
+// Text arena: sentences and the shown text live in fixed buffers, nothing on the heap
+const int MAX_SENTENCES = 10;
+const int SENTENCE_CAPACITY = 240; // Bytes per sentence, longer text is cut at a UTF-8 boundary
+static_assert(SENTENCE_CAPACITY <= RENDER_MAX_CODEPOINTS, "renderStrip() shapes a whole sentence");
+
+struct Sentence {
+  uint16_t length;
+  uint32_t hash; // sentenceHash() of text, makes change checks cheap
+  char text[SENTENCE_CAPACITY + 1];
+};
+
+Sentence sentences[MAX_SENTENCES]; // Sentences from Firebase
+char displayText[SENTENCE_CAPACITY + 1] = "Starting P10 Display..."; // Default text
+uint32_t displayTextVersion = 0; // Bumped by setDisplayText(), the renderer compares this instead of the text
+int shownMessageId = -1; // Message store id on the display instead of displayText, -1 = none
 int selectedSentence = 0; // Which sentence to display
 int totalSentences = 0; // How many sentences are available
 unsigned long lastFirebaseUpdate = 0;
+long syncedVersion = -1; // /display/version of the sentences we hold, -1 = unknown
 unsigned long lastWiFiCheck = 0;
-const unsigned long firebaseUpdateInterval = 10000; // Check every 10 seconds (more responsive)
+SyncCadence syncCadence; // Wait after lastFirebaseUpdate for stream resubscribes, polls and pushes
 const unsigned long wifiCheckInterval = 5000; // Check WiFi every 5 seconds (faster reconnect)
 const unsigned long wifiReconnectTimeout = 3600000; // 1 hour = 60 minutes * 60 seconds * 1000 milliseconds
+const unsigned long wifiAttemptTimeout = 10000; // Give each reconnect attempt 10 seconds
+const unsigned long wifiRetryDelayMin = 5000; // Backoff between attempts, doubles up to the max
+const unsigned long wifiRetryDelayMax = 60000;
 bool firebaseConnected = false;
 bool shouldSaveConfig = false;
-bool wifiReconnecting = false;
 unsigned long wifiDisconnectedTime = 0;
 
+// WiFi reconnect state machine, checkWiFiConnection() only ever looks at the clock and returns
+enum WiFiState {
+  WIFI_STATE_CONNECTED,
+  WIFI_STATE_RECONNECTING, // WiFi.reconnect() issued, waiting for the link
+  WIFI_STATE_WAITING,      // Attempt failed, waiting for the backoff timer
+  WIFI_STATE_PORTAL,       // 1 hour passed, non-blocking config portal is running
+  WIFI_STATE_STARTING      // Boot, first connection with the saved credentials
+};
+int wifiState = WIFI_STATE_STARTING;
+unsigned long wifiStateTime = 0; // When the current state was entered
+unsigned long wifiRetryDelay = wifiRetryDelayMin;
+const unsigned long wifiBootTimeout = 30000; // Open the config portal if the saved network is not up by then
+
+// Boot timeline, millis() when each stage was reached (0 = not yet). The display scrolls the
+// cached text from the first frame, WiFi, SNTP and Firebase come up behind it.
+struct BootTimeline {
+  uint32_t setupStart;
+  uint32_t cacheLoaded;  // Sentences and playlist read from flash
+  uint32_t firstFrame;   // First frame on the panel, time to first content
+  uint32_t wifi;
+  uint32_t time;         // First SNTP answer
+  uint32_t firebase;     // Firebase.begin() done and ready
+  uint32_t firstSync;    // First content from Firebase applied (stream or poll)
+};
+BootTimeline bootTimeline;
+
 // Firebase streaming variables
 bool streamActive = false;
+bool streamFallbackPoll = false; // The stream did not start, poll once on the next firebaseTask() pass
+uint32_t contentUpdateUs = 0; // When a stream event or API call last changed displayText (0 = already shown)
+const unsigned long streamKeepAliveTimeout = 45000; // RTDB sends keep-alive every 30 seconds
 bool dataChanged = false;
-unsigned long lastDataSave = 0;
-const unsigned long dataSaveInterval = 5000; // Save to EEPROM every 5 seconds if changed
+const unsigned long dataSaveInterval = 5000; // Save to flash every 5 seconds if changed
+
+// Last writer wins between the local API and Firebase, by updatedAt in ms since epoch
+uint64_t contentUpdatedAt = 0; // Timestamp of the content we hold, 0 = never set
+bool localPending = false; // Local API change not written to Firebase yet
+unsigned long localPushRetryAt = 0;
+const int localPushAttempts = 3; // Content writes per push while other writers move the version on
+
+// /display documents are read with the streaming parser into the buffers above, see readDisplayJson()
+enum DisplayReadMode {
+  DISPLAY_SCAN,  // Only collect version, selectedSentence and updatedAt
+  DISPLAY_PATCH, // Apply what the document holds
+  DISPLAY_PUT    // Apply, and remove sentences and playlist the document does not hold
+};
+
+// What the last readDisplayJson() found, besides the values it applied
+struct DisplayFields {
+  long version;       // -1 = not in the document
+  int selected;       // -1 = not in the document
+  uint64_t updatedAt; // 0 = not in the document
+  uint16_t sentences; // Bit per sentence index with text
+  int hashCount;      // Leading hashes, in order
+  uint32_t hashes[MAX_SENTENCES];
+  bool playlist;      // Playlist node seen, its items went to playlistUpload
+  bool updated;       // Sentences, selection or playlist changed
+};
+DisplayFields displayFields;
 
 // Clock display variables
 bool showClock = false; // Start with scrolling text first
 unsigned long lastClockSwitch = 0;
 const unsigned long clockDisplayTime = 10000; // Show clock for 10 seconds
 bool colonBlink = true;
-unsigned long lastColonBlink = 0;
 const unsigned long colonBlinkInterval = 500; // Blink every 500ms
+bool clockNeedsRedraw = true; // Set whenever something else drew over the panel
 bool scrollCompleted = false;
 
+// Playlist items, see Playlist.h. Without an active item the display shows selectedSentence.
+PlaylistItem playlist[PLAYLIST_MAX_ITEMS];
+int playlistLength = 0;
+
+// Largest /display document: every sentence at full length, its hash, a full playlist with every
+// field of every item set, and 256 bytes for the keys, settings, version and timestamps
+const int PLAYLIST_ITEM_JSON_MAX = 128;
+const uint16_t DISPLAY_JSON_MAX = MAX_SENTENCES * (SENTENCE_CAPACITY + 3) + MAX_SENTENCES * 11 +
+                                  PLAYLIST_MAX_ITEMS * PLAYLIST_ITEM_JSON_MAX + 256;
+
+PlaylistSchedule playlistSchedule;
+int playlistCurrent = -1;        // Item on the display, -1 = showing selectedSentence
+int playlistPasses = 0;          // Scroll passes of the current item
+unsigned long playlistItemStart = 0;
+
+// Scroll speed in pixels per second, from settings/scrollSpeed in Firebase (fractions allowed)
+const float SCROLL_SPEED_DEFAULT = 11.0f; // One pixel every ~91 ms, the fixed step used before
+const float SCROLL_SPEED_MIN = 1.0f;
+const float SCROLL_SPEED_MAX = 200.0f;
+float scrollSpeed = SCROLL_SPEED_DEFAULT;
+
+ScrollClock scrollClock; // Turns the time since the last frame into whole pixels
+
+//SETUP DMD
+#define DISPLAYS_WIDE 1 // Panel Columns
+#define DISPLAYS_HIGH 1 // Panel Rows
+DMDESP Disp(DISPLAYS_WIDE, DISPLAYS_HIGH);  // Number of P10 panels used (COLUMNS, ROWS)
+
+using Panel = PanelGrid<DISPLAYS_WIDE, DISPLAYS_HIGH>;
+FrameBuffer<Panel> frame;         // Everything is drawn here, present() sends the difference to Disp
+ScrollWindow<Panel> scrollWindow; // Text band as lit, only changed columns are written
+
+// Scroll strip variables (sentence pre-rendered once, one 16-bit column per pixel, bit 0 = top row)
+// Sized for the worst case: every byte of a full sentence a code point of the widest glyph.
+// 3.75 KB of RAM, so any sentence fits and there is no per frame drawText() fallback.
+const int SCROLL_STRIP_MAX_COLUMNS = SENTENCE_CAPACITY * (GLYPH_MAX_COLUMNS + 1);
+uint16_t scrollStrip[SCROLL_STRIP_MAX_COLUMNS];
+uint32_t scrollStripWidth = 0;
+
+// Status overlay: the top message of statusQueue takes over the text band while the content
+// keeps its timing underneath, text wider than the panel scrolls through once at least.
+enum StatusTag { STATUS_TAG_WIFI = 1, STATUS_TAG_FIREBASE }; // Same tag replaces
+const int STATUS_STRIP_COLUMNS = STATUS_TEXT_MAX * 8; // Widest glyph is 7 columns plus the gap
+
+StatusQueue statusQueue;
+uint32_t statusShownSequence = 0;   // Message on the panel, 0 = none
+unsigned long statusShownAt = 0;
+bool statusOverlayActive = false;   // Content renderers do not draw while set
+bool statusScrolls = false;
+bool statusPassDone = false;        // A scrolling message stays past its TTL until this is set
+uint16_t statusStrip[STATUS_STRIP_COLUMNS];
+uint32_t statusStripWidth = 0;
+
+// Clock layout: hour tens, hour ones, colon, minute tens, minute ones
+const int CLOCK_CELLS = 5;
+const int CLOCK_Y = Panel::TEXT_Y;
+constexpr uint8_t clockDigitWidth[10] = {
+  fontCharWidth(ElektronMart6x12, '0'), fontCharWidth(ElektronMart6x12, '1'),
+  fontCharWidth(ElektronMart6x12, '2'), fontCharWidth(ElektronMart6x12, '3'),
+  fontCharWidth(ElektronMart6x12, '4'), fontCharWidth(ElektronMart6x12, '5'),
+  fontCharWidth(ElektronMart6x12, '6'), fontCharWidth(ElektronMart6x12, '7'),
+  fontCharWidth(ElektronMart6x12, '8'), fontCharWidth(ElektronMart6x12, '9')
+};
+constexpr uint8_t clockColonWidth = fontCharWidth(ElektronMart6x12, ':');
+constexpr uint8_t clockSpaceWidth = fontCharWidth(ElektronMart6x12, ' ');
+char clockCellChar[CLOCK_CELLS]; // What is on the panel now
+int clockCellX[CLOCK_CELLS];
+
 // Time zone settings (adjust for your location)
 const long gmtOffset_sec = 6 * 3600; // GMT+6 for Bangladesh (6 hours * 3600 seconds)
 const int daylightOffset_sec = 0; // No daylight saving in Bangladesh
 
-// EEPROM addresses
+// Timekeeping: the clock is kept in RTC user memory, which survives every reset except a power
+// cut, so a reboot without network still shows the right time. See lib/TimeKeeper.
+const uint32_t TIME_RTC_BLOCK = 32; // First 128 bytes of RTC user memory belong to eboot (OTA)
+
+TimeKeeper timeKeeper;
+struct tm clockLocal;         // Broken-down local time, refreshed by timeTick() once a second
+time_t clockLocalSecond = 0;  // Second clockLocal holds, 0 = clock not set
+
+// Legacy EEPROM addresses (only read once to migrate into the flash record store)
 const int EEPROM_SIZE = 1024;
 const int EEPROM_ADDR_SELECTED = 0;
 const int EEPROM_ADDR_TOTAL = 4;
 const int EEPROM_ADDR_SENTENCES = 8;
 
-//SETUP DMD
-#define DISPLAYS_WIDE 1 // Panel Columns
-#define DISPLAYS_HIGH 1 // Panel Rows
-DMDESP Disp(DISPLAYS_WIDE, DISPLAYS_HIGH);  // Number of P10 panels used (COLUMNS, ROWS)
+// Flash record store: append-only log in the last STORE_SECTORS sectors of the filesystem area.
+// Every sector starts with a sector record, the newest sector also starts with a full snapshot.
+const int STORE_SECTORS = 4;
+const uint32_t STORE_BASE = FS_PHYS_ADDR + FS_PHYS_SIZE - STORE_SECTORS * FLASH_SECTOR_SIZE;
+const uint8_t STORE_RECORD_SENTENCE = 1;
+const uint8_t STORE_RECORD_STATE = 2; // selectedSentence + totalSentences
+const uint8_t STORE_RECORD_SYNC = 3;  // StoreSyncState
+const uint8_t STORE_RECORD_PLAYLIST = 4; // PlaylistItem array
+const int STORE_MAX_SENTENCE = SENTENCE_CAPACITY; // A snapshot of all sentences must fit one sector
+
+// SDK flash calls, with the power cut fault in front of writes
+struct StoreFlash {
+  bool read(uint32_t addr, uint32_t* data, uint32_t size);
+  bool write(uint32_t addr, uint32_t* data, uint32_t size);
+  bool eraseSector(uint32_t sector);
+};
+RecordStore<StoreFlash, STORE_SECTORS, STORE_MAX_SENTENCE> store(STORE_BASE);
+uint32_t storedHashes[10]; // Hash of each sentence as last written
+int storedSelected = -1;
+int storedTotal = -1;
+
+struct StoreSyncState {
+  uint64_t updatedAt; // contentUpdatedAt
+  uint32_t pending;   // localPending, a local change survives a reboot before it reached Firebase
+  uint32_t reserved;
+};
+StoreSyncState storedSync = { 0, 0, 0 };
+uint32_t storedPlaylistCrc = 0;
+
+// Message store: long texts such as news tickers live LZ compressed on LittleFS and are decoded
+// while they scroll, so RAM use does not depend on their length. LittleFS gets the filesystem
+// area without the record store sectors at its end.
+FS messageFS(FSImplPtr(new littlefs_impl::LittleFSImpl(FS_PHYS_ADDR, FS_PHYS_SIZE - STORE_SECTORS * FLASH_SECTOR_SIZE, 
+                                                       FS_PHYS_PAGE, FS_PHYS_BLOCK, 4)));
+const int MESSAGE_MAX = 256; // Ids 0-255
+const uint32_t MESSAGE_MAX_LENGTH = 65536;
+const int MESSAGE_CHUNK = 96; // Text shaped at a time, cut after a space
+const char* const MESSAGE_DATA = "/messages.dat"; // Compressed messages, appended
+const char* const MESSAGE_INDEX = "/messages.idx"; // MessageIndexEntry per id, lookup is one seek
+const char* const MESSAGE_DATA_NEW = "/messages.dat.new"; // Compaction in progress
+const char* const MESSAGE_INDEX_NEW = "/messages.idx.new";
+
+struct MessageIndexEntry {
+  uint32_t offset;  // In MESSAGE_DATA
+  uint32_t packed;  // Compressed bytes, 0 = no message
+  uint32_t length;  // Text bytes
+  uint32_t columns; // Rendered width, known before the message scrolls
+};
+
+// Compressed bytes of one message in MESSAGE_DATA, the LZSS decoder reads them in blocks
+struct MessageInput {
+  File file;
+  uint32_t left; // Compressed bytes not read from the file yet
+  int read(uint8_t* data, int size);
+};
+
+// Decompresses one message from MESSAGE_DATA as it is read
+struct MessageReader {
+  LzssDecoder<MessageInput> lz;
+
+  bool open(int id, MessageIndexEntry &entry);
+  int read(char* out, int size);
+  void close();
+};
+
+// Sliding window of glyph columns for a stored message, filled from the reader as the text
+// scrolls. Only the visible columns and the widest glyph are kept.
+struct GlyphStream {
+  static constexpr int COLUMNS = Panel::WIDTH + 64;
+  MessageReader reader;
+  int id;
+  uint32_t width; // Columns of the whole message, from the index
+  bool active = false;
+  char text[MESSAGE_CHUNK + 1]; // Decoded text not shaped yet
+  int textLength;
+  uint32_t shaped[MESSAGE_CHUNK];
+  int shapedCount;
+  int shapedPos;
+  uint16_t ring[COLUMNS];
+  uint32_t produced; // Columns laid out so far, the newest is at (produced - 1) % COLUMNS
+
+  bool open(int messageId);
+  bool rewind() { return open(id); }
+  void close();
+  void fill(uint32_t upTo);
+  uint16_t column(uint32_t x) const { return (x < produced && produced - x <= COLUMNS) ? ring[x % COLUMNS] : 0; }
+
+private:
+  bool nextChunk();
+  void layoutGlyph();
+  void overlay(const uint16_t* glyph, int glyphWidth);
+};
+
+// Appends the compressed bytes of an upload to MESSAGE_DATA
+struct MessageOutput {
+  File file;
+  bool write(const uint8_t* data, int size) { return file.write(data, size) == (size_t)size; }
+};
+
+// Compresses an upload into MESSAGE_DATA and measures its width on the way
+struct MessageWriter {
+  LzssEncoder<MessageOutput> lz;
+  int id;
+  MessageIndexEntry entry;
+  char text[MESSAGE_CHUNK + 1];
+  int textLength;
+  bool failed;  // Flash full or write error
+  bool tooLong;
+
+  bool begin(int messageId);
+  void write(const uint8_t* data, size_t size);
+  bool finish();
+  void abort();
+
+private:
+  void measure(bool last);
+};
+
+bool messageStoreReady = false;
+uint8_t messagePresent[MESSAGE_MAX / 8]; // Bit per id, checked by the playlist without reading the index
+uint32_t messageGarbage = 0; // Bytes of replaced and deleted messages in MESSAGE_DATA
+GlyphStream glyphStream;
+MessageWriter messageWriter;
+int messageUploadStatus = 400;
+
+// Cooperative scheduler: loop() runs the task with the earliest deadline, or idles until it is due
+struct Task {
+  const char* name;
+  void (*run)();
+  uint32_t periodUs;
+  uint8_t priority; // 0 = highest, breaks ties between equal deadlines
+  uint32_t nextRun; // micros() deadline
+  uint32_t runs;
+  uint64_t totalUs;
+  uint32_t maxUs;
+};
+
+const unsigned long taskStatsInterval = 60000; // Print task run times every minute
+const uint32_t framePeriodUs = 5000; // New frame every 5 ms, one pixel per frame at SCROLL_SPEED_MAX
+
+Task tasks[] = {
+  { "scan", scanTask, 1000, 0 },
+  { "display", displayTask, framePeriodUs, 0 },
+  { "clock", clockTick, colonBlinkInterval * 1000, 1 },
+  { "time", timeTick, 250000, 1 },
+  { "wifi", checkWiFiConnection, 10000, 1 },
+  { "firebase", firebaseTask, 20000, 2 },
+  { "save", saveTask, dataSaveInterval * 1000, 3 },
+  { "web", webTask, 10000, 2 },
+  { "stats", printTaskStats, taskStatsInterval * 1000, 4 },
+  { "telemetry", telemetryTask, 1000000, 5 },
+#ifdef P10_FAULTS
+  { "faults", faultTask, 1000000, 5 },
+#endif
+};
+const int TASK_COUNT = sizeof(tasks) / sizeof(tasks[0]);
+uint8_t taskHeap[TASK_COUNT]; // Min-heap of task indices ordered by deadline, then priority
+
+// Metrics: fixed-size counters only, cheap enough to stay on in production
+struct TimingMetric {
+  uint32_t count;
+  uint64_t totalUs;
+  uint32_t maxUs;
+};
+
+// Loop iteration (one scheduler task run) histogram, bucket bounds in microseconds
+const uint32_t loopBucketsUs[] = { 100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000 };
+const int LOOP_BUCKETS = sizeof(loopBucketsUs) / sizeof(loopBucketsUs[0]);
+uint32_t loopHistogram[LOOP_BUCKETS + 1]; // Last bucket is +Inf
+TimingMetric loopMetric;
+
+TimingMetric dispLoopMetric;       // Disp.loop()
+TimingMetric firebaseUpdateMetric; // updateTextFromFirebase()
+TimingMetric saveMetric;           // saveDataToEEPROM()
+TimingMetric firebaseRequestMetric;
+TimingMetric updateToScreenMetric; // Stream event or API call until the text is rendered
+uint32_t firebaseRequestFailures = 0;
+
+// Scroll frame interval jitter against the configured step time
+uint32_t scrollFrames = 0;
+uint64_t scrollJitterTotalUs = 0;
+uint32_t scrollJitterMaxUs = 0;
+uint32_t scrollSkippedPixels = 0; // Pixels jumped over to catch up after a stall
+
+// Telemetry for /status/<chip id>: events go into a ring in RAM and are written together with
+// the window counters in one PATCH per window. It lives outside /display so the writes of a
+// whole fleet do not reach the stream of every display. While offline the ring overwrites its oldest
+// event, nothing blocks and nothing grows.
+enum TelemetryEventType {
+  TELEMETRY_BOOT,    // value = reset reason
+  TELEMETRY_WIFI,    // value = WiFiState entered
+  TELEMETRY_STREAM,  // value = 1 started, 0 lost
+  TELEMETRY_CONTENT, // value = TelemetrySource
+  TELEMETRY_TYPES
+};
+const char* const telemetryTypeNames[TELEMETRY_TYPES] = { "boot", "wifi", "stream", "content" };
+enum TelemetrySource { SOURCE_STREAM, SOURCE_POLL, SOURCE_API };
+
+struct TelemetryEvent {
+  uint32_t uptime; // Seconds since boot
+  uint8_t type;
+  int16_t value;
+};
+
+const int TELEMETRY_EVENTS = 32;
+const unsigned long TELEMETRY_WINDOW = 300000; // One write every 5 minutes, 12 per hour
+const unsigned long TELEMETRY_RETRY = 60000;   // After a failed write
+TelemetryEvent telemetryRing[TELEMETRY_EVENTS];
+int telemetryHead = 0; // Oldest event
+int telemetryCount = 0;
+uint16_t telemetryCounts[TELEMETRY_TYPES]; // Events this window, overwritten ones included
+uint32_t telemetryDropped = 0;             // Events overwritten before they were written
+char telemetryPath[16];                    // /status/ and the chip id in hex, set by initFirebase()
+uint32_t telemetryDroppedBase = 0;         // telemetryDropped and firebaseRequestFailures
+uint32_t telemetryFailureBase = 0;         // at the start of the window
+unsigned long telemetryWindowStart = 0;
+unsigned long telemetryDue = TELEMETRY_WINDOW; // millis() of the next write
+uint32_t telemetryUploads = 0;
+
+// Soak counters: leaks, flash wear and reconnect loops show up here long before the field does
+uint32_t heapMinFree = 0xFFFFFFFF;
+uint8_t heapFragmentationMax = 0; // Sampled with the task stats, it walks the heap
+uint32_t wifiDisconnects = 0;
+uint32_t streamStarts = 0;
+
+#ifdef P10_FAULTS
+// Fault injection for soak runs, build with -DP10_FAULTS and set the rates with PUT /api/faults.
+// Settings and counters live in RTC user memory after the clock, so a run carries on through
+// the restarts of injected power cuts.
+struct FaultState {
+  uint32_t magic;
+  uint32_t wifiDropSec;         // Drop the WiFi link every n seconds, 0 = off
+  uint32_t streamDropSec;       // Fail a stream read every n seconds
+  uint32_t firebaseFailPercent; // Firebase requests reported as failed
+  uint32_t firebaseDelayMs;     // Blocking delay added to every Firebase request, a slow server
+  uint32_t powerCutPercent;     // Flash records cut in half, then a restart
+  uint32_t wifiDrops;
+  uint32_t streamDrops;
+  uint32_t firebaseFailures;
+  uint32_t firebaseDelays;
+  uint32_t powerCuts;
+  uint32_t recoveries;          // Boots after a cut that found the flash content as expected
+  uint32_t recoveryErrors;
+  uint32_t expectedCrc;         // storeContentCrc() at the cut, 0 = no cut to check
+  uint32_t crc;
+  uint32_t reserved;
+};
+const uint32_t FAULT_RTC_MAGIC = 0x50314654;
+const uint32_t FAULT_RTC_BLOCK = TIME_RTC_BLOCK + sizeof(RtcTimeRecord) / 4;
+static_assert(FAULT_RTC_BLOCK * 4 + sizeof(FaultState) <= 512, "RTC user memory is 512 bytes");
+FaultState faults;
+unsigned long faultLastWifiDrop = 0;
+unsigned long faultLastStreamDrop = 0;
+bool faultStreamDropPending = false;
+#endif
+
+char metricsChunk[256]; // Response is formatted here and sent as a chunk when full, no String per sample
+int metricsPos = 0;
+uint32_t metricsOverflows = 0; // Lines longer than metricsChunk, left out of a response
 
 
 
@@ -107,30 +638,32 @@ void setup() {
   Serial.begin(115200);
   Serial.println();
   Serial.println("Starting P10 Display with WiFiManager and Firebase...");
+  bootTimeline.setupStart = millis();
 
-  // Initialize EEPROM
-  EEPROM.begin(EEPROM_SIZE);
-  
-  // Load cached data from EEPROM first
+  // Load cached data from flash first, the playlist may point into the message store
+  initMessageStore();
   loadDataFromEEPROM();
+  bootMark(bootTimeline.cacheLoaded, "cache loaded");
+#ifdef P10_FAULTS
+  initFaults();
+#endif
+  telemetryEvent(TELEMETRY_BOOT, ESP.getResetInfoPtr()->reason);
 
   // DMDESP Setup
   Disp.start(); // Start DMDESP library
   Disp.setBrightness(100); // Brightness level
   Disp.setFont(ElektronMart6x12); // Set font
+  textFont = ElektronMart6x12; // Same font for the scroll strip and frame drawing
   
-  // Show startup message
-  displayMessage("P10 Display Starting...");
-  delay(2000);
-  
-  // Initialize WiFiManager
+  // Nothing below waits for the network: the cached text scrolls from the first loop(),
+  // checkWiFiConnection() brings up WiFi, then SNTP and Firebase, in the background
+  initTimeSync();
   initWiFiManager();
   
-  // Initialize time after WiFi connection
-  initTimeSync();
+  // Metrics endpoints, they listen on every interface once WiFi is up
+  initMetricsServer();
   
-  // Initialize Firebase with hardcoded credentials
-  initFirebase();
+  initScheduler();
   
   Serial.println("Setup complete!");
 }
@@ -141,116 +674,264 @@ void setup() {
 // LOOP
 
 void loop() {
-  // Always run display refresh first - this ensures continuous display
+  runScheduler();
+}
+
+
+//--------------------------
+// SCHEDULER TASKS
+
+void scanTask() {
+  // Panel refresh only, it shows the frame displayTask() presented last
+  uint32_t dispStart = micros();
   Disp.loop(); 
+  recordTiming(dispLoopMetric, micros() - dispStart);
+}
+
+void displayTask() {
+  // Status messages go over the content, which keeps its timing but does not draw
+  statusOverlayFrame();
   
   // Handle clock/text switching based on scroll completion
   if (!showClock) {
     // Show scrolling text and check if it completed
-    bool completed = ScrollingText(0, 90);
+    bool completed = ScrollingText(scrollSpeed);
     if (completed && !scrollCompleted) {
       // Scroll just completed, switch to clock
       scrollCompleted = true;
+      playlistPasses++;
       showClock = true;
       lastClockSwitch = millis();
-      Disp.clear();
+      clockNeedsRedraw = true;
     }
   } else {
     // Show clock and check if 6 seconds passed
     if (millis() - lastClockSwitch >= clockDisplayTime) {
       showClock = false;
       scrollCompleted = false;
-      Disp.clear();
-    } else {
+      scrollWindow.invalidate();
+      scrollClock.reset();
+      
+      // The playlist moves on between two scroll passes, never in the middle of one
+      if (playlistNext()) showActiveSentence();
+    } else if (!statusOverlayActive) {
       displayDigitalClock();
     }
   }
 
-  // Check WiFi connection periodically
-  if (millis() - lastWiFiCheck > wifiCheckInterval) {
-    checkWiFiConnection();
-    lastWiFiCheck = millis();
-  }
+  // Status indicator on top of the content while WiFi is down
+  drawStatusOverlay();
+  
+  // Finished frame goes out before the next Disp.loop() scan
+  frame.present(Disp);
+  if (!bootTimeline.firstFrame && frame.presents) bootMark(bootTimeline.firstFrame, "first frame");
+}
 
+void firebaseTask() {
   // Handle Firebase stream (lightweight, non-blocking)
-  if (firebaseConnected) {
-    if (!streamActive && millis() - lastFirebaseUpdate > firebaseUpdateInterval) {
-      // Start Firebase stream
-      startFirebaseStream();
-      lastFirebaseUpdate = millis();
-    } else if (streamActive) {
-      // Handle stream events
-      handleFirebaseStream();
+  if (!firebaseConnected) return;
+  
+  // Local API changes go to Firebase first, so a poll does not bring back the old content
+  if (localPending && (long)(millis() - localPushRetryAt) >= 0) {
+    if (!pushLocalChanges()) {
+      scheduleNextSync(false);
+      localPushRetryAt = millis() + syncCadence.delay;
     }
+    return;
   }
   
-  // Save data to EEPROM if changed (background task)
-  if (dataChanged && millis() - lastDataSave > dataSaveInterval) {
-    saveDataToEEPROM();
-    dataChanged = false;
-    lastDataSave = millis();
+  if (streamFallbackPoll) {
+    // Single poll after a failed stream start, on a pass of its own so a server that does not
+    // answer holds up the panel for one request timeout, not two. The stream is retried after
+    // the next sync delay.
+    streamFallbackPoll = false;
+    uint32_t updateStart = micros();
+    bool updated = updateTextFromFirebase();
+    recordTiming(firebaseUpdateMetric, micros() - updateStart);
+    scheduleNextSync(updated);
+  } else if (!streamActive && millis() - lastFirebaseUpdate > syncCadence.delay) {
+    // Start Firebase stream, schedules the next attempt itself
+    startFirebaseStream();
+  } else if (streamActive) {
+    // Handle stream events
+    handleFirebaseStream();
+  }
+}
+
+void saveTask() {
+  // Save data to flash if changed (background task)
+  if (dataChanged) {
+    uint32_t saveStart = micros();
+    bool saved = saveDataToEEPROM();
+    recordTiming(saveMetric, micros() - saveStart);
+    if (saved) dataChanged = false; // Else retried on the next run
+  }
+}
+
+void clockTick() {
+  // Handle colon blinking
+  colonBlink = !colonBlink;
+}
+
+void printTaskStats() {
+  for (int i = 0; i < TASK_COUNT; i++) {
+    Task &task = tasks[i];
+    uint32_t avg = task.runs ? task.totalUs / task.runs : 0;
+    Serial.println("Task " + String(task.name) + ": " + String(task.runs) + " runs, avg " + 
+                  String(avg) + " us, max " + String(task.maxUs) + " us");
   }
   
-  // Small delay to prevent overwhelming the system
-  delay(1);
+  heapFragmentationMax = max(heapFragmentationMax, ESP.getHeapFragmentation());
+  Serial.printf("Soak: heap min %u, fragmentation max %u%%, flash %u bytes / %u erases, %u WiFi drop(s), %u stream start(s)\n",
+                heapMinFree, heapFragmentationMax, store.bytesWritten, store.erases, wifiDisconnects, streamStarts);
+}
+
+//--------------------------
+// COOPERATIVE SCHEDULER
+
+bool taskBefore(uint8_t a, uint8_t b) {
+  int32_t diff = tasks[a].nextRun - tasks[b].nextRun; // Wrap-safe
+  return diff < 0 || (diff == 0 && tasks[a].priority < tasks[b].priority);
+}
+
+void taskSiftDown(int i) {
+  while (true) {
+    int smallest = i;
+    int left = 2 * i + 1;
+    int right = left + 1;
+    if (left < TASK_COUNT && taskBefore(taskHeap[left], taskHeap[smallest])) smallest = left;
+    if (right < TASK_COUNT && taskBefore(taskHeap[right], taskHeap[smallest])) smallest = right;
+    if (smallest == i) return;
+    uint8_t tmp = taskHeap[i];
+    taskHeap[i] = taskHeap[smallest];
+    taskHeap[smallest] = tmp;
+    i = smallest;
+  }
+}
+
+void initScheduler() {
+  uint32_t now = micros();
+  for (int i = 0; i < TASK_COUNT; i++) {
+    tasks[i].nextRun = now + tasks[i].periodUs;
+    taskHeap[i] = i;
+  }
+  tasks[0].nextRun = now; // Scan first
+  for (int i = TASK_COUNT / 2 - 1; i >= 0; i--) {
+    taskSiftDown(i);
+  }
 }
 
+void runScheduler() {
+  Task &task = tasks[taskHeap[0]];
+  uint32_t now = micros();
+  int32_t wait = task.nextRun - now;
+  
+  if (wait > 0) {
+    // Nothing due: delay() hands the time to the SDK, which idles the CPU. It only sleeps whole
+    // milliseconds, so a shorter wait sleeps one and the task runs late, the scan by the time it
+    // takes itself. delayMicroseconds() would spin.
+    delay(max(wait / 1000, (int32_t)1));
+    return;
+  }
+  
+  task.run();
+  
+  uint32_t elapsed = micros() - now;
+  recordLoopTime(elapsed);
+  heapMinFree = min(heapMinFree, ESP.getFreeHeap());
+  task.runs++;
+  task.totalUs += elapsed;
+  if (elapsed > task.maxUs) task.maxUs = elapsed;
+  
+  // Fixed rate, but skip missed periods instead of running a burst to catch up
+  task.nextRun += task.periodUs;
+  if ((int32_t)(micros() - task.nextRun) > 0) {
+    task.nextRun = micros() + task.periodUs;
+  }
+  taskSiftDown(0);
+}
 
 //--------------------------
 // DISPLAY SCROLLING TEXT
 
-bool ScrollingText(int y, uint8_t speed) {
+bool ScrollingText(float pixelsPerSecond) {
 
-  static uint32_t pM;
   static uint32_t x;
-  static String lastDisplayText = "";
+  static uint32_t lastTextVersion = 0xFFFFFFFF;
   static bool needsRedraw = true;
+  static uint32_t textWidth = 0;
   
-  uint32_t width = Disp.width();  // 32 pixels wide
-  uint32_t height = Disp.height(); // 16 pixels high
-  Disp.setFont(ElektronMart6x12);
-  uint32_t textWidth = Disp.textWidth(displayText.c_str());
-  
-  // Start from center and scroll to the left, then wrap around to right side
-  uint32_t centerStart = width / 2; // Start from center (pixel 16)
-  uint32_t fullScroll = textWidth + width; // Total scroll distance
-  
-  // Check if text has changed
-  if (displayText != lastDisplayText) {
-    lastDisplayText = displayText;
+  // Check if text has changed - render it into the strip once instead of every frame
+  if (displayTextVersion != lastTextVersion) {
+    lastTextVersion = displayTextVersion;
+    if (shownMessageId >= 0 && glyphStream.open(shownMessageId)) {
+      // Stored message, decoded from flash while it scrolls
+      textWidth = glyphStream.width;
+    } else {
+      glyphStream.close();
+      renderScrollStrip(displayText);
+      textWidth = scrollStripWidth;
+    }
     needsRedraw = true;
     x = 0; // Reset scroll position when text changes
+    scrollClock.reset();
+    
+    if (contentUpdateUs != 0) {
+      uint32_t latencyUs = micros() - contentUpdateUs;
+      recordTiming(updateToScreenMetric, latencyUs);
+      Serial.println("Update on screen after " + String(latencyUs / 1000) + " ms");
+      contentUpdateUs = 0;
+    }
   }
   
+  // Start from center and scroll to the left, then wrap around to right side
+  uint32_t centerStart = Panel::CENTER_X;
+  uint32_t fullScroll = textWidth + Panel::WIDTH; // Total scroll distance
+  
   bool scrollComplete = false;
   
-  if((millis() - pM) > speed) { 
-    pM = millis();
-    if (x < fullScroll) {
-      ++x;
+  uint32_t stepUs = 1000000.0f / pixelsPerSecond;
+  uint32_t frameUs = micros();
+  uint32_t steps = scrollClock.advance(frameUs, pixelsPerSecond);
+  
+  if (steps > 0) {
+    // Frame interval jitter against the step time, skipped pixels count separately
+    static uint32_t lastFrameUs = 0;
+    if (lastFrameUs != 0 && steps == 1) {
+      int32_t jitter = (int32_t)(frameUs - lastFrameUs) - (int32_t)stepUs;
+      uint32_t absJitter = jitter < 0 ? -jitter : jitter;
+      scrollFrames++;
+      scrollJitterTotalUs += absJitter;
+      if (absJitter > scrollJitterMaxUs) scrollJitterMaxUs = absJitter;
+    }
+    lastFrameUs = frameUs;
+    scrollSkippedPixels += steps - 1;
+    
+    if (x + steps < fullScroll) {
+      x += steps;
     } else {
       x = 0;
-      scrollComplete = true; // One complete scroll cycle finished
+      scrollComplete = true; // One complete scroll cycle finished, a stall does not carry over
+      if (glyphStream.active) glyphStream.rewind();
     }
     needsRedraw = true;
   }
   
-  // Only clear and redraw when necessary
-  if (needsRedraw) {
-    Disp.clear();
-    
+  // The status overlay has the text band, the position above keeps moving underneath
+  if (statusOverlayActive) {
+    needsRedraw = true;
+    return scrollComplete;
+  }
+  
+  // Only redraw when necessary
+  if (needsRedraw || !scrollWindow.valid) {
     // Calculate text position: start from center, move left
     int32_t textX = centerStart - x;
     
-    // If text has moved completely off the left side, wrap it to the right side
-    if (textX + textWidth < 0) {
-      textX = width + (textX + textWidth);
+    if (glyphStream.active) {
+      glyphStream.fill(Panel::WIDTH - textX);
     }
-    
-    // Center the text vertically in the display
-    int textY = (height / 2) - 6; // Adjust for font height
-    
-    Disp.drawText(textX, textY, displayText.c_str());
+    scrollWindow.blit(frame, textX, scrollColumn);
     needsRedraw = false;
   }
   
@@ -258,491 +939,2561 @@ bool ScrollingText(int y, uint8_t speed) {
 }
 
 //--------------------------
-// DISPLAY MESSAGE HELPER
+// SCROLL STRIP RENDERING
 
-void displayMessage(String message, bool clearFirst) {
-  if (clearFirst) {
-    Disp.clear();
-  }
-  Serial.println(message);
-  
-  // Split long messages into multiple lines if needed
-  if (message.length() <= 16) {
-    Disp.drawText(0, 4, message.c_str());
-  } else {
-    // Show first part, then scroll if needed
-    Disp.drawText(0, 4, message.substring(0, 16).c_str());
-  }
+bool renderScrollStrip(const char* text) {
+  int32_t width = renderStrip(text, scrollStrip, SCROLL_STRIP_MAX_COLUMNS);
+  scrollStripWidth = max(width, (int32_t)0);
+  return width >= 0;
+}
+
+// Column of the scrolling text, from the message stream or the pre-rendered strip
+uint16_t scrollColumn(int32_t stripX) {
+  if (stripX < 0) return 0;
+  if (glyphStream.active) return glyphStream.column(stripX);
+  return (stripX < (int32_t)scrollStripWidth) ? scrollStrip[stripX] : 0;
 }
 
 //--------------------------
-// WIFIMANAGER INITIALIZATION
+// MESSAGE STORE
 
-void initWiFiManager() {
-  displayMessage("Starting WiFi Setup...");
-  
-  // Set callback for saving config
-  wm.setSaveConfigCallback(saveConfigCallback);
-  wm.setAPCallback(configModeCallback);
-  
-  // Set timeout for config portal
-  wm.setConfigPortalTimeout(300); // 5 minutes timeout
+bool initMessageStore() {
+  if (!messageFS.begin()) {
+    Serial.println("Message store: LittleFS mount failed");
+    return false;
+  }
   
-  // Try to connect to saved WiFi
-  displayMessage("Connecting to WiFi...");
+  // A compaction that was cut short: finish the renames, or drop the copy if the old files are intact
+  if (messageFS.exists(MESSAGE_DATA_NEW) && messageFS.exists(MESSAGE_INDEX_NEW)) {
+    if (messageFS.exists(MESSAGE_DATA)) {
+      messageFS.remove(MESSAGE_DATA_NEW);
+      messageFS.remove(MESSAGE_INDEX_NEW);
+    } else {
+      messageFS.rename(MESSAGE_DATA_NEW, MESSAGE_DATA);
+    }
+  }
+  if (messageFS.exists(MESSAGE_INDEX_NEW)) {
+    messageFS.remove(MESSAGE_INDEX);
+    messageFS.rename(MESSAGE_INDEX_NEW, MESSAGE_INDEX);
+  }
   
-  if (!wm.autoConnect("P10_Display_Setup")) {
-    displayMessage("Failed to connect");
-    displayMessage("Starting config portal");
-    delay(2000);
-    
-    // Start config portal
-    if (!wm.startConfigPortal("P10_Display_Setup")) {
-      displayMessage("Config timeout");
-      delay(3000);
-      ESP.restart();
+  if (!messageFS.exists(MESSAGE_INDEX)) {
+    File index = messageFS.open(MESSAGE_INDEX, "w");
+    MessageIndexEntry empty = { 0, 0, 0, 0 };
+    for (int id = 0; index && id < MESSAGE_MAX; id++) {
+      index.write((const uint8_t*)&empty, sizeof(empty));
     }
+    index.close();
   }
   
-  // If we get here, we're connected
-  displayMessage("WiFi Connected!");
-  displayMessage("IP: " + WiFi.localIP().toString());
-  delay(2000);
+  // Everything in the data file that no entry points to is garbage
+  File index = messageFS.open(MESSAGE_INDEX, "r");
+  if (!index) {
+    Serial.println("Message store: no index");
+    return false;
+  }
+  uint32_t live = 0;
+  int count = 0;
+  memset(messagePresent, 0, sizeof(messagePresent));
+  for (int id = 0; id < MESSAGE_MAX; id++) {
+    MessageIndexEntry entry;
+    if (index.read((uint8_t*)&entry, sizeof(entry)) != sizeof(entry)) break;
+    if (entry.packed == 0) continue;
+    messagePresent[id / 8] |= 1 << (id % 8);
+    live += entry.packed;
+    count++;
+  }
+  index.close();
   
-  Serial.println("WiFi connected successfully!");
-  Serial.println("IP address: " + WiFi.localIP().toString());
+  File data = messageFS.open(MESSAGE_DATA, "r");
+  messageGarbage = data ? data.size() - live : 0;
+  data.close();
+  
+  messageStoreReady = true;
+  Serial.printf("Message store: %d message(s), %u bytes, %u bytes to compact\n", count, live, messageGarbage);
+  return true;
 }
 
-//--------------------------
-// WIFIMANAGER CALLBACKS
+bool messageExists(int id) {
+  return id >= 0 && id < MESSAGE_MAX && (messagePresent[id / 8] & (1 << (id % 8)));
+}
 
-void saveConfigCallback() {
-  Serial.println("Should save config");
-  shouldSaveConfig = true;
+bool readMessageEntry(int id, MessageIndexEntry &entry) {
+  if (!messageStoreReady || id < 0 || id >= MESSAGE_MAX) return false;
+  File index = messageFS.open(MESSAGE_INDEX, "r");
+  bool ok = index && index.seek(id * sizeof(entry)) && 
+            index.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+  index.close();
+  return ok;
 }
 
-void configModeCallback(WiFiManager *myWiFiManager) {
-  displayMessage("Config Mode");
-  displayMessage("Connect to: P10_Display_Setup");
-  delay(2000);
-  displayMessage("Open: " + WiFi.softAPIP().toString());
-  Serial.println("Entered config mode");
-  Serial.println("AP IP: " + WiFi.softAPIP().toString());
+bool writeMessageEntry(int id, const MessageIndexEntry &entry) {
+  MessageIndexEntry old;
+  if (!readMessageEntry(id, old)) return false;
+  
+  File index = messageFS.open(MESSAGE_INDEX, "r+");
+  bool ok = index && index.seek(id * sizeof(entry)) && 
+            index.write((const uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+  index.close();
+  if (!ok) return false;
+  
+  messageGarbage += old.packed;
+  if (entry.packed) {
+    messagePresent[id / 8] |= 1 << (id % 8);
+  } else {
+    messagePresent[id / 8] &= ~(1 << (id % 8));
+  }
+  if (id == shownMessageId) {
+    displayTextVersion++; // Reopened, the width has changed
+  }
+  return true;
 }
 
-//--------------------------
-// WIFI CONNECTION CHECK
+bool deleteMessage(int id) {
+  if (!messageExists(id)) return true;
+  MessageIndexEntry empty = { 0, 0, 0, 0 };
+  return writeMessageEntry(id, empty);
+}
 
-void checkWiFiConnection() {
-  if (WiFi.status() != WL_CONNECTED) {
-    if (!wifiReconnecting) {
-      // First time detecting disconnection
-      wifiReconnecting = true;
-      wifiDisconnectedTime = millis();
-      displayMessage("WiFi Disconnected!");
-      firebaseConnected = false;
-      
-      Serial.println("WiFi disconnected, starting 1-hour reconnection attempts...");
-    }
-    
-    // Calculate how long we've been disconnected
-    unsigned long disconnectedDuration = millis() - wifiDisconnectedTime;
-    unsigned long remainingTime = wifiReconnectTimeout - disconnectedDuration;
-    
-    if (disconnectedDuration < wifiReconnectTimeout) {
-      // Still within 1-hour window, keep trying to reconnect
-      int minutesRemaining = remainingTime / 60000;
-      int secondsRemaining = (remainingTime % 60000) / 1000;
-      
-      displayMessage("Reconnecting WiFi...");
-      Serial.println("Attempting WiFi reconnection... Time remaining: " + 
-                    String(minutesRemaining) + "m " + String(secondsRemaining) + "s");
-      
-      // Try to reconnect to saved WiFi
-      WiFi.reconnect();
-      
-      // Wait up to 10 seconds for this reconnection attempt
-      int attempts = 0;
-      while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
-      }
-      
-      if (WiFi.status() == WL_CONNECTED) {
-        // Successful reconnection
-        displayMessage("WiFi Reconnected!");
-        Serial.println("\nWiFi reconnected successfully after " + 
-                      String(disconnectedDuration / 1000) + " seconds!");
-        delay(2000);
-        
-        // Reset flags and reinitialize Firebase
-        wifiReconnecting = false;
-        wifiDisconnectedTime = 0;
-        initFirebase();
-      } else {
-        Serial.println(" failed.");
-        // Show countdown on display
-        displayMessage("Retry in " + String(minutesRemaining) + "m " + String(secondsRemaining) + "s");
-      }
-    } else {
-      // 1 hour has passed, reset WiFi credentials and open config portal
-      Serial.println("\n1 hour reconnection timeout reached. Resetting WiFi credentials...");
-      displayMessage("WiFi Reset Required");
-      delay(2000);
-      
-      displayMessage("Clearing WiFi Settings...");
-      
-      // Clear saved WiFi credentials
-      wm.resetSettings();
-      
-      delay(2000);
-      displayMessage("Starting WiFi Setup...");
-      
-      // Reset flags
-      wifiReconnecting = false;
-      wifiDisconnectedTime = 0;
-      
-      // Start config portal with fresh settings
-      if (!wm.startConfigPortal("P10_Display_Setup")) {
-        displayMessage("Config timeout");
-        delay(3000);
-        ESP.restart();
-      } else {
-        displayMessage("WiFi Reconfigured!");
-        delay(2000);
-        initFirebase();
+// Copies the live messages into a new data file, run before an upload when the garbage
+// takes up as much flash as is still free
+bool compactMessages() {
+  Serial.printf("Compacting message store, %u bytes to drop\n", messageGarbage);
+  if (glyphStream.active) {
+    glyphStream.close();
+    displayTextVersion++; // Reopened at its new offset
+  }
+  
+  File oldData = messageFS.open(MESSAGE_DATA, "r");
+  File oldIndex = messageFS.open(MESSAGE_INDEX, "r");
+  File newData = messageFS.open(MESSAGE_DATA_NEW, "w");
+  File newIndex = messageFS.open(MESSAGE_INDEX_NEW, "w");
+  bool ok = oldData && oldIndex && newData && newIndex;
+  
+  uint8_t buffer[128];
+  uint32_t offset = 0;
+  for (int id = 0; ok && id < MESSAGE_MAX; id++) {
+    MessageIndexEntry entry;
+    ok = oldIndex.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+    if (ok && entry.packed) {
+      ok = oldData.seek(entry.offset);
+      for (uint32_t copied = 0; ok && copied < entry.packed; ) {
+        size_t size = min<uint32_t>(sizeof(buffer), entry.packed - copied);
+        ok = oldData.read(buffer, size) == size && newData.write(buffer, size) == size;
+        copied += size;
       }
+      entry.offset = offset;
+      offset += entry.packed;
     }
-  } else {
-    // WiFi is connected, ensure reconnecting flags are cleared
-    if (wifiReconnecting) {
-      wifiReconnecting = false;
-      wifiDisconnectedTime = 0;
-    }
+    ok = ok && newIndex.write((const uint8_t*)&entry, sizeof(entry)) == sizeof(entry);
+    if (id % 16 == 0) yield();
   }
+  oldData.close();
+  oldIndex.close();
+  newData.close();
+  newIndex.close();
+  
+  if (!ok) {
+    messageFS.remove(MESSAGE_DATA_NEW);
+    messageFS.remove(MESSAGE_INDEX_NEW);
+    Serial.println("Message store compaction failed");
+    return false;
+  }
+  
+  // Same order as initMessageStore() expects after a power cut
+  messageFS.remove(MESSAGE_DATA);
+  messageFS.rename(MESSAGE_DATA_NEW, MESSAGE_DATA);
+  messageFS.remove(MESSAGE_INDEX);
+  messageFS.rename(MESSAGE_INDEX_NEW, MESSAGE_INDEX);
+  messageGarbage = 0;
+  return true;
 }
 
-//--------------------------
-// FIREBASE INITIALIZATION
+// Where to cut text so shaping never splits a word: after the last space, else before a
+// UTF-8 lead byte. The last piece of a message is taken whole.
+int messageChunkEnd(const char* text, int length, bool last) {
+  if (last) return length;
+  for (int i = length; i > 0; i--) {
+    if (text[i - 1] == ' ') return i;
+  }
+  for (int i = length - 1; i > 0; i--) {
+    if (((uint8_t)text[i] & 0xC0) != 0x80) return i;
+  }
+  return length;
+}
 
-void initFirebase() {
-  displayMessage("Connecting Firebase...");
+// Width of a piece of text as the glyph stream lays it out, columns is the width so far
+uint32_t textColumns(const char* text, uint32_t columns) {
+  static uint32_t shaped[MESSAGE_CHUNK];
+  uint16_t glyph[32];
+  uint8_t flags;
   
-  if (firebase_host.length() == 0 || firebase_auth.length() == 0) {
-    displayMessage("Firebase not configured");
-    displayText = "Use WiFi portal to set Firebase";
-    return;
+  int count = shapeText(text, shaped, MESSAGE_CHUNK);
+  for (int i = 0; i < count; i++) {
+    if (isZeroWidth(shaped[i])) continue;
+    int glyphWidth = glyphColumns(shaped[i], glyph, flags);
+    if (glyphWidth <= 0 || ((flags & ATLAS_OVERLAY) && columns > 0)) continue;
+    columns += glyphWidth + 1;
   }
+  return columns;
+}
+
+bool MessageReader::open(int id, MessageIndexEntry &entry) {
+  close();
+  if (!readMessageEntry(id, entry) || entry.packed == 0) return false;
   
-  // Configure Firebase - store in persistent strings
-  firebase_url = "https://" + firebase_host;
-  config.database_url = firebase_url.c_str();
-  config.signer.tokens.legacy_token = firebase_auth.c_str();
-  
-  // Initialize Firebase
-  Firebase.begin(&config, &auth);
-  Firebase.reconnectWiFi(true);
+  File &file = lz.input.file;
+  file = messageFS.open(MESSAGE_DATA, "r");
+  if (!file || !file.seek(entry.offset)) {
+    close();
+    return false;
+  }
+  lz.input.left = entry.packed;
+  lz.begin(entry.length);
+  return true;
+}
+
+void MessageReader::close() {
+  if (lz.input.file) lz.input.file.close();
+  lz.remaining = 0;
+}
+
+int MessageInput::read(uint8_t* data, int size) {
+  if (left == 0) return 0;
+  int count = file.read(data, min<uint32_t>(size, left));
+  left -= count;
+  return count;
+}
+
+// Up to size text bytes, fewer only at the end of the message
+int MessageReader::read(char* out, int size) {
+  int count = lz.read(out, size);
+  if (count < size && lz.remaining > 0) {
+    Serial.println("Message data ends early, text cut");
+    lz.remaining = 0;
+  }
+  return count;
+}
+
+bool GlyphStream::open(int messageId) {
+  MessageIndexEntry entry;
+  active = reader.open(messageId, entry);
+  if (!active) return false;
   
-  // Test connection
-  if (Firebase.ready()) {
-    firebaseConnected = true;
-    displayMessage("Firebase Connected!");
-    Serial.println("Firebase initialized successfully");
-    
-    // Load initial data
-    updateTextFromFirebase();
-  } else {
-    firebaseConnected = false;
-    displayMessage("Firebase Failed!");
-    displayText = "Check Firebase credentials";
-    Serial.println("Firebase connection failed");
+  id = messageId;
+  width = entry.columns;
+  textLength = 0;
+  shapedCount = 0;
+  shapedPos = 0;
+  produced = 0;
+  return true;
+}
+
+void GlyphStream::close() {
+  reader.close();
+  active = false;
+}
+
+// Lays out glyphs until column upTo - 1 exists or the message ends
+void GlyphStream::fill(uint32_t upTo) {
+  while (active && produced < upTo) {
+    if (shapedPos == shapedCount && !nextChunk()) break;
+    if (shapedPos < shapedCount) layoutGlyph();
   }
+}
+
+bool GlyphStream::nextChunk() {
+  textLength += reader.read(text + textLength, MESSAGE_CHUNK - textLength);
+  if (textLength == 0) return false;
   
-  delay(2000);
+  int cut = messageChunkEnd(text, textLength, reader.lz.remaining == 0);
+  char next = text[cut];
+  text[cut] = '\0';
+  shapedCount = max(shapeText(text, shaped, MESSAGE_CHUNK), 0);
+  shapedPos = 0;
+  text[cut] = next;
+  
+  memmove(text, text + cut, textLength - cut);
+  textLength -= cut;
+  return true;
 }
 
-//--------------------------
-// EEPROM DATA MANAGEMENT
+// Marks are right aligned over the previous glyph, skipping its trailing gap
+void GlyphStream::overlay(const uint16_t* glyph, int glyphWidth) {
+  uint32_t end = produced - 1;
+  uint32_t start = (end > (uint32_t)glyphWidth) ? end - glyphWidth : 0;
+  for (int j = 0; j < glyphWidth; j++) {
+    ring[(start + j) % COLUMNS] |= glyph[j];
+  }
+}
 
-void saveDataToEEPROM() {
-  Serial.println("Saving data to EEPROM...");
+// Next glyph with the marks that follow it, so a glyph is complete before it is shown
+void GlyphStream::layoutGlyph() {
+  uint16_t glyph[32];
+  uint8_t flags;
   
-  // Save selected sentence
-  EEPROM.put(EEPROM_ADDR_SELECTED, selectedSentence);
+  uint32_t cp = shaped[shapedPos++];
+  int glyphWidth = isZeroWidth(cp) ? 0 : glyphColumns(cp, glyph, flags);
+  if (glyphWidth <= 0) return;
+  if ((flags & ATLAS_OVERLAY) && produced > 0) {
+    overlay(glyph, glyphWidth);
+    return;
+  }
   
-  // Save total sentences
-  EEPROM.put(EEPROM_ADDR_TOTAL, totalSentences);
+  for (int j = 0; j < glyphWidth; j++) {
+    ring[produced++ % COLUMNS] = glyph[j];
+  }
+  ring[produced++ % COLUMNS] = 0; // 1 pixel gap between characters
   
-  // Save sentences (each sentence max 80 chars)
-  int addr = EEPROM_ADDR_SENTENCES;
-  for (int i = 0; i < totalSentences && i < 10; i++) {
-    String sentence = sentences[i];
-    if (sentence.length() > 80) sentence = sentence.substring(0, 80);
-    
-    // Save length first
-    uint8_t len = sentence.length();
-    EEPROM.put(addr, len);
-    addr += sizeof(uint8_t);
-    
-    // Save string data
-    for (int j = 0; j < len; j++) {
-      EEPROM.put(addr + j, sentence[j]);
+  while (shapedPos < shapedCount) {
+    cp = shaped[shapedPos];
+    if (isZeroWidth(cp)) {
+      shapedPos++;
+      continue;
     }
-    addr += 80; // Fixed space per sentence
+    glyphWidth = glyphColumns(cp, glyph, flags);
+    if (glyphWidth <= 0 || !(flags & ATLAS_OVERLAY)) break;
+    overlay(glyph, glyphWidth);
+    shapedPos++;
   }
-  
-  EEPROM.commit();
-  Serial.println("Data saved to EEPROM");
 }
 
-void loadDataFromEEPROM() {
-  Serial.println("Loading data from EEPROM...");
+bool MessageWriter::begin(int messageId) {
+  if (!messageStoreReady) return false;
   
-  // Load selected sentence
-  EEPROM.get(EEPROM_ADDR_SELECTED, selectedSentence);
+  FSInfo info;
+  if (messageGarbage > 0 && messageFS.info(info) && messageGarbage >= info.totalBytes - info.usedBytes) {
+    compactMessages();
+  }
   
-  // Load total sentences
-  EEPROM.get(EEPROM_ADDR_TOTAL, totalSentences);
+  File &file = lz.output.file;
+  file = messageFS.open(MESSAGE_DATA, "a");
+  if (!file) return false;
+  id = messageId;
+  entry = { (uint32_t)file.size(), 0, 0, 0 };
+  lz.begin();
+  textLength = 0;
+  failed = false;
+  tooLong = false;
+  return true;
+}
+
+void MessageWriter::write(const uint8_t* data, size_t size) {
+  for (size_t i = 0; i < size && !failed; i++) {
+    if (entry.length == MESSAGE_MAX_LENGTH) {
+      tooLong = true;
+      failed = true;
+      break;
+    }
+    entry.length++;
+    
+    lz.put(data[i]);
+    failed = lz.failed;
+    text[textLength++] = data[i];
+    if (textLength == MESSAGE_CHUNK) measure(false);
+  }
+}
+
+// Same cuts as GlyphStream::nextChunk(), so the width matches what will scroll
+void MessageWriter::measure(bool last) {
+  int cut = messageChunkEnd(text, textLength, last);
+  char next = text[cut];
+  text[cut] = '\0';
+  entry.columns = textColumns(text, entry.columns);
+  text[cut] = next;
+  
+  memmove(text, text + cut, textLength - cut);
+  textLength -= cut;
+}
+
+// Writes the index entry, an empty text deletes the message
+bool MessageWriter::finish() {
+  if (!failed && !lz.finish()) failed = true;
+  entry.packed = lz.packed;
+  while (textLength > 0 && !failed) measure(true);
+  
+  if (failed) {
+    abort();
+    return false;
+  }
+  lz.output.file.close();
+  
+  if (entry.length == 0) return deleteMessage(id);
+  return writeMessageEntry(id, entry);
+}
+
+// Drops what was appended, the data file ends where it did before
+void MessageWriter::abort() {
+  File &file = lz.output.file;
+  if (!file) return;
+  file.truncate(entry.offset);
+  file.close();
+}
+
+//--------------------------
+// STATUS MESSAGES
+
+// Queues a notice and returns at once, displayTask() shows it
+void postStatus(const char* text, uint8_t priority, uint32_t ttlMs, uint8_t tag) {
+  Serial.println(text);
+  statusQueue.post(text, priority, ttlMs, tag, millis());
+}
+
+// Called once per frame before the content is drawn. Drops expired messages and draws the
+// top one over the text band through scrollWindow, so only changed columns are written.
+void statusOverlayFrame() {
+  unsigned long now = millis();
+  
+  // A scrolling message stays until it went through once
+  const StatusMessage *m = statusQueue.top(now, (statusScrolls && !statusPassDone) ? statusShownSequence : 0);
+  if (!m) {
+    if (statusOverlayActive) {
+      // Content takes the band back with a full redraw
+      statusOverlayActive = false;
+      statusShownSequence = 0;
+      scrollWindow.invalidate();
+      clockNeedsRedraw = true;
+    }
+    return;
+  }
+  
+  if (m->sequence != statusShownSequence) {
+    if (!statusOverlayActive) scrollWindow.invalidate(); // The clock does not draw through it
+    statusOverlayActive = true;
+    statusShownSequence = m->sequence;
+    statusShownAt = now;
+    statusPassDone = false;
+    statusStripWidth = max(renderStrip(m->text, statusStrip, STATUS_STRIP_COLUMNS), (int32_t)0);
+    statusScrolls = statusStripWidth > (uint32_t)Panel::WIDTH;
+  }
+  
+  int32_t textX = (Panel::WIDTH - (int32_t)statusStripWidth) / 2;
+  if (statusScrolls) {
+    // Starts at the left edge so the first words are readable at once, then wraps in from the right
+    uint32_t travel = statusStripWidth + Panel::WIDTH;
+    uint32_t moved = (uint32_t)((now - statusShownAt) * scrollSpeed / 1000) + Panel::WIDTH;
+    if (moved >= travel) statusPassDone = true;
+    textX = Panel::WIDTH - (int32_t)(moved % travel);
+  }
+  scrollWindow.blit(frame, textX, statusColumn);
+}
+
+uint16_t statusColumn(int32_t stripX) {
+  return (stripX >= 0 && stripX < (int32_t)statusStripWidth) ? statusStrip[stripX] : 0;
+}
+
+//--------------------------
+// WIFIMANAGER INITIALIZATION
+
+void initWiFiManager() {
+  // Set callback for saving config
+  wm.setSaveConfigCallback(saveConfigCallback);
+  wm.setAPCallback(configModeCallback);
+  
+  // Set timeout for config portal
+  wm.setConfigPortalTimeout(300); // 5 minutes timeout
+  wm.setConfigPortalBlocking(false);
+  
+  // Connect with the saved credentials and return, WIFI_STATE_STARTING in
+  // checkWiFiConnection() waits for the link or opens the portal
+  Serial.println("Connecting to saved WiFi...");
+  WiFi.mode(WIFI_STA);
+  WiFi.begin();
+  setWiFiState(WIFI_STATE_STARTING);
+}
+
+//--------------------------
+// WIFIMANAGER CALLBACKS
+
+void saveConfigCallback() {
+  Serial.println("Should save config");
+  shouldSaveConfig = true;
+}
+
+void configModeCallback(WiFiManager *myWiFiManager) {
+  // No delay here, the portal can be opened from loop() while the display runs
+  postStatus(("Setup: WiFi P10_Display_Setup, " + WiFi.softAPIP().toString()).c_str(), STATUS_ALERT, 300000, STATUS_TAG_WIFI);
+  Serial.println("Connect to: P10_Display_Setup");
+  Serial.println("Entered config mode");
+  Serial.println("AP IP: " + WiFi.softAPIP().toString());
+}
+
+//--------------------------
+// WIFI CONNECTION CHECK
+
+void checkWiFiConnection() {
+  unsigned long now = millis();
+  
+  switch (wifiState) {
+    case WIFI_STATE_CONNECTED:
+      if (now - lastWiFiCheck < wifiCheckInterval) return;
+      lastWiFiCheck = now;
+      if (WiFi.status() == WL_CONNECTED) return;
+      
+      // First time detecting disconnection
+      wifiDisconnects++;
+      wifiDisconnectedTime = now;
+      wifiRetryDelay = wifiRetryDelayMin;
+      firebaseConnected = false;
+      Firebase.RTDB.endStream(&stream); // Frees the TLS session, the stream restarts after the reconnect
+      streamActive = false;
+      Serial.println("WiFi disconnected, starting 1-hour reconnection attempts...");
+      postStatus("Reconnecting WiFi...", STATUS_WARNING, 10000, STATUS_TAG_WIFI);
+      
+      WiFi.reconnect();
+      setWiFiState(WIFI_STATE_RECONNECTING);
+      break;
+      
+    case WIFI_STATE_RECONNECTING:
+      if (WiFi.status() == WL_CONNECTED) {
+        onWiFiReconnected();
+      } else if (now - wifiStateTime >= wifiAttemptTimeout) {
+        Serial.println("WiFi reconnect attempt failed, next in " + String(wifiRetryDelay / 1000) + "s");
+        setWiFiState(WIFI_STATE_WAITING);
+      }
+      break;
+      
+    case WIFI_STATE_WAITING:
+      if (WiFi.status() == WL_CONNECTED) {
+        // The SDK can also reconnect on its own
+        onWiFiReconnected();
+      } else if (now - wifiDisconnectedTime >= wifiReconnectTimeout) {
+        // 1 hour has passed, reset WiFi credentials and open config portal
+        Serial.println("1 hour reconnection timeout reached. Resetting WiFi credentials...");
+        wm.resetSettings();
+        
+        // Portal runs from loop() through wm.process() so the display keeps going.
+        // It brings its own web server on port 80.
+        server.stop();
+        wm.setConfigPortalBlocking(false);
+        wm.startConfigPortal("P10_Display_Setup");
+        setWiFiState(WIFI_STATE_PORTAL);
+      } else if (now - wifiStateTime >= wifiRetryDelay) {
+        unsigned long remainingTime = wifiReconnectTimeout - (now - wifiDisconnectedTime);
+        Serial.println("Attempting WiFi reconnection... Time remaining: " + 
+                      String(remainingTime / 60000) + "m " + String((remainingTime % 60000) / 1000) + "s");
+        
+        wifiRetryDelay = min(wifiRetryDelay * 2, wifiRetryDelayMax);
+        WiFi.reconnect();
+        setWiFiState(WIFI_STATE_RECONNECTING);
+      }
+      break;
+      
+    case WIFI_STATE_STARTING:
+      if (WiFi.status() == WL_CONNECTED) {
+        onWiFiConnected();
+      } else if (!wm.getWiFiIsSaved() || now - wifiStateTime >= wifiBootTimeout) {
+        // First setup, or the saved network is not around. Same portal as after the
+        // 1 hour timeout, but the credentials stay in case the network comes back.
+        Serial.println("No WiFi at boot, starting config portal");
+        server.stop();
+        wm.startConfigPortal("P10_Display_Setup");
+        setWiFiState(WIFI_STATE_PORTAL);
+      }
+      break;
+      
+    case WIFI_STATE_PORTAL:
+      if (wm.process()) {
+        Serial.println("WiFi reconfigured!");
+        onWiFiReconnected();
+      } else if (!wm.getConfigPortalActive()) {
+        Serial.println("Config timeout, restarting");
+        ESP.restart();
+      }
+      break;
+  }
+}
+
+void setWiFiState(int state) {
+  // WAITING is only the pause between two reconnect attempts
+  if (state != wifiState && state != WIFI_STATE_WAITING) {
+    telemetryEvent(TELEMETRY_WIFI, state);
+  }
+  wifiState = state;
+  wifiStateTime = millis();
+}
+
+void onWiFiReconnected() {
+  if (wifiDisconnectedTime) {
+    Serial.println("WiFi reconnected successfully after " + 
+                  String((millis() - wifiDisconnectedTime) / 1000) + " seconds!");
+  }
+  postStatus(("WiFi connected " + WiFi.localIP().toString()).c_str(), STATUS_INFO, 5000, STATUS_TAG_WIFI);
+  
+  // Reset flags and reinitialize Firebase
+  wifiDisconnectedTime = 0;
+  server.begin(); // Stopped while the config portal was open
+  onWiFiConnected();
+}
+
+void onWiFiConnected() {
+  setWiFiState(WIFI_STATE_CONNECTED);
+  lastWiFiCheck = millis();
+  bootMark(bootTimeline.wifi, "WiFi connected");
+  Serial.println("IP address: " + WiFi.localIP().toString());
+  
+  // SNTP was configured in setup() and answers on its own, see onTimeSet()
+  initFirebase();
+}
+
+//--------------------------
+// BOOT TIMELINE
+
+// Records the first time a stage is reached, later reconnects do not move it
+void bootMark(uint32_t &stage, const char* name) {
+  if (stage) return;
+  stage = millis();
+  if (!stage) stage = 1;
+  Serial.printf("Boot: %s at %u ms\n", name, stage);
+  
+  if (&stage == &bootTimeline.firstSync) printBootTimeline();
+}
+
+void printBootTimeline() {
+  Serial.printf("Boot timeline (ms): setup %u, cache %u, first frame %u, wifi %u, time %u, firebase %u, first sync %u\n",
+                bootTimeline.setupStart, bootTimeline.cacheLoaded, bootTimeline.firstFrame, bootTimeline.wifi,
+                bootTimeline.time, bootTimeline.firebase, bootTimeline.firstSync);
+}
+
+//--------------------------
+// STATUS OVERLAY
+
+// 2x2 dot in the top right corner, blinks while reconnecting and stays on while the portal is open.
+// Rows 0-1 are not used by the text or the clock, so the dot clears its own pixels.
+void drawStatusOverlay() {
+  bool on = (wifiState == WIFI_STATE_PORTAL) || 
+            (wifiState != WIFI_STATE_CONNECTED && (millis() / 500) % 2 == 0);
+  
+  int x = Panel::WIDTH - 2;
+  frame.setPixel(x, 0, on);
+  frame.setPixel(x + 1, 0, on);
+  frame.setPixel(x, 1, on);
+  frame.setPixel(x + 1, 1, on);
+}
+
+//--------------------------
+// FIREBASE INITIALIZATION
+
+void initFirebase() {
+  Serial.println("Connecting Firebase...");
+  
+  if (firebase_host.length() == 0 || firebase_auth.length() == 0) {
+    postStatus("Firebase not configured, use the WiFi portal", STATUS_WARNING, 10000, STATUS_TAG_FIREBASE);
+    // Cached sentences keep scrolling, the hint only replaces a placeholder
+    if (showingPlaceholder()) setDisplayText("Use WiFi portal to set Firebase");
+    return;
+  }
+  
+  // Configure Firebase - store in persistent strings
+  firebase_url = "https://" + firebase_host;
+  config.database_url = firebase_url.c_str();
+  config.signer.tokens.legacy_token = firebase_auth.c_str();
+  
+  // Stream keep-alive handling, the library reconnects the stream when it times out
+  config.timeout.rtdbKeepAlive = streamKeepAliveTimeout;
+  config.timeout.rtdbStreamReconnect = 1000;
+  
+  // Smaller BearSSL buffers for the stream connection, two TLS sessions must fit in RAM
+  stream.setBSSLBufferSize(2048, 512);
+  
+  // Room for the whole /display node, read in one response by syncFullDisplay() and sent as
+  // the first put when the stream starts
+  fbdo.setResponseSize(DISPLAY_JSON_MAX);
+  stream.setResponseSize(DISPLAY_JSON_MAX);
+  snprintf(telemetryPath, sizeof(telemetryPath), "/status/%06x", ESP.getChipId());
+  
+  // Initialize Firebase
+  Firebase.begin(&config, &auth);
+  Firebase.reconnectWiFi(true);
+  
+  // Test connection
+  if (Firebase.ready()) {
+    firebaseConnected = true;
+    bootMark(bootTimeline.firebase, "Firebase ready");
+    Serial.println("Firebase initialized successfully");
+    
+    // No fetch here: firebaseTask() opens the stream on its next run and the first
+    // event carries the whole /display node (it falls back to a poll by itself)
+    syncCadence.delay = 0;
+    lastFirebaseUpdate = millis();
+  } else {
+    firebaseConnected = false;
+    if (showingPlaceholder()) setDisplayText("Check Firebase credentials");
+    postStatus("Firebase connection failed", STATUS_WARNING, 10000, STATUS_TAG_FIREBASE);
+  }
+}
+
+//--------------------------
+// FLASH RECORD STORE
+
+// Only changed sentences are appended, a sector is erased when the log wraps around to it.
+// Returns false if a write failed, what was not written is tried again on the next save.
+bool saveDataToEEPROM() {
+  Serial.println("Saving data to flash...");
+  
+  int32_t state[2] = { selectedSentence, totalSentences };
+  bool stateChanged = (selectedSentence != storedSelected || totalSentences != storedTotal);
+  StoreSyncState sync = { contentUpdatedAt, localPending, 0 };
+  bool syncChanged = (sync.updatedAt != storedSync.updatedAt || sync.pending != storedSync.pending);
+  uint16_t playlistBytes = playlistLength * sizeof(PlaylistItem);
+  uint32_t playlistCrc = crc32(playlist, playlistBytes);
+  bool playlistChanged = (playlistCrc != storedPlaylistCrc);
+  
+  // Work out how much has to be written
+  uint32_t needed = stateChanged ? store.recordSize(sizeof(state)) : 0;
+  needed += syncChanged ? store.recordSize(sizeof(sync)) : 0;
+  needed += playlistChanged ? store.recordSize(playlistBytes) : 0;
+  int changed = 0;
+  for (int i = 0; i < totalSentences && i < 10; i++) {
+    if (sentences[i].hash != storedHashes[i]) {
+      needed += store.recordSize(sentences[i].length);
+      changed++;
+    }
+  }
+  
+  if (needed == 0) {
+    Serial.println("Nothing changed, flash not written");
+    return true;
+  }
+  
+  if (FS_PHYS_SIZE < STORE_SECTORS * FLASH_SECTOR_SIZE) return true; // No store, nothing to retry
+  
+  if (!store.fits(needed)) {
+    // Next sector gets a full snapshot, which includes this change
+    return storeRotate();
+  }
+  
+  for (int i = 0; i < totalSentences && i < 10; i++) {
+    if (sentences[i].hash != storedHashes[i]) {
+      if (!storeAppend(STORE_RECORD_SENTENCE, i, sentences[i].text, sentences[i].length)) return false;
+      storedHashes[i] = sentences[i].hash;
+    }
+  }
+  
+  if (stateChanged) {
+    if (!storeAppend(STORE_RECORD_STATE, 0, state, sizeof(state))) return false;
+    storedSelected = selectedSentence;
+    storedTotal = totalSentences;
+  }
+  
+  if (syncChanged) {
+    if (!storeAppend(STORE_RECORD_SYNC, 0, &sync, sizeof(sync))) return false;
+    storedSync = sync;
+  }
+  
+  if (playlistChanged) {
+    if (!storeAppend(STORE_RECORD_PLAYLIST, 0, playlist, playlistBytes)) return false;
+    storedPlaylistCrc = playlistCrc;
+  }
+  
+  Serial.printf("Data saved to flash: %d sentence(s), sector %d offset %u\n", changed, store.sector, store.offset);
+  return true;
+}
+
+void loadDataFromEEPROM() {
+  Serial.println("Loading data from flash...");
+  
+  if (FS_PHYS_SIZE < STORE_SECTORS * FLASH_SECTOR_SIZE) {
+    Serial.println("No filesystem area for the record store, check board_build.ldscript");
+    setDisplayText("Loading from Firebase...");
+    return;
+  }
+  
+  // Replay sectors oldest first, later records win
+  bool found = store.load([](const RecordHeader &header, const uint8_t* payload) {
+    if (header.type == STORE_RECORD_SENTENCE && header.index < 10) {
+      writeSentence(header.index, (const char*)payload, header.length);
+    } else if (header.type == STORE_RECORD_STATE && header.length == 2 * sizeof(int32_t)) {
+      int32_t state[2];
+      memcpy(state, payload, sizeof(state));
+      selectedSentence = state[0];
+      totalSentences = state[1];
+    } else if (header.type == STORE_RECORD_SYNC && header.length == sizeof(StoreSyncState)) {
+      memcpy(&storedSync, payload, sizeof(storedSync));
+      contentUpdatedAt = storedSync.updatedAt;
+      localPending = storedSync.pending;
+    } else if (header.type == STORE_RECORD_PLAYLIST && header.length % sizeof(PlaylistItem) == 0 && 
+               header.length <= sizeof(playlist)) {
+      memcpy(playlist, payload, header.length);
+      playlistLength = header.length / sizeof(PlaylistItem);
+    }
+  });
+  if (store.torn) {
+    Serial.println("Torn record in flash sector " + String(store.sector) + ", moving on");
+  }
+  
+  if (!found) {
+    // First boot with the record store, take over the old EEPROM content
+    loadLegacyEEPROM();
+  }
   
   // Validate data
   if (selectedSentence < 0 || selectedSentence > 9) selectedSentence = 0;
   if (totalSentences < 0 || totalSentences > 10) totalSentences = 0;
   
-  // Load sentences
-  int addr = EEPROM_ADDR_SENTENCES;
-  for (int i = 0; i < totalSentences && i < 10; i++) {
-    // Load length
-    uint8_t len;
-    EEPROM.get(addr, len);
-    addr += sizeof(uint8_t);
-    
-    if (len > 80) len = 80; // Safety check
-    
-    // Load string data
-    char buffer[81];
-    for (int j = 0; j < len; j++) {
-      EEPROM.get(addr + j, buffer[j]);
+  // Remember what is in flash so only changes get written
+  for (int i = 0; i < 10; i++) {
+    storedHashes[i] = found ? sentences[i].hash : 0;
+  }
+  storedSelected = found ? selectedSentence : -1;
+  storedTotal = found ? totalSentences : -1;
+  storedPlaylistCrc = crc32(playlist, playlistLength * sizeof(PlaylistItem));
+  if (!found && totalSentences > 0) {
+    dataChanged = true;
+  }
+  
+  // The clock is not set yet, so only playlist items without a window can start
+  compilePlaylist();
+  playlistNext();
+  
+  // Set initial display text from cached data
+  if (activeMessage() >= 0 || (totalSentences > 0 && activeSentence() < totalSentences)) {
+    showActiveSentence();
+    Serial.printf("Loaded cached display text: %s\n", displayText);
+  } else if (totalSentences > 0) {
+    setDisplayText(sentences[0].text);
+    selectedSentence = 0;
+    Serial.printf("Using first cached sentence: %s\n", displayText);
+  } else {
+    setDisplayText("Loading from Firebase...");
+    Serial.println("No cached data found, will load from Firebase");
+  }
+  
+  Serial.println("Loaded " + String(totalSentences) + " sentences from flash");
+}
+
+void loadLegacyEEPROM() {
+  Serial.println("No flash records, reading old EEPROM layout...");
+  
+  EEPROM.begin(EEPROM_SIZE);
+  EEPROM.get(EEPROM_ADDR_SELECTED, selectedSentence);
+  EEPROM.get(EEPROM_ADDR_TOTAL, totalSentences);
+  if (selectedSentence < 0 || selectedSentence > 9) selectedSentence = 0;
+  if (totalSentences < 0 || totalSentences > 10) totalSentences = 0;
+  
+  // 10 x (1 length byte + 80 fixed bytes)
+  int addr = EEPROM_ADDR_SENTENCES;
+  for (int i = 0; i < totalSentences; i++) {
+    uint8_t len;
+    EEPROM.get(addr, len);
+    addr += sizeof(uint8_t);
+    
+    if (len > 80) len = 80; // Safety check
+    
+    char buffer[80];
+    for (int j = 0; j < len; j++) {
+      EEPROM.get(addr + j, buffer[j]);
+    }
+    writeSentence(i, buffer, len);
+    
+    addr += 80; // Fixed space per sentence
+  }
+  EEPROM.end();
+}
+
+bool storeAppend(uint8_t type, uint8_t index, const void* payload, uint16_t length) {
+  if (!store.append(type, index, payload, length)) {
+    Serial.println("Flash write failed");
+    return false;
+  }
+  return true;
+}
+
+bool StoreFlash::read(uint32_t addr, uint32_t* data, uint32_t size) {
+  return ESP.flashRead(addr, data, size);
+}
+
+bool StoreFlash::write(uint32_t addr, uint32_t* data, uint32_t size) {
+#ifdef P10_FAULTS
+  if (faultHit(faults.powerCutPercent)) faultPowerCut(addr, data, size);
+#endif
+  return ESP.flashWrite(addr, data, size);
+}
+
+bool StoreFlash::eraseSector(uint32_t sector) {
+  return ESP.flashEraseSector(sector);
+}
+
+// What the record store holds according to the stored* copies, the same after a reload
+uint32_t storeContentCrc() {
+  int32_t state[2] = { storedSelected, storedTotal };
+  uint32_t crc = crc32(state, sizeof(state));
+  crc = crc32(storedHashes, constrain(storedTotal, 0, 10) * sizeof(uint32_t), crc);
+  crc = crc32(&storedSync.updatedAt, sizeof(storedSync.updatedAt), crc);
+  return crc32(&storedPlaylistCrc, sizeof(storedPlaylistCrc), crc);
+}
+
+// Erase the next sector in the ring and write a full snapshot into it
+bool storeRotate() {
+  if (!store.rotate()) {
+    Serial.println("Flash erase or write failed");
+    return false;
+  }
+  
+  for (int i = 0; i < totalSentences && i < 10; i++) {
+    if (!storeAppend(STORE_RECORD_SENTENCE, i, sentences[i].text, sentences[i].length)) return false;
+    storedHashes[i] = sentences[i].hash;
+  }
+  
+  int32_t state[2] = { selectedSentence, totalSentences };
+  if (!storeAppend(STORE_RECORD_STATE, 0, state, sizeof(state))) return false;
+  storedSelected = selectedSentence;
+  storedTotal = totalSentences;
+  
+  StoreSyncState sync = { contentUpdatedAt, localPending, 0 };
+  if (!storeAppend(STORE_RECORD_SYNC, 0, &sync, sizeof(sync))) return false;
+  storedSync = sync;
+  
+  uint16_t playlistBytes = playlistLength * sizeof(PlaylistItem);
+  if (!storeAppend(STORE_RECORD_PLAYLIST, 0, playlist, playlistBytes)) return false;
+  storedPlaylistCrc = crc32(playlist, playlistBytes);
+  
+  Serial.println("Flash snapshot written to sector " + String(store.sector) + 
+                ", generation " + String(store.generation));
+  return true;
+}
+
+//--------------------------
+// FIREBASE STREAM FUNCTIONS
+
+void startFirebaseStream() {
+  if (!Firebase.ready()) {
+    Serial.println("Firebase not ready for streaming!");
+    scheduleNextSync(false);
+    return;
+  }
+  
+  Serial.println("Starting Firebase stream...");
+  
+  // The first stream event is a put of the whole /display node, so no extra fetch is needed
+  uint32_t requestStart = micros();
+  if (recordFirebaseRequest(requestStart, Firebase.RTDB.beginStream(&stream, "/display"))) {
+    streamActive = true;
+    streamStarts++;
+    telemetryEvent(TELEMETRY_STREAM, 1);
+    Serial.println("Firebase stream started");
+    scheduleNextSync(true);
+  } else {
+    streamActive = false;
+    Serial.println("Failed to start stream: " + stream.errorReason());
+    streamFallbackPoll = true;
+  }
+}
+
+void handleFirebaseStream() {
+  bool ok = Firebase.RTDB.readStream(&stream);
+#ifdef P10_FAULTS
+  ok = ok && !faultTakeStreamDrop();
+#endif
+  if (!ok) {
+    Serial.println("Stream read failed: " + stream.errorReason());
+    Firebase.RTDB.endStream(&stream);
+    streamActive = false; // Resubscribed by firebaseTask() after the sync delay
+    telemetryEvent(TELEMETRY_STREAM, 0);
+    scheduleNextSync(false);
+    return;
+  }
+  
+  if (stream.streamTimeout()) {
+    Serial.println("Stream keep-alive timeout, reconnecting...");
+  }
+  
+  if (stream.streamAvailable()) {
+    applyStreamEvent(stream);
+  }
+}
+
+void applyStreamEvent(FirebaseData &data) {
+  String event = data.eventType();
+  String path = data.dataPath();
+  String type = data.dataType();
+  bool replace = (event == "put"); // patch only carries the changed children
+  bool updated = false;
+  
+  Serial.println("Stream " + event + " " + path + " (" + type + ")");
+  
+  // Writers that set updatedAt take part in last writer wins with the local API
+  uint64_t remoteUpdatedAt = 0;
+  String payload;
+  if (path == "/" && type == "json") {
+    // A first pass only reads updatedAt, which RTDB sends after the sentences
+    payload = data.payload();
+    if (!readDisplayJson(payload, "", DISPLAY_SCAN)) {
+      Serial.println("Stream event is not valid JSON, ignored");
+      return;
+    }
+    remoteUpdatedAt = displayFields.updatedAt;
+  } else if (path == "/updatedAt") {
+    remoteUpdatedAt = strtod(data.payload().c_str(), nullptr);
+  }
+  if (!remoteChangeWins(remoteUpdatedAt)) {
+    Serial.println("Stream event is older than the local change, ignored");
+    return;
+  }
+  acceptRemoteTime(remoteUpdatedAt);
+  
+  if (path == "/") {
+    if (type == "json") {
+      readDisplayJson(payload, "", replace ? DISPLAY_PUT : DISPLAY_PATCH);
+      updated = displayFields.updated;
+      // A patch without version leaves it as it was, a put without one has none
+      if (replace || displayFields.version >= 0) syncedVersion = displayFields.version;
+    } else if (type == "null") {
+      // Whole /display node deleted
+      updated = (totalSentences != 0);
+      totalSentences = 0;
+      updated |= applyPlaylistText("null", 4);
+      syncedVersion = -1;
+    }
+  } else if (path == "/version") {
+    // Events arrive in order, so the sentences of this version are already applied
+    syncedVersion = (type == "int") ? data.intData() : -1;
+  } else if (path == "/selectedSentence") {
+    if (type == "int") {
+      updated = setSelectedSentence(data.intData());
+    }
+  } else if (path == "/sentences") {
+    if (type == "array" || type == "json") {
+      readDisplayJson(data.payload(), "sentences", replace ? DISPLAY_PUT : DISPLAY_PATCH);
+      updated = displayFields.updated;
+    } else if (type == "null") {
+      updated = (totalSentences != 0);
+      totalSentences = 0;
+    }
+  } else if (path.startsWith("/sentences/")) {
+    int index = atoi(path.c_str() + 11);
+    if (type == "string") {
+      String value = data.stringData();
+      updated = setSentence(index, value.c_str(), value.length());
+    } else {
+      updated = setSentence(index, "", 0);
+    }
+  } else if (path == "/settings") {
+    if (type == "json") {
+      readDisplayJson(data.payload(), "settings", DISPLAY_PATCH);
+    }
+  } else if (path == "/settings/updateInterval") {
+    if (type == "int") {
+      setSyncInterval(data.intData());
+    }
+  } else if (path == "/playlist") {
+    // Payload is the raw JSON of the node, null included
+    payload = data.payload();
+    updated = applyPlaylistText(payload.c_str(), payload.length());
+  } else if (path.startsWith("/playlist/")) {
+    // Only part of an item changed, the table is compiled from the whole list
+    int requestCount = 0;
+    size_t bytesTransferred = 0;
+    syncPlaylist(requestCount, bytesTransferred);
+  } else if (path == "/settings/scrollSpeed") {
+    if (type == "int") {
+      setScrollSpeed(data.intData());
+    } else if (type == "float" || type == "double") {
+      setScrollSpeed(data.doubleData());
+    }
+  }
+  if (updated) {
+    // Keep the shown text in line with the selection
+    if (showActiveSentence()) {
+      contentUpdateUs = micros();
+    }
+    dataChanged = true;
+    telemetryEvent(TELEMETRY_CONTENT, SOURCE_STREAM);
+    bootMark(bootTimeline.firstSync, "first Firebase content");
+    Serial.println("Stream update applied. Total sentences: " + String(totalSentences));
+  }
+}
+
+// Sets a sentence as part of the list: empty text ends the list at index
+bool setSentence(int index, const char* text, size_t length) {
+  if (index < 0 || index >= MAX_SENTENCES) return false;
+  
+  if (length == 0) {
+    // Sentence removed, the list ends here
+    if (index < totalSentences) {
+      totalSentences = index;
+      return true;
+    }
+    return false;
+  }
+  
+  bool updated = false;
+  // Slots skipped over still hold text from before the list was cut, they become empty
+  for (int i = totalSentences; i < index; i++) {
+    writeSentence(i, "", 0);
+  }
+  if (writeSentence(index, text, length)) {
+    updated = true;
+    Serial.printf("Updated sentence %d: %s\n", index, sentences[index].text);
+  }
+  if (index >= totalSentences) {
+    totalSentences = index + 1;
+    updated = true;
+  }
+  return updated;
+}
+
+// Copies text into its slot, returns false if the slot already held the same text
+bool writeSentence(int index, const char* text, size_t length) {
+  if (length > SENTENCE_CAPACITY) {
+    // Cut before a UTF-8 continuation byte so no character is split
+    length = SENTENCE_CAPACITY;
+    while (length > 0 && ((uint8_t)text[length] & 0xC0) == 0x80) length--;
+  }
+  
+  Sentence &sentence = sentences[index];
+  uint32_t hash = sentenceHash(text, length);
+  if (hash == sentence.hash && length == sentence.length && memcmp(text, sentence.text, length) == 0) {
+    return false;
+  }
+  
+  memcpy(sentence.text, text, length);
+  sentence.text[length] = '\0';
+  sentence.length = length;
+  sentence.hash = hash;
+  return true;
+}
+
+bool setDisplayText(const char* text) {
+  if (shownMessageId < 0 && strcmp(displayText, text) == 0) return false;
+  
+  shownMessageId = -1;
+  strncpy(displayText, text, SENTENCE_CAPACITY);
+  displayText[SENTENCE_CAPACITY] = '\0';
+  displayTextVersion++;
+  return true;
+}
+
+// True while the display shows a startup placeholder rather than a sentence
+bool showingPlaceholder() {
+  return strcmp(displayText, "Loading from Firebase...") == 0 || 
+         strcmp(displayText, "Starting P10 Display...") == 0;
+}
+
+bool setSelectedSentence(int newSelected) {
+  if (newSelected < 0 || newSelected >= 10 || newSelected == selectedSentence) return false;
+  
+  selectedSentence = newSelected;
+  Serial.printf("Updated selected sentence to: %d\n", selectedSentence);
+  return true;
+}
+
+// Sentence that belongs on the display: the playlist item if one is running, else the selection
+int activeSentence() {
+  bool item = playlistCurrent >= 0 && !(playlist[playlistCurrent].flags & PLAYLIST_MESSAGE);
+  return item ? playlist[playlistCurrent].sentence : selectedSentence;
+}
+
+// Message store id if the playlist item is a stored message, else -1
+int activeMessage() {
+  bool item = playlistCurrent >= 0 && (playlist[playlistCurrent].flags & PLAYLIST_MESSAGE);
+  return item ? playlist[playlistCurrent].sentence : -1;
+}
+
+bool showActiveSentence() {
+  if (activeMessage() >= 0) return showStoredMessage(activeMessage());
+  int index = activeSentence();
+  return index < totalSentences && setDisplayText(sentences[index].text);
+}
+
+// Scrolls a stored message instead of displayText, which is kept for the fallback
+bool showStoredMessage(int id) {
+  if (id == shownMessageId) return false;
+  
+  shownMessageId = id;
+  displayTextVersion++;
+  return true;
+}
+
+bool setScrollSpeed(float pixelsPerSecond) {
+  if (pixelsPerSecond < SCROLL_SPEED_MIN) pixelsPerSecond = SCROLL_SPEED_MIN;
+  if (pixelsPerSecond > SCROLL_SPEED_MAX) pixelsPerSecond = SCROLL_SPEED_MAX;
+  if (pixelsPerSecond == scrollSpeed) return false;
+  
+  scrollSpeed = pixelsPerSecond;
+  Serial.printf("Scroll speed: %.2f px/s\n", scrollSpeed);
+  return true;
+}
+
+// From settings/updateInterval, applied without a reboot
+bool setSyncInterval(unsigned long intervalMs) {
+  if (!syncCadence.setInterval(intervalMs)) return false;
+  
+  Serial.printf("Sync interval: %lu ms\n", (unsigned long)syncCadence.base);
+  return true;
+}
+
+// Next attempt after the base interval if the last one got somewhere, else back off further
+void scheduleNextSync(bool progressed) {
+  syncCadence.schedule(progressed, random(0x7FFFFFFF));
+  lastFirebaseUpdate = millis();
+}
+
+// Settings are not covered by the hashes, they are read again whenever the version changes.
+// get() instead of getJSON() so a missing settings node is not an error.
+bool syncSettings(int &requestCount, size_t &bytesTransferred) {
+  requestCount++;
+  uint32_t requestStart = micros();
+  if (!recordFirebaseRequest(requestStart, Firebase.RTDB.get(&fbdo, "/display/settings"))) {
+    Serial.println("Failed to read settings: " + fbdo.errorReason());
+    return false;
+  }
+  bytesTransferred += fbdo.payloadLength();
+  
+  if (fbdo.dataType() == "json") {
+    readDisplayJson(fbdo.payload(), "settings", DISPLAY_PATCH);
+  }
+  return true;
+}
+
+//--------------------------
+// SIMPLIFIED FIREBASE UPDATE
+
+// Returns true if the content changed
+bool updateTextFromFirebase() {
+  if (!Firebase.ready()) {
+    Serial.println("Firebase not ready!");
+    return false;
+  }
+  
+  Serial.println("Quick Firebase update...");
+  
+  unsigned long syncStart = millis();
+  int requestCount = 0;
+  size_t bytesTransferred = 0;
+  bool updated = false;
+  
+  // Shallow read returns primitives (version, selectedSentence) with their values and children as true
+  requestCount++;
+  uint32_t requestStart = micros();
+  if (!recordFirebaseRequest(requestStart, Firebase.RTDB.getShallowData(&fbdo, "/display"))) {
+    Serial.println("Failed to read /display: " + fbdo.errorReason());
+    return false;
+  }
+  bytesTransferred += fbdo.payloadLength();
+  
+  long version = -1;
+  int newSelected = -1;
+  uint64_t remoteUpdatedAt = 0;
+  if (fbdo.dataType() == "json" && readDisplayJson(fbdo.payload(), "", DISPLAY_SCAN)) {
+    version = displayFields.version;
+    newSelected = displayFields.selected;
+    remoteUpdatedAt = displayFields.updatedAt;
+  }
+  
+  if (!remoteChangeWins(remoteUpdatedAt)) {
+    // A local API change is newer, firebaseTask() writes it to Firebase instead
+    Serial.println("Local change is newer than Firebase, not synced");
+    return false;
+  }
+  acceptRemoteTime(remoteUpdatedAt);
+  
+  if (version < 0) {
+    // No version counter in the database, download everything
+    updated = syncFullDisplay(requestCount, bytesTransferred);
+  } else {
+    if (newSelected >= 0) {
+      updated = setSelectedSentence(newSelected);
+    }
+    
+    if (version != syncedVersion) {
+      Serial.println("Firebase version " + String(version) + ", have " + String(syncedVersion));
+      if (syncChangedSentences(requestCount, bytesTransferred) && 
+          syncSettings(requestCount, bytesTransferred) && 
+          syncPlaylist(requestCount, bytesTransferred)) {
+        syncedVersion = version;
+        updated = true;
+      }
+    }
+  }
+  
+  // Show the selected sentence (or the playlist item) if we have it
+  if (activeMessage() >= 0 || (activeSentence() < totalSentences && sentences[activeSentence()].length > 0)) {
+    if (showActiveSentence()) {
+      updated = true;
+      Serial.printf("Display text: %s\n", displayText);
+    }
+  } else if (totalSentences > 0) {
+    Serial.printf("Selected sentence %d not available yet\n", activeSentence());
+    
+    // If display text is still loading message or default, fall back to the first sentence
+    if (showingPlaceholder()) {
+      setDisplayText(sentences[0].text);
+      selectedSentence = 0;
+      updated = true;
+      Serial.printf("Using first sentence as default: %s\n", displayText);
+    }
+  }
+  
+  // Only show error if we truly have no sentences
+  if (totalSentences == 0) {
+    Serial.println("No sentences available from Firebase");
+    if (showingPlaceholder()) {
+      setDisplayText("No sentences in Firebase");
+    }
+  }
+  
+  if (updated) {
+    dataChanged = true;
+    telemetryEvent(TELEMETRY_CONTENT, SOURCE_POLL);
+    bootMark(bootTimeline.firstSync, "first Firebase content");
+    Serial.println("Firebase update completed. Total sentences: " + String(totalSentences));
+  }
+  
+  Serial.println("Firebase sync: " + String(requestCount) + " request(s), " + 
+                String(bytesTransferred) + " bytes, " + String(millis() - syncStart) + " ms");
+  return updated;
+}
+
+// Pull the whole /display node in one request and apply it in one go
+bool syncFullDisplay(int &requestCount, size_t &bytesTransferred) {
+  requestCount++;
+  uint32_t requestStart = micros();
+  if (!recordFirebaseRequest(requestStart, Firebase.RTDB.getJSON(&fbdo, "/display"))) {
+    Serial.println("Failed to read /display: " + fbdo.errorReason());
+    return false;
+  }
+  bytesTransferred += fbdo.payloadLength();
+  
+  bool updated = false;
+  
+  if (fbdo.dataType() == "json") {
+    // All sentences are checked on every sync, no playlist node means no playlist
+    if (!readDisplayJson(fbdo.payload(), "", DISPLAY_PUT)) {
+      Serial.println("/display is not valid JSON");
+    }
+    updated = displayFields.updated;
+  } else if (totalSentences != 0) {
+    // /display is empty or not an object
+    totalSentences = 0;
+    updated = true;
+  }
+  return updated;
+}
+
+// Compare /display/hashes with our copy and download only the sentences that differ
+bool syncChangedSentences(int &requestCount, size_t &bytesTransferred) {
+  requestCount++;
+  uint32_t requestStart = micros();
+  if (!recordFirebaseRequest(requestStart, Firebase.RTDB.getArray(&fbdo, "/display/hashes"))) {
+    Serial.println("Failed to read hashes: " + fbdo.errorReason());
+    return false;
+  }
+  bytesTransferred += fbdo.payloadLength();
+  
+  // The hashes stay in displayFields, the sentence reads below are not parsed
+  if (!readDisplayJson(fbdo.payload(), "hashes", DISPLAY_PATCH)) {
+    Serial.println("Hashes are not valid JSON");
+    return false;
+  }
+  int count = displayFields.hashCount;
+  
+  for (int i = 0; i < count; i++) {
+    if (i < totalSentences && sentences[i].hash == displayFields.hashes[i]) continue;
+    
+    requestCount++;
+    char path[32];
+    snprintf(path, sizeof(path), "/display/sentences/%d", i);
+    uint32_t sentenceStart = micros();
+    if (!recordFirebaseRequest(sentenceStart, Firebase.RTDB.getString(&fbdo, path))) {
+      Serial.println("Failed to read sentence " + String(i) + ": " + fbdo.errorReason());
+      return false;
+    }
+    bytesTransferred += fbdo.payloadLength();
+    String value = fbdo.stringData();
+    if (setSentence(i, value.c_str(), value.length())) {
+      dataChanged = true; // Keep what we got even if a later read fails
+    }
+  }
+  
+  if (count < totalSentences) {
+    totalSentences = count;
+  }
+  return true;
+}
+
+// 32-bit FNV-1a over the UTF-8 bytes, stored in /display/hashes as 8 hex digits
+uint32_t sentenceHash(const char* text, size_t length) {
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)text[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+//--------------------------
+// RTDB JSON
+
+static_assert(JSON_VALUE_SIZE >= SENTENCE_CAPACITY, "A sentence string fits the parser's value buffer");
+
+// Parser for RTDB payloads, shared by applyPlaylistText() and readDisplayJson() which never nest
+JsonParser rtdbParser;
+
+//--------------------------
+// PLAYLIST
+// /display/playlist is a list of items, for example
+//   [{"sentence": 0, "repeat": 2}, {"sentence": 3, "dwell": 60, "from": "08:00", "to": "12:00", "days": "-MTWTF-"}]
+// An item can show a stored message with "message": id instead of "sentence".
+// It is compiled into playlistSchedule when it arrives, the display task only does a lookup
+// between two scroll passes.
+
+void compilePlaylist() {
+  playlistSchedule.compile(playlist, playlistLength);
+  Serial.println("Playlist: " + String(playlistLength) + " item(s), " + String(playlistSchedule.spanCount) + " span(s)");
+}
+
+// Local time as minute of the week, -1 while the clock is not set
+int currentMinuteOfWeek() {
+  if (!clockLocalSecond) return -1;
+  return clockLocal.tm_wday * MINUTES_PER_DAY + clockLocal.tm_hour * 60 + clockLocal.tm_min;
+}
+
+// Picks the item for the next scroll pass, returns true if that is a different sentence
+bool playlistNext() {
+  int before = activeSentence();
+  int beforeMessage = activeMessage();
+  int minute = currentMinuteOfWeek();
+  uint16_t mask = (minute < 0) ? playlistSchedule.alwaysMask : playlistSchedule.maskAt(minute);
+  
+  // Items whose sentence or message is missing are skipped
+  for (int i = 0; i < playlistLength; i++) {
+    bool missing = (playlist[i].flags & PLAYLIST_MESSAGE) ? !messageExists(playlist[i].sentence) : 
+                                                             playlist[i].sentence >= totalSentences;
+    if (missing) mask &= ~(1 << i);
+  }
+  
+  if (mask == 0) {
+    playlistCurrent = -1;
+  } else if (playlistCurrent < 0 || !(mask & (1 << playlistCurrent)) || 
+             (playlistPasses >= playlist[playlistCurrent].repeat && 
+              millis() - playlistItemStart >= playlist[playlistCurrent].dwell * 1000UL)) {
+    // Next active item in list order, wrapping around
+    int next = playlistCurrent;
+    do {
+      next = (next + 1) % playlistLength;
+    } while (!(mask & (1 << next)));
+    playlistCurrent = next;
+    playlistPasses = 0;
+    playlistItemStart = millis();
+  }
+  
+  return activeSentence() != before || activeMessage() != beforeMessage;
+}
+
+// Collected by onPlaylistJson(), copied over the playlist once the whole document parsed
+struct PlaylistUpload {
+  PlaylistItem items[PLAYLIST_MAX_ITEMS];
+  int count;
+  PlaylistItem item; // Item being parsed
+  int level;         // Parser depth of the items, 1 for a document that is just the list
+  bool hasSentence;
+  bool bad;          // A field did not parse, the item is skipped
+};
+
+PlaylistUpload playlistUpload;
+
+// "HH:MM" to minute of day, -1 if it is not a time
+int parseMinuteOfDay(const char* text) {
+  char* end;
+  long hour = strtol(text, &end, 10);
+  if (end == text || *end != ':') return -1;
+  const char* minuteText = end + 1;
+  long minute = strtol(minuteText, &end, 10);
+  if (end == minuteText || *end != '\0' || hour < 0 || hour > 24 || minute < 0 || minute > 59) return -1;
+  if (hour == 24 && minute != 0) return -1;
+  return (hour * 60 + minute) % MINUTES_PER_DAY; // 24:00 is midnight
+}
+
+// Items are the objects at playlistUpload.level, in an array or in an object keyed by index
+void onPlaylistJson(JsonParser &parser, int event) {
+  PlaylistItem &item = playlistUpload.item;
+  int level = playlistUpload.level;
+  
+  if (event == JSON_OBJECT_START && parser.depth == level) {
+    item = { 0, 1, 0x7F, 0, 0, 0, 0, 0 };
+    playlistUpload.hasSentence = false;
+    playlistUpload.bad = false;
+  } else if (event == JSON_OBJECT_END && parser.depth == level) {
+    if (playlistUpload.hasSentence && !playlistUpload.bad && playlistUpload.count < PLAYLIST_MAX_ITEMS) {
+      playlistUpload.items[playlistUpload.count++] = item;
+    } else {
+      Serial.println("Playlist item skipped");
+    }
+  } else if (parser.depth == level + 1 && !parser.inArray[level + 1]) {
+    const char* field = parser.key[level + 1];
+    long number = atol(parser.value);
+    
+    if (strcmp(field, "sentence") == 0) {
+      playlistUpload.hasSentence = (event == JSON_NUMBER && number >= 0 && number < MAX_SENTENCES);
+      item.sentence = number;
+      item.flags &= ~PLAYLIST_MESSAGE;
+    } else if (strcmp(field, "message") == 0) {
+      // Long text from the message store, uploaded through /api/messages
+      playlistUpload.hasSentence = (event == JSON_NUMBER && number >= 0 && number < MESSAGE_MAX);
+      item.sentence = number;
+      item.flags |= PLAYLIST_MESSAGE;
+    } else if (event == JSON_NUMBER && strcmp(field, "repeat") == 0) {
+      item.repeat = constrain(number, 1, 255);
+    } else if (event == JSON_NUMBER && strcmp(field, "dwell") == 0) {
+      item.dwell = constrain(number, 0, 65535);
+    } else if (event == JSON_STRING && (strcmp(field, "from") == 0 || strcmp(field, "to") == 0)) {
+      int minute = parseMinuteOfDay(parser.value);
+      if (minute < 0) {
+        playlistUpload.bad = true;
+      } else if (field[0] == 'f') {
+        item.from = minute;
+      } else {
+        item.to = minute;
+      }
+    } else if (event == JSON_STRING && strcmp(field, "days") == 0) {
+      // 7 characters from Sunday, "-" for a day off, e.g. "-MTWTF-"
+      item.days = 0;
+      for (int day = 0; day < 7 && parser.value[day]; day++) {
+        if (parser.value[day] != '-' && parser.value[day] != ' ') item.days |= 1 << day;
+      }
+    }
+  }
+}
+
+// Parses the raw JSON of /display/playlist, returns true if the playlist changed
+bool applyPlaylistText(const char* text, size_t length) {
+  playlistUpload.count = 0;
+  playlistUpload.level = 1;
+  rtdbParser.begin(onPlaylistJson);
+  rtdbParser.feed(text, length);
+  if (!rtdbParser.finish()) {
+    Serial.println("Playlist is not valid JSON, kept the old one");
+    return false;
+  }
+  return commitPlaylistUpload();
+}
+
+// Replaces the playlist with the items onPlaylistJson() collected, returns true if it changed
+bool commitPlaylistUpload() {
+  if (playlistUpload.count == playlistLength && 
+      memcmp(playlistUpload.items, playlist, playlistLength * sizeof(PlaylistItem)) == 0) {
+    return false;
+  }
+  
+  memcpy(playlist, playlistUpload.items, playlistUpload.count * sizeof(PlaylistItem));
+  playlistLength = playlistUpload.count;
+  compilePlaylist();
+  
+  // Start over from the first active item
+  playlistCurrent = -1;
+  playlistNext();
+  showActiveSentence();
+  dataChanged = true;
+  return true;
+}
+
+// Like settings, the playlist is not covered by the hashes and is read again on a version change
+bool syncPlaylist(int &requestCount, size_t &bytesTransferred) {
+  requestCount++;
+  uint32_t requestStart = micros();
+  if (!recordFirebaseRequest(requestStart, Firebase.RTDB.get(&fbdo, "/display/playlist"))) {
+    Serial.println("Failed to read playlist: " + fbdo.errorReason());
+    return false;
+  }
+  bytesTransferred += fbdo.payloadLength();
+  
+  String payload = fbdo.payload();
+  applyPlaylistText(payload.c_str(), payload.length());
+  return true;
+}
+
+//--------------------------
+// DISPLAY DOCUMENT
+// /display and its children are read from the raw RTDB payload with the streaming parser
+// instead of the FirebaseJson DOM. Values go straight into sentences[], the settings and
+// playlistUpload as they are parsed; status, hashes (unless asked for) and keys we do not
+// know are passed over without being stored. Nothing is allocated besides the payload the
+// library already holds.
+
+struct DisplayRead {
+  const char* node; // /display child the document is, "" for /display itself
+  uint8_t mode;     // DisplayReadMode
+};
+
+DisplayRead displayRead = { "", DISPLAY_SCAN };
+
+// Reads a document, returns false if it did not parse. What was applied before the error
+// stays, like a delta sync that stops halfway; the list is only cut and the playlist only
+// replaced once the whole document parsed.
+bool readDisplayJson(const String &payload, const char* node, uint8_t mode) {
+  beginDisplayJson(node, mode);
+  rtdbParser.feed(payload.c_str(), payload.length());
+  return finishDisplayJson();
+}
+
+void beginDisplayJson(const char* node, uint8_t mode) {
+  displayRead.node = node;
+  displayRead.mode = mode;
+  displayFields = { -1, -1, 0, 0, 0, {}, false, false };
+  rtdbParser.begin(onDisplayJson);
+}
+
+bool finishDisplayJson() {
+  DisplayFields &fields = displayFields;
+  if (!rtdbParser.finish()) return false;
+  if (displayRead.mode == DISPLAY_SCAN) return true;
+  
+  bool whole = (displayRead.node[0] == '\0');
+  if (displayRead.mode == DISPLAY_PUT && (whole || strcmp(displayRead.node, "sentences") == 0)) {
+    // The list ends at the first index without text
+    int count = 0;
+    while (count < MAX_SENTENCES && (fields.sentences & (1 << count))) count++;
+    if (count < totalSentences) {
+      totalSentences = count;
+      fields.updated = true;
+    }
+  }
+  
+  if (fields.playlist) {
+    fields.updated |= commitPlaylistUpload();
+  } else if (displayRead.mode == DISPLAY_PUT && whole) {
+    // No playlist node means no playlist
+    playlistUpload.count = 0;
+    fields.updated |= commitPlaylistUpload();
+  }
+  return true;
+}
+
+void onDisplayJson(JsonParser &parser, int event) {
+  DisplayFields &fields = displayFields;
+  bool whole = (displayRead.node[0] == '\0');
+  int level = whole ? 1 : 0; // Depth of the child's own value, its elements are one below
+  if (parser.depth < level || (whole && parser.inArray[1])) return;
+  const char* node = whole ? parser.key[1] : displayRead.node;
+  
+  if (parser.depth == level && event == JSON_NUMBER) {
+    if (strcmp(node, "version") == 0) {
+      fields.version = atol(parser.value);
+    } else if (strcmp(node, "updatedAt") == 0) {
+      fields.updatedAt = strtod(parser.value, nullptr);
+    } else if (strcmp(node, "selectedSentence") == 0) {
+      fields.selected = atoi(parser.value);
+      if (displayRead.mode != DISPLAY_SCAN) fields.updated |= setSelectedSentence(fields.selected);
     }
-    buffer[len] = '\0';
-    sentences[i] = String(buffer);
-    
-    addr += 80; // Fixed space per sentence
+    return;
   }
+  if (displayRead.mode == DISPLAY_SCAN) return;
   
-  // Set initial display text from cached data
-  if (totalSentences > 0 && selectedSentence < totalSentences) {
-    displayText = sentences[selectedSentence];
-    Serial.println("Loaded cached display text: " + displayText);
-  } else if (totalSentences > 0) {
-    displayText = sentences[0];
-    selectedSentence = 0;
-    Serial.println("Using first cached sentence: " + displayText);
+  int inner = level + 1;
+  if (strcmp(node, "sentences") == 0) {
+    if (parser.depth != inner || event != JSON_STRING) return;
+    int index = displayIndex(parser, inner);
+    if (index < 0) return;
+    fields.updated |= setSentence(index, parser.value, parser.length);
+    if (parser.length > 0) fields.sentences |= 1 << index;
+  } else if (strcmp(node, "hashes") == 0) {
+    if (parser.depth == inner && event == JSON_STRING && displayIndex(parser, inner) == fields.hashCount) {
+      fields.hashes[fields.hashCount++] = strtoul(parser.value, nullptr, 16);
+    }
+  } else if (strcmp(node, "settings") == 0) {
+    if (parser.depth != inner || parser.inArray[inner] || event != JSON_NUMBER) return;
+    if (strcmp(parser.key[inner], "scrollSpeed") == 0) {
+      setScrollSpeed(atof(parser.value));
+    } else if (strcmp(parser.key[inner], "updateInterval") == 0) {
+      setSyncInterval(atol(parser.value));
+    }
+  } else if (strcmp(node, "playlist") == 0) {
+    if (parser.depth == level && !fields.playlist) {
+      // Items are collected like a /display/playlist read, one level further down
+      fields.playlist = true;
+      playlistUpload.count = 0;
+      playlistUpload.level = inner;
+    }
+    onPlaylistJson(parser, event);
+  }
+}
+
+// Sentence index of the element at depth, RTDB sends a list with gaps as an object keyed by index
+int displayIndex(const JsonParser &parser, int depth) {
+  int index;
+  if (parser.inArray[depth]) {
+    index = parser.index[depth];
+  } else if (isdigit((unsigned char)parser.key[depth][0])) {
+    index = atoi(parser.key[depth]);
   } else {
-    displayText = "Loading from Firebase...";
-    Serial.println("No cached data found, will load from Firebase");
+    return -1;
   }
-  
-  Serial.println("Loaded " + String(totalSentences) + " sentences from EEPROM");
+  return (index < MAX_SENTENCES) ? index : -1;
 }
 
 //--------------------------
-// FIREBASE STREAM FUNCTIONS
+// LOCAL CONTROL API
+// REST endpoints next to /metrics, for changes on the LAN without the cloud round trip:
+//   GET /api/state                           sentences, selection and content timestamp
+//   PUT /api/sentences[?updatedAt=ms]        body ["text", ...] or {"sentences": [...], "selectedSentence": n}
+//   PUT /api/selected?index=n[&updatedAt=ms]
+//   GET /api/messages[?id=n]                 message store index, or the text of one message
+//   PUT /api/messages?id=n                   body is the message text, stored compressed on flash
+//   DELETE /api/messages?id=n
+// Local changes are written to Firebase afterwards. Between the two, the change with the
+// newer updatedAt (ms since epoch) wins.
 
-void startFirebaseStream() {
-  if (!Firebase.ready()) {
-    Serial.println("Firebase not ready for streaming!");
-    return;
+struct SentenceUpload {
+  JsonParser parser;
+  uint64_t updatedAt;
+  int count;    // Sentences received
+  int selected; // selectedSentence from the body, -1 = not given
+  bool updated;
+  int status;   // HTTP status for the reply, stays 400 if no body arrived
+};
+
+SentenceUpload upload = { {}, 0, 0, -1, false, 400 };
+
+void initLocalApi() {
+  server.on("/api/state", HTTP_GET, handleApiState);
+  server.on("/api/sentences", HTTP_PUT, handleApiSentences, handleApiSentencesBody);
+  server.on("/api/selected", HTTP_PUT, handleApiSelected);
+  server.on("/api/messages", HTTP_GET, handleApiMessages);
+  server.on("/api/messages", HTTP_PUT, handleApiMessagePut, handleApiMessageBody);
+  server.on("/api/messages", HTTP_DELETE, handleApiMessageDelete);
+#ifdef P10_FAULTS
+  server.on("/api/faults", HTTP_GET, handleApiFaults);
+  server.on("/api/faults", HTTP_PUT, handleApiFaultsPut);
+#endif
+}
+
+// Timestamp of a local change: ?updatedAt if the client sent one, else the device clock
+uint64_t apiRequestTime() {
+  if (server.hasArg("updatedAt")) {
+    return strtoull(server.arg("updatedAt").c_str(), nullptr, 10);
+  }
+  int64_t now = timeKeeper.epochUs(micros64());
+  if (now >= TIME_VALID_US) {
+    return now / 1000;
+  }
+  return contentUpdatedAt + 1; // Clock not set yet, still newer than what we hold
+}
+
+// A local change with this timestamp replaces the content we hold
+bool localChangeWins(uint64_t updatedAt) {
+  return updatedAt >= contentUpdatedAt;
+}
+
+// Remote changes without a timestamp lose against a local change not yet in Firebase
+bool remoteChangeWins(uint64_t updatedAt) {
+  return (updatedAt == 0) ? !localPending : updatedAt >= contentUpdatedAt;
+}
+
+void acceptRemoteTime(uint64_t updatedAt) {
+  if (updatedAt > contentUpdatedAt) {
+    contentUpdatedAt = updatedAt;
+    localPending = false; // Firebase has something newer than our local change
+    dataChanged = true;
+  }
+}
+
+void commitLocalChange(uint64_t updatedAt) {
+  contentUpdatedAt = max(contentUpdatedAt, updatedAt);
+  localPending = true;
+  dataChanged = true;
+  telemetryEvent(TELEMETRY_CONTENT, SOURCE_API);
+  if (showActiveSentence()) {
+    contentUpdateUs = micros();
+  }
+}
+
+void apiReply(int status, const char* error) {
+  char reply[160];
+  if (error) {
+    snprintf(reply, sizeof(reply), "{\"ok\":false,\"error\":\"%s\",\"updatedAt\":%.0f}", error, (double)contentUpdatedAt);
+  } else {
+    snprintf(reply, sizeof(reply), "{\"ok\":true,\"updatedAt\":%.0f,\"totalSentences\":%d,\"selectedSentence\":%d}", 
+             (double)contentUpdatedAt, totalSentences, selectedSentence);
   }
+  server.send(status, "application/json", reply);
+}
+
+// Sentences are applied one by one while the body streams in
+void onUploadJson(JsonParser &parser, int event) {
+  bool topArray = parser.inArray[1];
+  int listLevel = topArray ? 1 : 2;
   
-  Serial.println("Starting Firebase stream...");
+  if (event == JSON_STRING && parser.depth == listLevel && parser.inArray[listLevel] && 
+      (topArray || parser.at(1, "sentences"))) {
+    upload.updated |= setSentence(parser.index[listLevel], parser.value, parser.length);
+    upload.count = parser.index[listLevel] + 1;
+  } else if (event == JSON_ARRAY_END && parser.depth == listLevel - 1 && 
+             (topArray || parser.at(1, "sentences"))) {
+    // The batch replaces the list, drop sentences past its end
+    if (upload.count < totalSentences) {
+      totalSentences = upload.count;
+      upload.updated = true;
+    }
+  } else if (event == JSON_NUMBER && parser.depth == 1 && parser.at(1, "selectedSentence")) {
+    upload.selected = atoi(parser.value);
+  }
+}
+
+void handleApiSentencesBody() {
+  HTTPRaw &raw = server.raw();
   
-  // Use a simple get request instead of complex streaming to reduce load
-  updateTextFromFirebase();
+  if (raw.status == RAW_START) {
+    upload.updatedAt = apiRequestTime();
+    upload.count = 0;
+    upload.selected = -1;
+    upload.updated = false;
+    upload.status = localChangeWins(upload.updatedAt) ? 0 : 409;
+    upload.parser.begin(onUploadJson);
+  } else if (raw.status == RAW_WRITE) {
+    if (upload.status == 0) {
+      upload.parser.feed((const char*)raw.buf, raw.currentSize);
+    }
+  } else if (raw.status == RAW_END) {
+    if (upload.status == 0) {
+      upload.status = upload.parser.finish() ? 200 : 400;
+    }
+  } else {
+    upload.status = 400; // Client went away
+  }
 }
 
-void handleFirebaseStream() {
-  // This function is kept for compatibility but not used in the simplified approach
-  streamActive = false;
+void handleApiSentences() {
+  int status = upload.status;
+  upload.status = 400;
+  
+  if (status == 200 && upload.selected >= 0) {
+    upload.updated |= setSelectedSentence(upload.selected);
+  }
+  // Sentences received before a parse error are kept, they are already on the panel
+  if (upload.updated) {
+    commitLocalChange(upload.updatedAt);
+  }
+  
+  if (status == 409) {
+    apiReply(status, "older than current content");
+  } else if (status != 200) {
+    apiReply(status, "invalid JSON body");
+  } else {
+    apiReply(status, nullptr);
+  }
 }
 
-//--------------------------
-// SIMPLIFIED FIREBASE UPDATE
+void handleApiSelected() {
+  uint64_t updatedAt = apiRequestTime();
+  int index = server.hasArg("index") ? server.arg("index").toInt() : -1;
+  
+  if (index < 0 || index >= totalSentences) {
+    apiReply(400, "index out of range");
+  } else if (!localChangeWins(updatedAt)) {
+    apiReply(409, "older than current content");
+  } else {
+    if (setSelectedSentence(index)) {
+      commitLocalChange(updatedAt);
+    }
+    apiReply(200, nullptr);
+  }
+}
 
-void updateTextFromFirebase() {
-  if (!Firebase.ready()) {
-    Serial.println("Firebase not ready!");
+// Index of the message store, one entry per stored message
+void handleApiMessages() {
+  File index = messageFS.open(MESSAGE_INDEX, "r");
+  if (!messageStoreReady || !index) {
+    apiReply(503, "message store not available");
     return;
   }
   
-  Serial.println("Quick Firebase update...");
+  FSInfo info;
+  messageFS.info(info);
+  char line[112];
+  snprintf(line, sizeof(line), "{\"free\":%u,\"garbage\":%u,\"messages\":[", 
+           (unsigned)(info.totalBytes - info.usedBytes), messageGarbage);
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  server.sendContent(line);
   
-  bool updated = false;
+  bool first = true;
+  for (int id = 0; id < MESSAGE_MAX; id++) {
+    MessageIndexEntry entry;
+    if (index.read((uint8_t*)&entry, sizeof(entry)) != sizeof(entry)) break;
+    if (entry.packed == 0) continue;
+    snprintf(line, sizeof(line), "%s{\"id\":%d,\"length\":%u,\"packed\":%u,\"columns\":%u}", 
+             first ? "" : ",", id, entry.length, entry.packed, entry.columns);
+    server.sendContent(line);
+    first = false;
+  }
+  index.close();
+  server.sendContent("]}");
+  server.sendContent(""); // Ends the chunked response
+}
+
+void handleApiMessagePut() {
+  int status = messageUploadStatus;
+  messageUploadStatus = 400;
   
-  // Always check for sentences first, especially on initial load
-  static int updateCounter = 0;
-  updateCounter++;
+  if (status == 200) {
+    char reply[112];
+    snprintf(reply, sizeof(reply), "{\"ok\":true,\"id\":%d,\"length\":%u,\"packed\":%u,\"columns\":%u}", 
+             messageWriter.id, messageWriter.entry.length, messageWriter.entry.packed, messageWriter.entry.columns);
+    server.send(200, "application/json", reply);
+  } else if (status == 413) {
+    apiReply(status, "message too long");
+  } else if (status == 507) {
+    apiReply(status, "message store full");
+  } else {
+    apiReply(status, "id out of range or no body");
+  }
+}
+
+// The body goes through the compressor straight to flash, it is never held in RAM
+void handleApiMessageBody() {
+  HTTPRaw &raw = server.raw();
   
-  // On first run or every 5th update, check for new sentences
-  if (totalSentences == 0 || updateCounter >= 5) {
-    updateCounter = 0;
-    
-    Serial.println("Checking for sentences in Firebase...");
-    
-    // Check all sentences to build the initial list
-    int maxSentencesToCheck = (totalSentences == 0) ? 10 : 3; // Check all on first run, fewer on updates
-    
-    for (int i = 0; i < maxSentencesToCheck; i++) {
-      String path = "/display/sentences/" + String(i);
-      if (Firebase.RTDB.getString(&fbdo, path.c_str())) {
-        String sentence = fbdo.stringData();
-        if (sentence.length() > 0) {
-          if (sentence != sentences[i]) {
-            sentences[i] = sentence;
-            updated = true;
-            Serial.println("Updated sentence " + String(i) + ": " + sentence);
-          }
-          // Update total sentences count
-          if (i >= totalSentences) {
-            totalSentences = i + 1;
-            updated = true;
-          }
-        } else if (i == 0) {
-          // If first sentence is empty, there are no sentences
-          Serial.println("No sentences found in Firebase");
-          break;
-        } else {
-          // End of sentences found
-          break;
-        }
-      } else {
-        Serial.println("Failed to read sentence " + String(i) + ": " + fbdo.errorReason());
-        if (i == 0) {
-          // Can't read first sentence, might be a connection issue
-          Serial.println("Cannot read Firebase data");
-          return;
-        }
-        break;
+  if (raw.status == RAW_START) {
+    int id = server.hasArg("id") ? server.arg("id").toInt() : -1;
+    if (id < 0 || id >= MESSAGE_MAX || !server.hasArg("id")) {
+      messageUploadStatus = 400;
+    } else {
+      messageUploadStatus = messageWriter.begin(id) ? 0 : 507;
+    }
+  } else if (raw.status == RAW_WRITE) {
+    if (messageUploadStatus == 0) {
+      messageWriter.write(raw.buf, raw.currentSize);
+      if (messageWriter.failed) {
+        messageUploadStatus = messageWriter.tooLong ? 413 : 507;
+        messageWriter.abort();
       }
-      delay(10); // Small delay between requests
     }
+  } else if (raw.status == RAW_END) {
+    if (messageUploadStatus == 0) {
+      messageUploadStatus = messageWriter.finish() ? 200 : 507;
+    }
+  } else {
+    if (messageUploadStatus == 0) messageWriter.abort();
+    messageUploadStatus = 400; // Client went away
+  }
+}
+
+void handleApiMessageDelete() {
+  int id = server.hasArg("id") ? server.arg("id").toInt() : -1;
+  if (id < 0 || id >= MESSAGE_MAX) {
+    apiReply(400, "id out of range");
+  } else if (!deleteMessage(id)) {
+    apiReply(503, "message store not available");
+  } else {
+    // A playlist item showing it moves on
+    if (id == shownMessageId && playlistNext()) showActiveSentence();
+    apiReply(200, nullptr);
+  }
+}
+
+// Sends text as a JSON string in small pieces, no copy of the whole sentence
+void apiSendJsonString(const char* text) {
+  char chunk[128];
+  size_t pos = 0;
+  chunk[pos++] = '"';
+  for (const char* p = text; *p; p++) {
+    if (pos > sizeof(chunk) - 8) {
+      server.sendContent(chunk, pos);
+      pos = 0;
+    }
+    uint8_t c = *p;
+    if (c == '"' || c == '\\') {
+      chunk[pos++] = '\\';
+      chunk[pos++] = c;
+    } else if (c < 0x20) {
+      pos += snprintf(chunk + pos, sizeof(chunk) - pos, "\\u%04x", c);
+    } else {
+      chunk[pos++] = c;
+    }
+  }
+  chunk[pos++] = '"';
+  server.sendContent(chunk, pos);
+}
+
+void handleApiState() {
+  char head[160];
+  snprintf(head, sizeof(head), "{\"selectedSentence\":%d,\"totalSentences\":%d,\"updatedAt\":%.0f,\"pending\":%s,\"shownMessage\":%d,\"displayText\":", 
+           selectedSentence, totalSentences, (double)contentUpdatedAt, localPending ? "true" : "false", shownMessageId);
+  
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  server.sendContent(head);
+  apiSendJsonString(displayText);
+  server.sendContent(",\"sentences\":[");
+  for (int i = 0; i < totalSentences; i++) {
+    if (i) server.sendContent(",");
+    apiSendJsonString(sentences[i].text);
+  }
+  server.sendContent("]}");
+  server.sendContent(""); // Ends the chunked response
+}
+
+// Writes the local content to /display in one update with its hashes for delta sync, then moves
+// the version on. The version always moves on, or polling devices would never fetch the new
+// sentences. Its bump is a conditional write against the ETag read before the content went out:
+// if another writer bumped it in between, that writer may have overwritten our content or be
+// about to, so the content is written again under the next version. The last writer to bump
+// is the one whose content /display holds.
+bool pushLocalChanges() {
+  if (!Firebase.ready()) return false;
+  
+  // get() so a missing version is not an error
+  uint32_t requestStart = micros();
+  if (!recordFirebaseRequest(requestStart, Firebase.RTDB.get(&fbdo, "/display/version"))) {
+    Serial.println("Failed to read version: " + fbdo.errorReason());
+    return false;
   }
   
-  // Now check for selected sentence (after we have sentences loaded)
-  if (Firebase.RTDB.getInt(&fbdo, "/display/selectedSentence")) {
-    int newSelected = fbdo.intData();
-    Serial.println("Firebase selectedSentence: " + String(newSelected) + ", current: " + String(selectedSentence));
+  FirebaseJson json;
+  char path[24];
+  char hash[9];
+  
+  if (totalSentences == 0) {
+    json.set("sentences"); // null removes the list
+    json.set("hashes");
+  }
+  for (int i = 0; i < totalSentences; i++) {
+    snprintf(path, sizeof(path), "sentences/[%d]", i);
+    json.set(path, sentences[i].text);
+    snprintf(path, sizeof(path), "hashes/[%d]", i);
+    snprintf(hash, sizeof(hash), "%08x", sentences[i].hash);
+    json.set(path, hash);
+  }
+  json.set("selectedSentence", selectedSentence);
+  json.set("updatedAt", (double)contentUpdatedAt);
+  
+  for (int attempt = 0; attempt < localPushAttempts; attempt++) {
+    // fbdo holds the version and its ETag, from the read above or from the rejected bump
+    long version = (fbdo.dataType() == "int") ? fbdo.intData() : 0;
+    String etag = fbdo.ETag();
     
-    if (newSelected != selectedSentence && newSelected >= 0) {
-      // If we don't have enough sentences loaded yet, but the selection changed, try to load that specific sentence
-      if (newSelected >= totalSentences) {
-        Serial.println("Loading additional sentence " + String(newSelected) + "...");
-        String path = "/display/sentences/" + String(newSelected);
-        if (Firebase.RTDB.getString(&fbdo, path.c_str())) {
-          String sentence = fbdo.stringData();
-          if (sentence.length() > 0) {
-            sentences[newSelected] = sentence;
-            totalSentences = max(totalSentences, newSelected + 1);
-            updated = true;
-            Serial.println("Loaded new sentence " + String(newSelected) + ": " + sentence);
-          }
-        }
-      }
-      
-      // Now update the selected sentence if we have it
-      if (newSelected < totalSentences && sentences[newSelected].length() > 0) {
-        selectedSentence = newSelected;
-        displayText = sentences[selectedSentence];
-        updated = true;
-        Serial.println("Updated selected sentence to: " + String(selectedSentence) + " - " + displayText);
-      } else {
-        Serial.println("Selected sentence " + String(newSelected) + " not available yet");
-      }
+    requestStart = micros();
+    if (!recordFirebaseRequest(requestStart, Firebase.RTDB.updateNode(&fbdo, "/display", &json))) {
+      Serial.println("Failed to push local changes: " + fbdo.errorReason());
+      return false;
+    }
+    
+    version++;
+    requestStart = micros();
+    if (recordFirebaseRequest(requestStart, Firebase.RTDB.setInt(&fbdo, "/display/version", (int)version, etag.c_str()))) {
+      syncedVersion = version;
+      localPending = false;
+      dataChanged = true;
+      Serial.println("Local changes written to Firebase");
+      return true;
     }
+    if (fbdo.httpCode() != FIREBASE_ERROR_HTTP_CODE_PRECONDITION_FAILED) {
+      Serial.println("Failed to write version: " + fbdo.errorReason());
+      return false;
+    }
+    Serial.println("Version moved on to " + String(fbdo.intData()) + " while pushing, writing again");
+  }
+  return false; // Still pending, retried after the sync delay
+}
+
+//--------------------------
+// TELEMETRY
+
+void telemetryEvent(uint8_t type, int16_t value) {
+  if (telemetryCount == TELEMETRY_EVENTS) {
+    // Full, the oldest event makes room
+    telemetryHead = (telemetryHead + 1) % TELEMETRY_EVENTS;
+    telemetryCount--;
+    telemetryDropped++;
+  }
+  TelemetryEvent &event = telemetryRing[(telemetryHead + telemetryCount) % TELEMETRY_EVENTS];
+  event.uptime = millis() / 1000;
+  event.type = type;
+  event.value = value;
+  telemetryCount++;
+  if (telemetryCounts[type] < UINT16_MAX) telemetryCounts[type]++;
+}
+
+// The write is a TLS round trip, so it waits for the clock phase where the panel shows a
+// still frame. A window that never gets one is written anyway one window late.
+void telemetryTask() {
+  unsigned long now = millis();
+  if ((long)(now - telemetryDue) < 0) return;
+  if (!firebaseConnected || localPending) return; // Local content goes to Firebase first
+  if (!showClock && now - telemetryDue < TELEMETRY_WINDOW) return;
+  
+  if (uploadTelemetry()) {
+    telemetryDue = now + TELEMETRY_WINDOW;
   } else {
-    Serial.println("Failed to read selectedSentence: " + fbdo.errorReason());
+    telemetryDue = now + TELEMETRY_RETRY;
+  }
+}
+
+// Everything collected since the last write, as one PATCH of /status/<chip id>
+bool uploadTelemetry() {
+  if (!Firebase.ready()) return false;
+  
+  FirebaseJson json;
+  char path[32];
+  
+  time_t now = clockNow();
+  if (now) {
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    char iso[24];
+    strftime(iso, sizeof(iso), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    json.set("lastUpdate", iso);
   }
+  json.set("deviceOnline", true);
+  json.set("wifiConnected", wifiState == WIFI_STATE_CONNECTED);
+  json.set("firebaseConnected", firebaseConnected);
+  json.set("uptime", (int)(millis() / 1000));
+  json.set("freeHeap", (int)ESP.getFreeHeap());
   
-  // If display text is still loading message or default, set it to the selected sentence
-  if (totalSentences > 0 && (displayText == "Loading from Firebase..." || displayText == "Starting P10 Display...")) {
-    if (selectedSentence < totalSentences && sentences[selectedSentence].length() > 0) {
-      displayText = sentences[selectedSentence];
-      updated = true;
-      Serial.println("Set initial display text: " + displayText);
-    } else if (sentences[0].length() > 0) {
-      displayText = sentences[0];
-      selectedSentence = 0;
-      updated = true;
-      Serial.println("Using first sentence as default: " + displayText);
+  json.set("window/seconds", (int)((millis() - telemetryWindowStart) / 1000));
+  json.set("window/requestFailures", (int)(firebaseRequestFailures - telemetryFailureBase));
+  json.set("window/droppedEvents", (int)(telemetryDropped - telemetryDroppedBase));
+  for (int type = 0; type < TELEMETRY_TYPES; type++) {
+    snprintf(path, sizeof(path), "window/%s", telemetryTypeNames[type]);
+    json.set(path, (int)telemetryCounts[type]);
+  }
+  
+  // Replaces the events of the last window, an empty window removes them
+  int count = telemetryCount;
+  if (count == 0) {
+    json.set("events");
+  }
+  for (int i = 0; i < count; i++) {
+    const TelemetryEvent &event = telemetryRing[(telemetryHead + i) % TELEMETRY_EVENTS];
+    snprintf(path, sizeof(path), "events/[%d]/uptime", i);
+    json.set(path, (int)event.uptime);
+    snprintf(path, sizeof(path), "events/[%d]/type", i);
+    json.set(path, telemetryTypeNames[event.type]);
+    snprintf(path, sizeof(path), "events/[%d]/value", i);
+    json.set(path, (int)event.value);
+  }
+  
+  uint32_t requestStart = micros();
+  if (!recordFirebaseRequest(requestStart, Firebase.RTDB.updateNode(&fbdo, telemetryPath, &json))) {
+    Serial.println("Failed to write status: " + fbdo.errorReason());
+    return false;
+  }
+  
+  // Start the next window. After a failed write everything stays for the retry.
+  telemetryHead = (telemetryHead + count) % TELEMETRY_EVENTS;
+  telemetryCount -= count;
+  memset(telemetryCounts, 0, sizeof(telemetryCounts));
+  telemetryDroppedBase = telemetryDropped;
+  telemetryFailureBase = firebaseRequestFailures;
+  telemetryWindowStart = millis();
+  telemetryUploads++;
+  Serial.println("Status written, " + String(count) + " event(s)");
+  return true;
+}
+
+//--------------------------
+// METRICS
+
+void recordTiming(TimingMetric &metric, uint32_t us) {
+  metric.count++;
+  metric.totalUs += us;
+  if (us > metric.maxUs) metric.maxUs = us;
+}
+
+void recordLoopTime(uint32_t us) {
+  int bucket = 0;
+  while (bucket < LOOP_BUCKETS && us > loopBucketsUs[bucket]) bucket++;
+  loopHistogram[bucket]++;
+  recordTiming(loopMetric, us);
+}
+
+// Returns ok so it can wrap the Firebase call in an if
+bool recordFirebaseRequest(uint32_t startUs, bool ok) {
+#ifdef P10_FAULTS
+  ok = faultFirebaseRequest(ok);
+#endif
+  recordTiming(firebaseRequestMetric, micros() - startUs);
+  if (!ok) firebaseRequestFailures++;
+  return ok;
+}
+
+void initMetricsServer() {
+  server.on("/metrics", HTTP_GET, handleMetricsPrometheus);
+  server.on("/metrics.json", HTTP_GET, handleMetricsJson);
+  initLocalApi();
+  server.begin();
+  Serial.println("Metrics on http://" + WiFi.localIP().toString() + "/metrics");
+}
+
+void webTask() {
+  if (wifiState == WIFI_STATE_CONNECTED) {
+    server.handleClient();
+  }
+}
+
+// Chunked response, the length is not known until the last line is formatted
+void metricsBegin(const char* contentType) {
+  metricsPos = 0;
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, contentType, "");
+}
+
+// snprintf into metricsChunk, which goes out first if the piece does not fit behind it
+void metricsAppend(const char* format, ...) {
+  va_list args;
+  while (true) {
+    va_start(args, format);
+    int written = vsnprintf(metricsChunk + metricsPos, sizeof(metricsChunk) - metricsPos, format, args);
+    va_end(args);
+    if (written < 0) return;
+    if (metricsPos + written < (int)sizeof(metricsChunk)) {
+      metricsPos += written;
+      return;
     }
+    if (metricsPos == 0) {
+      // Would be cut short, a broken line is worse than a missing one
+      metricsOverflows++;
+      Serial.printf("Metrics: %d byte line does not fit, left out\n", written);
+      return;
+    }
+    server.sendContent(metricsChunk, metricsPos);
+    metricsPos = 0;
   }
+}
+
+void metricsEnd() {
+  if (metricsPos > 0) server.sendContent(metricsChunk, metricsPos);
+  metricsPos = 0;
+  server.sendContent(""); // Ends the chunked response
+}
+
+void metricsAppendTiming(const char* name, const char* help, const TimingMetric &metric) {
+  metricsAppend("# HELP p10_%s_seconds %s\n# TYPE p10_%s_seconds summary\n", name, help, name);
+  metricsAppend("p10_%s_seconds_sum %.6f\n", name, metric.totalUs / 1e6);
+  metricsAppend("p10_%s_seconds_count %u\n", name, metric.count);
+  metricsAppend("# TYPE p10_%s_max_seconds gauge\np10_%s_max_seconds %.6f\n", name, name, metric.maxUs / 1e6);
+}
+
+void handleMetricsPrometheus() {
+  metricsBegin("text/plain; version=0.0.4");
   
-  // Only show error if we truly have no sentences
-  if (totalSentences == 0) {
-    Serial.println("No sentences available from Firebase");
-    if (displayText == "Loading from Firebase..." || displayText == "Starting P10 Display...") {
-      displayText = "No sentences in Firebase";
+  metricsAppend("# HELP p10_loop_duration_seconds Loop iterations that ran a task\n");
+  metricsAppend("# TYPE p10_loop_duration_seconds histogram\n");
+  uint32_t cumulative = 0;
+  for (int i = 0; i < LOOP_BUCKETS; i++) {
+    cumulative += loopHistogram[i];
+    metricsAppend("p10_loop_duration_seconds_bucket{le=\"%.4f\"} %u\n", loopBucketsUs[i] / 1e6, cumulative);
+  }
+  metricsAppend("p10_loop_duration_seconds_bucket{le=\"+Inf\"} %u\n", loopMetric.count);
+  metricsAppend("p10_loop_duration_seconds_sum %.6f\n", loopMetric.totalUs / 1e6);
+  metricsAppend("p10_loop_duration_seconds_count %u\n", loopMetric.count);
+  
+  metricsAppend("# HELP p10_scroll_jitter_seconds Scroll frame interval deviation from the step time\n");
+  metricsAppend("# TYPE p10_scroll_jitter_seconds summary\n");
+  metricsAppend("p10_scroll_jitter_seconds_sum %.6f\n", scrollJitterTotalUs / 1e6);
+  metricsAppend("p10_scroll_jitter_seconds_count %u\n", scrollFrames);
+  metricsAppend("# TYPE p10_scroll_jitter_max_seconds gauge\np10_scroll_jitter_max_seconds %.6f\n", scrollJitterMaxUs / 1e6);
+  metricsAppend("# HELP p10_scroll_skipped_pixels_total Pixels skipped to catch up after a stall\n");
+  metricsAppend("# TYPE p10_scroll_skipped_pixels_total counter\np10_scroll_skipped_pixels_total %u\n", scrollSkippedPixels);
+  metricsAppend("# HELP p10_frames_presented_total Frames copied to the panel, unchanged frames are skipped\n");
+  metricsAppend("# TYPE p10_frames_presented_total counter\np10_frames_presented_total %u\n", frame.presents);
+  
+  metricsAppendTiming("disp_loop", "Time spent in Disp.loop()", dispLoopMetric);
+  metricsAppendTiming("firebase_update", "Time spent in updateTextFromFirebase()", firebaseUpdateMetric);
+  metricsAppendTiming("flash_save", "Time spent in saveDataToEEPROM()", saveMetric);
+  metricsAppendTiming("firebase_request", "Firebase request latency", firebaseRequestMetric);
+  metricsAppendTiming("update_to_screen", "Content change until it is rendered", updateToScreenMetric);
+  metricsAppend("# TYPE p10_firebase_request_failures_total counter\np10_firebase_request_failures_total %u\n", firebaseRequestFailures);
+  metricsAppend("# HELP p10_sync_delay_seconds Wait before the next resubscribe or poll, backoff and jitter included\n");
+  metricsAppend("# TYPE p10_sync_delay_seconds gauge\np10_sync_delay_seconds %.3f\n", syncCadence.delay / 1e3);
+  metricsAppend("# HELP p10_telemetry_writes_total Status writes to /status/<chip id>\n");
+  metricsAppend("# TYPE p10_telemetry_writes_total counter\np10_telemetry_writes_total %u\n", telemetryUploads);
+  metricsAppend("# HELP p10_telemetry_dropped_total Events overwritten before they were written\n");
+  metricsAppend("# TYPE p10_telemetry_dropped_total counter\np10_telemetry_dropped_total %u\n", telemetryDropped);
+  
+  metricsAppend("# TYPE p10_status_messages_total counter\np10_status_messages_total %u\n", statusQueue.posted);
+  metricsAppend("# HELP p10_status_dropped_total Status messages pushed out of a full queue\n");
+  metricsAppend("# TYPE p10_status_dropped_total counter\np10_status_dropped_total %u\n", statusQueue.dropped);
+  metricsAppend("# HELP p10_clock_offset_seconds Last SNTP answer minus the device clock\n");
+  metricsAppend("# TYPE p10_clock_offset_seconds gauge\np10_clock_offset_seconds %.3f\n", timeKeeper.lastOffsetUs / 1e6);
+  metricsAppend("# HELP p10_clock_drift_ppm Crystal drift correction measured from SNTP\n");
+  metricsAppend("# TYPE p10_clock_drift_ppm gauge\np10_clock_drift_ppm %.3f\n", timeKeeper.driftPpb / 1e3);
+  metricsAppend("# TYPE p10_clock_sntp_samples_total counter\np10_clock_sntp_samples_total %u\n", timeKeeper.samples);
+  metricsAppend("# TYPE p10_clock_steps_total counter\np10_clock_steps_total %u\n", timeKeeper.steps);
+  
+  // Stages not reached yet are left out
+  const char* const bootStages[] = { "cache", "first_frame", "wifi", "time", "firebase", "first_sync" };
+  const uint32_t bootTimes[] = { bootTimeline.cacheLoaded, bootTimeline.firstFrame, bootTimeline.wifi,
+                                 bootTimeline.time, bootTimeline.firebase, bootTimeline.firstSync };
+  metricsAppend("# HELP p10_boot_stage_seconds Time after power on when a boot stage was reached\n");
+  metricsAppend("# TYPE p10_boot_stage_seconds gauge\n");
+  for (int i = 0; i < 6; i++) {
+    if (bootTimes[i]) metricsAppend("p10_boot_stage_seconds{stage=\"%s\"} %.3f\n", bootStages[i], bootTimes[i] / 1e3);
+  }
+  
+  metricsAppend("# TYPE p10_heap_free_bytes gauge\np10_heap_free_bytes %u\n", ESP.getFreeHeap());
+  metricsAppend("# TYPE p10_heap_min_free_bytes gauge\np10_heap_min_free_bytes %u\n", heapMinFree);
+  metricsAppend("# TYPE p10_heap_fragmentation_max_percent gauge\np10_heap_fragmentation_max_percent %u\n", heapFragmentationMax);
+  metricsAppend("# TYPE p10_flash_written_bytes_total counter\np10_flash_written_bytes_total %u\n", store.bytesWritten);
+  metricsAppend("# TYPE p10_flash_erases_total counter\np10_flash_erases_total %u\n", store.erases);
+  metricsAppend("# TYPE p10_wifi_disconnects_total counter\np10_wifi_disconnects_total %u\n", wifiDisconnects);
+  metricsAppend("# TYPE p10_stream_starts_total counter\np10_stream_starts_total %u\n", streamStarts);
+  metricsAppend("# TYPE p10_heap_max_block_bytes gauge\np10_heap_max_block_bytes %u\n", ESP.getMaxFreeBlockSize());
+  metricsAppend("# TYPE p10_uptime_seconds gauge\np10_uptime_seconds %lu\n", millis() / 1000);
+  metricsAppend("# HELP p10_metrics_overflows_total Lines left out of a response for not fitting the chunk buffer\n");
+  metricsAppend("# TYPE p10_metrics_overflows_total counter\np10_metrics_overflows_total %u\n", metricsOverflows);
+  metricsEnd();
+}
+
+void metricsAppendTimingJson(const char* name, const TimingMetric &metric) {
+  uint32_t avg = metric.count ? metric.totalUs / metric.count : 0;
+  metricsAppend("\"%s\":{\"count\":%u,\"avg_us\":%u,\"max_us\":%u},", name, metric.count, avg, metric.maxUs);
+}
+
+void handleMetricsJson() {
+  metricsBegin("application/json");
+  metricsAppend("{\"uptime_ms\":%lu,\"loop\":{\"buckets_us\":[", millis());
+  for (int i = 0; i < LOOP_BUCKETS; i++) {
+    metricsAppend("%s{\"le\":%u,\"count\":%u}", i ? "," : "", loopBucketsUs[i], loopHistogram[i]);
+  }
+  metricsAppend(",{\"le\":\"inf\",\"count\":%u}],", loopHistogram[LOOP_BUCKETS]);
+  uint32_t loopAvg = loopMetric.count ? loopMetric.totalUs / loopMetric.count : 0;
+  metricsAppend("\"count\":%u,\"avg_us\":%u,\"max_us\":%u},", loopMetric.count, loopAvg, loopMetric.maxUs);
+  
+  uint32_t jitterAvg = scrollFrames ? scrollJitterTotalUs / scrollFrames : 0;
+  metricsAppend("\"scroll_jitter\":{\"frames\":%u,\"avg_us\":%u,\"max_us\":%u,\"skipped_pixels\":%u},", 
+                scrollFrames, jitterAvg, scrollJitterMaxUs, scrollSkippedPixels);
+  metricsAppend("\"frames_presented\":%u,", frame.presents);
+  
+  metricsAppendTimingJson("disp_loop", dispLoopMetric);
+  metricsAppendTimingJson("firebase_update", firebaseUpdateMetric);
+  metricsAppendTimingJson("flash_save", saveMetric);
+  metricsAppendTimingJson("firebase_request", firebaseRequestMetric);
+  metricsAppendTimingJson("update_to_screen", updateToScreenMetric);
+  metricsAppend("\"firebase_request_failures\":%u,", firebaseRequestFailures);
+  metricsAppend("\"sync\":{\"interval_ms\":%lu,\"backoff_shift\":%d,\"delay_ms\":%lu},", 
+                (unsigned long)syncCadence.base, syncCadence.shift, (unsigned long)syncCadence.delay);
+  metricsAppend("\"telemetry\":{\"path\":\"%s\",\"writes\":%u,\"queued\":%d,\"dropped\":%u},", 
+                telemetryPath, telemetryUploads, telemetryCount, telemetryDropped);
+  metricsAppend("\"status\":{\"posted\":%u,\"queued\":%d,\"dropped\":%u},", 
+                statusQueue.posted, statusQueue.count, statusQueue.dropped);
+  metricsAppend("\"clock\":{\"set\":%s,\"offset_ms\":%ld,\"drift_ppm\":%.3f,\"sntp_samples\":%u,\"steps\":%u},", 
+                clockLocalSecond ? "true" : "false", (long)(timeKeeper.lastOffsetUs / 1000), timeKeeper.driftPpb / 1e3,
+                timeKeeper.samples, timeKeeper.steps);
+  metricsAppend("\"boot_ms\":{\"cache\":%u,\"first_frame\":%u,\"wifi\":%u,\"time\":%u,\"firebase\":%u,\"first_sync\":%u},", 
+                bootTimeline.cacheLoaded, bootTimeline.firstFrame, bootTimeline.wifi,
+                bootTimeline.time, bootTimeline.firebase, bootTimeline.firstSync);
+  metricsAppend("\"soak\":{\"flash_written\":%u,\"flash_erases\":%u,\"wifi_disconnects\":%u,\"stream_starts\":%u},", 
+                store.bytesWritten, store.erases, wifiDisconnects, streamStarts);
+  metricsAppend("\"heap\":{\"free\":%u,\"max_block\":%u,\"min_free\":%u,\"fragmentation_max\":%u},", 
+                ESP.getFreeHeap(), ESP.getMaxFreeBlockSize(), heapMinFree, heapFragmentationMax);
+  metricsAppend("\"metrics_overflows\":%u}", metricsOverflows);
+  metricsEnd();
+}
+
+#ifdef P10_FAULTS
+//--------------------------
+// FAULT INJECTION (build with -DP10_FAULTS, rates are set with PUT /api/faults)
+
+// Restores the settings after a restart and checks the flash content after an injected power cut
+void initFaults() {
+  FaultState saved;
+  bool valid = ESP.rtcUserMemoryRead(FAULT_RTC_BLOCK, (uint32_t*)&saved, sizeof(saved)) && 
+               saved.magic == FAULT_RTC_MAGIC && saved.crc == crc32(&saved, offsetof(FaultState, crc));
+  if (!valid) {
+    memset(&faults, 0, sizeof(faults));
+    faults.magic = FAULT_RTC_MAGIC;
+    saveFaults();
+    Serial.println("Fault injection ready, all rates 0");
+    return;
+  }
+  
+  faults = saved;
+  if (faults.expectedCrc) {
+    if (storeContentCrc() == faults.expectedCrc) {
+      faults.recoveries++;
+    } else {
+      faults.recoveryErrors++;
+      Serial.println("Flash content after the power cut does not match what was written before it");
     }
+    faults.expectedCrc = 0;
   }
+  saveFaults();
+  Serial.printf("Fault injection: %u power cut(s), %u recovered, %u error(s)\n", 
+                faults.powerCuts, faults.recoveries, faults.recoveryErrors);
+}
+
+void saveFaults() {
+  faults.crc = crc32(&faults, offsetof(FaultState, crc));
+  ESP.rtcUserMemoryWrite(FAULT_RTC_BLOCK, (uint32_t*)&faults, sizeof(faults));
+}
+
+bool faultHit(uint32_t percent) {
+  return percent > 0 && (uint32_t)random(100) < percent;
+}
+
+void faultTask() {
+  unsigned long now = millis();
   
-  if (updated) {
-    dataChanged = true;
-    Serial.println("Firebase update completed. Total sentences: " + String(totalSentences));
+  // The SDK call drops the link but keeps the saved credentials, unlike WiFi.disconnect()
+  if (faults.wifiDropSec && wifiState == WIFI_STATE_CONNECTED && now - faultLastWifiDrop >= faults.wifiDropSec * 1000) {
+    faultLastWifiDrop = now;
+    faults.wifiDrops++;
+    saveFaults();
+    Serial.println("Fault: WiFi dropped");
+    wifi_station_disconnect();
+  }
+  
+  if (faults.streamDropSec && streamActive && now - faultLastStreamDrop >= faults.streamDropSec * 1000) {
+    faultLastStreamDrop = now;
+    faultStreamDropPending = true;
+  }
+}
+
+// Wraps the result of a Firebase request, see recordFirebaseRequest()
+bool faultFirebaseRequest(bool ok) {
+  if (faults.firebaseDelayMs) {
+    faults.firebaseDelays++;
+    delay(faults.firebaseDelayMs);
   }
+  if (ok && faultHit(faults.firebaseFailPercent)) {
+    faults.firebaseFailures++;
+    Serial.println("Fault: Firebase request failed");
+    return false;
+  }
+  return ok;
+}
+
+bool faultTakeStreamDrop() {
+  if (!faultStreamDropPending) return false;
+  faultStreamDropPending = false;
+  faults.streamDrops++;
+  saveFaults();
+  Serial.println("Fault: stream read failed");
+  return true;
+}
+
+// Power lost in the middle of a record: half of it reaches flash, then the device restarts.
+// initFaults() compares what the store loads after the restart with what it held before.
+void faultPowerCut(uint32_t addr, uint32_t* record, uint32_t size) {
+  ESP.flashWrite(addr, record, (size / 2) & ~3);
+  faults.powerCuts++;
+  faults.expectedCrc = storeContentCrc();
+  if (!faults.expectedCrc) faults.expectedCrc = 1;
+  saveFaults();
+  Serial.println("Fault: power cut while writing flash");
+  ESP.restart();
+}
+
+void handleApiFaults() {
+  char body[512];
+  snprintf(body, sizeof(body), 
+           "{\"wifiDrop\":%u,\"streamDrop\":%u,\"firebaseFail\":%u,\"firebaseDelay\":%u,\"powerCut\":%u,"
+           "\"injected\":{\"wifiDrops\":%u,\"streamDrops\":%u,\"firebaseFailures\":%u,\"firebaseDelays\":%u,\"powerCuts\":%u},"
+           "\"recoveries\":%u,\"recoveryErrors\":%u,\"uptime\":%lu,\"heapMinFree\":%u,\"flashWritten\":%u}",
+           faults.wifiDropSec, faults.streamDropSec, faults.firebaseFailPercent, faults.firebaseDelayMs, faults.powerCutPercent,
+           faults.wifiDrops, faults.streamDrops, faults.firebaseFailures, faults.firebaseDelays, faults.powerCuts,
+           faults.recoveries, faults.recoveryErrors, millis() / 1000, heapMinFree, store.bytesWritten);
+  server.send(200, "application/json", body);
+}
+
+// PUT /api/faults?wifiDrop=600&streamDrop=300&firebaseFail=10&firebaseDelay=2000&powerCut=5
+void handleApiFaultsPut() {
+  if (server.hasArg("wifiDrop")) faults.wifiDropSec = server.arg("wifiDrop").toInt();
+  if (server.hasArg("streamDrop")) faults.streamDropSec = server.arg("streamDrop").toInt();
+  if (server.hasArg("firebaseFail")) faults.firebaseFailPercent = constrain(server.arg("firebaseFail").toInt(), 0, 100);
+  if (server.hasArg("firebaseDelay")) faults.firebaseDelayMs = constrain(server.arg("firebaseDelay").toInt(), 0, 30000);
+  if (server.hasArg("powerCut")) faults.powerCutPercent = constrain(server.arg("powerCut").toInt(), 0, 100);
+  saveFaults();
+  handleApiFaults();
 }
 
+#endif
+
 //--------------------------
-// TIME SYNCHRONIZATION
+// TIMEKEEPING
 
 void initTimeSync() {
-  displayMessage("Syncing time...");
-  
-  // Configure time with NTP servers
+  // Configure time with NTP servers. SNTP starts asking once WiFi is up, resyncs hourly on
+  // its own and calls onTimeSet() with each answer. configTime() also sets TZ for localtime_r().
+  settimeofday_cb(onTimeSet);
   configTime(gmtOffset_sec, daylightOffset_sec, "pool.ntp.org", "time.nist.gov");
   
-  // Wait for time to be set
-  int attempts = 0;
-  while (!time(nullptr) && attempts < 20) {
-    delay(500);
-    Serial.print(".");
-    attempts++;
+  if (restoreTimeFromRtc()) {
+    bootMark(bootTimeline.time, "time restored");
+    timeTick();
+  } else {
+    Serial.println("No saved time, the clock shows TIME ERROR until SNTP answers");
   }
+}
+
+// SNTP has just set the system time, which only serves as the sample for the device clock
+void onTimeSet() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  uint64_t localUs = micros64();
+  int64_t sntpUs = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+  if (sntpUs < TIME_VALID_US) return;
   
-  if (time(nullptr)) {
-    displayMessage("Time synced!");
-    Serial.println("\nTime synchronized successfully");
+  bool wasSet = (timeKeeper.refEpochUs != 0);
+  int64_t offset = timeKeeper.sample(sntpUs, localUs);
+  if (wasSet) {
+    Serial.printf("SNTP offset %ld ms, drift %.2f ppm\n", (long)(offset / 1000), timeKeeper.driftPpb / 1000.0);
   } else {
-    displayMessage("Time sync failed");
-    Serial.println("\nFailed to sync time");
+    Serial.println("Time synchronized successfully");
+  }
+  bootMark(bootTimeline.time, "time set");
+  timeTick();
+}
+
+// Refreshes clockLocal on every new second and keeps the RTC copy current
+void timeTick() {
+  uint64_t localUs = micros64();
+  int64_t now = timeKeeper.epochUs(localUs);
+  if (now < TIME_VALID_US) {
+    clockLocalSecond = 0;
+    return;
   }
   
-  delay(1000);
+  time_t second = now / 1000000;
+  if (second == clockLocalSecond) return;
+  localtime_r(&second, &clockLocal);
+  clockLocalSecond = second;
+  
+  if (localUs - timeKeeper.refLocalUs >= TIME_ANCHOR_US) timeKeeper.anchor(localUs);
+  saveTimeToRtc(localUs);
+}
+
+// Seconds since epoch, 0 while the clock is not set
+time_t clockNow() {
+  int64_t now = timeKeeper.epochUs(micros64());
+  return (now >= TIME_VALID_US) ? now / 1000000 : 0;
+}
+
+void saveTimeToRtc(uint64_t localUs) {
+  RtcTimeRecord record;
+  timeKeeper.save(record, localUs, system_get_rtc_time(), system_rtc_clock_cali_proc());
+  ESP.rtcUserMemoryWrite(TIME_RTC_BLOCK, (uint32_t*)&record, sizeof(record));
+}
+
+// After a reset the RTC counter tells how long the device was away, RTC memory holds the rest
+bool restoreTimeFromRtc() {
+  if (ESP.getResetInfoPtr()->reason == REASON_DEFAULT_RST) return false; // Power on, memory is random
+  
+  RtcTimeRecord record;
+  if (!ESP.rtcUserMemoryRead(TIME_RTC_BLOCK, (uint32_t*)&record, sizeof(record))) return false;
+  uint64_t gapUs = timeKeeper.restore(record, micros64(), system_get_rtc_time());
+  if (!gapUs) return false;
+  Serial.printf("Clock restored from RTC memory, %u ms after the last save\n", (uint32_t)(gapUs / 1000));
+  return true;
 }
 
 //--------------------------
 // DIGITAL CLOCK DISPLAY
 
 void displayDigitalClock() {
-  // Handle colon blinking
-  if (millis() - lastColonBlink >= colonBlinkInterval) {
-    colonBlink = !colonBlink;
-    lastColonBlink = millis();
-  }
+  // Colon blinking is toggled by clockTick()
   
-  // Get current time
-  time_t now = time(nullptr);
-  struct tm* timeinfo = localtime(&now);
-  
-  if (!timeinfo) {
-    Disp.clear();
-    Disp.setFont(ElektronMart6x12);
-    Disp.drawText(2, 4, "TIME ERROR");
-    return;
+  // Reads the local time timeTick() keeps, no localtime() call per frame
+  static bool timeValid = false;
+  if (timeValid != (clockLocalSecond != 0)) {
+    clockNeedsRedraw = true;
   }
+  timeValid = (clockLocalSecond != 0);
   
-  // Convert to 12-hour format
-  int hour = timeinfo->tm_hour;
-  int minute = timeinfo->tm_min;
+  int hour = clockLocal.tm_hour;
+  int minute = clockLocal.tm_min;
   
   // Convert 24-hour to 12-hour format
   if (hour == 0) {
@@ -751,31 +3502,69 @@ void displayDigitalClock() {
     hour = hour - 12; // Afternoon/Evening
   }
   
-  // Format time components separately for fixed positioning
-  String hourStr = (hour < 10) ? " " + String(hour) : String(hour);
-  String minStr = (minute < 10) ? "0" + String(minute) : String(minute);
+  if (!timeValid) {
+    if (clockNeedsRedraw) {
+      frame.clear();
+      frame.drawText(2, Panel::MESSAGE_Y, "TIME ERROR");
+      clockNeedsRedraw = false;
+    }
+    return;
+  }
   
-  // Clear display
-  Disp.clear();
-  Disp.setFont(ElektronMart6x12);
+  // Hour tens (blank below 10), hour ones, colon (blank when off), minute tens, minute ones
+  char cells[CLOCK_CELLS] = {
+    (char)(hour < 10 ? ' ' : '0' + hour / 10),
+    (char)('0' + hour % 10),
+    colonBlink ? ':' : ' ',
+    (char)('0' + minute / 10),
+    (char)('0' + minute % 10)
+  };
   
-  // Calculate fixed positions for each component
-  int hourWidth = Disp.textWidth(hourStr.c_str());
-  int colonWidth = Disp.textWidth(":");
-  int minWidth = Disp.textWidth(minStr.c_str());
+  // Cell widths include the 1 pixel gap drawText() leaves after every character
+  uint8_t widths[CLOCK_CELLS];
+  int totalWidth = 0;
+  for (int i = 0; i < CLOCK_CELLS; i++) {
+    if (i == 2) {
+      widths[i] = clockColonWidth + 1; // Keeps its space when blinked off
+    } else if (cells[i] == ' ') {
+      widths[i] = clockSpaceWidth + 1;
+    } else {
+      widths[i] = clockDigitWidth[cells[i] - '0'] + 1;
+    }
+    totalWidth += widths[i];
+  }
   
   // Total width for centering
-  int totalWidth = hourWidth + colonWidth + minWidth;
-  int startX = (32 - totalWidth) / 2;
-  int startY = (16 - 12) / 2;
-  
-  // Draw components at fixed positions
-  Disp.drawText(startX, startY, hourStr.c_str());
+  int x = (Panel::WIDTH - totalWidth) / 2;
+  if (x != clockCellX[0]) {
+    // Layout moved (hour went from 1 to 2 digits or digit widths differ), redraw everything
+    clockNeedsRedraw = true;
+  }
+  if (clockNeedsRedraw) {
+    frame.clear();
+  }
   
-  // Only draw colon when it should be visible
-  if (colonBlink) {
-    Disp.drawText(startX + hourWidth, startY, ":");
+  // Only cells whose character or position changed are redrawn
+  for (int i = 0; i < CLOCK_CELLS; i++) {
+    if (clockNeedsRedraw || cells[i] != clockCellChar[i] || x != clockCellX[i]) {
+      drawClockCell(x, cells[i], widths[i]);
+      clockCellChar[i] = cells[i];
+      clockCellX[i] = x;
+    }
+    x += widths[i];
   }
+  clockNeedsRedraw = false;
+}
+
+// Writes every pixel of the cell so the previous glyph does not need a clear
+void drawClockCell(int x, char c, uint8_t width) {
+  uint16_t glyph[32]; // Widest ElektronMart6x12 glyph is 6 columns
+  int glyphWidth = (c == ' ') ? 0 : fontGlyphColumns(ElektronMart6x12, (unsigned char)c, glyph);
   
-  Disp.drawText(startX + hourWidth + colonWidth, startY, minStr.c_str());
+  for (int col = 0; col < width; col++) {
+    uint16_t column = (col < glyphWidth) ? glyph[col] : 0;
+    for (int row = 0; row < 12; row++) {
+      frame.setPixel(x + col, CLOCK_Y + row, (column >> row) & 1);
+    }
+  }
 }
\ No newline at end of file
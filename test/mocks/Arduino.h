@@ -0,0 +1,508 @@
+// Host stand-in for the ESP8266 Arduino core, [env:native] builds src/main.cpp against it.
+// Time is virtual: it only moves when the firmware waits (delay(), yield()) or a mock charges
+// for slow I/O, so a test runs days of device time in seconds. String allocates from a counted
+// heap and ESP.getFreeHeap() reports what is left of it. Names starting with mock are the test
+// side, everything else has the signature of the core.
+#pragma once
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <MockClock.h>
+#include <pgmspace.h>
+#include <user_interface.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define F(s) (s)
+#define DEC 10
+#define HEX 16
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+using std::max;
+using std::min;
+
+//--------------------------
+// TIME
+
+inline std::function<void()> mockYieldHook; // Runs whenever the firmware hands over to the SDK
+
+inline unsigned long micros() { return (uint32_t)mockNowUs; } // Wraps after 71 minutes like the device
+inline uint64_t micros64() { return mockNowUs; }
+inline unsigned long millis() { return (uint32_t)(mockNowUs / 1000); }
+
+inline void yield() {
+  mockNowUs += 1;
+  if (mockYieldHook) mockYieldHook();
+}
+
+inline void delay(unsigned long ms) {
+  mockNowUs += (uint64_t)ms * 1000;
+  yield();
+}
+
+// Spins on the device, the CPU never idles through it
+inline uint64_t mockBusyWaitUs = 0;
+
+inline void delayMicroseconds(unsigned int us) {
+  mockNowUs += us;
+  mockBusyWaitUs += us;
+}
+
+// System time as settimeofday() left it: epoch microseconds at micros64() == 0. Zero until SNTP
+// answers, so gettimeofday() counts from 1970 like the device does before the first answer.
+inline int64_t mockSystemTimeUs = 0;
+inline std::function<void()> mockTimeSetCallback; // settimeofday_cb()
+
+inline int mockGettimeofday(struct timeval* tv, void*) {
+  int64_t now = mockSystemTimeUs + (int64_t)mockNowUs;
+  tv->tv_sec = (time_t)(now / 1000000);
+  tv->tv_usec = (suseconds_t)(now % 1000000);
+  return 0;
+}
+#define gettimeofday mockGettimeofday
+
+// An SNTP answer arriving now, with the server's time in epoch microseconds
+inline void mockSntpAnswer(int64_t epochUs) {
+  mockSystemTimeUs = epochUs - (int64_t)mockNowUs;
+  if (mockTimeSetCallback) mockTimeSetCallback();
+}
+
+inline void configTime(int timezone, int daylightOffset_sec, const char*, const char* = nullptr, const char* = nullptr) {
+  // POSIX TZ counts east of UTC as negative
+  char tz[16];
+  snprintf(tz, sizeof(tz), "UTC%+d", -(timezone + daylightOffset_sec) / 3600);
+  setenv("TZ", tz, 1);
+  tzset();
+}
+
+//--------------------------
+// RANDOM
+
+inline uint32_t mockRandomState = 2463534242u; // xorshift32, the same sequence every run
+
+inline long random(long howbig) {
+  if (howbig <= 0) return 0;
+  mockRandomState ^= mockRandomState << 13;
+  mockRandomState ^= mockRandomState >> 17;
+  mockRandomState ^= mockRandomState << 5;
+  return (long)(mockRandomState % (uint32_t)howbig);
+}
+
+inline long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return howsmall + random(howbig - howsmall);
+}
+
+inline void randomSeed(unsigned long seed) {
+  if (seed != 0) mockRandomState = (uint32_t)seed;
+}
+
+//--------------------------
+// HEAP
+
+const uint32_t MOCK_HEAP_SIZE = 40000; // Free heap after setup() on the device, roughly
+
+struct MockHeap {
+  uint32_t used;        // Bytes allocated now
+  uint32_t peak;        // Most bytes allocated at once
+  uint32_t allocations; // Allocations since power on, for allocs per frame
+};
+inline MockHeap mockHeap;
+
+inline void* mockAlloc(size_t size) {
+  mockHeap.used += size;
+  mockHeap.peak = max(mockHeap.peak, mockHeap.used);
+  mockHeap.allocations++;
+  return malloc(size);
+}
+
+inline void mockFree(void* p, size_t size) {
+  if (!p) return;
+  mockHeap.used -= size;
+  free(p);
+}
+
+//--------------------------
+// STRING
+
+class String {
+ public:
+  String() { init(); }
+  String(const char* s) { init(); if (s) copy(s, strlen(s)); }
+  String(const String& s) { init(); copy(s.c_str(), s.len); }
+  String(String&& s) { init(); take(s); }
+  explicit String(char c) { init(); copy(&c, 1); }
+  explicit String(unsigned char v, unsigned char base = 10) { init(); number((unsigned long long)v, base); }
+  explicit String(int v, unsigned char base = 10) { init(); number((long long)v, base); }
+  explicit String(unsigned int v, unsigned char base = 10) { init(); number((unsigned long long)v, base); }
+  explicit String(long v, unsigned char base = 10) { init(); number((long long)v, base); }
+  explicit String(unsigned long v, unsigned char base = 10) { init(); number((unsigned long long)v, base); }
+  explicit String(long long v, unsigned char base = 10) { init(); number(v, base); }
+  explicit String(unsigned long long v, unsigned char base = 10) { init(); number(v, base); }
+  explicit String(float v, unsigned char decimals = 2) { init(); real(v, decimals); }
+  explicit String(double v, unsigned char decimals = 2) { init(); real(v, decimals); }
+  ~String() { release(); }
+
+  String& operator=(const String& s) {
+    if (this != &s) copy(s.c_str(), s.len);
+    return *this;
+  }
+  String& operator=(String&& s) {
+    if (this != &s) { release(); init(); take(s); }
+    return *this;
+  }
+  String& operator=(const char* s) {
+    if (s) copy(s, strlen(s)); else copy("", 0);
+    return *this;
+  }
+
+  const char* c_str() const { return heap ? heap : sso; }
+  unsigned int length() const { return len; }
+  bool isEmpty() const { return len == 0; }
+  void clear() { len = 0; buffer()[0] = 0; }
+
+  bool reserve(unsigned int size) {
+    if (size <= capacity) return true;
+    char* grown = (char*)mockAlloc(size + 1);
+    memcpy(grown, c_str(), len + 1);
+    if (heap) mockFree(heap, capacity + 1);
+    heap = grown;
+    capacity = size;
+    return true;
+  }
+
+  bool concat(const char* s, unsigned int n) {
+    reserve(len + n);
+    memmove(buffer() + len, s, n);
+    len += n;
+    buffer()[len] = 0;
+    return true;
+  }
+  bool concat(const String& s) { return concat(s.c_str(), s.len); }
+  bool concat(const char* s) { return s ? concat(s, strlen(s)) : false; }
+  bool concat(char c) { return concat(&c, 1); }
+  template <class T> bool concat(T v) { return concat(String(v)); }
+
+  template <class T> String& operator+=(const T& v) { concat(v); return *this; }
+
+  char operator[](unsigned int i) const { return i < len ? c_str()[i] : 0; }
+  char& operator[](unsigned int i) { return buffer()[i]; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  int indexOf(char c, unsigned int from = 0) const {
+    if (from >= len) return -1;
+    const char* p = strchr(c_str() + from, c);
+    return p ? (int)(p - c_str()) : -1;
+  }
+  int indexOf(const char* s, unsigned int from = 0) const {
+    if (from > len) return -1;
+    const char* p = strstr(c_str() + from, s);
+    return p ? (int)(p - c_str()) : -1;
+  }
+  int indexOf(const String& s, unsigned int from = 0) const { return indexOf(s.c_str(), from); }
+
+  bool startsWith(const char* s) const { return strncmp(c_str(), s, strlen(s)) == 0; }
+  bool startsWith(const String& s) const { return startsWith(s.c_str()); }
+  bool endsWith(const char* s) const {
+    size_t n = strlen(s);
+    return n <= len && strcmp(c_str() + len - n, s) == 0;
+  }
+  bool endsWith(const String& s) const { return endsWith(s.c_str()); }
+
+  String substring(unsigned int from) const { return substring(from, len); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    to = min(to, len);
+    String out;
+    if (from < to) out.copy(c_str() + from, to - from);
+    return out;
+  }
+
+  void trim() {
+    unsigned int start = 0;
+    while (start < len && isspace((unsigned char)c_str()[start])) start++;
+    unsigned int end = len;
+    while (end > start && isspace((unsigned char)c_str()[end - 1])) end--;
+    memmove(buffer(), c_str() + start, end - start);
+    len = end - start;
+    buffer()[len] = 0;
+  }
+
+  long toInt() const { return atol(c_str()); }
+  float toFloat() const { return (float)atof(c_str()); }
+  double toDouble() const { return atof(c_str()); }
+
+  bool equals(const char* s) const { return strcmp(c_str(), s ? s : "") == 0; }
+  bool operator==(const String& s) const { return len == s.len && equals(s.c_str()); }
+  bool operator==(const char* s) const { return equals(s); }
+  bool operator!=(const String& s) const { return !(*this == s); }
+  bool operator!=(const char* s) const { return !equals(s); }
+  bool operator<(const String& s) const { return strcmp(c_str(), s.c_str()) < 0; }
+
+ private:
+  static const unsigned int SSO_SIZE = 11; // Characters kept inside the object, like the core's String
+
+  char sso[SSO_SIZE + 1];
+  char* heap;
+  unsigned int capacity;
+  unsigned int len;
+
+  char* buffer() { return heap ? heap : sso; }
+
+  void init() {
+    sso[0] = 0;
+    heap = nullptr;
+    capacity = SSO_SIZE;
+    len = 0;
+  }
+
+  void release() {
+    if (heap) mockFree(heap, capacity + 1);
+    heap = nullptr;
+  }
+
+  void copy(const char* s, unsigned int n) {
+    if (n > capacity) {
+      // Grow without keeping the old content, which may be s itself
+      char* grown = (char*)mockAlloc(n + 1);
+      memcpy(grown, s, n);
+      release();
+      heap = grown;
+      capacity = n;
+    } else {
+      memmove(buffer(), s, n);
+    }
+    len = n;
+    buffer()[len] = 0;
+  }
+
+  void take(String& s) {
+    if (s.heap) {
+      heap = s.heap;
+      capacity = s.capacity;
+      len = s.len;
+      s.init();
+    } else {
+      copy(s.sso, s.len);
+    }
+  }
+
+  void number(long long v, unsigned char base) {
+    if (base == 10 || v >= 0) { numberText(v < 0 ? -(unsigned long long)v : (unsigned long long)v, base, v < 0); return; }
+    numberText((unsigned long long)(uint32_t)v, base, false); // The core prints negative hex as 32 bits
+  }
+  void number(unsigned long long v, unsigned char base) { numberText(v, base, false); }
+  void numberText(unsigned long long v, unsigned char base, bool negative) {
+    char text[72];
+    char* p = text + sizeof(text) - 1;
+    *p = 0;
+    do {
+      int digit = v % base;
+      *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+      v /= base;
+    } while (v > 0);
+    if (negative) *--p = '-';
+    copy(p, strlen(p));
+  }
+  void real(double v, unsigned char decimals) {
+    char text[48];
+    snprintf(text, sizeof(text), "%.*f", decimals, v);
+    copy(text, strlen(text));
+  }
+};
+
+inline String operator+(const String& a, const String& b) { String s(a); s.concat(b); return s; }
+inline String operator+(const String& a, const char* b) { String s(a); s.concat(b); return s; }
+inline String operator+(const char* a, const String& b) { String s(a); s.concat(b); return s; }
+inline String operator+(const String& a, char b) { String s(a); s.concat(b); return s; }
+
+//--------------------------
+// PRINT
+
+inline const bool mockSerialEcho = getenv("P10_SERIAL") != nullptr; // Set P10_SERIAL=1 to see the log
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned int v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(double v, int digits = 2) { return print(String(v, (unsigned char)digits)); }
+
+  size_t println() { return write("\r\n"); }
+  template <class T> size_t println(const T& v) { return print(v) + println(); }
+  template <class T> size_t println(const T& v, int format) { return print(v, format) + println(); }
+
+  size_t printf(const char* format, ...) {
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    return write((const uint8_t*)text, min<size_t>(n, sizeof(text) - 1));
+  }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+};
+
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override {
+    if (mockSerialEcho) fputc(c, stdout);
+    return 1;
+  }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    if (mockSerialEcho) fwrite(buffer, 1, size, stdout);
+    return size;
+  }
+  using Print::write;
+};
+inline HardwareSerial Serial;
+
+//--------------------------
+// FLASH
+
+// NOR flash the way the chip behaves: erasing sets a 4 KB sector to 0xFF, writing can only clear
+// bits. Counts erases per sector and bytes written, and can cut a write short like a power loss.
+// Erases and writes take their time on the virtual clock.
+class MockFlash {
+ public:
+  static const uint32_t SIZE = 0x400000; // 4 MB, eagle.flash.4m1m.ld
+  static const uint32_t SECTOR = 0x1000;
+
+  uint32_t eraseUs = 30000;   // Sector erase
+  uint32_t writeUs = 20;      // Per write call, plus writeUsPerKB for the bytes
+  uint32_t writeUsPerKB = 2800;
+  int32_t tearAfter = -1;     // Bytes of the next write that get through before power is lost, -1 = none
+  uint32_t failWrites = 0;    // Next writes that fail without writing anything, as on a worn sector
+  uint64_t bytesWritten = 0;
+  uint32_t eraseCount = 0;
+
+  bool read(uint32_t address, void* out, size_t size) {
+    if (!valid(address, size)) return false;
+    memcpy(out, &bytes()[address], size);
+    return true;
+  }
+
+  bool write(uint32_t address, const void* in, size_t size) {
+    if (!valid(address, size)) return false;
+    if (failWrites) {
+      failWrites--;
+      return false;
+    }
+    size_t n = size;
+    if (tearAfter >= 0) n = min<size_t>(size, (size_t)tearAfter);
+    const uint8_t* data = (const uint8_t*)in;
+    for (size_t i = 0; i < n; i++) bytes()[address + i] &= data[i];
+    bytesWritten += n;
+    mockNowUs += writeUs + (uint64_t)n * writeUsPerKB / 1024;
+    if (tearAfter >= 0) {
+      tearAfter = -1;
+      throw MockPowerLoss();
+    }
+    return true;
+  }
+
+  bool eraseSector(uint32_t sector) {
+    if (sector >= SIZE / SECTOR) return false;
+    memset(&bytes()[sector * SECTOR], 0xFF, SECTOR);
+    erases[sector]++;
+    eraseCount++;
+    mockNowUs += eraseUs;
+    return true;
+  }
+
+  uint32_t sectorErases(uint32_t sector) const { return erases[sector]; }
+
+  // Power on with a blank chip
+  void reset() {
+    data.clear();
+    std::fill(erases, erases + SIZE / SECTOR, 0);
+    bytesWritten = 0;
+    eraseCount = 0;
+    tearAfter = -1;
+    failWrites = 0;
+  }
+
+  struct MockPowerLoss {}; // The write was cut short, the test boots the firmware again
+
+ private:
+  std::vector<uint8_t> data;
+  uint32_t erases[SIZE / SECTOR] = {};
+
+  std::vector<uint8_t>& bytes() {
+    if (data.empty()) data.assign(SIZE, 0xFF);
+    return data;
+  }
+
+  // The SDK only takes word aligned addresses and sizes
+  static bool valid(uint32_t address, size_t size) {
+    return address % 4 == 0 && size % 4 == 0 && address + size <= SIZE;
+  }
+};
+inline MockFlash mockFlash;
+
+//--------------------------
+// ESP
+
+struct MockRestart {}; // ESP.restart(), the test boots the firmware again
+
+inline rst_info mockResetInfo = { REASON_DEFAULT_RST, 0, 0, 0, 0, 0, 0 };
+inline uint8_t mockRtcMemory[512]; // RTC user memory, survives everything but a power cut
+
+class EspClass {
+ public:
+  uint32_t getFreeHeap() { return MOCK_HEAP_SIZE - mockHeap.used; }
+  uint32_t getMaxFreeBlockSize() { return getFreeHeap(); } // The host heap does not fragment
+  uint8_t getHeapFragmentation() { return 0; }
+  uint32_t getChipId() { return 0x00A1B2C3; } // 24 bits, from the MAC address on the device
+  rst_info* getResetInfoPtr() { return &mockResetInfo; }
+  [[noreturn]] void restart() { throw MockRestart(); }
+  uint32_t random() { return (uint32_t)::random(0x7fffffff); }
+
+  bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size) {
+    if (offset * 4 + size > sizeof(mockRtcMemory)) return false;
+    memcpy(data, mockRtcMemory + offset * 4, size);
+    return true;
+  }
+  bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size) {
+    if (offset * 4 + size > sizeof(mockRtcMemory)) return false;
+    memcpy(mockRtcMemory + offset * 4, data, size);
+    return true;
+  }
+
+  bool flashRead(uint32_t address, uint32_t* data, size_t size) { return mockFlash.read(address, data, size); }
+  bool flashWrite(uint32_t address, const uint32_t* data, size_t size) { return mockFlash.write(address, data, size); }
+  bool flashEraseSector(uint32_t sector) { return mockFlash.eraseSector(sector); }
+};
+inline EspClass ESP;
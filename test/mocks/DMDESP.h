@@ -0,0 +1,97 @@
+// The panel as a pixel array the tests read back. loop() is one scan of the panel: it counts
+// scans and calls mockOnScan, so a test sees exactly what the LEDs would show at that moment.
+#pragma once
+#include <Arduino.h>
+#include <string>
+
+class DMDESP {
+ public:
+  DMDESP(byte panelsWide, byte panelsHigh)
+      : mockWidth(32 * panelsWide), mockHeight(16 * panelsHigh), pixels(mockWidth * mockHeight, 0) {}
+
+  void start() {}
+  void setBrightness(uint16_t) {}
+  void setFont(const uint8_t* f) { font = f; }
+
+  void loop() {
+    mockScans++;
+    if (mockOnScan) mockOnScan();
+  }
+
+  void clear() { std::fill(pixels.begin(), pixels.end(), 0); }
+
+  void setPixel(uint16_t x, uint16_t y, uint8_t color = 1) {
+    mockPixelWrites++;
+    if (x < mockWidth && y < mockHeight) pixels[y * mockWidth + x] = color ? 1 : 0;
+  }
+
+  void drawText(int x, int y, String text, uint8_t color = 1) {
+    for (const char* p = text.c_str(); *p; p++) {
+      uint16_t columns[16];
+      int width = glyph((unsigned char)*p, columns);
+      for (int i = 0; i < width; i++) {
+        for (int row = 0; row < 16; row++) {
+          if ((columns[i] >> row) & 1 && x + i >= 0 && y + row >= 0) setPixel(x + i, y + row, color);
+        }
+      }
+      x += width + 1;
+    }
+  }
+
+  int textWidth(String text) {
+    int width = 0;
+    uint16_t columns[16];
+    for (const char* p = text.c_str(); *p; p++) width += glyph((unsigned char)*p, columns) + 1;
+    return width;
+  }
+
+  //--------------------------
+  // TEST SIDE
+
+  bool mockPixel(int x, int y) const { return pixels[y * mockWidth + x]; }
+
+  // One row as '#' and '.', for golden frames
+  std::string mockRow(int y) const {
+    std::string row;
+    for (int x = 0; x < mockWidth; x++) row += mockPixel(x, y) ? '#' : '.';
+    return row;
+  }
+
+  const int mockWidth;
+  const int mockHeight;
+  uint32_t mockScans = 0;
+  uint32_t mockPixelWrites = 0;
+  std::function<void()> mockOnScan;
+
+ private:
+  std::vector<uint8_t> pixels;
+  const uint8_t* font = nullptr;
+
+  // DMD variable width font, the last byte row bottom aligned
+  int glyph(unsigned char c, uint16_t* columns) {
+    if (!font) return 0;
+    uint8_t height = font[3], first = font[4], count = font[5];
+    uint8_t bytes = (height + 7) / 8;
+    bool blank = c == ' ';
+    if (blank) c = 'n';
+    if (c < first || c >= first + count) return 0;
+    c -= first;
+    int index = 0;
+    for (int i = 0; i < c; i++) index += font[6 + i];
+    index = index * bytes + count + 6;
+    int width = font[6 + c];
+    for (int j = 0; j < width; j++) {
+      uint16_t column = 0;
+      for (int i = 0; i < bytes && !blank; i++) {
+        uint8_t data = font[index + j + i * width];
+        int offset = (i == bytes - 1 && bytes > 1) ? height - 8 : i * 8;
+        for (int k = 0; k < 8; k++) {
+          int row = offset + k;
+          if (row >= i * 8 && row < height && (data & (1 << k))) column |= 1 << row;
+        }
+      }
+      columns[j] = column;
+    }
+    return width;
+  }
+};
@@ -0,0 +1,23 @@
+// The legacy settings area, only ever read back
+#pragma once
+#include <Arduino.h>
+
+class EEPROMClass {
+ public:
+  void begin(size_t size) { bytes.resize(size, 0xFF); }
+  void end() {}
+  bool commit() { return true; }
+  uint8_t read(int address) { return bytes[address]; }
+  void write(int address, uint8_t value) { bytes[address] = value; }
+  template <class T> T& get(int address, T& t) {
+    memcpy(&t, &bytes[address], sizeof(T));
+    return t;
+  }
+  template <class T> const T& put(int address, const T& t) {
+    memcpy(&bytes[address], &t, sizeof(T));
+    return t;
+  }
+ private:
+  std::vector<uint8_t> bytes;
+};
+inline EEPROMClass EEPROM;
@@ -0,0 +1,141 @@
+// Route table of the web server. mockRequest() plays a client: the body arrives in raw chunks
+// the size the core uses, and the reply is collected into a MockResponse.
+#pragma once
+#include <ESP8266WiFi.h>
+#include <string>
+#include <utility>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+enum HTTPRawStatus { RAW_START, RAW_WRITE, RAW_END, RAW_ABORTED };
+
+#define HTTP_RAW_BUFLEN 1436
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+struct HTTPRaw {
+  HTTPRawStatus status;
+  size_t totalSize;
+  size_t currentSize;
+  uint8_t buf[HTTP_RAW_BUFLEN];
+};
+
+struct MockResponse {
+  int status = 0;
+  std::string contentType;
+  std::string body;
+  bool chunked = false;
+  size_t sends = 0;      // send() and sendContent() calls
+  size_t largestSend = 0; // Biggest piece handed to the server at once
+};
+
+class ESP8266WebServer {
+ public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  ESP8266WebServer(int) {}
+
+  void on(const String& uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+  void on(const String& uri, HTTPMethod method, THandlerFunction handler) { on(uri, method, handler, nullptr); }
+  void on(const String& uri, HTTPMethod method, THandlerFunction handler, THandlerFunction upload) {
+    routes.push_back({ uri.c_str(), method, handler, upload });
+  }
+
+  void begin() { running = true; }
+  void stop() { running = false; }
+  void handleClient() {}
+
+  bool hasArg(const String& name) {
+    for (auto& a : args) if (a.first == name.c_str()) return true;
+    return false;
+  }
+  String arg(const String& name) {
+    for (auto& a : args) if (a.first == name.c_str()) return String(a.second.c_str());
+    return String();
+  }
+
+  HTTPRaw& raw() { return rawBody; }
+
+  void setContentLength(size_t length) { contentLength = length; }
+
+  void send(int code, const char* contentType, const String& content) {
+    send(code, contentType, content.c_str(), content.length());
+  }
+  void send(int code, const char* contentType, const char* content) { send(code, contentType, content, strlen(content)); }
+
+  void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+  void sendContent(const char* content) { sendContent(content, strlen(content)); }
+  void sendContent(const char* content, size_t size) {
+    response.body.append(content, size);
+    response.sends++;
+    response.largestSend = max(response.largestSend, size);
+  }
+
+  // A client request, query is "a=1&b=2", body is sent in HTTP_RAW_BUFLEN chunks
+  MockResponse mockRequest(HTTPMethod method, const char* uri, const char* query = "", const char* body = nullptr) {
+    response = MockResponse();
+    contentLength = 0;
+    args.clear();
+    parseQuery(query);
+    for (auto& route : routes) {
+      if (route.uri != uri || (route.method != HTTP_ANY && route.method != method)) continue;
+      if (route.upload && body) {
+        size_t total = strlen(body);
+        rawBody.totalSize = 0;
+        rawBody.currentSize = 0;
+        rawBody.status = RAW_START;
+        route.upload();
+        for (size_t at = 0; at < total; at += HTTP_RAW_BUFLEN) {
+          rawBody.currentSize = min<size_t>(HTTP_RAW_BUFLEN, total - at);
+          memcpy(rawBody.buf, body + at, rawBody.currentSize);
+          rawBody.totalSize += rawBody.currentSize;
+          rawBody.status = RAW_WRITE;
+          route.upload();
+        }
+        rawBody.currentSize = 0;
+        rawBody.status = RAW_END;
+        route.upload();
+      }
+      route.handler();
+      return response;
+    }
+    response.status = 404;
+    return response;
+  }
+
+  bool running = false;
+
+ private:
+  struct Route {
+    std::string uri;
+    HTTPMethod method;
+    THandlerFunction handler;
+    THandlerFunction upload;
+  };
+
+  std::vector<Route> routes;
+  std::vector<std::pair<std::string, std::string>> args;
+  HTTPRaw rawBody;
+  MockResponse response;
+  size_t contentLength = 0;
+
+  void send(int code, const char* contentType, const char* content, size_t size) {
+    response.status = code;
+    response.contentType = contentType;
+    response.chunked = contentLength == CONTENT_LENGTH_UNKNOWN;
+    response.body.clear();
+    sendContent(content, size);
+  }
+
+  void parseQuery(const char* query) {
+    std::string text(query);
+    size_t start = 0;
+    while (start < text.size()) {
+      size_t end = text.find('&', start);
+      if (end == std::string::npos) end = text.size();
+      std::string pair = text.substr(start, end - start);
+      size_t eq = pair.find('=');
+      if (eq == std::string::npos) args.push_back({ pair, "" });
+      else args.push_back({ pair.substr(0, eq), pair.substr(eq + 1) });
+      start = end + 1;
+    }
+  }
+};
@@ -0,0 +1,50 @@
+// Arduino view of the fake station in user_interface.h
+#pragma once
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_WRONG_PASSWORD = 6,
+  WL_DISCONNECTED = 7
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } WiFiMode_t;
+
+class IPAddress {
+ public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : octets{ a, b, c, d } {}
+  String toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+    return String(text);
+  }
+ private:
+  uint8_t octets[4];
+};
+
+class WiFiClass {
+ public:
+  wl_status_t status() { return mockStation.up() ? WL_CONNECTED : WL_DISCONNECTED; }
+  bool mode(WiFiMode_t) { return true; }
+  wl_status_t begin() {
+    mockStation.connect();
+    return status();
+  }
+  bool reconnect() {
+    mockStation.connect();
+    return true;
+  }
+  bool disconnect(bool = false) {
+    mockStation.drop();
+    mockStation.connecting = false;
+    return true;
+  }
+  IPAddress localIP() { return mockStation.up() ? IPAddress(192, 168, 1, 23) : IPAddress(); }
+  IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+};
+inline WiFiClass WiFi;
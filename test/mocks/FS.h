@@ -0,0 +1,153 @@
+// In-memory filesystem with the Arduino FS interface. Files live as long as the FS object, so
+// they survive a restart of the firmware the way flash does.
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FSInfo {
+  size_t totalBytes;
+  size_t usedBytes;
+  size_t blockSize;
+  size_t pageSize;
+  size_t maxOpenFiles;
+  size_t maxPathLength;
+};
+
+// What a filesystem holds, shared by the FS object and its open files
+class FSImpl {
+ public:
+  FSImpl(uint32_t size, uint32_t block) : size(size), block(block) {}
+  virtual ~FSImpl() {}
+
+  uint32_t size;
+  uint32_t block;
+  std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+
+  // Whole blocks per file plus two for the superblock, like littlefs
+  size_t used() const {
+    size_t bytes = 2 * block;
+    for (auto& file : files) bytes += (file.second->size() + block - 1) / block * block;
+    return bytes;
+  }
+};
+typedef std::shared_ptr<FSImpl> FSImplPtr;
+
+class File : public Stream {
+ public:
+  File() {}
+  File(FSImplPtr fs, std::shared_ptr<std::vector<uint8_t>> data, size_t pos, bool append)
+      : fs(fs), data(data), pos(pos), append(append) {}
+
+  operator bool() const { return (bool)data; }
+  size_t size() const { return data ? data->size() : 0; }
+  size_t position() const { return pos; }
+  void close() { data.reset(); }
+  void flush() {}
+
+  bool seek(uint32_t offset, SeekMode mode = SeekSet) {
+    if (!data) return false;
+    size_t base = mode == SeekSet ? 0 : mode == SeekCur ? pos : data->size();
+    if (base + offset > data->size()) return false;
+    pos = base + offset;
+    return true;
+  }
+
+  size_t read(uint8_t* buffer, size_t size) {
+    if (!data || pos >= data->size()) return 0;
+    size_t n = min(size, data->size() - pos);
+    memcpy(buffer, data->data() + pos, n);
+    pos += n;
+    return n;
+  }
+  int read() override {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  int peek() override { return data && pos < data->size() ? (*data)[pos] : -1; }
+  int available() override { return data ? (int)(data->size() - pos) : 0; }
+
+  size_t write(const uint8_t* buffer, size_t size) override {
+    if (!data) return 0;
+    if (append) pos = data->size();
+    size_t end = pos + size;
+    if (end > data->size()) {
+      // Only what fits in the free blocks gets written
+      size_t free = fs->size > fs->used() ? fs->size - fs->used() : 0;
+      size_t grow = min(end - data->size(), free);
+      end = data->size() + grow;
+      data->resize(end);
+      size = end - pos;
+    }
+    memcpy(data->data() + pos, buffer, size);
+    pos += size;
+    return size;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  using Print::write;
+
+  bool truncate(uint32_t size) {
+    if (!data || size > data->size()) return false;
+    data->resize(size);
+    pos = min<size_t>(pos, size);
+    return true;
+  }
+
+ private:
+  FSImplPtr fs;
+  std::shared_ptr<std::vector<uint8_t>> data;
+  size_t pos = 0;
+  bool append = false;
+};
+
+class FS {
+ public:
+  FS(FSImplPtr impl) : impl(impl) {}
+
+  bool begin() { return true; }
+  void end() {}
+  bool format() {
+    impl->files.clear();
+    return true;
+  }
+
+  bool info(FSInfo& info) {
+    info = { impl->size, impl->used(), impl->block, 256, 5, 32 };
+    return true;
+  }
+
+  File open(const char* path, const char* mode) {
+    auto found = impl->files.find(path);
+    bool exists = found != impl->files.end();
+    if (mode[0] == 'r') {
+      if (!exists) return File();
+      return File(impl, found->second, 0, false);
+    }
+    if (!exists || mode[0] == 'w') {
+      if (impl->used() + impl->block > impl->size && !exists) return File();
+      auto data = std::make_shared<std::vector<uint8_t>>();
+      impl->files[path] = data;
+      return File(impl, data, 0, mode[0] == 'a');
+    }
+    return File(impl, found->second, found->second->size(), true);
+  }
+  File open(const String& path, const char* mode) { return open(path.c_str(), mode); }
+
+  bool exists(const char* path) { return impl->files.count(path) > 0; }
+  bool exists(const String& path) { return exists(path.c_str()); }
+  bool remove(const char* path) { return impl->files.erase(path) > 0; }
+
+  bool rename(const char* from, const char* to) {
+    auto found = impl->files.find(from);
+    if (found == impl->files.end()) return false;
+    auto data = found->second;
+    impl->files.erase(found);
+    impl->files[to] = data;
+    return true;
+  }
+
+  FSImplPtr impl;
+};
@@ -0,0 +1,417 @@
+// Realtime Database behind the Firebase client API. mockRtdb holds the tree; writes from the
+// firmware and from the test (the "console") reach open streams as put and patch events after
+// eventDelayUs. Every request costs latencyUs on the virtual clock, the way the blocking TLS round
+// trip does on the device, and is counted with its bytes in both directions.
+#pragma once
+#include <ESP8266WiFi.h>
+#include <MockJson.h>
+#include <deque>
+
+class FirebaseData;
+
+#define FIREBASE_ERROR_HTTP_CODE_OK 200
+#define FIREBASE_ERROR_HTTP_CODE_PRECONDITION_FAILED 412
+
+struct MockRtdbRequest {
+  uint64_t timeUs;
+  const char* method;
+  std::string path;
+  size_t bytesUp;
+  size_t bytesDown;
+};
+
+class MockRtdb {
+ public:
+  MockJsonNode root;
+  bool online = true;           // The server answers, the device also needs its WiFi link
+  uint32_t latencyUs = 150000;  // Request round trip
+  uint32_t timeoutUs = 5000000; // Until a request to a server that does not answer gives up
+  uint32_t eventDelayUs = 100000; // From a write to the event on an open stream
+
+  uint32_t requests = 0;
+  uint32_t events = 0;
+  uint64_t bytesUp = 0;
+  uint64_t bytesDown = 0;
+  std::vector<MockRtdbRequest> log;
+  std::function<void(const MockRtdbRequest&)> onRequest; // After each request, another writer can get in here
+
+  // Console side, like editing the database by hand
+  void set(const char* path, const char* json) {
+    MockJsonNode value;
+    MockJsonNode::parse(json, value);
+    put(path, value);
+  }
+  void update(const char* path, const char* json) {
+    MockJsonNode body;
+    MockJsonNode::parse(json, body);
+    patch(path, body);
+  }
+  std::string get(const char* path) {
+    MockJsonNode* node = root.find(path);
+    return node ? node->text() : "null";
+  }
+
+  // Like the server's, it only changes with the value at the path
+  std::string etag(const char* path) {
+    std::string text = get(path);
+    uint32_t hash = 2166136261UL;
+    for (char c : text) hash = (hash ^ (uint8_t)c) * 16777619UL;
+    char out[12];
+    snprintf(out, sizeof(out), "%08x", (unsigned)hash);
+    return out;
+  }
+
+  void reset() {
+    *this = MockRtdb();
+  }
+
+  //--------------------------
+  // SERVER
+
+  void put(const std::string& path, const MockJsonNode& value) {
+    root.assign(path, value);
+    notify(path, "put", &value);
+  }
+
+  void patch(const std::string& path, const MockJsonNode& body) {
+    for (auto& child : body.children) root.assign(path + "/" + child.first, child.second);
+    notify(path, "patch", &body);
+  }
+
+  // One request: false if the link or the server is down, after the time that takes
+  bool request(const char* method, const std::string& path, size_t up, size_t down, std::string& error);
+
+  void notify(const std::string& path, const char* event, const MockJsonNode* data);
+
+  std::vector<FirebaseData*> streams;
+};
+inline MockRtdb mockRtdb;
+
+//--------------------------
+// FIREBASE JSON
+
+class FirebaseJsonData {
+ public:
+  bool success = false;
+  String type;
+  String stringValue;
+  int intValue = 0;
+  float floatValue = 0;
+  double doubleValue = 0;
+  bool boolValue = false;
+};
+
+class FirebaseJson {
+ public:
+  // "a/b" paths, "[3]" is an array index
+  void set(const String& path) { node.assign(key(path), MockJsonNode()); }
+  void set(const String& path, const String& value) { put(path, MockJsonNode::string(value.c_str())); }
+  void set(const String& path, const char* value) { put(path, MockJsonNode::string(value)); }
+  void set(const String& path, bool value) { put(path, MockJsonNode::boolean(value)); }
+  void set(const String& path, int value) { put(path, MockJsonNode::number(std::to_string(value))); }
+  void set(const String& path, double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.15g", value);
+    put(path, MockJsonNode::number(text));
+  }
+
+  void setJsonData(const String& text) { MockJsonNode::parse(text.c_str(), node); }
+  void clear() { node = MockJsonNode(); }
+  void toString(String& out, bool = false) { out = node.text().c_str(); }
+  String raw() { return String(node.text().c_str()); }
+
+  bool get(FirebaseJsonData& result, const String& path, bool = false) {
+    MockJsonNode* found = node.find(key(path));
+    result = FirebaseJsonData();
+    if (!found || found->type == MockJsonNode::NONE) return false;
+    result.success = true;
+    result.type = typeName(*found);
+    if (found->type == MockJsonNode::STRING) result.stringValue = found->value.c_str();
+    else result.stringValue = found->text().c_str();
+    result.doubleValue = atof(found->value.c_str());
+    result.floatValue = (float)result.doubleValue;
+    result.intValue = (int)result.doubleValue;
+    result.boolValue = found->value == "true";
+    return true;
+  }
+
+  static const char* typeName(const MockJsonNode& n) {
+    switch (n.type) {
+      case MockJsonNode::NONE: return "null";
+      case MockJsonNode::BOOLEAN: return "boolean";
+      case MockJsonNode::STRING: return "string";
+      case MockJsonNode::OBJECT: return n.isArray() ? "array" : "object";
+      case MockJsonNode::NUMBER: break;
+    }
+    if (n.value.find_first_of(".eE") != std::string::npos) return "double";
+    double v = atof(n.value.c_str());
+    return v >= INT32_MIN && v <= INT32_MAX ? "int" : "double";
+  }
+
+  MockJsonNode node;
+
+ private:
+  static std::string key(const String& path) {
+    std::string out;
+    for (const char* p = path.c_str(); *p; p++) if (*p != '[' && *p != ']') out += *p;
+    return out;
+  }
+  void put(const String& path, const MockJsonNode& value) { node.assign(key(path), value); }
+};
+
+//--------------------------
+// FIREBASE DATA
+
+const size_t MOCK_RESPONSE_SIZE = 1024; // Response buffer without setResponseSize(), as in the library
+
+class FirebaseData {
+ public:
+  ~FirebaseData() { stop(); }
+
+  String payload() { return String(body.c_str()); }
+  size_t payloadLength() { return body.size(); }
+  String dataType() { return String(type.c_str()); }
+  String dataPath() { return String(path.c_str()); }
+  String eventType() { return String(event.c_str()); }
+  String errorReason() { return String(error.c_str()); }
+  String ETag() { return String(etag.c_str()); }
+  int httpCode() { return code; }
+  String stringData() { return type == "string" ? String(value.value.c_str()) : String(); }
+  int intData() { return (int)atof(value.value.c_str()); }
+  double doubleData() { return atof(value.value.c_str()); }
+  bool streamTimeout() { return false; }
+  bool streamAvailable() { return available; }
+
+  void setResponseSize(uint16_t size) { responseSize = size; }
+  void setBSSLBufferSize(uint16_t, uint16_t) {}
+
+  // Response, or the event read last
+  void respond(const MockJsonNode& v, const char* eventType, const std::string& eventPath) {
+    value = v;
+    body = v.text();
+    type = v.type == MockJsonNode::OBJECT ? (v.isArray() ? "array" : "json") : FirebaseJson::typeName(v);
+    event = eventType;
+    path = eventPath;
+    code = FIREBASE_ERROR_HTTP_CODE_OK;
+    largestResponse = max(largestResponse, body.size());
+  }
+
+  void truncate() {
+    if (body.size() > responseSize) body.resize(responseSize);
+  }
+
+  void stop() {
+    streaming = false;
+    queue.clear();
+    auto& streams = mockRtdb.streams;
+    streams.erase(std::remove(streams.begin(), streams.end(), this), streams.end());
+  }
+
+  struct Event {
+    uint64_t atUs;
+    std::string type;
+    std::string path;
+    MockJsonNode data;
+  };
+
+  std::string streamPath;
+  bool streaming = false;
+  bool available = false;
+  std::deque<Event> queue;
+  size_t responseSize = MOCK_RESPONSE_SIZE; // setResponseSize()
+  size_t largestResponse = 0; // Largest payload this object has received
+  std::string error;
+  std::string etag; // Of the path read or written last
+  int code = 0;     // HTTP status of the last response, 0 without one
+
+ private:
+  MockJsonNode value;
+  std::string body;
+  std::string type;
+  std::string event;
+  std::string path;
+};
+
+inline bool MockRtdb::request(const char* method, const std::string& path, size_t up, size_t down, std::string& error) {
+  requests++;
+  if (!mockStation.up()) {
+    error = "not connected";
+    return false;
+  }
+  if (!online) {
+    mockNowUs += timeoutUs;
+    error = "response read timed out";
+    return false;
+  }
+  mockNowUs += latencyUs;
+  bytesUp += up;
+  bytesDown += down;
+  log.push_back({ mockNowUs, method, path, up, down });
+  if (onRequest) onRequest(log.back());
+  return true;
+}
+
+inline void MockRtdb::notify(const std::string& path, const char* event, const MockJsonNode* data) {
+  auto trim = [](const std::string& p) {
+    std::string out = "/";
+    for (size_t i = 0; i < p.size(); i++) {
+      if (p[i] == '/' && (out.back() == '/')) continue;
+      out += p[i];
+    }
+    if (out.size() > 1 && out.back() == '/') out.pop_back();
+    return out;
+  };
+  std::string written = trim(path);
+  for (FirebaseData* stream : streams) {
+    std::string watched = trim(stream->streamPath);
+    uint64_t at = mockNowUs + eventDelayUs;
+    if (written == watched || written.compare(0, watched.size() + 1, watched + "/") == 0 || watched == "/") {
+      // At or below the stream, the event carries the write itself
+      std::string relative = watched == "/" ? written : written.substr(watched.size());
+      if (relative.empty()) relative = "/";
+      stream->queue.push_back({ at, event, relative, *data });
+    } else if (watched.compare(0, written.size() + 1, written + "/") == 0 || written == "/") {
+      // Above the stream, the whole watched node is sent again
+      MockJsonNode* node = root.find(watched);
+      stream->queue.push_back({ at, "put", "/", node ? *node : MockJsonNode() });
+    }
+  }
+}
+
+//--------------------------
+// CLIENT
+
+class FirebaseAuth {};
+
+struct FirebaseConfig {
+  const char* database_url = nullptr;
+  struct {
+    struct {
+      const char* legacy_token = nullptr;
+    } tokens;
+  } signer;
+  struct {
+    unsigned long rtdbKeepAlive = 0;
+    unsigned long rtdbStreamReconnect = 0;
+  } timeout;
+};
+
+class RTDBCls {
+ public:
+  bool get(FirebaseData* fbdo, const char* path) { return read(fbdo, "GET", path, nullptr); }
+  bool getJSON(FirebaseData* fbdo, const char* path) { return read(fbdo, "GET", path, "json"); }
+  bool getArray(FirebaseData* fbdo, const char* path) { return read(fbdo, "GET", path, "array"); }
+  bool getString(FirebaseData* fbdo, const char* path) { return read(fbdo, "GET", path, "string"); }
+
+  // Children with their values, objects as true
+  bool getShallowData(FirebaseData* fbdo, const char* path) {
+    MockJsonNode* node = mockRtdb.root.find(path);
+    MockJsonNode shallow;
+    if (node) {
+      shallow = *node;
+      for (auto& child : shallow.children) {
+        if (child.second.type == MockJsonNode::OBJECT) child.second = MockJsonNode::boolean(true);
+      }
+    }
+    if (!mockRtdb.request("GET", std::string(path) + "?shallow=true", 0, shallow.text().size(), fbdo->error)) return false;
+    fbdo->respond(shallow, "", path);
+    return true;
+  }
+
+  // Conditional write (if-match): rejected with 412, the value at the path and its ETag when the
+  // value changed since the ETag was read
+  bool setInt(FirebaseData* fbdo, const char* path, int value, const char* etag) {
+    MockJsonNode node = MockJsonNode::number(std::to_string(value));
+    std::string body = node.text();
+    fbdo->code = 0;
+    if (!mockRtdb.request("PUT", path, body.size(), body.size(), fbdo->error)) return false;
+    if (mockRtdb.etag(path) != etag) {
+      MockJsonNode* current = mockRtdb.root.find(path);
+      fbdo->respond(current ? *current : MockJsonNode(), "", path);
+      fbdo->etag = mockRtdb.etag(path);
+      fbdo->code = FIREBASE_ERROR_HTTP_CODE_PRECONDITION_FAILED;
+      fbdo->error = "precondition failed (ETag does not match)";
+      return false;
+    }
+    mockRtdb.put(path, node);
+    fbdo->respond(node, "", path);
+    fbdo->etag = mockRtdb.etag(path);
+    return true;
+  }
+
+  bool updateNode(FirebaseData* fbdo, const char* path, FirebaseJson* json) {
+    std::string body = json->node.text();
+    if (!mockRtdb.request("PATCH", path, body.size(), body.size(), fbdo->error)) return false;
+    mockRtdb.patch(path, json->node);
+    fbdo->respond(json->node, "", path);
+    return true;
+  }
+
+  bool beginStream(FirebaseData* fbdo, const char* path) {
+    fbdo->stop();
+    if (!mockRtdb.request("STREAM", path, 0, 0, fbdo->error)) return false;
+    fbdo->streamPath = path;
+    fbdo->streaming = true;
+    mockRtdb.streams.push_back(fbdo);
+    MockJsonNode* node = mockRtdb.root.find(path);
+    fbdo->queue.push_back({ mockNowUs, "put", "/", node ? *node : MockJsonNode() });
+    return true;
+  }
+
+  // Takes at most one event that has arrived
+  bool readStream(FirebaseData* fbdo) {
+    fbdo->available = false;
+    if (!fbdo->streaming) {
+      fbdo->error = "stream not started";
+      return false;
+    }
+    if (!mockStation.up() || !mockRtdb.online) {
+      fbdo->error = "connection lost";
+      return false;
+    }
+    if (fbdo->queue.empty() || fbdo->queue.front().atUs > mockNowUs) return true;
+    FirebaseData::Event next = fbdo->queue.front();
+    fbdo->queue.pop_front();
+    fbdo->respond(next.data, next.type.c_str(), next.path);
+    fbdo->available = true;
+    mockRtdb.events++;
+    mockRtdb.bytesDown += fbdo->payloadLength();
+    // An event larger than the response buffer arrives cut off, the stream itself carries on
+    fbdo->truncate();
+    return true;
+  }
+
+  bool endStream(FirebaseData* fbdo) {
+    fbdo->stop();
+    return true;
+  }
+
+ private:
+  bool read(FirebaseData* fbdo, const char* method, const char* path, const char* want) {
+    MockJsonNode* node = mockRtdb.root.find(path);
+    MockJsonNode value = node ? *node : MockJsonNode();
+    size_t size = value.text().size();
+    if (!mockRtdb.request(method, path, 0, size, fbdo->error)) return false;
+    if (size > fbdo->responseSize) {
+      fbdo->error = "payload too large";
+      return false;
+    }
+    fbdo->respond(value, "", path);
+    fbdo->etag = mockRtdb.etag(path);
+    if (want && fbdo->dataType() != want) {
+      fbdo->error = value.type == MockJsonNode::NONE ? "path not exist" : "data type mismatch";
+      return false;
+    }
+    return true;
+  }
+};
+
+class FirebaseCls {
+ public:
+  RTDBCls RTDB;
+  void begin(FirebaseConfig*, FirebaseAuth*) { begun = true; }
+  void reconnectWiFi(bool) {}
+  bool ready() { return begun && mockStation.up(); }
+  bool begun = false;
+};
+inline FirebaseCls Firebase;
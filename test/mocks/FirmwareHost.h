@@ -0,0 +1,23 @@
+// Runs the firmware in src/main.cpp on the virtual clock, for the tests that drive it as a whole.
+// Firmware globals keep their values between tests of one program, like they do on the device.
+#pragma once
+#include <Arduino.h>
+#include <DMDESP.h>
+#include <string>
+
+void setup();
+void loop();
+
+// Calls loop() until the clock reaches us, one scheduler pass at a time
+inline void runUntil(uint64_t us) {
+  while (mockNowUs < us) loop();
+}
+
+inline void runFor(uint64_t us) { runUntil(mockNowUs + us); }
+
+// What the panel shows, one line of '#' and '.' per row, for golden frames
+inline std::string panelText(const DMDESP& display) {
+  std::string text;
+  for (int y = 0; y < display.mockHeight; y++) text += display.mockRow(y) + "\n";
+  return text;
+}
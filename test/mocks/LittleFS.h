@@ -0,0 +1,10 @@
+#pragma once
+#include <FS.h>
+
+namespace littlefs_impl {
+class LittleFSImpl : public FSImpl {
+ public:
+  LittleFSImpl(uint32_t start, uint32_t size, uint32_t pageSize, uint32_t blockSize, uint32_t maxOpenFds)
+      : FSImpl(size, blockSize) {}
+};
+}
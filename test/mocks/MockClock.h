@@ -0,0 +1,5 @@
+// The virtual clock every mock charges its time to
+#pragma once
+#include <stdint.h>
+
+inline uint64_t mockNowUs = 0; // Device time since power on
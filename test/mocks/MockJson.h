@@ -0,0 +1,251 @@
+// JSON tree the way the Realtime Database keeps it: arrays are objects with index keys, null and
+// empty objects are not stored, and an object reads back as an array when most of the keys from
+// 0 to its highest index are there.
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// Index keys first in numeric order, then names
+struct MockKeyOrder {
+  static long index(const std::string& key) {
+    if (key.empty() || key.size() > 9 || (key.size() > 1 && key[0] == '0')) return -1;
+    for (char c : key) if (c < '0' || c > '9') return -1;
+    return atol(key.c_str());
+  }
+  bool operator()(const std::string& a, const std::string& b) const {
+    long ai = index(a), bi = index(b);
+    if (ai >= 0 && bi >= 0) return ai < bi;
+    if (ai >= 0 || bi >= 0) return ai >= 0;
+    return a < b;
+  }
+};
+
+struct MockJsonNode {
+  enum Type { NONE, BOOLEAN, NUMBER, STRING, OBJECT };
+  Type type = NONE;
+  std::string value; // Number as written, string content, "true" or "false"
+  std::map<std::string, MockJsonNode, MockKeyOrder> children;
+
+  static MockJsonNode string(const std::string& s) { MockJsonNode n; n.type = STRING; n.value = s; return n; }
+  static MockJsonNode number(const std::string& s) { MockJsonNode n; n.type = NUMBER; n.value = s; return n; }
+  static MockJsonNode boolean(bool b) { MockJsonNode n; n.type = BOOLEAN; n.value = b ? "true" : "false"; return n; }
+
+  bool isArray() const {
+    if (type != OBJECT || children.empty()) return false;
+    long last = MockKeyOrder::index(children.rbegin()->first);
+    for (auto& child : children) if (MockKeyOrder::index(child.first) < 0) return false;
+    return (long)children.size() * 2 > last + 1;
+  }
+
+  // Follows "a/b/0", creating objects on the way when create is set
+  MockJsonNode* find(const std::string& path, bool create = false) {
+    MockJsonNode* node = this;
+    size_t start = 0;
+    while (start <= path.size()) {
+      size_t end = path.find('/', start);
+      if (end == std::string::npos) end = path.size();
+      std::string key = path.substr(start, end - start);
+      start = end + 1;
+      if (key.empty()) continue;
+      if (node->type != OBJECT) {
+        if (!create) return nullptr;
+        node->type = OBJECT;
+        node->value.clear();
+      }
+      auto found = node->children.find(key);
+      if (found == node->children.end()) {
+        if (!create) return nullptr;
+        found = node->children.emplace(key, MockJsonNode()).first;
+      }
+      node = &found->second;
+    }
+    return node;
+  }
+
+  // Puts value at path, a NONE value deletes it along with the objects it leaves empty
+  void assign(const std::string& path, const MockJsonNode& v) {
+    if (v.type != NONE) {
+      *find(path, true) = v;
+      return;
+    }
+    size_t cut = path.find_last_not_of('/');
+    if (cut == std::string::npos) {
+      *this = MockJsonNode();
+      return;
+    }
+    std::string trimmed = path.substr(0, cut + 1);
+    size_t slash = trimmed.rfind('/');
+    std::string parentPath = slash == std::string::npos ? "" : trimmed.substr(0, slash);
+    std::string key = slash == std::string::npos ? trimmed : trimmed.substr(slash + 1);
+    MockJsonNode* parent = find(parentPath);
+    if (!parent || parent->type != OBJECT) return;
+    parent->children.erase(key);
+    if (parent->children.empty()) assign(parentPath, MockJsonNode());
+  }
+
+  //--------------------------
+  // TEXT
+
+  std::string text() const {
+    std::string out;
+    write(out);
+    return out;
+  }
+
+  void write(std::string& out) const {
+    switch (type) {
+      case NONE: out += "null"; break;
+      case BOOLEAN:
+      case NUMBER: out += value; break;
+      case STRING: quote(value, out); break;
+      case OBJECT:
+        if (isArray()) {
+          out += '[';
+          long next = 0;
+          for (auto& child : children) {
+            for (long i = MockKeyOrder::index(child.first); next < i; next++) out += "null,";
+            child.second.write(out);
+            out += ',';
+            next++;
+          }
+          out.back() = ']';
+        } else {
+          out += '{';
+          for (auto& child : children) {
+            quote(child.first, out);
+            out += ':';
+            child.second.write(out);
+            out += ',';
+          }
+          out.back() = '}';
+        }
+        break;
+    }
+  }
+
+  static void quote(const std::string& s, std::string& out) {
+    out += '"';
+    for (unsigned char c : s) {
+      if (c == '"' || c == '\\') { out += '\\'; out += (char)c; }
+      else if (c == '\n') out += "\\n";
+      else if (c == '\r') out += "\\r";
+      else if (c == '\t') out += "\\t";
+      else if (c < 0x20) { char esc[8]; snprintf(esc, sizeof(esc), "\\u%04x", c); out += esc; }
+      else out += (char)c;
+    }
+    out += '"';
+  }
+
+  // Parses a JSON text, false if it is not valid
+  static bool parse(const char* text, MockJsonNode& out) {
+    const char* p = text;
+    out = MockJsonNode();
+    if (!parseValue(p, out)) return false;
+    skipSpace(p);
+    return *p == 0;
+  }
+
+ private:
+  static void skipSpace(const char*& p) {
+    while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') p++;
+  }
+
+  static void utf8(uint32_t cp, std::string& out) {
+    if (cp < 0x80) out += (char)cp;
+    else if (cp < 0x800) { out += (char)(0xC0 | cp >> 6); out += (char)(0x80 | (cp & 0x3F)); }
+    else if (cp < 0x10000) { out += (char)(0xE0 | cp >> 12); out += (char)(0x80 | (cp >> 6 & 0x3F)); out += (char)(0x80 | (cp & 0x3F)); }
+    else { out += (char)(0xF0 | cp >> 18); out += (char)(0x80 | (cp >> 12 & 0x3F)); out += (char)(0x80 | (cp >> 6 & 0x3F)); out += (char)(0x80 | (cp & 0x3F)); }
+  }
+
+  static bool parseString(const char*& p, std::string& out) {
+    if (*p != '"') return false;
+    p++;
+    while (*p && *p != '"') {
+      if (*p != '\\') { out += *p++; continue; }
+      p++;
+      char c = *p++;
+      switch (c) {
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'u': {
+          uint32_t cp = strtoul(std::string(p, 4).c_str(), nullptr, 16);
+          p += 4;
+          if (cp >= 0xD800 && cp < 0xDC00 && p[0] == '\\' && p[1] == 'u') {
+            uint32_t low = strtoul(std::string(p + 2, 4).c_str(), nullptr, 16);
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            p += 6;
+          }
+          utf8(cp, out);
+          break;
+        }
+        case 0: return false;
+        default: out += c; break;
+      }
+    }
+    if (*p != '"') return false;
+    p++;
+    return true;
+  }
+
+  static bool parseValue(const char*& p, MockJsonNode& out) {
+    skipSpace(p);
+    if (*p == '{' || *p == '[') {
+      char close = *p == '{' ? '}' : ']';
+      bool array = *p == '[';
+      p++;
+      out.type = OBJECT;
+      long index = 0;
+      skipSpace(p);
+      if (*p == close) { p++; out.type = NONE; return true; }
+      while (true) {
+        std::string key;
+        skipSpace(p);
+        if (array) {
+          key = std::to_string(index++);
+        } else {
+          if (!parseString(p, key)) return false;
+          skipSpace(p);
+          if (*p++ != ':') return false;
+        }
+        MockJsonNode child;
+        if (!parseValue(p, child)) return false;
+        if (child.type != NONE) out.children[key] = child;
+        skipSpace(p);
+        if (*p == ',') { p++; continue; }
+        if (*p++ != close) return false;
+        break;
+      }
+      if (out.children.empty()) out.type = NONE;
+      return true;
+    }
+    if (*p == '"') {
+      out.type = STRING;
+      return parseString(p, out.value);
+    }
+    if (!strncmp(p, "true", 4) || !strncmp(p, "false", 5)) {
+      out.type = BOOLEAN;
+      out.value = *p == 't' ? "true" : "false";
+      p += out.value.size();
+      return true;
+    }
+    if (!strncmp(p, "null", 4)) {
+      p += 4;
+      return true;
+    }
+    const char* start = p;
+    if (*p == '-') p++;
+    while ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-') p++;
+    if (p == start) return false;
+    out.type = NUMBER;
+    out.value.assign(start, p - start);
+    return true;
+  }
+};
@@ -0,0 +1,49 @@
+// Non-blocking configuration portal. The test plays the user: mockSubmit() saves a network the
+// way the portal form does, otherwise the portal closes when its timeout runs out.
+#pragma once
+#include <ESP8266WiFi.h>
+
+class WiFiManager {
+ public:
+  bool mockSaved = true; // Credentials in flash from an earlier setup
+
+  void setSaveConfigCallback(std::function<void()> callback) { saveCallback = callback; }
+  void setAPCallback(std::function<void(WiFiManager*)> callback) { apCallback = callback; }
+  void setConfigPortalTimeout(unsigned long seconds) { timeoutMs = seconds * 1000; }
+  void setConfigPortalBlocking(bool) {}
+  bool getWiFiIsSaved() { return mockSaved; }
+  bool getConfigPortalActive() { return active; }
+  void resetSettings() { mockSaved = false; }
+
+  bool startConfigPortal(const char*, const char* = nullptr) {
+    active = true;
+    submitted = false;
+    startedMs = millis();
+    if (apCallback) apCallback(this);
+    return false;
+  }
+
+  bool process() {
+    if (!active) return false;
+    if (submitted) {
+      active = false;
+      mockSaved = true;
+      mockStation.linkUp = true;
+      mockStation.connecting = false;
+      if (saveCallback) saveCallback();
+      return true;
+    }
+    if (timeoutMs > 0 && millis() - startedMs >= timeoutMs) active = false;
+    return false;
+  }
+
+  void mockSubmit() { submitted = true; }
+
+ private:
+  std::function<void()> saveCallback;
+  std::function<void(WiFiManager*)> apCallback;
+  unsigned long timeoutMs = 0;
+  unsigned long startedMs = 0;
+  bool active = false;
+  bool submitted = false;
+};
@@ -0,0 +1,9 @@
+// Flash layout of eagle.flash.4m1m.ld
+#pragma once
+#include <Arduino.h>
+
+#define FLASH_SECTOR_SIZE 0x1000
+#define FS_PHYS_ADDR ((uint32_t)0x300000)
+#define FS_PHYS_SIZE ((uint32_t)0xFA000)
+#define FS_PHYS_PAGE 0x100
+#define FS_PHYS_BLOCK 0x2000
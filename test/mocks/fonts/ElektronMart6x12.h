@@ -0,0 +1,66 @@
+// Stand-in for the DMDESP font on the host: same layout (DMD variable width, 12 rows, ASCII
+// 0x20-0x7F), glyphs from a 5x7 font placed on rows 2-8. Golden frames are drawn with it.
+#pragma once
+#include <pgmspace.h>
+
+const uint8_t ElektronMart6x12[] PROGMEM = {
+  0x03, 0xB0, 0x06, 0x0C, 0x20, 0x60, 0x01, 0x01, 0x03, 0x05, 0x05, 0x05, 0x05, 0x02, 0x03, 0x03,
+  0x05, 0x05, 0x02, 0x05, 0x02, 0x05, 0x05, 0x03, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+  0x02, 0x02, 0x04, 0x05, 0x04, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x03,
+  0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+  0x05, 0x03, 0x05, 0x03, 0x05, 0x05, 0x03, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x03,
+  0x04, 0x04, 0x03, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x05,
+  0x05, 0x03, 0x01, 0x03, 0x05, 0x01, 0x00, 0x00, 0x7C, 0x10, 0x1C, 0x00, 0x1C, 0x00, 0x00, 0x00,
+  0x50, 0xFC, 0x50, 0xFC, 0x50, 0x00, 0x10, 0x00, 0x10, 0x00, 0x90, 0xA8, 0xFC, 0xA8, 0x48, 0x00,
+  0x00, 0x10, 0x00, 0x00, 0x8C, 0x4C, 0x20, 0x90, 0x88, 0x00, 0x00, 0x00, 0x10, 0x10, 0xD8, 0x24,
+  0x54, 0x88, 0x40, 0x00, 0x10, 0x10, 0x00, 0x10, 0x14, 0x0C, 0x00, 0x00, 0x70, 0x88, 0x04, 0x00,
+  0x00, 0x10, 0x04, 0x88, 0x70, 0x10, 0x00, 0x00, 0x20, 0xA8, 0x70, 0xA8, 0x20, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x20, 0x20, 0xF8, 0x20, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0xC0, 0x10, 0x00,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x80, 0x10, 0x10, 0x80, 0x40,
+  0x20, 0x10, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF8, 0x44, 0x24, 0x14, 0xF8, 0x00, 0x10, 0x10,
+  0x10, 0x00, 0x08, 0xFC, 0x00, 0x10, 0x10, 0x10, 0x08, 0x84, 0x44, 0x24, 0x18, 0x10, 0x10, 0x10,
+  0x10, 0x10, 0x84, 0x04, 0x14, 0x2C, 0xC4, 0x00, 0x10, 0x10, 0x10, 0x00, 0x60, 0x50, 0x48, 0xFC,
+  0x40, 0x00, 0x00, 0x00, 0x10, 0x00, 0x9C, 0x14, 0x14, 0x14, 0xE4, 0x00, 0x10, 0x10, 0x10, 0x00,
+  0xF0, 0x28, 0x24, 0x24, 0xC0, 0x00, 0x10, 0x10, 0x10, 0x00, 0x04, 0xC4, 0x24, 0x14, 0x0C, 0x00,
+  0x10, 0x00, 0x00, 0x00, 0xD8, 0x24, 0x24, 0x24, 0xD8, 0x00, 0x10, 0x10, 0x10, 0x00, 0x18, 0x24,
+  0x24, 0xA4, 0x78, 0x00, 0x10, 0x10, 0x00, 0x00, 0xD8, 0xD8, 0x00, 0x00, 0x58, 0xD8, 0x10, 0x00,
+  0x20, 0x50, 0x88, 0x04, 0x00, 0x00, 0x00, 0x10, 0x50, 0x50, 0x50, 0x50, 0x50, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x04, 0x88, 0x50, 0x20, 0x10, 0x00, 0x00, 0x00, 0x08, 0x04, 0x44, 0x24, 0x18, 0x00,
+  0x00, 0x10, 0x00, 0x00, 0xC8, 0x24, 0xE4, 0x04, 0xF8, 0x00, 0x10, 0x10, 0x10, 0x00, 0xF8, 0x44,
+  0x44, 0x44, 0xF8, 0x10, 0x00, 0x00, 0x00, 0x10, 0xFC, 0x24, 0x24, 0x24, 0xD8, 0x10, 0x10, 0x10,
+  0x10, 0x00, 0xF8, 0x04, 0x04, 0x04, 0x88, 0x00, 0x10, 0x10, 0x10, 0x00, 0xFC, 0x04, 0x04, 0x88,
+  0x70, 0x10, 0x10, 0x10, 0x00, 0x00, 0xFC, 0x24, 0x24, 0x24, 0x04, 0x10, 0x10, 0x10, 0x10, 0x10,
+  0xFC, 0x24, 0x24, 0x04, 0x04, 0x10, 0x00, 0x00, 0x00, 0x00, 0xF8, 0x04, 0x04, 0x44, 0xC8, 0x00,
+  0x10, 0x10, 0x10, 0x00, 0xFC, 0x20, 0x20, 0x20, 0xFC, 0x10, 0x00, 0x00, 0x00, 0x10, 0x04, 0xFC,
+  0x04, 0x10, 0x10, 0x10, 0x80, 0x00, 0x04, 0xFC, 0x04, 0x00, 0x10, 0x10, 0x00, 0x00, 0xFC, 0x20,
+  0x50, 0x88, 0x04, 0x10, 0x00, 0x00, 0x00, 0x10, 0xFC, 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10,
+  0x10, 0x10, 0xFC, 0x08, 0x10, 0x08, 0xFC, 0x10, 0x00, 0x00, 0x00, 0x10, 0xFC, 0x10, 0x20, 0x40,
+  0xFC, 0x10, 0x00, 0x00, 0x00, 0x10, 0xF8, 0x04, 0x04, 0x04, 0xF8, 0x00, 0x10, 0x10, 0x10, 0x00,
+  0xFC, 0x24, 0x24, 0x24, 0x18, 0x10, 0x00, 0x00, 0x00, 0x00, 0xF8, 0x04, 0x44, 0x84, 0x78, 0x00,
+  0x10, 0x10, 0x00, 0x10, 0xFC, 0x24, 0x64, 0xA4, 0x18, 0x10, 0x00, 0x00, 0x00, 0x10, 0x18, 0x24,
+  0x24, 0x24, 0xC4, 0x10, 0x10, 0x10, 0x10, 0x00, 0x04, 0x04, 0xFC, 0x04, 0x04, 0x00, 0x00, 0x10,
+  0x00, 0x00, 0xFC, 0x00, 0x00, 0x00, 0xFC, 0x00, 0x10, 0x10, 0x10, 0x00, 0x7C, 0x80, 0x00, 0x80,
+  0x7C, 0x00, 0x00, 0x10, 0x00, 0x00, 0xFC, 0x80, 0x60, 0x80, 0xFC, 0x10, 0x00, 0x00, 0x00, 0x10,
+  0x8C, 0x50, 0x20, 0x50, 0x8C, 0x10, 0x00, 0x00, 0x00, 0x10, 0x0C, 0x10, 0xE0, 0x10, 0x0C, 0x00,
+  0x00, 0x10, 0x00, 0x00, 0x84, 0x44, 0x24, 0x14, 0x0C, 0x10, 0x10, 0x10, 0x10, 0x10, 0xFC, 0x04,
+  0x04, 0x10, 0x10, 0x10, 0x08, 0x10, 0x20, 0x40, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x04,
+  0xFC, 0x10, 0x10, 0x10, 0x10, 0x08, 0x04, 0x08, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x04, 0x08, 0x10, 0x00, 0x00, 0x00, 0x80, 0x50,
+  0x50, 0x50, 0xE0, 0x00, 0x10, 0x10, 0x10, 0x10, 0xFC, 0x20, 0x10, 0x10, 0xE0, 0x10, 0x10, 0x10,
+  0x10, 0x00, 0xE0, 0x10, 0x10, 0x10, 0x80, 0x00, 0x10, 0x10, 0x10, 0x00, 0xE0, 0x10, 0x10, 0x20,
+  0xFC, 0x00, 0x10, 0x10, 0x10, 0x10, 0xE0, 0x50, 0x50, 0x50, 0x60, 0x00, 0x10, 0x10, 0x10, 0x00,
+  0x20, 0xF8, 0x24, 0x04, 0x08, 0x00, 0x10, 0x00, 0x00, 0x00, 0x20, 0x50, 0x50, 0x50, 0xF0, 0x00,
+  0x00, 0x10, 0x10, 0x00, 0xFC, 0x20, 0x10, 0x10, 0xE0, 0x10, 0x00, 0x00, 0x00, 0x10, 0x10, 0xF4,
+  0x00, 0x10, 0x10, 0x10, 0x80, 0x00, 0x10, 0xF4, 0x00, 0x10, 0x10, 0x00, 0xFC, 0x40, 0xA0, 0x10,
+  0x10, 0x00, 0x00, 0x10, 0x04, 0xFC, 0x00, 0x10, 0x10, 0x10, 0xF0, 0x10, 0x60, 0x10, 0xE0, 0x10,
+  0x00, 0x00, 0x00, 0x10, 0xF0, 0x20, 0x10, 0x10, 0xE0, 0x10, 0x00, 0x00, 0x00, 0x10, 0xE0, 0x10,
+  0x10, 0x10, 0xE0, 0x00, 0x10, 0x10, 0x10, 0x00, 0xF0, 0x50, 0x50, 0x50, 0x20, 0x10, 0x00, 0x00,
+  0x00, 0x00, 0x20, 0x50, 0x50, 0x60, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x10, 0xF0, 0x20, 0x10, 0x10,
+  0x20, 0x10, 0x00, 0x00, 0x00, 0x00, 0x20, 0x50, 0x50, 0x50, 0x80, 0x10, 0x10, 0x10, 0x10, 0x00,
+  0x10, 0xFC, 0x10, 0x00, 0x80, 0x00, 0x00, 0x10, 0x10, 0x00, 0xF0, 0x00, 0x00, 0x80, 0xF0, 0x00,
+  0x10, 0x10, 0x00, 0x10, 0x70, 0x80, 0x00, 0x80, 0x70, 0x00, 0x00, 0x10, 0x00, 0x00, 0xF0, 0x00,
+  0xC0, 0x00, 0xF0, 0x00, 0x10, 0x00, 0x10, 0x00, 0x10, 0xA0, 0x40, 0xA0, 0x10, 0x10, 0x00, 0x00,
+  0x00, 0x10, 0x30, 0x40, 0x40, 0x40, 0xF0, 0x00, 0x10, 0x10, 0x10, 0x00, 0x10, 0x90, 0x50, 0x30,
+  0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x20, 0xD8, 0x04, 0x00, 0x00, 0x10, 0xFC, 0x10, 0x04, 0xD8,
+  0x20, 0x10, 0x00, 0x00, 0x20, 0x20, 0xA8, 0x70, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
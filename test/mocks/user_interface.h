@@ -0,0 +1,73 @@
+// SDK calls the firmware makes directly. The WiFi station lives here because the SDK owns it,
+// ESP8266WiFi.h is the Arduino view of the same link.
+#pragma once
+#include <stdint.h>
+#include <MockClock.h>
+
+enum rst_reason {
+  REASON_DEFAULT_RST = 0,
+  REASON_WDT_RST = 1,
+  REASON_EXCEPTION_RST = 2,
+  REASON_SOFT_WDT_RST = 3,
+  REASON_SOFT_RESTART = 4,
+  REASON_DEEP_SLEEP_AWAKE = 5,
+  REASON_EXT_SYS_RST = 6
+};
+
+struct rst_info {
+  uint32_t reason;
+  uint32_t exccause;
+  uint32_t epc1;
+  uint32_t epc2;
+  uint32_t epc3;
+  uint32_t excvaddr;
+  uint32_t depc;
+};
+
+// Fake access point and station. The SDK reconnects on its own after a drop, retrying every
+// connectUs until the access point is back in range.
+struct MockStation {
+  bool inRange = true;        // The saved access point can be reached
+  uint32_t connectUs = 3000000; // Association and DHCP
+  bool linkUp = false;
+  bool connecting = false;
+  uint64_t connectAt = 0;
+  uint32_t drops = 0;
+
+  void connect() {
+    if (linkUp || connecting) return;
+    connecting = true;
+    connectAt = mockNowUs + connectUs;
+  }
+
+  void drop() {
+    if (linkUp) drops++;
+    linkUp = false;
+    connecting = false;
+    connect();
+  }
+
+  bool up() {
+    if (connecting && mockNowUs >= connectAt) {
+      if (inRange) {
+        linkUp = true;
+        connecting = false;
+      } else {
+        connectAt = mockNowUs + connectUs;
+      }
+    }
+    return linkUp;
+  }
+};
+inline MockStation mockStation;
+
+inline bool wifi_station_disconnect() {
+  mockStation.drop();
+  return true;
+}
+
+// The RTC timer runs at about 150 kHz and keeps counting through a reset
+const uint32_t MOCK_RTC_PERIOD_US = 6;
+
+inline uint32_t system_get_rtc_time() { return (uint32_t)(mockNowUs / MOCK_RTC_PERIOD_US); }
+inline uint32_t system_rtc_clock_cali_proc() { return MOCK_RTC_PERIOD_US << 12; } // Q12 microseconds per cycle
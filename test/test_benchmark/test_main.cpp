@@ -0,0 +1,175 @@
+// Per frame cost of the render paths on the host: ns/frame is host time and only comparable
+// between runs on one machine, allocs/frame is exact and has to stay at 0 on every frame that
+// is not a text change. Run with: pio test -e native -f test_benchmark
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <PanelFrame.h>
+#include <TextRender.h>
+#include <chrono>
+
+// Firmware under test (src/main.cpp)
+extern DMDESP Disp;
+extern FrameBuffer<PanelGrid<1, 1>> frame;
+extern bool clockNeedsRedraw;
+extern bool colonBlink;
+extern char displayText[];
+extern uint32_t scrollStripWidth;
+bool ScrollingText(float pixelsPerSecond);
+bool setDisplayText(const char* text);
+bool renderScrollStrip(const char* text);
+uint16_t scrollColumn(int32_t stripX);
+void displayDigitalClock();
+void timeTick();
+void postStatus(const char* text, uint8_t priority, uint32_t ttlMs, uint8_t tag);
+void statusOverlayFrame();
+
+const int FRAMES = 2000;
+const float SPEED = 50; // Pixels per second, the default scrollSpeed
+const uint32_t STEP_US = 1000000 / SPEED;
+
+struct FrameCost {
+  uint64_t nsPerFrame;
+  uint32_t allocsPerFrame; // Rounded up, one allocation in the whole run reads as 1
+};
+
+// Runs draw once per step of virtual time, with the frame sent to the panel after each
+template <typename Draw>
+FrameCost measure(Draw draw) {
+  uint32_t allocations = mockHeap.allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FRAMES; i++) {
+    mockNowUs += STEP_US;
+    draw(i);
+    frame.present(Disp);
+  }
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  uint32_t allocs = mockHeap.allocations - allocations;
+  return { (uint64_t)ns / FRAMES, (allocs + FRAMES - 1) / FRAMES };
+}
+
+void report(const char* label, const FrameCost &cost) {
+  char line[96];
+  snprintf(line, sizeof(line), "%-28s %8llu ns/frame, %u allocs/frame", label,
+           (unsigned long long)cost.nsPerFrame, (unsigned)cost.allocsPerFrame);
+  TEST_MESSAGE(line);
+}
+
+std::string letters(int length) {
+  std::string text;
+  for (int i = 0; i < length; i++) text += (char)('A' + i % 26);
+  return text;
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// SCROLLING TEXT
+
+void scrollText(int length) {
+  setDisplayText(letters(length).c_str());
+  ScrollingText(SPEED); // Text change: shapes and renders the strip once
+
+  FrameCost cost = measure([](int) { ScrollingText(SPEED); });
+  char label[32];
+  snprintf(label, sizeof(label), "ScrollingText %d chars", length);
+  report(label, cost);
+  TEST_ASSERT_EQUAL(0, cost.allocsPerFrame);
+  TEST_ASSERT_LESS_THAN(100000, cost.nsPerFrame);
+}
+
+void test_scroll_10() { scrollText(10); }
+void test_scroll_80() { scrollText(80); }
+
+void test_scroll_500() {
+  // Cut to a full sentence, which still scrolls from the strip
+  scrollText(500);
+  TEST_ASSERT_EQUAL(240, strlen(displayText));
+  TEST_ASSERT_EQUAL(glyphTextWidth(displayText), scrollStripWidth);
+}
+
+void test_scroll_unicode() {
+  // Bangla shaping and atlas symbols, shaped once per text change
+  setDisplayText("আমার সোনার বাংলা "
+                 "Sale ⭐️ 50% off ❤️ ➡ Shop now ✅");
+  ScrollingText(SPEED);
+
+  FrameCost cost = measure([](int) { ScrollingText(SPEED); });
+  report("ScrollingText UTF-8", cost);
+  TEST_ASSERT_EQUAL(0, cost.allocsPerFrame);
+}
+
+// The scroll window for other panel grids, each with a frame buffer and panel of its own size
+template <int WIDE, int HIGH>
+void scrollGrid() {
+  using Grid = PanelGrid<WIDE, HIGH>;
+  static DMDESP display(WIDE, HIGH);
+  static FrameBuffer<Grid> gridFrame;
+  static ScrollWindow<Grid> window;
+  renderScrollStrip("Grid benchmark text scrolling across the chain");
+
+  uint32_t allocations = mockHeap.allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < FRAMES; step++) {
+    window.blit(gridFrame, Grid::CENTER_X - step % 300, scrollColumn);
+    gridFrame.present(display);
+  }
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  char label[32];
+  snprintf(label, sizeof(label), "scroll window %dx%d", WIDE, HIGH);
+  report(label, { (uint64_t)ns / FRAMES, mockHeap.allocations - allocations });
+  TEST_ASSERT_EQUAL(allocations, mockHeap.allocations);
+  // Text band only: the rows above and below stay dark
+  TEST_ASSERT_EQUAL_STRING(std::string(display.mockWidth, '.').c_str(), display.mockRow(0).c_str());
+}
+
+void test_scroll_grids() {
+  scrollGrid<1, 1>();
+  scrollGrid<4, 1>();
+  scrollGrid<8, 2>();
+}
+
+//--------------------------
+// CLOCK AND STATUS
+
+void test_digital_clock() {
+  mockSntpAnswer(1767607650LL * 1000000);
+  timeTick();
+  clockNeedsRedraw = true;
+  displayDigitalClock();
+
+  // Colon blinks every 500 ms, the minute changes every 3000 frames
+  FrameCost cost = measure([](int i) {
+    if (i % 25 == 0) colonBlink = !colonBlink;
+    timeTick();
+    displayDigitalClock();
+  });
+  report("displayDigitalClock()", cost);
+  TEST_ASSERT_EQUAL(0, cost.allocsPerFrame);
+  TEST_ASSERT_LESS_THAN(100000, cost.nsPerFrame);
+}
+
+void test_status_overlay() {
+  // Wider than the panel, so it scrolls through the strip
+  postStatus("Firebase: sync failed, retrying", 2, 3600000, 0);
+  statusOverlayFrame();
+
+  FrameCost cost = measure([](int) { statusOverlayFrame(); });
+  report("statusOverlayFrame()", cost);
+  TEST_ASSERT_EQUAL(0, cost.allocsPerFrame);
+  TEST_ASSERT_LESS_THAN(100000, cost.nsPerFrame);
+}
+
+int main() {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_scroll_10);
+  RUN_TEST(test_scroll_80);
+  RUN_TEST(test_scroll_500);
+  RUN_TEST(test_scroll_unicode);
+  RUN_TEST(test_scroll_grids);
+  RUN_TEST(test_digital_clock);
+  RUN_TEST(test_status_overlay);
+  return UNITY_END();
+}
@@ -0,0 +1,147 @@
+// Boot timeline: with text cached in flash the panel shows it well before WiFi is up, the stages
+// come up in order behind it (cache, first frame, WiFi, then time and Firebase, first sync). Up to
+// Firebase nothing holds up the panel scan, after that only a request round trip does. Time to
+// first content is reported.
+// Run with: pio test -e native -f test_boot_timeline
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <ESP8266WebServer.h>
+#include <Firebase_ESP_Client.h>
+#include <RecordStore.h>
+
+// Firmware under test (src/main.cpp)
+struct BootTimeline {
+  uint32_t setupStart;
+  uint32_t cacheLoaded;
+  uint32_t firstFrame;
+  uint32_t wifi;
+  uint32_t time;
+  uint32_t firebase;
+  uint32_t firstSync;
+};
+extern BootTimeline bootTimeline;
+extern DMDESP Disp;
+extern char displayText[];
+extern ESP8266WebServer server;
+
+const int STORE_SECTORS = 4;
+const uint32_t STORE_BASE = FS_PHYS_ADDR + FS_PHYS_SIZE - STORE_SECTORS * FLASH_SECTOR_SIZE;
+const uint8_t STORE_RECORD_SENTENCE = 1;
+const uint8_t STORE_RECORD_STATE = 2;
+
+const uint32_t FIRST_CONTENT_MS = 500;
+const uint32_t MAX_SCAN_GAP_US = 5000;
+const int64_t SNTP_EPOCH_US = 1760000000LL * 1000000;
+
+// The emulated flash as a previous boot left it
+struct SeedFlash {
+  bool read(uint32_t addr, uint32_t* data, uint32_t size) { return ESP.flashRead(addr, data, size); }
+  bool write(uint32_t addr, uint32_t* data, uint32_t size) { return ESP.flashWrite(addr, data, size); }
+  bool eraseSector(uint32_t sector) { return ESP.flashEraseSector(sector); }
+};
+
+void seedCache(const char* text) {
+  RecordStore<SeedFlash, STORE_SECTORS, 240> seed(STORE_BASE);
+  TEST_ASSERT_TRUE(seed.rotate());
+  int32_t state[2] = { 0, 1 }; // Sentence 0 selected, one sentence
+  TEST_ASSERT_TRUE(seed.append(STORE_RECORD_SENTENCE, 0, text, strlen(text)));
+  TEST_ASSERT_TRUE(seed.append(STORE_RECORD_STATE, 0, state, sizeof(state)));
+}
+
+// Text pixels, the WiFi dot in the top two rows does not count
+bool panelShowsText() {
+  for (int y = 2; y < Disp.mockHeight; y++) {
+    for (int x = 0; x < Disp.mockWidth; x++) {
+      if (Disp.mockPixel(x, y)) return true;
+    }
+  }
+  return false;
+}
+
+uint64_t firstTextUs = 0;  // First scan with text on the panel
+uint64_t worstScanGapUs = 0;
+uint64_t worstGapBeforeFirebaseUs = 0;
+String textBeforeWiFi;     // What scrolled while the network was coming up
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// TESTS
+
+void test_cached_text_first() {
+  TEST_ASSERT_NOT_EQUAL(0, firstTextUs);
+  TEST_ASSERT_EQUAL_STRING("Cached news", textBeforeWiFi.c_str());
+  TEST_ASSERT_LESS_THAN(FIRST_CONTENT_MS, bootTimeline.firstFrame);
+  TEST_ASSERT_LESS_THAN(FIRST_CONTENT_MS * 1000ULL, firstTextUs);
+
+  char line[96];
+  snprintf(line, sizeof(line), "First frame at %u ms, cached text on the panel at %llu ms, WiFi at %u ms",
+           bootTimeline.firstFrame, (unsigned long long)(firstTextUs / 1000), bootTimeline.wifi);
+  TEST_MESSAGE(line);
+}
+
+void test_stages_in_order() {
+  const uint32_t stages[] = { bootTimeline.cacheLoaded, bootTimeline.firstFrame, bootTimeline.wifi,
+                              bootTimeline.time, bootTimeline.firebase, bootTimeline.firstSync };
+  for (uint32_t stage : stages) TEST_ASSERT_NOT_EQUAL(0, stage);
+  TEST_ASSERT_LESS_OR_EQUAL(bootTimeline.cacheLoaded, bootTimeline.setupStart);
+  TEST_ASSERT_LESS_OR_EQUAL(bootTimeline.firstFrame, bootTimeline.cacheLoaded);
+  // The network only starts once the panel shows something
+  TEST_ASSERT_LESS_THAN(bootTimeline.wifi, bootTimeline.firstFrame);
+  // SNTP and Firebase both wait for the link, not for each other
+  TEST_ASSERT_LESS_OR_EQUAL(bootTimeline.time, bootTimeline.wifi);
+  TEST_ASSERT_LESS_OR_EQUAL(bootTimeline.firebase, bootTimeline.wifi);
+  TEST_ASSERT_LESS_OR_EQUAL(bootTimeline.firstSync, bootTimeline.firebase);
+  TEST_ASSERT_EQUAL_STRING("Live news", displayText);
+
+  char line[128];
+  snprintf(line, sizeof(line), "Boot ms: cache %u, first frame %u, wifi %u, time %u, firebase %u, first sync %u",
+           stages[0], stages[1], stages[2], stages[3], stages[4], stages[5]);
+  TEST_MESSAGE(line);
+}
+
+void test_bring_up_never_blocks_the_panel() {
+  TEST_ASSERT_LESS_OR_EQUAL(MAX_SCAN_GAP_US, worstGapBeforeFirebaseUs);
+  // The Firebase calls block for their TLS round trip, one at a time
+  TEST_ASSERT_LESS_OR_EQUAL(mockRtdb.latencyUs + MAX_SCAN_GAP_US, worstScanGapUs);
+}
+
+void test_metrics_report_the_timeline() {
+  MockResponse response = server.mockRequest(HTTP_GET, "/metrics.json", "", "");
+  TEST_ASSERT_EQUAL(200, response.status);
+  char expected[128];
+  snprintf(expected, sizeof(expected), "\"boot_ms\":{\"cache\":%u,\"first_frame\":%u,\"wifi\":%u,\"time\":%u,",
+           bootTimeline.cacheLoaded, bootTimeline.firstFrame, bootTimeline.wifi, bootTimeline.time);
+  TEST_ASSERT_NOT_NULL(strstr(response.body.c_str(), expected));
+}
+
+int main() {
+  seedCache("Cached news");
+  mockRtdb.set("/display", "{\"sentences\":[\"Live news\"],\"selectedSentence\":0}");
+
+  uint64_t lastScan = 0;
+  Disp.mockOnScan = [&]() {
+    if (!firstTextUs && panelShowsText()) firstTextUs = mockNowUs;
+    if (lastScan) worstScanGapUs = max(worstScanGapUs, mockNowUs - lastScan);
+    if (!bootTimeline.firebase) worstGapBeforeFirebaseUs = worstScanGapUs;
+    lastScan = mockNowUs;
+  };
+  setup();
+
+  // SNTP answers a second after the link is up, then Firebase brings the live text
+  while (!bootTimeline.wifi && mockNowUs < 60000000) runFor(1000);
+  textBeforeWiFi = displayText;
+  runFor(1000000);
+  mockSntpAnswer(SNTP_EPOCH_US);
+  while (!bootTimeline.firstSync && mockNowUs < 60000000) runFor(1000);
+  runFor(1000000);
+  Disp.mockOnScan = nullptr;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_cached_text_first);
+  RUN_TEST(test_stages_in_order);
+  RUN_TEST(test_bring_up_never_blocks_the_panel);
+  RUN_TEST(test_metrics_report_the_timeline);
+  return UNITY_END();
+}
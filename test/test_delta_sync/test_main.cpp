@@ -0,0 +1,227 @@
+// Versioned delta sync against a mock RTDB that counts requests and bytes: a poll without a
+// version change reads the shallow node only, a changed sentence costs the hashes and that
+// sentence, not the document. Local changes race another writer for the next version.
+// Run with: pio test -e native -f test_delta_sync
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <Firebase_ESP_Client.h>
+
+// Firmware under test (src/main.cpp)
+extern FirebaseData stream;
+extern FirebaseData fbdo;
+extern bool streamActive;
+extern int totalSentences;
+extern char displayText[];
+extern long syncedVersion;
+bool updateTextFromFirebase();
+bool pushLocalChanges();
+bool setSentence(int index, const char* text, size_t length);
+uint32_t sentenceHash(const char* text, size_t length);
+
+const int SENTENCES = 10;
+std::string texts[SENTENCES];
+int version = 1;
+
+std::string quoted(const std::string& text) { return "\"" + text + "\""; }
+
+std::string hashText(const std::string& text) {
+  char hex[12];
+  snprintf(hex, sizeof(hex), "\"%08x\"", (unsigned)sentenceHash(text.c_str(), text.size()));
+  return hex;
+}
+
+// The whole document as a writer that keeps version and hashes up to date leaves it
+std::string document() {
+  std::string sentences = "[", hashes = "[";
+  for (int i = 0; i < SENTENCES; i++) {
+    sentences += (i ? "," : "") + quoted(texts[i]);
+    hashes += (i ? "," : "") + hashText(texts[i]);
+  }
+  return "{\"sentences\":" + sentences + "],\"hashes\":" + hashes + "],\"selectedSentence\":3,\"version\":" +
+         std::to_string(version) + "}";
+}
+
+// Requests and bytes down of one poll
+struct PollCost {
+  uint32_t requests;
+  uint64_t bytes;
+};
+
+PollCost poll() {
+  uint32_t requests = mockRtdb.requests;
+  uint64_t bytes = mockRtdb.bytesDown;
+  updateTextFromFirebase();
+  return { mockRtdb.requests - requests, mockRtdb.bytesDown - bytes };
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// TESTS
+
+void test_first_poll_downloads_everything() {
+  PollCost cost = poll();
+  TEST_ASSERT_EQUAL(SENTENCES, totalSentences);
+  TEST_ASSERT_EQUAL(version, syncedVersion);
+  TEST_ASSERT_EQUAL_STRING(texts[3].c_str(), displayText);
+  // Shallow, hashes, every sentence, settings and playlist
+  TEST_ASSERT_EQUAL(2 + SENTENCES + 2, cost.requests);
+}
+
+void test_unchanged_version_reads_shallow_only() {
+  PollCost cost = poll();
+  TEST_ASSERT_EQUAL(1, cost.requests);
+  // Primitives with their values, the children as true
+  TEST_ASSERT_LESS_THAN(120, cost.bytes);
+}
+
+void test_one_changed_sentence() {
+  texts[7] = "Changed " + texts[7];
+  version++;
+  mockRtdb.set("/display", document().c_str());
+  uint64_t documentBytes = mockRtdb.get("/display").size();
+
+  PollCost cost = poll();
+  TEST_ASSERT_EQUAL(version, syncedVersion);
+  // Shallow, hashes, sentence 7, settings and playlist
+  TEST_ASSERT_EQUAL(5, cost.requests);
+  TEST_ASSERT_LESS_THAN(120 + 11 * SENTENCES + texts[7].size() + 2 + 40, cost.bytes);
+  TEST_ASSERT_LESS_THAN(documentBytes / 4, cost.bytes);
+
+  char line[80];
+  snprintf(line, sizeof(line), "one of %d sentences changed: %llu of %llu bytes", SENTENCES,
+           (unsigned long long)cost.bytes, (unsigned long long)documentBytes);
+  TEST_MESSAGE(line);
+}
+
+void test_selection_only() {
+  mockRtdb.set("/display/selectedSentence", "7");
+  PollCost cost = poll();
+  TEST_ASSERT_EQUAL(1, cost.requests);
+  TEST_ASSERT_EQUAL_STRING(texts[7].c_str(), displayText);
+}
+
+void test_shortened_list() {
+  // Version bumped with three sentences fewer, nothing left to download
+  mockRtdb.set("/display/sentences/9", "null");
+  mockRtdb.set("/display/sentences/8", "null");
+  mockRtdb.set("/display/sentences/7", "null");
+  mockRtdb.set("/display/hashes/9", "null");
+  mockRtdb.set("/display/hashes/8", "null");
+  mockRtdb.set("/display/hashes/7", "null");
+  mockRtdb.set("/display/selectedSentence", "2");
+  mockRtdb.set("/display/version", std::to_string(++version).c_str());
+  PollCost cost = poll();
+  TEST_ASSERT_EQUAL(4, cost.requests);
+  TEST_ASSERT_EQUAL(7, totalSentences);
+}
+
+void test_local_change_bumps_version_and_hashes() {
+  // Written through the local API, polling devices see a new version and the new hash
+  std::string text = "Written on the device";
+  setSentence(4, text.c_str(), text.size());
+  uint32_t requests = mockRtdb.requests;
+  TEST_ASSERT_TRUE(pushLocalChanges());
+  TEST_ASSERT_EQUAL(3, mockRtdb.requests - requests); // Version with its ETag, content, conditional bump
+  TEST_ASSERT_EQUAL_STRING(std::to_string(++version).c_str(), mockRtdb.get("/display/version").c_str());
+  TEST_ASSERT_EQUAL_STRING(hashText(text).c_str(), mockRtdb.get("/display/hashes/4").c_str());
+  TEST_ASSERT_EQUAL(version, syncedVersion);
+  TEST_ASSERT_EQUAL(1, poll().requests); // Our own write is not downloaded again
+}
+
+void test_local_change_before_first_sync() {
+  // No version known yet: continue from the database instead of leaving it where it was
+  syncedVersion = -1;
+  uint32_t requests = mockRtdb.requests;
+  TEST_ASSERT_TRUE(pushLocalChanges());
+  TEST_ASSERT_EQUAL(3, mockRtdb.requests - requests);
+  TEST_ASSERT_EQUAL_STRING(std::to_string(++version).c_str(), mockRtdb.get("/display/version").c_str());
+  TEST_ASSERT_EQUAL(version, syncedVersion);
+}
+
+void test_racing_writers_get_their_own_version() {
+  // Another display read the same version and writes its sentence while our content goes out,
+  // then bumps first. Ours is written again under the version after its one.
+  std::string mine = "Written here", theirs = "Written on the other display";
+  setSentence(5, mine.c_str(), mine.size());
+  bool raced = false;
+  mockRtdb.onRequest = [&](const MockRtdbRequest& request) {
+    if (raced || strcmp(request.method, "PATCH")) return;
+    raced = true;
+    mockRtdb.set("/display/sentences/5", quoted(theirs).c_str());
+    mockRtdb.set("/display/hashes/5", hashText(theirs).c_str());
+    mockRtdb.set("/display/version", std::to_string(version + 1).c_str());
+  };
+  uint32_t requests = mockRtdb.requests;
+  TEST_ASSERT_TRUE(pushLocalChanges());
+  mockRtdb.onRequest = nullptr;
+
+  // Version with its ETag, content, bump refused, content again, bump
+  TEST_ASSERT_EQUAL(5, mockRtdb.requests - requests);
+  version += 2;
+  TEST_ASSERT_EQUAL_STRING(std::to_string(version).c_str(), mockRtdb.get("/display/version").c_str());
+  TEST_ASSERT_EQUAL(version, syncedVersion);
+  TEST_ASSERT_EQUAL_STRING(quoted(mine).c_str(), mockRtdb.get("/display/sentences/5").c_str());
+  TEST_ASSERT_EQUAL_STRING(hashText(mine).c_str(), mockRtdb.get("/display/hashes/5").c_str());
+}
+
+void test_largest_document_fits_one_response() {
+  // Every sentence at 240 bytes and 16 playlist items with every field, read in one go
+  std::string full[SENTENCES];
+  std::string sentences = "[", hashes = "[", playlist = "[";
+  for (int i = 0; i < SENTENCES; i++) {
+    full[i] = std::string(240, (char)('a' + i));
+    sentences += (i ? "," : "") + quoted(full[i]);
+    hashes += (i ? "," : "") + hashText(full[i]);
+  }
+  for (int i = 0; i < 16; i++) {
+    playlist += std::string(i ? "," : "") + "{\"sentence\":" + std::to_string(i % SENTENCES) +
+                ",\"message\":65535,\"repeat\":255,\"dwell\":65535,\"from\":\"23:59\",\"to\":\"23:58\",\"days\":\"SMTWTFS\"}";
+  }
+  std::string document = "{\"sentences\":" + sentences + "],\"hashes\":" + hashes + "],\"playlist\":" + playlist +
+                         "],\"settings\":{\"scrollSpeed\":12.5,\"brightness\":100,\"updateInterval\":600000}," +
+                         "\"selectedSentence\":9,\"updatedAt\":1760000000000}";
+  mockRtdb.set("/display", document.c_str());
+  TEST_ASSERT_EQUAL(2, poll().requests);
+  TEST_ASSERT_EQUAL_STRING(full[9].c_str(), displayText);
+  TEST_ASSERT_EQUAL(SENTENCES, totalSentences);
+  TEST_ASSERT_LESS_OR_EQUAL(fbdo.responseSize, document.size());
+}
+
+void test_no_version_falls_back_to_full_read() {
+  mockRtdb.set("/display/version", "null");
+  uint64_t documentBytes = mockRtdb.get("/display").size();
+  PollCost cost = poll();
+  TEST_ASSERT_EQUAL(2, cost.requests);
+  TEST_ASSERT_GREATER_OR_EQUAL(documentBytes, cost.bytes);
+}
+
+int main() {
+  for (int i = 0; i < SENTENCES; i++) {
+    texts[i] = "Sentence " + std::to_string(i) + ": ";
+    while (texts[i].size() < 200) texts[i] += (char)('a' + texts[i].size() % 26);
+  }
+  mockRtdb.set("/display", document().c_str());
+  setup();
+
+  // Boot until Firebase is up, then take the stream away: every sync below is a poll
+  runFor(5000000);
+  Firebase.RTDB.endStream(&stream);
+  streamActive = false;
+  syncedVersion = -1;
+  totalSentences = 0;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_first_poll_downloads_everything);
+  RUN_TEST(test_unchanged_version_reads_shallow_only);
+  RUN_TEST(test_one_changed_sentence);
+  RUN_TEST(test_selection_only);
+  RUN_TEST(test_shortened_list);
+  RUN_TEST(test_local_change_bumps_version_and_hashes);
+  RUN_TEST(test_local_change_before_first_sync);
+  RUN_TEST(test_racing_writers_get_their_own_version);
+  RUN_TEST(test_no_version_falls_back_to_full_read);
+  RUN_TEST(test_largest_document_fits_one_response);
+  return UNITY_END();
+}
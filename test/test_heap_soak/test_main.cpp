@@ -0,0 +1,113 @@
+// Millions of content updates against the String heap of the mocks: the text arena paths do not
+// allocate at all, and the stream path gives back everything it takes with a high-water mark that
+// stops moving once every kind of event has been seen. The host heap does not fragment, so no
+// allocation in the hot paths and a flat peak are what keep the device heap from fragmenting.
+// Run with: pio test -e native -f test_heap_soak
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <Firebase_ESP_Client.h>
+
+// Firmware under test (src/main.cpp)
+extern bool streamActive;
+extern int totalSentences;
+extern char displayText[];
+bool setSentence(int index, const char* text, size_t length);
+bool setSelectedSentence(int newSelected);
+bool showActiveSentence();
+void handleFirebaseStream();
+void displayTask();
+
+const int ARENA_CYCLES = 2000000;
+const int STREAM_CYCLES = 1000000;
+const int WARMUP_CYCLES = 10000; // Every event kind and text length at least once
+
+// Text of cycle n, 1 to 240 bytes, some of it Bangla
+std::string cycleText(int n) {
+  static const char* words[] = { "Sale ", "আমার ", "Open ", "সোনার ", "24/7 " };
+  std::string text;
+  size_t length = 1 + (n * 37) % 240;
+  for (int i = 0; text.size() < length; i++) text += words[(n + i) % 5];
+  while (text.size() > length) text.pop_back();
+  while (!text.empty() && ((uint8_t)text.back() & 0xC0) == 0x80) text.pop_back(); // Whole characters
+  if (!text.empty() && (uint8_t)text.back() >= 0xC0) text.pop_back();
+  return text.empty() ? "x" : text;
+}
+
+// One update through the stream: the console writes, the event is read and applied, a frame drawn
+void streamCycle(int n) {
+  std::string text = cycleText(n);
+  switch (n % 4) {
+    case 0:
+      mockRtdb.set(("/display/sentences/" + std::to_string(n % 10)).c_str(), ("\"" + text + "\"").c_str());
+      break;
+    case 1:
+      mockRtdb.set("/display/selectedSentence", std::to_string(n / 4 % 10).c_str());
+      break;
+    case 2:
+      mockRtdb.update("/display/sentences", ("{\"" + std::to_string(n % 10) + "\":\"" + text + "\"}").c_str());
+      break;
+    case 3:
+      if (n % 1000 == 3) mockRtdb.set("/display/settings/scrollSpeed", std::to_string(10 + n / 1000 % 40).c_str());
+      else mockRtdb.set(("/display/sentences/" + std::to_string(n / 4 % 10)).c_str(), ("\"" + text + "\"").c_str());
+      break;
+  }
+  handleFirebaseStream();
+  displayTask();
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// TESTS
+
+void test_arena_updates_do_not_allocate() {
+  std::string texts[16];
+  for (int i = 0; i < 16; i++) texts[i] = cycleText(i * 7);
+
+  uint32_t allocations = mockHeap.allocations;
+  uint32_t used = mockHeap.used;
+  for (int n = 0; n < ARENA_CYCLES; n++) {
+    const std::string& text = texts[n % 16];
+    setSentence(n % 10, text.data(), text.size());
+    setSelectedSentence(n / 10 % 10);
+    showActiveSentence();
+    if (n % 64 == 0) displayTask(); // Shapes and renders the strip for the new text
+  }
+  TEST_ASSERT_EQUAL(10, totalSentences);
+  TEST_ASSERT_EQUAL(allocations, mockHeap.allocations);
+  TEST_ASSERT_EQUAL(used, mockHeap.used);
+}
+
+void test_stream_updates_keep_heap_flat() {
+  mockRtdb.eventDelayUs = 0;
+  int n = 0;
+  for (; n < WARMUP_CYCLES; n++) streamCycle(n);
+  uint32_t used = mockHeap.used;
+  mockHeap.peak = mockHeap.used;
+  for (; n < WARMUP_CYCLES * 2; n++) streamCycle(n);
+  uint32_t warmPeak = mockHeap.peak;
+
+  uint32_t allocations = mockHeap.allocations;
+  for (; n < STREAM_CYCLES; n++) streamCycle(n);
+  TEST_ASSERT_TRUE(streamActive);
+  TEST_ASSERT_EQUAL(10, totalSentences);
+
+  char line[96];
+  snprintf(line, sizeof(line), "%d stream updates: %u bytes at rest, peak %u, %.1f allocs/update", STREAM_CYCLES,
+           (unsigned)mockHeap.used, (unsigned)mockHeap.peak,
+           (double)(mockHeap.allocations - allocations) / (STREAM_CYCLES - 2 * WARMUP_CYCLES));
+  TEST_MESSAGE(line);
+  TEST_ASSERT_EQUAL(used, mockHeap.used);     // Nothing kept between updates
+  TEST_ASSERT_EQUAL(warmPeak, mockHeap.peak); // High-water mark flat
+}
+
+int main() {
+  mockRtdb.set("/display", "{\"sentences\":[\"Soak\"],\"selectedSentence\":0}");
+  setup();
+  runFor(10000000); // WiFi, Firebase and the stream are up
+  UNITY_BEGIN();
+  RUN_TEST(test_arena_updates_do_not_allocate);
+  RUN_TEST(test_stream_updates_keep_heap_flat);
+  return UNITY_END();
+}
@@ -0,0 +1,358 @@
+// JSON parser: a recorded /display payload gives the same values through the streaming parser as
+// through the FirebaseJson tree the sync used to build, whole or fed in pieces that cut escapes and
+// UTF-8 sequences, and the firmware reads the same sentences, settings and playlist out of it.
+// On generated 1 KB, 10 KB and 100 KB payloads parse throughput and peak memory of both are
+// reported: the streaming side allocates nothing, the tree holds the payload and more.
+// Run with: pio test -e native -f test_json_parser
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <Firebase_ESP_Client.h>
+#include <JsonParser.h>
+#include <Playlist.h>
+#include <chrono>
+#include <map>
+#include <new>
+#include <string>
+
+// Firmware under test (src/main.cpp)
+const int MAX_SENTENCES = 10;
+struct Sentence {
+  uint16_t length;
+  uint32_t hash;
+  char text[240 + 1];
+};
+struct DisplayFields {
+  long version;
+  int selected;
+  uint64_t updatedAt;
+  uint16_t sentences;
+  int hashCount;
+  uint32_t hashes[MAX_SENTENCES];
+  bool playlist;
+  bool updated;
+};
+enum DisplayReadMode { DISPLAY_SCAN, DISPLAY_PATCH, DISPLAY_PUT };
+extern Sentence sentences[];
+extern int totalSentences;
+extern int selectedSentence;
+extern float scrollSpeed;
+extern PlaylistItem playlist[];
+extern int playlistLength;
+extern DisplayFields displayFields;
+extern JsonParser rtdbParser;
+bool readDisplayJson(const String &payload, const char* node, uint8_t mode);
+void beginDisplayJson(const char* node, uint8_t mode);
+bool finishDisplayJson();
+
+// /display as the RTDB sent it: Bangla as \u escapes and as UTF-8, an emoji as a surrogate pair,
+// escaped quotes, a playlist, and status and meta nodes the firmware reads over
+const char* RECORDED_DISPLAY = R"json({
+  "hashes": ["9c1f02aa", "5e0d33b1", "00c4e7f9"],
+  "meta": {"device": {"fw": {"build": {"sha": "4f2a9c1", "dirty": false}}}, "owner": "newsroom"},
+  "playlist": [
+    {"sentence": 0, "repeat": 2, "from": "06:00", "to": "12:00", "days": "-MTWTF-"},
+    {"sentence": 2, "dwell": 30, "from": "18:30", "to": "02:00"},
+    {"message": 1, "repeat": 1}
+  ],
+  "selectedSentence": 1,
+  "sentences": [
+    "\u09AC\u09BE\u0982\u09B2\u09BE\u09A6\u09C7\u09B6 বাণিজ্য মেলা শুরু \ud83d\udcf0",
+    "Breaking: \"Padma bridge\" traffic resumes ⭐ ঢাকা\tনিউজ",
+    "Weather: 31.5 °C, humidity 78%, wind 12 km/h\\N"
+  ],
+  "settings": {"scrollSpeed": 35.5, "updateInterval": 60000, "brightness": null, "night": {"from": "23:00", "dim": true}},
+  "status": {"log": [
+    {"t": 1760000000, "event": "reconnect", "rssi": -71, "ok": true},
+    {"t": 1760000420, "event": "sync", "bytes": 1.25e3, "ok": false}
+  ]},
+  "updatedAt": 1760000123456,
+  "version": 42
+})json";
+
+//--------------------------
+// HEAP
+// The FirebaseJson tree allocates through new, String through mockHeap. Counted only while
+// counting is set, the sizes sit in front of each block.
+
+bool counting = false;
+size_t newBytes = 0;     // Allocated now
+size_t newPeak = 0;      // Most allocated at once
+uint32_t newCount = 0;
+
+void* operator new(size_t size) {
+  size_t* block = (size_t*)malloc(size + sizeof(max_align_t));
+  if (!block) throw std::bad_alloc();
+  *block = counting ? size : 0;
+  if (counting) {
+    newBytes += size;
+    newPeak = max(newPeak, newBytes);
+    newCount++;
+  }
+  return (char*)block + sizeof(max_align_t);
+}
+
+void operator delete(void* p) noexcept {
+  if (!p) return;
+  size_t* block = (size_t*)((char*)p - sizeof(max_align_t));
+  newBytes -= *block;
+  free(block);
+}
+
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
+struct HeapCount {
+  uint32_t mockUsed, mockAllocations;
+  HeapCount() {
+    mockUsed = mockHeap.used;
+    mockHeap.peak = mockHeap.used;
+    mockAllocations = mockHeap.allocations;
+    newBytes = newPeak = newCount = 0;
+    counting = true;
+  }
+  ~HeapCount() { counting = false; }
+  size_t peak() const { return newPeak + (mockHeap.peak - mockUsed); }
+  uint32_t allocations() const { return newCount + (mockHeap.allocations - mockAllocations); }
+};
+
+//--------------------------
+// FLATTENING
+// Every scalar as "path=value", paths in RTDB form ("sentences/2"), nulls left out like the RTDB
+// does. Only values within JSON_MAX_DEPTH, the streaming parser reads deeper ones over.
+
+std::map<std::string, std::string> streamed;
+
+void onFlattenJson(JsonParser &parser, int event) {
+  if (event >= JSON_OBJECT_START || event == JSON_NULL) return;
+  std::string path;
+  for (int level = 1; level <= parser.depth; level++) {
+    if (level > 1) path += '/';
+    path += parser.inArray[level] ? std::to_string(parser.index[level]) : std::string(parser.key[level]);
+  }
+  streamed[path] = std::string(event == JSON_STRING ? "s:" : "v:") + parser.value;
+}
+
+std::map<std::string, std::string> flattenStream(const std::string &text, size_t pieceSize) {
+  JsonParser parser;
+  streamed.clear();
+  parser.begin(onFlattenJson);
+  for (size_t at = 0; at < text.size(); at += pieceSize) {
+    parser.feed(text.data() + at, min(pieceSize, text.size() - at));
+  }
+  TEST_ASSERT_TRUE(parser.finish());
+  return streamed;
+}
+
+void flattenNode(const MockJsonNode &node, const std::string &path, int depth, std::map<std::string, std::string> &out) {
+  if (node.type == MockJsonNode::OBJECT) {
+    if (depth == JSON_MAX_DEPTH) return;
+    for (auto &child : node.children) {
+      flattenNode(child.second, path.empty() ? child.first : path + "/" + child.first, depth + 1, out);
+    }
+  } else if (node.type != MockJsonNode::NONE) {
+    out[path] = std::string(node.type == MockJsonNode::STRING ? "s:" : "v:") + node.value;
+  }
+}
+
+std::map<std::string, std::string> flattenDom(const std::string &text) {
+  FirebaseJson json;
+  json.setJsonData(text.c_str());
+  std::map<std::string, std::string> out;
+  flattenNode(json.node, "", 0, out);
+  return out;
+}
+
+// First path where the two differ, empty if none
+std::string firstDifference(const std::map<std::string, std::string> &a, const std::map<std::string, std::string> &b) {
+  for (auto &entry : a) {
+    auto found = b.find(entry.first);
+    if (found == b.end() || found->second != entry.second) return entry.first + "=" + entry.second;
+  }
+  for (auto &entry : b) {
+    if (!a.count(entry.first)) return entry.first + "=" + entry.second;
+  }
+  return "";
+}
+
+//--------------------------
+// GENERATED PAYLOADS
+
+// A /display document of about size bytes: the content the device reads, then status log
+// entries it passes over
+std::string displayPayload(size_t size) {
+  char piece[160];
+  std::string text = "{\"selectedSentence\":1,\"sentences\":[";
+  for (int i = 0; i < MAX_SENTENCES; i++) {
+    snprintf(piece, sizeof(piece), "%s\"Sentence %d \\u09AC\\u09BE\\u0982\\u09B2\\u09BE ⭐ payload text\"", i ? "," : "", i);
+    text += piece;
+  }
+  text += "],\"settings\":{\"scrollSpeed\":40.00,\"updateInterval\":30000},\"status\":{\"log\":[";
+  for (int i = 0; text.size() + 80 < size; i++) {
+    snprintf(piece, sizeof(piece), "%s{\"t\":%d,\"event\":\"reconnect\",\"rssi\":%d,\"ok\":true}", i ? "," : "",
+             1760000000 + i, -60 - i % 30);
+    text += piece;
+  }
+  text += "]},\"updatedAt\":1760000000000,\"version\":1}";
+  return text;
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// EQUIVALENCE
+
+void test_recorded_payload_same_as_dom() {
+  std::map<std::string, std::string> dom = flattenDom(RECORDED_DISPLAY);
+  std::map<std::string, std::string> whole = flattenStream(RECORDED_DISPLAY, strlen(RECORDED_DISPLAY));
+  TEST_ASSERT_EQUAL_STRING("", firstDifference(dom, whole).c_str());
+  TEST_ASSERT_EQUAL(dom.size(), whole.size());
+  TEST_ASSERT_GREATER_THAN(30, whole.size());
+
+  TEST_ASSERT_EQUAL_STRING("s:বাংলাদেশ বাণিজ্য মেলা শুরু 📰", whole["sentences/0"].c_str());
+  TEST_ASSERT_EQUAL_STRING("s:Breaking: \"Padma bridge\" traffic resumes ⭐ ঢাকা\tনিউজ", whole["sentences/1"].c_str());
+  TEST_ASSERT_EQUAL_STRING("v:1.25e3", whole["status/log/1/bytes"].c_str());
+  TEST_ASSERT_EQUAL(0, whole.count("settings/brightness"));        // null
+  TEST_ASSERT_EQUAL(0, whole.count("meta/device/fw/build/sha"));   // Deeper than JSON_MAX_DEPTH
+  TEST_ASSERT_EQUAL_STRING("s:newsroom", whole["meta/owner"].c_str());
+}
+
+void test_pieces_cut_anywhere() {
+  std::map<std::string, std::string> dom = flattenDom(RECORDED_DISPLAY);
+  // 1 byte pieces cut every escape and every UTF-8 sequence, the others at odd places
+  const size_t pieceSizes[] = { 1, 2, 3, 7, 64, 500 };
+  for (size_t pieceSize : pieceSizes) {
+    std::map<std::string, std::string> pieces = flattenStream(RECORDED_DISPLAY, pieceSize);
+    TEST_ASSERT_EQUAL_STRING("", firstDifference(dom, pieces).c_str());
+  }
+}
+
+void test_firmware_reads_what_dom_reads() {
+  TEST_ASSERT_TRUE(readDisplayJson(RECORDED_DISPLAY, "", DISPLAY_PUT));
+  FirebaseJson json;
+  json.setJsonData(RECORDED_DISPLAY);
+  FirebaseJsonData result;
+
+  int count = 0;
+  char path[32];
+  for (;; count++) {
+    snprintf(path, sizeof(path), "sentences/[%d]", count);
+    if (!json.get(result, path)) break;
+    TEST_ASSERT_EQUAL_STRING(result.stringValue.c_str(), sentences[count].text);
+  }
+  TEST_ASSERT_EQUAL(3, count);
+  TEST_ASSERT_EQUAL(count, totalSentences);
+
+  json.get(result, "selectedSentence");
+  TEST_ASSERT_EQUAL(result.intValue, selectedSentence);
+  json.get(result, "settings/scrollSpeed");
+  TEST_ASSERT_EQUAL_FLOAT(result.floatValue, scrollSpeed);
+  json.get(result, "version");
+  TEST_ASSERT_EQUAL(result.intValue, displayFields.version);
+  json.get(result, "updatedAt");
+  TEST_ASSERT_EQUAL(1760000123456ULL, displayFields.updatedAt);
+
+  TEST_ASSERT_EQUAL(3, displayFields.hashCount);
+  for (int i = 0; i < displayFields.hashCount; i++) {
+    snprintf(path, sizeof(path), "hashes/[%d]", i);
+    json.get(result, path);
+    TEST_ASSERT_EQUAL_HEX32(strtoul(result.stringValue.c_str(), nullptr, 16), displayFields.hashes[i]);
+  }
+
+  TEST_ASSERT_EQUAL(3, playlistLength);
+  json.get(result, "playlist/[1]/dwell");
+  TEST_ASSERT_EQUAL(result.intValue, playlist[1].dwell);
+  json.get(result, "playlist/[0]/repeat");
+  TEST_ASSERT_EQUAL(result.intValue, playlist[0].repeat);
+  TEST_ASSERT_EQUAL(6 * 60, playlist[0].from);
+  TEST_ASSERT_EQUAL(2 * 60, playlist[1].to);
+  TEST_ASSERT_EQUAL(0x3E, playlist[0].days);
+  TEST_ASSERT_EQUAL(PLAYLIST_MESSAGE, playlist[2].flags & PLAYLIST_MESSAGE);
+}
+
+//--------------------------
+// THROUGHPUT AND MEMORY
+
+const size_t PIECE_SIZE = 512; // What the stream client hands over at a time
+
+struct ParseRun {
+  size_t length;
+  double streamKBs, domKBs;
+  size_t streamPeak, domPeak;
+  uint32_t streamAllocations;
+};
+
+ParseRun runParse(size_t size) {
+  ParseRun run = {};
+  std::string text = displayPayload(size);
+  run.length = text.size();
+  int repeats = max(4, (int)(4000000 / text.size()));
+
+  // readDisplayJson() fed piece by piece, the payload never has to be in RAM at once
+  {
+    HeapCount heap;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) {
+      beginDisplayJson("", DISPLAY_PATCH);
+      for (size_t at = 0; at < text.size(); at += PIECE_SIZE) {
+        rtdbParser.feed(text.data() + at, min(PIECE_SIZE, text.size() - at));
+      }
+      TEST_ASSERT_TRUE(finishDisplayJson());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    run.streamKBs = text.size() * repeats / 1024.0 / seconds;
+    run.streamPeak = heap.peak();
+    run.streamAllocations = heap.allocations();
+  }
+
+  // FirebaseJson as the sync did before: the whole payload in a String, then the tree and the gets
+  {
+    HeapCount heap;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) {
+      String payload(text.c_str());
+      FirebaseJson json;
+      json.setJsonData(payload);
+      FirebaseJsonData result;
+      json.get(result, "selectedSentence");
+      char path[24];
+      for (int j = 0; j < MAX_SENTENCES; j++) {
+        snprintf(path, sizeof(path), "sentences/[%d]", j);
+        json.get(result, path);
+      }
+      json.get(result, "settings/scrollSpeed");
+      json.get(result, "settings/updateInterval");
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    run.domKBs = text.size() * repeats / 1024.0 / seconds;
+    run.domPeak = heap.peak();
+  }
+  return run;
+}
+
+void test_parse_throughput_and_memory() {
+  const size_t sizes[] = { 1024, 10240, 102400 };
+  for (size_t size : sizes) {
+    ParseRun run = runParse(size);
+    TEST_ASSERT_EQUAL(0, run.streamAllocations);
+    TEST_ASSERT_EQUAL(0, run.streamPeak);
+    TEST_ASSERT_GREATER_THAN(run.length, run.domPeak); // The payload and its tree
+
+    char line[160];
+    snprintf(line, sizeof(line), "%6u bytes: streaming %7.0f KB/s, heap 0 + %u static; FirebaseJson %7.0f KB/s, heap peak %u",
+             (unsigned)run.length, run.streamKBs, (unsigned)(sizeof(JsonParser) + sizeof(DisplayFields)),
+             run.domKBs, (unsigned)run.domPeak);
+    TEST_MESSAGE(line);
+  }
+  TEST_ASSERT_EQUAL_STRING("Sentence 9 বাংলা ⭐ payload text", sentences[9].text);
+}
+
+int main() {
+  setup();
+  runFor(10000000);
+  UNITY_BEGIN();
+  RUN_TEST(test_recorded_payload_same_as_dom);
+  RUN_TEST(test_pieces_cut_anywhere);
+  RUN_TEST(test_firmware_reads_what_dom_reads);
+  RUN_TEST(test_parse_throughput_and_memory);
+  return UNITY_END();
+}
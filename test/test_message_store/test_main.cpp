@@ -0,0 +1,163 @@
+// LZSS codec of the message store: round trips of every kind of text at any read size, a
+// 10 KB ticker decoded with the RAM of the window and a few small buffers, data cut short,
+// and the same ticker uploaded through the local API and scrolled to its end on the panel.
+// Run with: pio test -e native -f test_message_store
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <ESP8266WebServer.h>
+#include <MockJson.h>
+#include <Lzss.h>
+#include <random>
+#include <vector>
+
+// Firmware under test (src/main.cpp)
+extern ESP8266WebServer server;
+extern bool showClock;
+bool applyPlaylistText(const char* text, size_t length);
+bool setScrollSpeed(float pixelsPerSecond);
+
+struct MemoryOutput {
+  std::vector<uint8_t>* data;
+  bool write(const uint8_t* bytes, int size) {
+    data->insert(data->end(), bytes, bytes + size);
+    return true;
+  }
+};
+
+struct MemoryInput {
+  const uint8_t* data;
+  size_t size;
+  size_t pos = 0;
+  uint32_t reads = 0;
+  int read(uint8_t* bytes, int count) {
+    int n = min<size_t>(count, size - pos);
+    memcpy(bytes, data + pos, n);
+    pos += n;
+    if (n) reads++;
+    return n;
+  }
+};
+
+std::vector<uint8_t> encode(const std::string& text) {
+  std::vector<uint8_t> packed;
+  static LzssEncoder<MemoryOutput> encoder; // 1 KB window, static like the firmware's
+  encoder.output.data = &packed;
+  encoder.begin();
+  for (char c : text) encoder.put(c);
+  TEST_ASSERT_TRUE(encoder.finish());
+  TEST_ASSERT_EQUAL(text.size(), encoder.total);
+  TEST_ASSERT_EQUAL(packed.size(), encoder.packed);
+  return packed;
+}
+
+// Decodes in reads of chunk bytes
+std::string decode(const std::vector<uint8_t>& packed, size_t length, int chunk, uint32_t* reads = nullptr) {
+  static LzssDecoder<MemoryInput> decoder;
+  decoder.input = { packed.data(), packed.size() };
+  decoder.begin(length);
+  std::string text;
+  char buffer[4096];
+  for (int count; (count = decoder.read(buffer, chunk)) > 0; ) text.append(buffer, count);
+  if (reads) *reads = decoder.input.reads;
+  return text;
+}
+
+// A news ticker like the ones the store is for, words repeat but not in a fixed cycle
+std::string ticker(size_t length) {
+  const char* words[] = { "Dhaka ", "traffic ", "update: ", "বাংলা ", "rain ", "expected ",
+                          "after ", "3pm, ", "⭐ ", "markets ", "open ", "higher. " };
+  const int wordCount = sizeof(words) / sizeof(words[0]);
+  std::string text;
+  for (uint32_t i = 0; text.size() < length; i++) text += words[(i * 7 + i / wordCount) % wordCount];
+  return text;
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// CODEC
+
+void test_round_trips() {
+  std::mt19937 rng(20);
+  std::string random(10240, 0);
+  for (char& c : random) c = rng();
+  std::string texts[] = { "", "a", std::string(5000, 'a'), "abcabcabcabcabcabcabx", ticker(10240), random,
+                          ticker(70000).substr(0, 65536) };
+  for (const std::string& text : texts) {
+    std::vector<uint8_t> packed = encode(text);
+    // One flag byte per 8 tokens on top of the literals at worst
+    TEST_ASSERT_LESS_OR_EQUAL(text.size() + (text.size() + 7) / 8, packed.size());
+    for (int chunk : { 1, 7, 96, 4096 }) {
+      TEST_ASSERT_TRUE(decode(packed, text.size(), chunk) == text);
+    }
+  }
+}
+
+void test_ten_kb_ticker() {
+  std::string text = ticker(10240);
+  std::vector<uint8_t> packed = encode(text);
+  uint32_t reads;
+  TEST_ASSERT_TRUE(decode(packed, text.size(), 96, &reads) == text);
+  // Input comes in 64 byte blocks, never read twice
+  TEST_ASSERT_EQUAL((packed.size() + 63) / 64, reads);
+  TEST_ASSERT_LESS_THAN(text.size() / 2, packed.size());
+
+  // The window and a few buffers, whatever the length of the text
+  size_t decoderRam = sizeof(LzssDecoder<MemoryInput>) - sizeof(MemoryInput);
+  size_t encoderRam = sizeof(LzssEncoder<MemoryOutput>) - sizeof(MemoryOutput);
+  TEST_ASSERT_LESS_OR_EQUAL(LZ_WINDOW + 96, decoderRam);
+  TEST_ASSERT_LESS_OR_EQUAL(LZ_WINDOW + LZ_MAX_MATCH + 64, encoderRam);
+
+  char line[112];
+  snprintf(line, sizeof(line), "10 KB ticker: %zu bytes packed, decoder %zu bytes RAM, encoder %zu bytes RAM",
+           packed.size(), decoderRam, encoderRam);
+  TEST_MESSAGE(line);
+}
+
+void test_data_cut_short() {
+  std::string text = ticker(2000);
+  std::vector<uint8_t> packed = encode(text);
+  packed.resize(packed.size() / 2);
+  std::string decoded = decode(packed, text.size(), 96);
+  TEST_ASSERT_LESS_THAN(text.size(), decoded.size());
+  TEST_ASSERT_TRUE(text.compare(0, decoded.size(), decoded) == 0); // What came out is right
+}
+
+//--------------------------
+// FIRMWARE
+
+void test_upload_and_scroll_to_the_end() {
+  std::string text = ticker(10240);
+  MockResponse response = server.mockRequest(HTTP_PUT, "/api/messages", "id=7", text.c_str());
+  TEST_ASSERT_EQUAL_MESSAGE(200, response.status, response.body.c_str());
+  MockJsonNode reply;
+  TEST_ASSERT_TRUE(MockJsonNode::parse(response.body.c_str(), reply));
+  TEST_ASSERT_EQUAL(text.size(), atoi(reply.find("/length")->text().c_str()));
+  TEST_ASSERT_EQUAL(encode(text).size(), atoi(reply.find("/packed")->text().c_str()));
+  uint32_t columns = atoi(reply.find("/columns")->text().c_str());
+
+  // Played through the playlist at top speed, the clock comes once the last column is through
+  const float SPEED = 200;
+  const char* playlist = "[{\"message\": 7}]";
+  TEST_ASSERT_TRUE(applyPlaylistText(playlist, strlen(playlist)));
+  setScrollSpeed(SPEED);
+  while (!showClock) runFor(1000);
+  while (showClock) runFor(1000);
+  uint64_t start = mockNowUs;
+  while (!showClock) runFor(1000);
+  double seconds = (mockNowUs - start) / 1e6;
+  double expected = columns / SPEED;
+  TEST_ASSERT_FLOAT_WITHIN(expected * 0.05 + 1, expected, seconds);
+}
+
+int main() {
+  setup();
+  runFor(5000000);
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trips);
+  RUN_TEST(test_ten_kb_ticker);
+  RUN_TEST(test_data_cut_short);
+  RUN_TEST(test_upload_and_scroll_to_the_end);
+  return UNITY_END();
+}
@@ -0,0 +1,112 @@
+// /metrics and /metrics.json go out chunked from a small buffer: every response is complete and
+// well formed however long it gets, and a line too long for the buffer is counted instead of
+// sent cut short. Run with: pio test -e native -f test_metrics
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <ESP8266WebServer.h>
+#include <MockJson.h>
+#include <set>
+
+// Firmware under test (src/main.cpp)
+extern ESP8266WebServer server;
+extern char metricsChunk[256];
+extern uint32_t metricsOverflows;
+void metricsBegin(const char* contentType);
+void metricsAppend(const char* format, ...);
+void metricsEnd();
+
+const size_t CHUNK = sizeof(metricsChunk);
+
+// Every sample line is "name{labels} value" with a # TYPE line for its family before it
+void checkPrometheus(const std::string& body) {
+  std::set<std::string> typed;
+  size_t start = 0, samples = 0;
+  while (start < body.size()) {
+    size_t end = body.find('\n', start);
+    TEST_ASSERT_TRUE_MESSAGE(end != std::string::npos, "last line not terminated");
+    std::string line = body.substr(start, end - start);
+    start = end + 1;
+    if (line.rfind("# TYPE ", 0) == 0) {
+      typed.insert(line.substr(7, line.find(' ', 7) - 7));
+      continue;
+    }
+    if (line.rfind("# HELP ", 0) == 0) continue;
+
+    size_t nameEnd = line.find_first_of("{ ");
+    TEST_ASSERT_TRUE_MESSAGE(nameEnd != std::string::npos, line.c_str());
+    std::string name = line.substr(0, nameEnd);
+    std::string family = name;
+    for (const char* suffix : { "_bucket", "_sum", "_count" }) {
+      size_t at = name.size() - strlen(suffix);
+      if (name.size() > strlen(suffix) && name.compare(at, std::string::npos, suffix) == 0 && !typed.count(name)) {
+        family = name.substr(0, at);
+      }
+    }
+    TEST_ASSERT_TRUE_MESSAGE(typed.count(family), line.c_str());
+    char* number;
+    strtod(line.c_str() + line.rfind(' ') + 1, &number);
+    TEST_ASSERT_EQUAL_MESSAGE(0, *number, line.c_str());
+    samples++;
+  }
+  TEST_ASSERT_GREATER_THAN(50, samples);
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// TESTS
+
+void test_prometheus_chunked() {
+  MockResponse response = server.mockRequest(HTTP_GET, "/metrics");
+  TEST_ASSERT_EQUAL(200, response.status);
+  TEST_ASSERT_TRUE(response.chunked);
+  TEST_ASSERT_LESS_OR_EQUAL(CHUNK, response.largestSend);
+  // Far more than one chunk, all of it there
+  TEST_ASSERT_GREATER_THAN(8 * CHUNK, response.body.size());
+  checkPrometheus(response.body);
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, response.body.find("\np10_metrics_overflows_total 0\n"));
+
+  char line[64];
+  snprintf(line, sizeof(line), "/metrics: %zu bytes in %zu sends", response.body.size(), response.sends);
+  TEST_MESSAGE(line);
+}
+
+void test_json_chunked() {
+  MockResponse response = server.mockRequest(HTTP_GET, "/metrics.json");
+  TEST_ASSERT_EQUAL(200, response.status);
+  TEST_ASSERT_TRUE(response.chunked);
+  TEST_ASSERT_LESS_OR_EQUAL(CHUNK, response.largestSend);
+
+  MockJsonNode json;
+  TEST_ASSERT_TRUE_MESSAGE(MockJsonNode::parse(response.body.c_str(), json), response.body.c_str());
+  TEST_ASSERT_NOT_NULL(json.find("/heap/min_free"));
+  TEST_ASSERT_NOT_NULL(json.find("/soak/flash_erases"));
+  TEST_ASSERT_EQUAL_STRING("0", json.find("/metrics_overflows")->text().c_str());
+}
+
+void test_long_line_is_reported() {
+  server.on("/overflow", HTTP_GET, []() {
+    metricsBegin("text/plain");
+    metricsAppend("before %d\n", 1);
+    metricsAppend("%s\n", std::string(CHUNK, 'x').c_str());
+    metricsAppend("after %d\n", 2);
+    metricsEnd();
+  });
+  MockResponse response = server.mockRequest(HTTP_GET, "/overflow");
+  TEST_ASSERT_EQUAL_STRING("before 1\nafter 2\n", response.body.c_str());
+  TEST_ASSERT_EQUAL(1, metricsOverflows);
+
+  response = server.mockRequest(HTTP_GET, "/metrics");
+  TEST_ASSERT_NOT_EQUAL(std::string::npos, response.body.find("\np10_metrics_overflows_total 1\n"));
+}
+
+int main() {
+  setup();
+  runFor(10000000);
+  UNITY_BEGIN();
+  RUN_TEST(test_prometheus_chunked);
+  RUN_TEST(test_json_chunked);
+  RUN_TEST(test_long_line_is_reported);
+  return UNITY_END();
+}
@@ -0,0 +1,117 @@
+// Playlist schedule over a simulated week: the compiled span table gives the same items as the
+// rules of every item for every minute of the week, for hand written playlists, random ones
+// with windows past midnight, and one parsed from the console's JSON.
+// Run with: pio test -e native -f test_playlist
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <Playlist.h>
+#include <random>
+
+// Firmware under test (src/main.cpp)
+extern PlaylistItem playlist[];
+extern int playlistLength;
+extern PlaylistSchedule playlistSchedule;
+bool applyPlaylistText(const char* text, size_t length);
+
+// Minutes of the week where the table and the rules disagree
+int weekMismatches(const PlaylistSchedule& schedule, const PlaylistItem* items, int count) {
+  int mismatches = 0;
+  for (int minute = 0; minute < MINUTES_PER_WEEK; minute++) {
+    uint16_t expected = 0;
+    for (int i = 0; i < count; i++) {
+      if (playlistItemActive(items[i], minute)) expected |= 1 << i;
+    }
+    if (schedule.maskAt(minute) != expected) mismatches++;
+  }
+  return mismatches;
+}
+
+int minuteOf(int day, int hour, int minute) { return day * MINUTES_PER_DAY + hour * 60 + minute; }
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// SCHEDULE
+
+void test_empty_playlist() {
+  PlaylistSchedule schedule;
+  schedule.compile(nullptr, 0);
+  TEST_ASSERT_EQUAL(1, schedule.spanCount);
+  TEST_ASSERT_EQUAL(0, schedule.alwaysMask);
+  TEST_ASSERT_EQUAL(0, schedule.maskAt(0));
+  TEST_ASSERT_EQUAL(0, schedule.maskAt(MINUTES_PER_WEEK - 1));
+}
+
+void test_week_of_windows() {
+  const PlaylistItem items[] = {
+    { 0, 1, 0x7F, 0, 0, 0, 0, 0 },                // Always
+    { 1, 2, 0x3E, 0, 8 * 60, 12 * 60, 60, 0 },    // Weekdays 08:00-12:00
+    { 2, 1, 0x41, 0, 22 * 60, 2 * 60, 0, 0 },     // Weekends 22:00-02:00
+    { 3, 1, 0x7F, 0, 12 * 60, 12 * 60 + 1, 0, 0 } // One minute a day
+  };
+  PlaylistSchedule schedule;
+  schedule.compile(items, 4);
+  TEST_ASSERT_EQUAL(0, weekMismatches(schedule, items, 4));
+  TEST_ASSERT_EQUAL(0x1, schedule.alwaysMask);
+
+  TEST_ASSERT_EQUAL(0x1, schedule.maskAt(minuteOf(1, 7, 59)));
+  TEST_ASSERT_EQUAL(0x3, schedule.maskAt(minuteOf(1, 8, 0)));   // Monday 08:00
+  TEST_ASSERT_EQUAL(0x9, schedule.maskAt(minuteOf(1, 12, 0)));  // The one minute
+  TEST_ASSERT_EQUAL(0x1, schedule.maskAt(minuteOf(1, 12, 1)));
+  TEST_ASSERT_EQUAL(0x1, schedule.maskAt(minuteOf(6, 8, 30)));  // Not on Saturday
+  TEST_ASSERT_EQUAL(0x5, schedule.maskAt(minuteOf(6, 23, 0)));  // Saturday night
+  TEST_ASSERT_EQUAL(0x5, schedule.maskAt(minuteOf(0, 1, 59)));  // Past midnight into Sunday
+  TEST_ASSERT_EQUAL(0x5, schedule.maskAt(minuteOf(1, 1, 0)));   // Sunday night into Monday
+  TEST_ASSERT_EQUAL(0x1, schedule.maskAt(minuteOf(2, 1, 0)));   // Monday's night is not on
+}
+
+void test_random_playlists_over_a_week() {
+  std::mt19937 rng(19);
+  int worstSpans = 0;
+  for (int run = 0; run < 200; run++) {
+    PlaylistItem items[PLAYLIST_MAX_ITEMS];
+    int count = 1 + rng() % PLAYLIST_MAX_ITEMS;
+    for (int i = 0; i < count; i++) {
+      items[i] = { (uint8_t)(rng() % 10), 1, (uint8_t)(rng() % 128), 0, 0, 0, 0, 0 };
+      if (rng() % 4) {
+        items[i].from = rng() % MINUTES_PER_DAY;
+        items[i].to = rng() % MINUTES_PER_DAY; // Before from half the time, past midnight
+      }
+    }
+    PlaylistSchedule schedule;
+    schedule.compile(items, count);
+    TEST_ASSERT_EQUAL(0, weekMismatches(schedule, items, count));
+    TEST_ASSERT_LESS_OR_EQUAL(PlaylistSchedule::MAX_SPANS, schedule.spanCount);
+    worstSpans = max(worstSpans, schedule.spanCount);
+  }
+  char line[64];
+  snprintf(line, sizeof(line), "200 random playlists, at most %d spans", worstSpans);
+  TEST_MESSAGE(line);
+}
+
+//--------------------------
+// FIRMWARE
+
+void test_console_playlist_compiles() {
+  const char* text = "[{\"sentence\": 0, \"repeat\": 2}, "
+                     "{\"sentence\": 3, \"dwell\": 60, \"from\": \"08:00\", \"to\": \"12:00\", \"days\": \"-MTWTF-\"}, "
+                     "{\"sentence\": 9, \"from\": \"22:00\", \"to\": \"06:00\"}]";
+  TEST_ASSERT_TRUE(applyPlaylistText(text, strlen(text)));
+  TEST_ASSERT_EQUAL(3, playlistLength);
+  TEST_ASSERT_EQUAL(0, weekMismatches(playlistSchedule, playlist, playlistLength));
+  TEST_ASSERT_EQUAL(0x1, playlistSchedule.alwaysMask);
+  TEST_ASSERT_EQUAL(0x3, playlistSchedule.maskAt(minuteOf(3, 9, 0)));  // Wednesday morning
+  TEST_ASSERT_EQUAL(0x5, playlistSchedule.maskAt(minuteOf(0, 5, 59))); // Sunday before six
+  TEST_ASSERT_EQUAL(0x1, playlistSchedule.maskAt(minuteOf(0, 6, 0)));
+}
+
+int main() {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_playlist);
+  RUN_TEST(test_week_of_windows);
+  RUN_TEST(test_random_playlists_over_a_week);
+  RUN_TEST(test_console_playlist_compiles);
+  return UNITY_END();
+}
@@ -0,0 +1,175 @@
+// Record store on emulated NOR flash: what comes back after a reload, how the erases spread
+// over the ring, and a power loss at every byte of a record. Run with:
+// pio test -e native -f test_record_store
+#include <unity.h>
+#include <Arduino.h>
+#include <RecordStore.h>
+
+struct TestFlash {
+  bool read(uint32_t addr, uint32_t* data, uint32_t size) { return mockFlash.read(addr, data, size); }
+  bool write(uint32_t addr, uint32_t* data, uint32_t size) { return mockFlash.write(addr, data, size); }
+  bool eraseSector(uint32_t sector) { return mockFlash.eraseSector(sector); }
+};
+
+const int SECTORS = 4;
+const uint32_t BASE = FS_PHYS_ADDR + FS_PHYS_SIZE - SECTORS * FLASH_SECTOR_SIZE;
+using Store = RecordStore<TestFlash, SECTORS, 240>;
+
+const uint8_t TYPE_TEXT = 1;
+
+// What a reload finds: the last payload per index
+struct Loaded {
+  std::string text[4];
+  int records = 0;
+};
+
+Loaded reload(Store& store) {
+  Loaded loaded;
+  store = Store(BASE);
+  store.load([&](const RecordHeader& header, const uint8_t* payload) {
+    if (header.type == TYPE_TEXT && header.index < 4) loaded.text[header.index].assign((const char*)payload, header.length);
+    loaded.records++;
+  });
+  return loaded;
+}
+
+// Writes a change the way the firmware does: rotate to a fresh sector with a snapshot when it
+// does not fit
+void save(Store& store, const std::string (&texts)[4], int index) {
+  if (!store.fits(Store::recordSize(texts[index].size()))) {
+    TEST_ASSERT_TRUE(store.rotate());
+    for (int i = 0; i < 4; i++) TEST_ASSERT_TRUE(store.append(TYPE_TEXT, i, texts[i].data(), texts[i].size()));
+    return;
+  }
+  TEST_ASSERT_TRUE(store.append(TYPE_TEXT, index, texts[index].data(), texts[index].size()));
+}
+
+void setUp() { mockFlash.reset(); }
+void tearDown() {}
+
+//--------------------------
+// TESTS
+
+void test_blank_flash() {
+  Store store(BASE);
+  TEST_ASSERT_FALSE(store.load([](const RecordHeader&, const uint8_t*) {}));
+  TEST_ASSERT_EQUAL(-1, store.sector);
+  TEST_ASSERT_FALSE(store.fits(1));
+  TEST_ASSERT_FALSE(store.append(TYPE_TEXT, 0, "x", 1));
+}
+
+void test_later_records_win() {
+  Store store(BASE);
+  std::string texts[4] = { "zero", "one", "two", "three" };
+  TEST_ASSERT_TRUE(store.rotate());
+  for (int i = 0; i < 4; i++) save(store, texts, i);
+  texts[1] = "one, changed";
+  save(store, texts, 1);
+
+  Loaded loaded = reload(store);
+  TEST_ASSERT_EQUAL_STRING("one, changed", loaded.text[1].c_str());
+  TEST_ASSERT_EQUAL_STRING("three", loaded.text[3].c_str());
+  TEST_ASSERT_EQUAL(5, loaded.records);
+  TEST_ASSERT_FALSE(store.torn);
+  TEST_ASSERT_EQUAL(6, store.generation); // Sector record and five texts
+}
+
+void test_wear_spreads_over_the_ring() {
+  Store store(BASE);
+  std::string texts[4];
+  for (int i = 0; i < 4; i++) texts[i] = std::string(200, 'a' + i);
+  TEST_ASSERT_TRUE(store.rotate());
+
+  const int SAVES = 20000;
+  for (int n = 0; n < SAVES; n++) {
+    texts[n % 4][n % 200] ^= 1;
+    save(store, texts, n % 4);
+  }
+
+  uint32_t first = BASE / FLASH_SECTOR_SIZE;
+  uint32_t least = UINT32_MAX, most = 0;
+  for (int s = 0; s < SECTORS; s++) {
+    least = min(least, mockFlash.sectorErases(first + s));
+    most = max(most, mockFlash.sectorErases(first + s));
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(1, most - least);
+  TEST_ASSERT_EQUAL(store.erases, mockFlash.eraseCount); // Nothing outside the ring
+  // A sector takes about 15 changes of 216 bytes next to a 4 record snapshot
+  TEST_ASSERT_LESS_THAN(SAVES / 10, store.erases);
+
+  char line[80];
+  snprintf(line, sizeof(line), "%d saves: %u erases, %u to %u per sector, %llu bytes", SAVES,
+           (unsigned)store.erases, (unsigned)least, (unsigned)most, (unsigned long long)mockFlash.bytesWritten);
+  TEST_MESSAGE(line);
+
+  Loaded loaded = reload(store);
+  for (int i = 0; i < 4; i++) TEST_ASSERT_EQUAL_STRING(texts[i].c_str(), loaded.text[i].c_str());
+}
+
+void test_power_loss_at_every_byte() {
+  std::string texts[4] = { "zero", "one", "two", "three" };
+  // A multiple of 4 and no 0xFF in the record, so every cut short of the end is visible
+  std::string changed = "one, but cut short while it was written!";
+  uint32_t size = Store::recordSize(changed.size());
+
+  for (uint32_t cut = 0; cut <= size; cut++) {
+    mockFlash.reset();
+    Store store(BASE);
+    TEST_ASSERT_TRUE(store.rotate());
+    for (int i = 0; i < 4; i++) save(store, texts, i);
+
+    mockFlash.tearAfter = cut;
+    bool lost = false;
+    try {
+      store.append(TYPE_TEXT, 1, changed.data(), changed.size());
+    } catch (MockFlash::MockPowerLoss&) {
+      lost = true;
+    }
+    TEST_ASSERT_TRUE(lost);
+
+    // Power on again: the old text unless the whole record made it
+    Loaded loaded = reload(store);
+    bool complete = cut == size;
+    TEST_ASSERT_EQUAL_STRING(complete ? changed.c_str() : "one", loaded.text[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("three", loaded.text[3].c_str());
+
+    // A torn tail is never appended to, the next change goes to a fresh sector
+    TEST_ASSERT_EQUAL(cut > 0 && !complete, store.torn);
+    texts[2] = "two, after the cut";
+    save(store, texts, 2);
+    loaded = reload(store);
+    TEST_ASSERT_EQUAL_STRING("two, after the cut", loaded.text[2].c_str());
+    TEST_ASSERT_FALSE(store.torn);
+    texts[2] = "two";
+  }
+}
+
+void test_flipped_bit_is_rejected() {
+  Store store(BASE);
+  std::string texts[4] = { "zero", "one", "two", "three" };
+  TEST_ASSERT_TRUE(store.rotate());
+  for (int i = 0; i < 4; i++) save(store, texts, i);
+
+  // NOR can only clear bits: clear one in the payload of "three", the last record. The padding
+  // after it is not covered by the crc.
+  uint32_t addr = store.sectorAddress(store.sector) + store.offset - 4;
+  uint32_t word;
+  mockFlash.read(addr, &word, 4);
+  word &= ~0x1u; // "e" of "three" reads as "d"
+  mockFlash.write(addr, &word, 4);
+
+  Loaded loaded = reload(store);
+  TEST_ASSERT_EQUAL_STRING("", loaded.text[3].c_str());
+  TEST_ASSERT_EQUAL_STRING("two", loaded.text[2].c_str());
+  TEST_ASSERT_TRUE(store.torn);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_blank_flash);
+  RUN_TEST(test_later_records_win);
+  RUN_TEST(test_wear_spreads_over_the_ring);
+  RUN_TEST(test_power_loss_at_every_byte);
+  RUN_TEST(test_flipped_bit_is_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,454 @@
+// Text rendering and the frames that reach the panel, compared against golden frames drawn with
+// the host font in test/mocks/fonts. Run with: pio test -e native -f test_render
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <PanelFrame.h>
+#include <TextRender.h>
+
+// Firmware under test (src/main.cpp)
+extern DMDESP Disp;
+extern FrameBuffer<PanelGrid<1, 1>> frame;
+extern ScrollWindow<PanelGrid<1, 1>> scrollWindow;
+extern bool colonBlink;
+extern bool clockNeedsRedraw;
+extern uint32_t scrollStripWidth;
+bool renderScrollStrip(const char* text);
+uint16_t scrollColumn(int32_t stripX);
+void displayDigitalClock();
+void timeTick();
+void postStatus(const char* text, uint8_t priority, uint32_t ttlMs, uint8_t tag);
+void statusOverlayFrame();
+
+const uint8_t STATUS_ALERT = 2;
+
+std::string stripText(const uint16_t* strip, int width) {
+  std::string text;
+  for (int row = 0; row < 12; row++) {
+    for (int x = 0; x < width; x++) text += (strip[x] >> row) & 1 ? '#' : '.';
+    text += "\n";
+  }
+  return text;
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// STRIP
+
+void test_strip_ascii() {
+  uint16_t strip[64];
+  int32_t width = renderStrip("Hi!", strip, 64);
+  TEST_ASSERT_EQUAL(5 + 1 + 3 + 1 + 1 + 1, width);
+  TEST_ASSERT_EQUAL_STRING(
+    "............\n"
+    "............\n"
+    "#...#..#..#.\n"
+    "#...#.....#.\n"
+    "#...#.##..#.\n"
+    "#####..#..#.\n"
+    "#...#..#..#.\n"
+    "#...#..#....\n"
+    "#...#.###.#.\n"
+    "............\n"
+    "............\n"
+    "............\n", stripText(strip, width).c_str());
+}
+
+void test_strip_does_not_fit() {
+  uint16_t strip[8];
+  TEST_ASSERT_EQUAL(-1, renderStrip("Hello", strip, 8));
+}
+
+void test_strip_symbols_and_fallback() {
+  uint16_t strip[64];
+  // Degree sign from the atlas, a code point nobody has drawn gets the box
+  int32_t width = renderStrip("\xC2\xB0\xE4\xB8\x80", strip, 64);
+  TEST_ASSERT_EQUAL(4 + 1 + 5 + 1, width);
+  TEST_ASSERT_EQUAL_HEX16(0x00C, strip[0]);
+  TEST_ASSERT_EQUAL_HEX16(0x7FC, strip[5]);
+  TEST_ASSERT_EQUAL_HEX16(0x404, strip[6]);
+}
+
+void test_glyphs_within_max_columns() {
+  uint16_t glyph[32];
+  uint8_t flags;
+  for (uint32_t cp = 0; cp < 0x20000; cp++) {
+    if (isZeroWidth(cp)) continue;
+    TEST_ASSERT_LESS_OR_EQUAL(GLYPH_MAX_COLUMNS, glyphColumns(cp, glyph, flags));
+  }
+}
+
+void test_widest_sentence_fits_strip() {
+  // 240 bytes of the widest ASCII glyph, then of the widest atlas glyph (3 bytes each)
+  std::string ascii(240, 'W'), arrows;
+  while (arrows.size() + 3 <= 240) arrows += "\xE2\x86\x90";
+  TEST_ASSERT_TRUE(renderScrollStrip(ascii.c_str()));
+  TEST_ASSERT_EQUAL(glyphTextWidth(ascii.c_str()), scrollStripWidth);
+  TEST_ASSERT_TRUE(renderScrollStrip(arrows.c_str()));
+  TEST_ASSERT_EQUAL(80 * (GLYPH_MAX_COLUMNS + 1), scrollStripWidth);
+}
+
+//--------------------------
+// UTF-8 AND SHAPING
+
+void test_utf8_malformed() {
+  const char* text = "\xC3(\xE0\x80\xAF" "a";
+  const char* p = text;
+  TEST_ASSERT_EQUAL_HEX32(CP_INVALID, utf8Next(p)); // Lead byte without continuation
+  TEST_ASSERT_EQUAL_HEX32('(', utf8Next(p));        // The next character survives
+  TEST_ASSERT_EQUAL_HEX32(CP_INVALID, utf8Next(p)); // Overlong
+  TEST_ASSERT_EQUAL_HEX32('a', utf8Next(p));
+  TEST_ASSERT_EQUAL(0, *p);
+}
+
+void test_shape_bangla() {
+  uint32_t out[16];
+  // কি: the i sign goes in front of the consonant
+  TEST_ASSERT_EQUAL(2, shapeText("\xE0\xA6\x95\xE0\xA6\xBF", out, 16));
+  TEST_ASSERT_EQUAL_HEX32(0x09BF, out[0]);
+  TEST_ASSERT_EQUAL_HEX32(0x0995, out[1]);
+  // কো: split around the consonant
+  TEST_ASSERT_EQUAL(3, shapeText("\xE0\xA6\x95\xE0\xA7\x8B", out, 16));
+  TEST_ASSERT_EQUAL_HEX32(0x09C7, out[0]);
+  TEST_ASSERT_EQUAL_HEX32(0x0995, out[1]);
+  TEST_ASSERT_EQUAL_HEX32(0x09BE, out[2]);
+  // র্ক: reph after the cluster
+  TEST_ASSERT_EQUAL(2, shapeText("\xE0\xA6\xB0\xE0\xA7\x8D\xE0\xA6\x95", out, 16));
+  TEST_ASSERT_EQUAL_HEX32(0x0995, out[0]);
+  TEST_ASSERT_EQUAL_HEX32(CP_REPH, out[1]);
+  // Too small for the text
+  TEST_ASSERT_EQUAL(-1, shapeText("abc", out, 2));
+}
+
+void test_shape_conjuncts() {
+  uint32_t out[16];
+  // ক্ষ: one ligature
+  TEST_ASSERT_EQUAL(1, shapeText("\xE0\xA6\x95\xE0\xA7\x8D\xE0\xA6\xB7", out, 16));
+  TEST_ASSERT_EQUAL_HEX32(banglaConjunct(0x0995, 0x09B7), out[0]);
+  TEST_ASSERT_NOT_EQUAL(0, out[0]);
+  // প্র, ক্য, স্ব: phalas after the consonant
+  TEST_ASSERT_EQUAL(2, shapeText("\xE0\xA6\xAA\xE0\xA7\x8D\xE0\xA6\xB0", out, 16));
+  TEST_ASSERT_EQUAL_HEX32(CP_RA_PHALA, out[1]);
+  TEST_ASSERT_EQUAL(2, shapeText("\xE0\xA6\x95\xE0\xA7\x8D\xE0\xA6\xAF", out, 16));
+  TEST_ASSERT_EQUAL_HEX32(CP_YA_PHALA, out[1]);
+  TEST_ASSERT_EQUAL(2, shapeText("\xE0\xA6\xB8\xE0\xA7\x8D\xE0\xA6\xAC", out, 16));
+  TEST_ASSERT_EQUAL_HEX32(CP_BA_PHALA, out[1]);
+  // ন্ত্রি: the i sign in front, ligature, then the ra-phala under it
+  TEST_ASSERT_EQUAL(3, shapeText("\xE0\xA6\xA8\xE0\xA7\x8D\xE0\xA6\xA4\xE0\xA7\x8D\xE0\xA6\xB0\xE0\xA6\xBF", out, 16));
+  TEST_ASSERT_EQUAL_HEX32(0x09BF, out[0]);
+  TEST_ASSERT_EQUAL_HEX32(banglaConjunct(0x09A8, 0x09A4), out[1]);
+  TEST_ASSERT_EQUAL_HEX32(CP_RA_PHALA, out[2]);
+  // ক্খ has no ligature, the hasanta stays visible
+  TEST_ASSERT_EQUAL(3, shapeText("\xE0\xA6\x95\xE0\xA7\x8D\xE0\xA6\x96", out, 16));
+  TEST_ASSERT_EQUAL_HEX32(0x09CD, out[1]);
+
+  // Every ligature has its glyph
+  uint16_t glyph[32];
+  uint8_t flags;
+  int ligatures = 0;
+  for (uint32_t first = 0x0995; first <= 0x09B9; first++) {
+    for (uint32_t second = 0x0995; second <= 0x09B9; second++) {
+      uint32_t ligature = banglaConjunct(first, second);
+      if (!ligature) continue;
+      TEST_ASSERT_EQUAL_HEX32(CP_CONJUNCT + ligatures, ligature);
+      TEST_ASSERT_GREATER_THAN(0, glyphColumns(ligature, glyph, flags));
+      TEST_ASSERT_EQUAL(0, flags);
+      ligatures++;
+    }
+  }
+  TEST_ASSERT_EQUAL(16, ligatures);
+}
+
+// Every Bangla letter, sign and digit is drawn from the atlas, none falls back to the box
+void test_bangla_glyphs_not_boxes() {
+  uint16_t box[32], glyph[32];
+  uint8_t flags;
+  int boxWidth = glyphColumns(0x4E00, box, flags);
+  auto isBox = [&](uint32_t cp) {
+    int width = glyphColumns(cp, glyph, flags);
+    return width == boxWidth && !memcmp(glyph, box, boxWidth * sizeof(uint16_t));
+  };
+  const uint32_t unassigned[] = { 0x098D, 0x098E, 0x0991, 0x0992, 0x09A9, 0x09B1, 0x09B3, 0x09B4, 0x09B5,
+                                  0x09C5, 0x09C6, 0x09C9, 0x09CA };
+  auto assigned = [&](uint32_t cp) {
+    for (uint32_t u : unassigned) if (u == cp) return false;
+    return true;
+  };
+  int letters = 0, signs = 0;
+  for (uint32_t cp = 0x0985; cp <= 0x09B9; cp++) {
+    if (!assigned(cp)) continue;
+    TEST_ASSERT_FALSE_MESSAGE(isBox(cp), "letter");
+    letters++;
+  }
+  for (uint32_t cp : { 0x0982u, 0x0983u, 0x09CEu, 0x09DCu, 0x09DDu, 0x09DFu }) TEST_ASSERT_FALSE(isBox(cp));
+  for (uint32_t cp = 0x09E6; cp <= 0x09EF; cp++) TEST_ASSERT_FALSE_MESSAGE(isBox(cp), "digit");
+
+  // Vowel signs as shaping leaves them after a consonant, ো and ৌ in their two halves
+  for (uint32_t cp = 0x09BE; cp <= 0x09CC; cp++) {
+    if (!assigned(cp)) continue;
+    char text[8] = "\xE0\xA6\x95";
+    text[3] = (char)0xE0;
+    text[4] = (char)(0x80 | (cp >> 6));
+    text[5] = (char)(0x80 | (cp & 0x3F));
+    uint32_t shaped[4];
+    int count = shapeText(text, shaped, 4);
+    TEST_ASSERT_GREATER_OR_EQUAL(2, count);
+    for (int i = 0; i < count; i++) TEST_ASSERT_FALSE_MESSAGE(isBox(shaped[i]), "vowel sign");
+    signs++;
+  }
+  TEST_ASSERT_EQUAL(12 + 32, letters); // Independent vowels and consonants
+  TEST_ASSERT_EQUAL(11, signs);
+}
+
+void test_strip_bangla() {
+  uint16_t strip[64];
+  // বাংলা: letters on the headline, া as its stem, ং between them
+  int32_t width = renderStrip("\xE0\xA6\xAC\xE0\xA6\xBE\xE0\xA6\x82\xE0\xA6\xB2\xE0\xA6\xBE", strip, 64);
+  TEST_ASSERT_EQUAL(5 + 1 + 2 + 1 + 4 + 1 + 5 + 1 + 2 + 1, width);
+  TEST_ASSERT_EQUAL_STRING(
+    ".......................\n"
+    ".......................\n"
+    "#####.##......#####.##.\n"
+    "...##..#........#.#..#.\n"
+    "..#.#..#..#....#..#..#.\n"
+    ".#..#..#.#.#..#.#.#..#.\n"
+    "#...#..#.#..#.#..##..#.\n"
+    ".#..#..#.#..#..#..#..#.\n"
+    "..###..#..##....###..#.\n"
+    ".......................\n"
+    ".......................\n"
+    ".......................\n", stripText(strip, width).c_str());
+
+  // শিক্ষা: ি in front of the cluster, ক্ষ as one ligature
+  width = renderStrip("\xE0\xA6\xB6\xE0\xA6\xBF\xE0\xA6\x95\xE0\xA7\x8D\xE0\xA6\xB7\xE0\xA6\xBE", strip, 64);
+  TEST_ASSERT_EQUAL(3 + 1 + 6 + 1 + 7 + 1 + 2 + 1, width);
+  TEST_ASSERT_EQUAL_STRING(
+    ".##...................\n"
+    "#.....................\n"
+    "###.######.#######.##.\n"
+    "#...#.#..#...#...#..#.\n"
+    "#...#.#..#..###..#..#.\n"
+    "#....#.#.#.#.#.#.#..#.\n"
+    "#......#.#..##.###..#.\n"
+    "#.....#..#...#...#..#.\n"
+    "#.......##...#...#..#.\n"
+    "......................\n"
+    "......................\n"
+    "......................\n", stripText(strip, width).c_str());
+
+  // গ্রামে: ra-phala under গ, ে in front of ম
+  width = renderStrip("\xE0\xA6\x97\xE0\xA7\x8D\xE0\xA6\xB0\xE0\xA6\xBE\xE0\xA6\xAE\xE0\xA7\x87", strip, 64);
+  TEST_ASSERT_EQUAL_STRING(
+    "...................\n"
+    ".........##........\n"
+    "#####.##...#.#####.\n"
+    ".#..#..#..#...#..#.\n"
+    "#...#..#.#...#.#.#.\n"
+    ".#..#..#.#...#..##.\n"
+    "..#.#..#.#....#..#.\n"
+    ".#..#..#..#....#.#.\n"
+    "#...#..#...#.....#.\n"
+    "..#................\n"
+    "...#...............\n"
+    "....#..............\n", stripText(strip, width).c_str());
+
+  // ২০২৬: digits without a headline, on the same rows as ASCII digits
+  width = renderStrip("\xE0\xA7\xA8\xE0\xA7\xA6\xE0\xA7\xA8\xE0\xA7\xAC", strip, 64);
+  TEST_ASSERT_EQUAL_STRING(
+    "........................\n"
+    "........................\n"
+    ".###...###...###..#.....\n"
+    "#...#.#...#.#...#..#....\n"
+    "....#.#...#.....#...#...\n"
+    "...#..#...#....#...#.#..\n"
+    "..#...#...#...#...#...#.\n"
+    ".#....#...#..#.......#..\n"
+    "..###..###....###...#...\n"
+    "........................\n"
+    "........................\n"
+    "........................\n", stripText(strip, width).c_str());
+}
+
+//--------------------------
+// FRAMES
+
+void test_time_error_frame() {
+  // Before the first SNTP answer
+  clockNeedsRedraw = true;
+  displayDigitalClock();
+  frame.present(Disp);
+  TEST_ASSERT_EQUAL_STRING(
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "..#####.###.#...#.#####.......##\n"
+    "....#....#..##.##.#...........#.\n"
+    "....#....#..#.#.#.#...........#.\n"
+    "....#....#..#...#.####........##\n"
+    "....#....#..#...#.#...........#.\n"
+    "....#....#..#...#.#...........#.\n"
+    "....#...###.#...#.#####.......##\n"
+    "................................\n"
+    "................................\n"
+    "................................\n", panelText(Disp).c_str());
+}
+
+void test_scroll_frames() {
+  TEST_ASSERT_TRUE(renderScrollStrip("HELLO"));
+  scrollWindow.invalidate();
+  scrollWindow.blit(frame, 2, scrollColumn);
+  frame.present(Disp);
+  TEST_ASSERT_EQUAL_STRING(
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "..#...#.#####.#.....#......###..\n"
+    "..#...#.#.....#.....#.....#...#.\n"
+    "..#...#.#.....#.....#.....#...#.\n"
+    "..#####.####..#.....#.....#...#.\n"
+    "..#...#.#.....#.....#.....#...#.\n"
+    "..#...#.#.....#.....#.....#...#.\n"
+    "..#...#.#####.#####.#####..###..\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n", panelText(Disp).c_str());
+
+  // One column to the left: only the pixels that changed are written
+  uint32_t writes = Disp.mockPixelWrites;
+  scrollWindow.blit(frame, 1, scrollColumn);
+  frame.present(Disp);
+  TEST_ASSERT_EQUAL_STRING(
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    ".#...#.#####.#.....#......###...\n"
+    ".#...#.#.....#.....#.....#...#..\n"
+    ".#...#.#.....#.....#.....#...#..\n"
+    ".#####.####..#.....#.....#...#..\n"
+    ".#...#.#.....#.....#.....#...#..\n"
+    ".#...#.#.....#.....#.....#...#..\n"
+    ".#...#.#####.#####.#####..###...\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n", panelText(Disp).c_str());
+  TEST_ASSERT_LESS_THAN(100, Disp.mockPixelWrites - writes);
+
+  // Nothing moved, nothing written
+  writes = Disp.mockPixelWrites;
+  scrollWindow.blit(frame, 1, scrollColumn);
+  frame.present(Disp);
+  TEST_ASSERT_EQUAL(writes, Disp.mockPixelWrites);
+}
+
+void test_bangla_scroll_frame() {
+  // আমার বাংলা, the start of it on the panel
+  TEST_ASSERT_TRUE(renderScrollStrip("\xE0\xA6\x86\xE0\xA6\xAE\xE0\xA6\xBE\xE0\xA6\xB0 "
+                                     "\xE0\xA6\xAC\xE0\xA6\xBE\xE0\xA6\x82\xE0\xA6\xB2\xE0\xA6\xBE"));
+  scrollWindow.invalidate();
+  scrollWindow.blit(frame, 1, scrollColumn);
+  frame.present(Disp);
+  TEST_ASSERT_EQUAL_STRING(
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    ".#######.#####.##.#####.......##\n"
+    "..#..#.#..#..#..#....##.........\n"
+    ".#.#.#.#.#.#.#..#...#.#.........\n"
+    "...###.#.#..##..#..#..#........#\n"
+    "..#..#.#..#..#..#.#...#.......#.\n"
+    ".#.#.#.#...#.#..#..#..#........#\n"
+    "..#..#.#.....#..#...###.........\n"
+    "................................\n"
+    "....................#...........\n"
+    "................................\n"
+    "................................\n"
+    "................................\n", panelText(Disp).c_str());
+}
+
+void test_clock_frame() {
+  mockSntpAnswer(1767607650LL * 1000000); // 10:07:30 UTC, 4:07 pm in UTC+6
+  timeTick();
+  colonBlink = true;
+  clockNeedsRedraw = true;
+  displayDigitalClock();
+  frame.present(Disp);
+  TEST_ASSERT_EQUAL_STRING(
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "...........#......###..#####....\n"
+    "..........##..##.#...#.....#....\n"
+    ".........#.#..##.#..##....#.....\n"
+    "........#..#.....#.#.#...#......\n"
+    "........#####.##.##..#..#.......\n"
+    "...........#..##.#...#..#.......\n"
+    "...........#......###...#.......\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n", panelText(Disp).c_str());
+
+  // Colon off: only its 8 pixels are written
+  uint32_t writes = Disp.mockPixelWrites;
+  colonBlink = false;
+  displayDigitalClock();
+  frame.present(Disp);
+  TEST_ASSERT_EQUAL(8, Disp.mockPixelWrites - writes);
+}
+
+void test_status_frame() {
+  postStatus("WiFi", STATUS_ALERT, 5000, 0);
+  statusOverlayFrame();
+  frame.present(Disp);
+  TEST_ASSERT_EQUAL_STRING(
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "......#...#..#..#####..#........\n"
+    "......#...#.....#...............\n"
+    "......#...#.##..#.....##........\n"
+    "......#.#.#..#..###....#........\n"
+    "......#.#.#..#..#......#........\n"
+    "......##.##..#..#......#........\n"
+    "......#...#.###.#.....###.......\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n"
+    "................................\n", panelText(Disp).c_str());
+}
+
+int main() {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_strip_ascii);
+  RUN_TEST(test_strip_does_not_fit);
+  RUN_TEST(test_strip_symbols_and_fallback);
+  RUN_TEST(test_glyphs_within_max_columns);
+  RUN_TEST(test_widest_sentence_fits_strip);
+  RUN_TEST(test_utf8_malformed);
+  RUN_TEST(test_shape_bangla);
+  RUN_TEST(test_shape_conjuncts);
+  RUN_TEST(test_bangla_glyphs_not_boxes);
+  RUN_TEST(test_strip_bangla);
+  RUN_TEST(test_time_error_frame);
+  RUN_TEST(test_scroll_frames);
+  RUN_TEST(test_bangla_scroll_frame);
+  RUN_TEST(test_clock_frame);
+  RUN_TEST(test_status_frame);
+  return UNITY_END();
+}
@@ -0,0 +1,130 @@
+// Cooperative scheduler over hours of virtual time, through the micros() wrap at 71 minutes:
+// every task keeps its period, the panel is scanned every millisecond, and the idle time is
+// slept instead of spun, through loop() or delayMicroseconds(). Each scan costs what it does on
+// the device, so the wait before the next one is under a millisecond.
+// Run with: pio test -e native -f test_scheduler
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <Firebase_ESP_Client.h>
+
+// Firmware under test (src/main.cpp)
+struct Task {
+  const char* name;
+  void (*run)();
+  uint32_t periodUs;
+  uint8_t priority;
+  uint32_t nextRun;
+  uint32_t runs;
+  uint64_t totalUs;
+  uint32_t maxUs;
+};
+extern Task tasks[];
+extern DMDESP Disp;
+
+#ifdef P10_FAULTS
+const int TASK_COUNT = 11;
+#else
+const int TASK_COUNT = 10;
+#endif
+const uint64_t HOURS = 3;
+const uint64_t RUN_US = HOURS * 3600000000ULL;
+const uint32_t SCAN_US = 40; // Shifting a row out to one panel
+
+uint32_t runsBefore[TASK_COUNT];
+uint64_t loopCalls = 0;
+uint32_t lateScans = 0;     // More than 1.1 ms after the one before
+uint64_t worstScanGap = 0;
+uint32_t requests = 0;      // Firebase round trips in the run, each one holds up the scheduler
+
+Task& task(const char* name) {
+  for (int i = 0; i < TASK_COUNT; i++) {
+    if (!strcmp(tasks[i].name, name)) return tasks[i];
+  }
+  TEST_FAIL_MESSAGE(name);
+  return tasks[0];
+}
+
+uint32_t runs(const char* name) {
+  Task& t = task(name);
+  return t.runs - runsBefore[&t - tasks];
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// TESTS
+
+void test_tasks_keep_their_period() {
+  for (int i = 0; i < TASK_COUNT; i++) {
+    // The scan sleeps a whole millisecond after its own run
+    uint32_t period = tasks[i].periodUs + (strcmp(tasks[i].name, "scan") ? 0 : SCAN_US);
+    uint32_t expected = RUN_US / period;
+    uint32_t actual = runs(tasks[i].name);
+    char line[80];
+    snprintf(line, sizeof(line), "%-10s %9u runs, %9u expected, max %7u us", tasks[i].name,
+             (unsigned)actual, (unsigned)expected, (unsigned)tasks[i].maxUs);
+    TEST_MESSAGE(line);
+    // Missed periods are skipped, only the Firebase round trips cost any
+    TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(expected + 1, actual, tasks[i].name);
+    TEST_ASSERT_GREATER_OR_EQUAL_MESSAGE(expected - expected / 100 - 1, actual, tasks[i].name);
+  }
+}
+
+void test_panel_scanned_every_millisecond() {
+  char line[80];
+  snprintf(line, sizeof(line), "%u late scans, worst gap %llu us, %u Firebase requests", (unsigned)lateScans,
+           (unsigned long long)worstScanGap, (unsigned)requests);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_LESS_OR_EQUAL(requests, lateScans);
+  TEST_ASSERT_LESS_OR_EQUAL(1000 + mockRtdb.latencyUs + 1000, worstScanGap);
+}
+
+void test_idle_is_slept() {
+  // A spinning scheduler calls loop() thousands of times per task run, one that sleeps until
+  // the next deadline at most twice
+  uint64_t taskRuns = 0;
+  for (int i = 0; i < TASK_COUNT; i++) taskRuns += runs(tasks[i].name);
+  TEST_ASSERT_LESS_OR_EQUAL(2 * taskRuns, loopCalls);
+  TEST_ASSERT_EQUAL(0, mockBusyWaitUs);
+}
+
+void test_run_time_accounting() {
+  // Virtual time only moves in the mocked network and flash and the charged scan, the render
+  // path costs none
+  TEST_ASSERT_EQUAL(SCAN_US, task("scan").maxUs);
+  TEST_ASSERT_EQUAL(0, task("display").totalUs);
+  TEST_ASSERT_GREATER_OR_EQUAL(mockRtdb.latencyUs, task("telemetry").maxUs);
+}
+
+int main() {
+  mockRtdb.set("/display", "{\"sentences\":[\"Hours of virtual time\"],\"selectedSentence\":0}");
+  setup();
+  runFor(10000000); // WiFi, SNTP and the stream are up
+
+  for (int i = 0; i < TASK_COUNT; i++) runsBefore[i] = tasks[i].runs;
+  uint32_t requestsBefore = mockRtdb.requests;
+  uint64_t lastScan = mockNowUs;
+  mockBusyWaitUs = 0;
+  Disp.mockOnScan = [&]() {
+    mockNowUs += SCAN_US;
+    uint64_t gap = mockNowUs - lastScan;
+    if (gap > 1100) lateScans++;
+    worstScanGap = max(worstScanGap, gap);
+    lastScan = mockNowUs;
+  };
+  uint64_t end = mockNowUs + RUN_US;
+  while (mockNowUs < end) {
+    loop();
+    loopCalls++;
+  }
+  Disp.mockOnScan = nullptr;
+  requests = mockRtdb.requests - requestsBefore;
+
+  UNITY_BEGIN();
+  RUN_TEST(test_tasks_keep_their_period);
+  RUN_TEST(test_panel_scanned_every_millisecond);
+  RUN_TEST(test_idle_is_slept);
+  RUN_TEST(test_run_time_accounting);
+  return UNITY_END();
+}
@@ -0,0 +1,156 @@
+// Time-based scrolling on a fake clock with stalls injected: the position follows elapsed time
+// at fractional speeds for hours, and on the panel it is never more than a frame behind, however
+// long loop() was held up before. Run with: pio test -e native -f test_scroll_clock
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <PanelFrame.h>
+#include <ScrollClock.h>
+#include <TextRender.h>
+#include <random>
+
+// Firmware under test (src/main.cpp)
+extern DMDESP Disp;
+extern bool showClock;
+extern uint32_t scrollStripWidth;
+extern uint32_t scrollSkippedPixels;
+bool setScrollSpeed(float pixelsPerSecond);
+bool setDisplayText(const char* text);
+
+using Panel = PanelGrid<1, 1>;
+const char* TEXT = "Stall test 0123456789 abcdefghij";
+
+// Pixels a scroll started at startUs should have moved by nowUs
+uint64_t idealPixels(uint64_t startUs, uint64_t nowUs, uint32_t milliPixelsPerSecond) {
+  return (nowUs - startUs) * milliPixelsPerSecond / ScrollClock::PIXEL;
+}
+
+// Scroll offset the panel shows, -1 if it shows something else. The closest to around wins,
+// once the text has left the panel every offset shows the same dark band.
+int panelOffset(const uint16_t* strip, int width, int around, int range) {
+  for (int i = 0; i <= 2 * range; i++) {
+    int x = around + (i % 2 ? -(i + 1) / 2 : i / 2);
+    if (x < 0) continue;
+    bool match = true;
+    for (int c = 0; c < Panel::WIDTH && match; c++) {
+      int at = c - Panel::CENTER_X + x;
+      uint16_t expected = at >= 0 && at < width ? strip[at] : 0;
+      uint16_t column = 0;
+      for (int row = 0; row < Panel::TEXT_HEIGHT; row++) {
+        if (Disp.mockPixel(c, Panel::TEXT_Y + row)) column |= 1 << row;
+      }
+      match = column == expected;
+    }
+    if (match) return x;
+  }
+  return -1;
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// SCROLL CLOCK
+
+void test_first_advance_starts_the_clock() {
+  ScrollClock clock;
+  TEST_ASSERT_EQUAL(0, clock.advance(123456, 50));
+  TEST_ASSERT_EQUAL(1, clock.advance(123456 + 20000, 50));
+  clock.reset();
+  TEST_ASSERT_EQUAL(0, clock.advance(999999, 50));
+}
+
+void test_hours_with_stalls() {
+  // 6 hours at 11.3 px/s through the micros() wrap, frames 5 ms apart with stalls up to 2 s
+  ScrollClock clock;
+  uint64_t start = 0xFFFFFFFFULL - 3000000; // Wraps 3 s in
+  uint64_t now = start;
+  uint64_t position = clock.advance((uint32_t)now, 11.3f);
+  uint32_t stalls = 0;
+  uint64_t worstError = 0;
+  std::mt19937 rng(7);
+  while (now - start < 6 * 3600000000ULL) {
+    now += 5000;
+    if (rng() % 1000 == 0) {
+      now += 1 + rng() % 2000000;
+      stalls++;
+    }
+    position += clock.advance((uint32_t)now, 11.3f);
+    uint64_t ideal = idealPixels(start, now, 11300);
+    worstError = max(worstError, position > ideal ? position - ideal : ideal - position);
+  }
+  TEST_ASSERT_GREATER_THAN(1000, stalls);
+  TEST_ASSERT_EQUAL(0, worstError); // Whole pixels exactly where elapsed time puts them
+}
+
+void test_speed_change_keeps_the_fraction() {
+  ScrollClock clock;
+  clock.advance(0, 2.5f);
+  TEST_ASSERT_EQUAL(0, clock.advance(300000, 2.5f)); // 0.75 px
+  TEST_ASSERT_EQUAL(1, clock.advance(400000, 2.5f)); // 1 px, 0 left
+  TEST_ASSERT_EQUAL(2, clock.advance(500000, 20.5f)); // 2.05 px
+}
+
+//--------------------------
+// ON THE PANEL
+
+void test_panel_position_bounded_through_stalls() {
+  const float SPEED = 37.5f;
+  const uint64_t STALL_US = 300000; // A blocking Firebase fetch
+  setScrollSpeed(SPEED);
+  setDisplayText(TEXT);
+  runUntil(mockNowUs + 1); // Strip rendered
+  static uint16_t strip[2048];
+  int width = renderStrip(TEXT, strip, 2048);
+
+  // Wait for the clock to hand over to a fresh scroll pass
+  while (!showClock) runFor(1000);
+  while (showClock) runFor(1000);
+
+  uint64_t start = 0, lastScan = mockNowUs;
+  uint32_t scans = 0, stalls = 0, checked = 0;
+  int64_t worst = 0;
+  uint32_t skipped = scrollSkippedPixels;
+  Disp.mockOnScan = [&]() {
+    bool afterStall = mockNowUs - lastScan > 1100; // That scan can run before the frame is redrawn
+    lastScan = mockNowUs;
+    if (showClock) return;
+    int64_t ideal = start ? idealPixels(start, mockNowUs, SPEED * 1000) : 0;
+    int x = panelOffset(strip, width, ideal, 20);
+    if (!start) {
+      if (x != 0) return; // The clock frame is still up
+      start = mockNowUs;
+    }
+    TEST_ASSERT_NOT_EQUAL(-1, x);
+    if (!afterStall) {
+      worst = max(worst, x > ideal ? x - ideal : ideal - x);
+      checked++;
+    }
+    if (++scans % 700 == 0) {
+      mockNowUs += STALL_US;
+      stalls++;
+    }
+  };
+  while (!showClock) runFor(1000);
+  Disp.mockOnScan = nullptr;
+
+  char line[96];
+  snprintf(line, sizeof(line), "%u scans checked, %u stalls, %u pixels skipped, worst error %lld px", (unsigned)checked,
+           (unsigned)stalls, (unsigned)(scrollSkippedPixels - skipped), (long long)worst);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_GREATER_THAN(5, stalls);
+  // One frame at this speed is 0.2 px, plus the whole pixel the clock rounds down
+  TEST_ASSERT_LESS_OR_EQUAL(2, worst);
+  // Each stall is caught up in one frame, which moves one pixel and skips the rest
+  TEST_ASSERT_GREATER_OR_EQUAL(stalls * ((int)(STALL_US * SPEED / 1e6) - 1), scrollSkippedPixels - skipped);
+  TEST_ASSERT_EQUAL(width, scrollStripWidth);
+}
+
+int main() {
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_first_advance_starts_the_clock);
+  RUN_TEST(test_hours_with_stalls);
+  RUN_TEST(test_speed_change_keeps_the_fraction);
+  RUN_TEST(test_panel_position_bounded_through_stalls);
+  return UNITY_END();
+}
@@ -0,0 +1,276 @@
+// Soak run: a week of virtual time on the firmware against the emulated flash, WiFi and RTDB, with
+// the fault injection of the P10_FAULTS build (PUT /api/faults) dropping the WiFi link and the
+// stream, failing and slowing Firebase requests and cutting power in the middle of flash writes.
+// Every power cut boots the firmware again. Per day it reports heap, loop latency and flash
+// writes; at the end the content is the console's, the stream is up and the heap is back where
+// it started. Build with -DP10_FAULTS. Run with: pio test -e native_soak
+#ifndef P10_FAULTS
+#error "test_soak drives the P10_FAULTS hooks, run it with pio test -e native_soak"
+#endif
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <ESP8266WebServer.h>
+#include <Firebase_ESP_Client.h>
+#include <string>
+
+#ifndef SOAK_DAYS
+#define SOAK_DAYS 7 // -DSOAK_DAYS=30 for a month
+#endif
+
+// Firmware under test (src/main.cpp)
+struct Sentence {
+  uint16_t length;
+  uint32_t hash;
+  char text[240 + 1];
+};
+struct TimingMetric {
+  uint32_t count;
+  uint64_t totalUs;
+  uint32_t maxUs;
+};
+struct FaultState {
+  uint32_t magic;
+  uint32_t wifiDropSec, streamDropSec, firebaseFailPercent, firebaseDelayMs, powerCutPercent;
+  uint32_t wifiDrops, streamDrops, firebaseFailures, firebaseDelays, powerCuts;
+  uint32_t recoveries, recoveryErrors;
+  uint32_t expectedCrc, crc, reserved;
+};
+extern Sentence sentences[];
+extern int totalSentences;
+extern int selectedSentence;
+extern char displayText[];
+extern int playlistLength;
+extern bool dataChanged;
+extern bool localPending;
+extern uint64_t contentUpdatedAt;
+extern bool streamActive;
+extern bool firebaseConnected;
+extern int wifiState;
+extern TimingMetric loopMetric;
+extern uint32_t heapMinFree;
+extern uint32_t streamStarts;
+extern FaultState faults;
+extern DMDESP Disp;
+extern ESP8266WebServer server;
+
+const int WIFI_STATE_CONNECTED = 0;
+const int WIFI_STATE_PORTAL = 3;
+const int WIFI_STATE_STARTING = 4;
+
+const uint64_t MINUTE_US = 60ULL * 1000000;
+const uint64_t HOUR_US = 60 * MINUTE_US;
+const uint64_t DAY_US = 24 * HOUR_US;
+const int64_t SNTP_EPOCH_US = 1760000000LL * 1000000;
+
+// Injected through the fault hooks: the link drops every 6 hours, the stream every hour, one
+// Firebase request in 10 fails, each one takes half a second more and 5% of the flash writes
+// lose power halfway
+const char* FAULT_RATES = "wifiDrop=21600&streamDrop=3600&firebaseFail=10&firebaseDelay=500&powerCut=5";
+const uint32_t FIREBASE_DELAY_US = 500000;
+const uint32_t MAX_SCAN_GAP_US = 5000;
+const uint32_t SECTOR_ERASE_LIMIT = 100000;  // Rated cycles of the flash
+const int WEAR_YEARS = 10;                    // The busiest sector still has to last this long
+
+struct SoakDay {
+  uint32_t heapUsed, heapPeak;  // mockHeap at the end of the day, and its peak during it
+  uint32_t worstLoopUs;
+  uint64_t worstScanGapUs;
+  uint64_t flashBytes;          // Written during the day
+  uint32_t erases;
+};
+
+SoakDay days[SOAK_DAYS];
+uint32_t restarts = 0;
+uint32_t contentChanges = 0;
+uint32_t heapAtStart = 0;
+std::string lastContent;
+
+uint64_t lastScanUs = 0;
+uint64_t scanGapUs = 0;
+
+// Boots the firmware again after ESP.restart(): RAM starts over, flash, RTC memory and the
+// clock carry on. Only the state setup() expects to find zeroed is cleared.
+void rebootFirmware() {
+  restarts++;
+  memset(sentences, 0, 10 * sizeof(Sentence));
+  totalSentences = 0;
+  selectedSentence = 0;
+  playlistLength = 0;
+  dataChanged = false;
+  localPending = false;
+  contentUpdatedAt = 0;
+  streamActive = false;
+  firebaseConnected = false;
+  wifiState = WIFI_STATE_STARTING;
+  mockStation.drop();
+  mockResetInfo.reason = REASON_SOFT_RESTART;
+  setup();
+}
+
+// loop() until the clock reaches us, rebooting whenever an injected power cut restarts the device
+void soakUntil(uint64_t us) {
+  while (mockNowUs < us) {
+    try {
+      loop();
+    } catch (MockRestart&) {
+      rebootFirmware();
+    }
+  }
+}
+
+// What the console does: a sentence edited every 10 minutes, the selection now and then
+void consoleWrite(int n) {
+  char path[32], json[64];
+  snprintf(path, sizeof(path), "/display/sentences/%d", n % 3);
+  snprintf(json, sizeof(json), "\"Update %d বাংলা\"", n);
+  mockRtdb.set(path, json);
+  mockRtdb.set("/display/selectedSentence", std::to_string(n % 3).c_str());
+  lastContent = std::string("Update ") + std::to_string(n) + " বাংলা";
+  contentChanges++;
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// SOAK
+
+void runSoak() {
+  MockResponse response = server.mockRequest(HTTP_PUT, "/api/faults", FAULT_RATES, "");
+  TEST_ASSERT_EQUAL(200, response.status);
+
+  Disp.mockOnScan = []() {
+    if (lastScanUs) scanGapUs = max(scanGapUs, mockNowUs - lastScanUs);
+    lastScanUs = mockNowUs;
+  };
+  uint64_t start = mockNowUs;
+  int write = 0;
+  for (int day = 0; day < SOAK_DAYS; day++) {
+    SoakDay &d = days[day];
+    uint64_t flashBefore = mockFlash.bytesWritten;
+    uint32_t erasesBefore = mockFlash.eraseCount;
+    mockHeap.peak = mockHeap.used;
+    loopMetric.maxUs = 0;
+    scanGapUs = 0;
+
+    for (int hour = 0; hour < 24; hour++) {
+      uint64_t hourStart = start + day * DAY_US + hour * HOUR_US;
+      mockSntpAnswer(SNTP_EPOCH_US + (int64_t)(mockNowUs - start));
+      // The RTDB is away for 20 minutes once a day
+      if (hour == 3) mockRtdb.online = false;
+      for (int minute = 0; minute < 60; minute += 10) {
+        if (minute == 20) mockRtdb.online = true;
+        consoleWrite(write++);
+        soakUntil(hourStart + (minute + 10) * MINUTE_US);
+      }
+      mockRtdb.log.clear();
+    }
+    d.heapUsed = mockHeap.used;
+    d.heapPeak = mockHeap.peak;
+    d.worstLoopUs = loopMetric.maxUs;
+    d.worstScanGapUs = scanGapUs;
+    d.flashBytes = mockFlash.bytesWritten - flashBefore;
+    d.erases = mockFlash.eraseCount - erasesBefore;
+  }
+
+  // Faults off, one more change, and five minutes to settle
+  response = server.mockRequest(HTTP_PUT, "/api/faults", "wifiDrop=0&streamDrop=0&firebaseFail=0&firebaseDelay=0&powerCut=0", "");
+  TEST_ASSERT_EQUAL(200, response.status);
+  consoleWrite(write++);
+  soakUntil(mockNowUs + 5 * MINUTE_US);
+  Disp.mockOnScan = nullptr;
+}
+
+//--------------------------
+// TESTS
+
+void test_faults_were_injected() {
+  TEST_ASSERT_GREATER_OR_EQUAL(SOAK_DAYS * 3, faults.wifiDrops);
+  TEST_ASSERT_GREATER_OR_EQUAL(SOAK_DAYS * 12, faults.streamDrops);
+  TEST_ASSERT_GREATER_THAN(0, faults.firebaseFailures);
+  TEST_ASSERT_GREATER_THAN(0, faults.firebaseDelays);
+  TEST_ASSERT_GREATER_THAN(0, faults.powerCuts);
+  TEST_ASSERT_EQUAL(faults.powerCuts, restarts);
+
+  char line[160];
+  snprintf(line, sizeof(line), "%d days: %u content changes, %u WiFi drops, %u stream drops, %u Firebase failures, %u power cuts",
+           SOAK_DAYS, (unsigned)contentChanges, (unsigned)faults.wifiDrops, (unsigned)faults.streamDrops,
+           (unsigned)faults.firebaseFailures, (unsigned)faults.powerCuts);
+  TEST_MESSAGE(line);
+}
+
+void test_every_power_cut_recovered() {
+  TEST_ASSERT_EQUAL(0, faults.recoveryErrors);
+  TEST_ASSERT_EQUAL(faults.powerCuts, faults.recoveries);
+}
+
+void test_content_and_links_back() {
+  TEST_ASSERT_EQUAL_STRING(lastContent.c_str(), displayText);
+  TEST_ASSERT_EQUAL(WIFI_STATE_CONNECTED, wifiState); // Never stuck in the portal or a reconnect loop
+  TEST_ASSERT_TRUE(firebaseConnected);
+  TEST_ASSERT_TRUE(streamActive);
+  TEST_ASSERT_GREATER_THAN(faults.streamDrops, streamStarts); // Resubscribed after every drop
+  TEST_ASSERT_FALSE(dataChanged); // Saved to flash
+}
+
+void test_heap_flat() {
+  // The peak stops moving once every kind of fault has been through, nothing is left behind
+  int settled = max(1, SOAK_DAYS / 2);
+  uint32_t peak = 0;
+  for (int day = 0; day < settled; day++) peak = max(peak, days[day].heapPeak);
+  for (int day = settled; day < SOAK_DAYS; day++) TEST_ASSERT_LESS_OR_EQUAL(peak, days[day].heapPeak);
+  TEST_ASSERT_EQUAL(heapAtStart, days[SOAK_DAYS - 1].heapUsed);
+  TEST_ASSERT_GREATER_THAN(0, heapMinFree);
+}
+
+void test_latency_bounded() {
+  for (int day = 0; day < SOAK_DAYS; day++) {
+    // A Firebase request blocks for its round trip and the injected delay, nothing else does
+    TEST_ASSERT_LESS_OR_EQUAL(mockRtdb.timeoutUs + FIREBASE_DELAY_US + MAX_SCAN_GAP_US, days[day].worstLoopUs);
+    TEST_ASSERT_LESS_OR_EQUAL(mockRtdb.timeoutUs + FIREBASE_DELAY_US + MAX_SCAN_GAP_US, days[day].worstScanGapUs);
+  }
+}
+
+void test_flash_wear() {
+  uint32_t busiest = 0;
+  for (uint32_t sector = 0; sector < MockFlash::SIZE / MockFlash::SECTOR; sector++) {
+    busiest = max(busiest, mockFlash.sectorErases(sector));
+  }
+  double perYear = busiest * 365.0 / SOAK_DAYS;
+  TEST_ASSERT_LESS_THAN(SECTOR_ERASE_LIMIT / WEAR_YEARS, (uint32_t)perYear);
+
+  char line[128];
+  snprintf(line, sizeof(line), "Flash: %llu bytes written, busiest sector erased %u times, %.0f a year",
+           (unsigned long long)mockFlash.bytesWritten, (unsigned)busiest, perYear);
+  TEST_MESSAGE(line);
+}
+
+void test_daily_report() {
+  for (int day = 0; day < SOAK_DAYS; day++) {
+    const SoakDay &d = days[day];
+    char line[160];
+    snprintf(line, sizeof(line), "Day %d: heap %u used, %u peak; worst loop %u us, scan gap %llu us; flash %llu bytes, %u erases",
+             day + 1, (unsigned)d.heapUsed, (unsigned)d.heapPeak, (unsigned)d.worstLoopUs,
+             (unsigned long long)d.worstScanGapUs, (unsigned long long)d.flashBytes, (unsigned)d.erases);
+    TEST_MESSAGE(line);
+  }
+}
+
+int main() {
+  setup();
+  mockSntpAnswer(SNTP_EPOCH_US);
+  consoleWrite(0);
+  soakUntil(mockNowUs + 5 * MINUTE_US); // WiFi, Firebase and the first sync are up
+  heapAtStart = mockHeap.used;
+  runSoak();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_faults_were_injected);
+  RUN_TEST(test_every_power_cut_recovered);
+  RUN_TEST(test_content_and_links_back);
+  RUN_TEST(test_heap_flat);
+  RUN_TEST(test_latency_bounded);
+  RUN_TEST(test_flash_wear);
+  RUN_TEST(test_daily_report);
+  return UNITY_END();
+}
@@ -0,0 +1,169 @@
+// Status overlay: the queue shows alerts before warnings before info, oldest first within a
+// priority, a tag replaces its own message and a full queue pushes out the least important one.
+// On the firmware the messages come up in that order over the content, a long one scrolls through
+// whole, and the loop and the panel scan keep their timing while overlays are up.
+// Run with: pio test -e native -f test_status_overlay
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <StatusQueue.h>
+#include <string>
+
+// Firmware under test (src/main.cpp)
+struct TimingMetric {
+  uint32_t count;
+  uint64_t totalUs;
+  uint32_t maxUs;
+};
+extern DMDESP Disp;
+extern TimingMetric loopMetric;
+extern StatusQueue statusQueue;
+extern uint32_t statusShownSequence;
+extern uint32_t statusStripWidth;
+extern bool statusOverlayActive;
+extern bool showClock;
+void postStatus(const char* text, uint8_t priority, uint32_t ttlMs, uint8_t tag);
+bool setScrollSpeed(float pixelsPerSecond);
+
+const uint32_t MAX_LOOP_US = 5000;
+const uint32_t MAX_SCAN_GAP_US = 5000;
+
+// First characters of the messages in the order top() gives them, each expiring once shown
+std::string drainOrder(StatusQueue& queue, uint32_t now) {
+  std::string order;
+  while (const StatusMessage* m = queue.top(now, 0)) {
+    order += m->text[0];
+    const_cast<StatusMessage*>(m)->ttl = 0;
+  }
+  return order;
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// QUEUE
+
+void test_priority_order() {
+  StatusQueue queue;
+  queue.post("1 info", STATUS_INFO, 60000, 0, 0);
+  queue.post("2 alert", STATUS_ALERT, 60000, 0, 0);
+  queue.post("3 warning", STATUS_WARNING, 60000, 0, 0);
+  queue.post("4 info", STATUS_INFO, 60000, 0, 0);
+  queue.post("5 alert", STATUS_ALERT, 60000, 0, 0);
+  TEST_ASSERT_EQUAL_STRING("25314", drainOrder(queue, 1).c_str());
+  TEST_ASSERT_EQUAL(0, queue.count);
+}
+
+void test_tag_replaces_and_ttl_expires() {
+  StatusQueue queue;
+  queue.post("a Reconnecting WiFi...", STATUS_WARNING, 10000, 1, 0);
+  queue.post("b Firebase failed", STATUS_WARNING, 10000, 2, 100);
+  queue.post("c WiFi connected", STATUS_INFO, 5000, 1, 200);
+  TEST_ASSERT_EQUAL(2, queue.count);
+  TEST_ASSERT_EQUAL_STRING("b Firebase failed", queue.top(300, 0)->text);
+
+  // Expired at 5200 and 10100, unless held while it scrolls
+  TEST_ASSERT_EQUAL_STRING("c WiFi connected", queue.top(10100, 3)->text);
+  TEST_ASSERT_EQUAL(1, queue.count);
+  TEST_ASSERT_NULL(queue.top(10100, 0));
+}
+
+void test_full_queue_keeps_the_important() {
+  StatusQueue queue;
+  for (int i = 0; i < STATUS_QUEUE_SIZE; i++) {
+    char text[2] = { (char)('0' + i), 0 };
+    queue.post(text, STATUS_WARNING, 60000, 0, i);
+  }
+  TEST_ASSERT_FALSE(queue.post("i", STATUS_INFO, 60000, 0, 10)); // Less important than all of them
+  TEST_ASSERT_TRUE(queue.post("A", STATUS_ALERT, 60000, 0, 11));  // Pushes out the oldest warning
+  TEST_ASSERT_EQUAL(2, queue.dropped);
+  TEST_ASSERT_EQUAL(STATUS_QUEUE_SIZE, queue.count);
+  TEST_ASSERT_EQUAL_STRING("A1234567", drainOrder(queue, 12).c_str());
+}
+
+void test_long_text_cut_on_a_character() {
+  StatusQueue queue;
+  std::string text(STATUS_TEXT_MAX - 1, 'a');
+  text += "বাংলা"; // 3 byte characters across the limit
+  queue.post(text.c_str(), STATUS_INFO, 1000, 0, 0);
+  TEST_ASSERT_EQUAL(STATUS_TEXT_MAX - 1, strlen(queue.messages[0].text));
+}
+
+//--------------------------
+// FIRMWARE
+
+void test_overlay_order_on_the_panel() {
+  // Narrower than the panel, so each one stays until its TTL is up
+  postStatus("1 i", STATUS_INFO, 500, 0);
+  postStatus("2 A", STATUS_ALERT, 2000, 0);
+  postStatus("3 W", STATUS_WARNING, 4000, 0);
+  postStatus("4 i", STATUS_INFO, 6000, 0);
+
+  std::string order;
+  uint32_t shown = 0;
+  for (int ms = 0; ms < 30000 && (statusOverlayActive || order.empty()); ms++) {
+    runFor(1000);
+    if (statusOverlayActive && statusShownSequence != shown) {
+      shown = statusShownSequence;
+      for (int i = 0; i < statusQueue.count; i++) {
+        if (statusQueue.messages[i].sequence == shown) order += statusQueue.messages[i].text[0];
+      }
+    }
+  }
+  TEST_ASSERT_FALSE(statusOverlayActive);
+  TEST_ASSERT_EQUAL_STRING("234", order.c_str()); // 1 info expired behind the others
+}
+
+void test_long_message_scrolls_through() {
+  const float SPEED = 40;
+  setScrollSpeed(SPEED);
+  const char* text = "Setup: WiFi P10_Display_Setup, 192.168.4.1";
+  postStatus(text, STATUS_ALERT, 100, 0);
+  while (!statusOverlayActive) runFor(1000);
+  uint64_t start = mockNowUs;
+  while (statusOverlayActive) runFor(1000);
+  double seconds = (mockNowUs - start) / 1e6;
+  // All of it is on the strip, it starts at the left edge and stays one pass past its TTL
+  TEST_ASSERT_GREATER_THAN(strlen(text) * 4, statusStripWidth);
+  TEST_ASSERT_FLOAT_WITHIN(0.05, statusStripWidth / SPEED, seconds);
+}
+
+void test_loop_latency_with_overlays() {
+  loopMetric.maxUs = 0;
+  uint64_t lastScan = mockNowUs, gap = 0;
+  uint32_t scans = Disp.mockScans;
+  Disp.mockOnScan = [&]() {
+    gap = max(gap, mockNowUs - lastScan);
+    lastScan = mockNowUs;
+  };
+  // A minute of notices coming and going over the scrolling text and the clock
+  for (int second = 0; second < 60; second++) {
+    if (second % 3 == 0) postStatus("Reconnecting WiFi, the display keeps running", STATUS_WARNING, 2000, 1);
+    if (second % 7 == 0) postStatus("Sync failed", STATUS_ALERT, 1500, 2);
+    runFor(1000000);
+  }
+  Disp.mockOnScan = nullptr;
+
+  char line[96];
+  snprintf(line, sizeof(line), "Overlays for 60 s: worst loop %u us, worst scan gap %llu us, %u posted",
+           (unsigned)loopMetric.maxUs, (unsigned long long)gap, (unsigned)statusQueue.posted);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_LESS_OR_EQUAL(MAX_LOOP_US, loopMetric.maxUs);
+  TEST_ASSERT_LESS_OR_EQUAL(MAX_SCAN_GAP_US, gap);
+  TEST_ASSERT_GREATER_THAN(50000, Disp.mockScans - scans); // The panel was scanned the whole time
+}
+
+int main() {
+  setup();
+  runFor(10000000); // WiFi and Firebase are up and their notices gone
+  while (statusOverlayActive) runFor(1000);
+  UNITY_BEGIN();
+  RUN_TEST(test_priority_order);
+  RUN_TEST(test_tag_replaces_and_ttl_expires);
+  RUN_TEST(test_full_queue_keeps_the_important);
+  RUN_TEST(test_long_text_cut_on_a_character);
+  RUN_TEST(test_overlay_order_on_the_panel);
+  RUN_TEST(test_long_message_scrolls_through);
+  RUN_TEST(test_loop_latency_with_overlays);
+  return UNITY_END();
+}
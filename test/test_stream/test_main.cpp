@@ -0,0 +1,311 @@
+// RTDB stream on /display: recorded server-sent events are replayed through the mock database
+// and the panel is watched scan by scan, so the latency is from the event reaching the device
+// to the new text on the LEDs. Run with: pio test -e native -f test_stream
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <Firebase_ESP_Client.h>
+#include <PanelFrame.h>
+#include <TextRender.h>
+
+// Firmware under test (src/main.cpp)
+extern DMDESP Disp;
+extern bool streamActive;
+extern int totalSentences;
+extern int selectedSentence;
+extern uint32_t streamStarts;
+extern long syncedVersion;
+extern bool dataChanged;
+bool uploadTelemetry();
+void loadDataFromEEPROM();
+
+struct Sentence {
+  uint16_t length;
+  uint32_t hash;
+  char text[241];
+};
+extern Sentence sentences[];
+
+using Panel = PanelGrid<1, 1>;
+const uint64_t MAX_LATENCY_US = 50000; // Stream task period plus a frame, with room to spare
+
+// Sentences long enough to scroll for 20 s and more, so no event lands on the clock
+std::string sentence(char first) {
+  std::string text;
+  for (int i = 0; i < 180; i++) text += (char)(first + i % 20);
+  return text;
+}
+
+// A text that scrolls in from the center is on the panel: its first columns on the right
+// half, nothing on the left
+bool panelStarts(const std::string& text) {
+  static uint16_t strip[2048];
+  renderStrip(text.c_str(), strip, 2048);
+  for (int x = 0; x < Panel::WIDTH; x++) {
+    uint16_t column = 0;
+    for (int row = 0; row < Panel::TEXT_HEIGHT; row++) {
+      if (Disp.mockPixel(x, Panel::TEXT_Y + row)) column |= 1 << row;
+    }
+    uint16_t expected = x < Panel::CENTER_X ? 0 : strip[x - Panel::CENTER_X];
+    if (column != expected) return false;
+  }
+  return true;
+}
+
+// Plays an SSE recording the way RTDB sends it ("event: put" / "data: {path, data}"), each
+// event at atMs after the start. Keep-alives carry nothing and are skipped.
+struct SseEvent {
+  uint32_t atMs;
+  const char* text;
+};
+
+void replay(const SseEvent& event) {
+  const char* type = strstr(event.text, "event: ") + 7;
+  const char* data = strstr(event.text, "data: ") + 6;
+  if (!strncmp(type, "keep-alive", 10)) return;
+  MockJsonNode body;
+  TEST_ASSERT_TRUE(MockJsonNode::parse(data, body));
+  std::string path = "/display" + body.children["path"].value;
+  if (!strncmp(type, "put", 3)) mockRtdb.put(path, body.children["data"]);
+  else mockRtdb.patch(path, body.children["data"]);
+}
+
+// Runs until text scrolls in, returns the time from the event arriving to the frame
+uint64_t screenLatency(const std::string& text) {
+  uint64_t arrival = mockNowUs + mockRtdb.eventDelayUs;
+  uint64_t shownAt = 0;
+  Disp.mockOnScan = [&]() {
+    if (!shownAt && panelStarts(text)) shownAt = mockNowUs;
+  };
+  runUntil(arrival + 1000000);
+  Disp.mockOnScan = nullptr;
+  TEST_ASSERT_NOT_EQUAL(0, shownAt);
+  return shownAt - arrival;
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// TESTS
+
+void test_stream_starts() {
+  runFor(5000000);
+  TEST_ASSERT_TRUE(streamActive);
+  TEST_ASSERT_EQUAL(2, totalSentences);
+  TEST_ASSERT_EQUAL(0, selectedSentence);
+  // Only the stream request, its first event is the whole node
+  TEST_ASSERT_EQUAL(1, mockRtdb.requests);
+}
+
+void test_put_selected_sentence() {
+  std::string text = sentence('a');
+  std::string json = "event: put\ndata: {\"path\":\"/sentences/0\",\"data\":\"" + text + "\"}\n\n";
+  replay({ 0, json.c_str() });
+  uint64_t latency = screenLatency(text);
+  TEST_ASSERT_LESS_THAN(MAX_LATENCY_US, latency);
+}
+
+void test_put_selection() {
+  replay({ 0, "event: put\ndata: {\"path\":\"/selectedSentence\",\"data\":1}\n\n" });
+  TEST_ASSERT_LESS_THAN(MAX_LATENCY_US, screenLatency(sentence('K')));
+  TEST_ASSERT_EQUAL(1, selectedSentence);
+}
+
+void test_patch_sentences() {
+  // The console writes both sentences at once, only the selected one reaches the panel
+  std::string a = sentence('A'), b = sentence('0');
+  std::string json = "event: patch\ndata: {\"path\":\"/sentences\",\"data\":{\"0\":\"" + a + "\",\"1\":\"" + b + "\"}}\n\n";
+  replay({ 0, json.c_str() });
+  TEST_ASSERT_LESS_THAN(MAX_LATENCY_US, screenLatency(b));
+}
+
+void test_unselected_sentence_keeps_scrolling() {
+  std::string text = sentence('n');
+  std::string json = "event: put\ndata: {\"path\":\"/sentences/0\",\"data\":\"" + text + "\"}\n\n";
+  bool restarted = false;
+  Disp.mockOnScan = [&]() { restarted |= panelStarts(sentence('0')); };
+  replay({ 0, json.c_str() });
+  runFor(1000000);
+  Disp.mockOnScan = nullptr;
+  TEST_ASSERT_FALSE(restarted);
+  TEST_ASSERT_EQUAL(2, totalSentences);
+}
+
+void test_recorded_session() {
+  // A console session: keep-alives between edits, a sentence added and selected, one put of the
+  // whole node from another tool
+  std::string c = sentence('c'), d = sentence('d');
+  std::string addC = "event: put\ndata: {\"path\":\"/sentences/2\",\"data\":\"" + c + "\"}\n\n";
+  std::string whole = "event: put\ndata: {\"path\":\"/\",\"data\":{\"selectedSentence\":0,\"sentences\":[\"" + d + "\"]}}\n\n";
+  SseEvent session[] = {
+    { 0, "event: keep-alive\ndata: null\n\n" },
+    { 200, addC.c_str() },
+    { 5000, "event: keep-alive\ndata: null\n\n" },
+    { 5300, "event: put\ndata: {\"path\":\"/selectedSentence\",\"data\":2}\n\n" },
+    { 9000, whole.c_str() },
+  };
+  const std::string* shows[] = { nullptr, nullptr, nullptr, &c, &d };
+
+  uint64_t start = mockNowUs;
+  uint64_t worst = 0;
+  for (size_t i = 0; i < sizeof(session) / sizeof(session[0]); i++) {
+    runUntil(start + session[i].atMs * 1000ULL);
+    replay(session[i]);
+    if (shows[i]) worst = max(worst, screenLatency(*shows[i]));
+  }
+  char line[64];
+  snprintf(line, sizeof(line), "worst event to screen %llu us", (unsigned long long)worst);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_LESS_THAN(MAX_LATENCY_US, worst);
+  TEST_ASSERT_EQUAL(1, totalSentences);
+  TEST_ASSERT_EQUAL(1, streamStarts); // No resubscribe on the way
+}
+
+void test_version_follows_the_stream() {
+  // A tool that writes the sentences and the version in one patch of the whole node, then a
+  // writer that bumps the version after its content (pushLocalChanges())
+  std::string e = sentence('e');
+  std::string bump = "event: patch\ndata: {\"path\":\"/\",\"data\":{\"sentences\":[\"" + e + "\"],\"version\":5}}\n\n";
+  replay({ 0, bump.c_str() });
+  runFor(200000);
+  TEST_ASSERT_EQUAL(5, syncedVersion);
+  replay({ 0, "event: put\ndata: {\"path\":\"/version\",\"data\":6}\n\n" });
+  runFor(200000);
+  TEST_ASSERT_EQUAL(6, syncedVersion);
+  // A put of the whole node without a version has none
+  std::string whole = "event: put\ndata: {\"path\":\"/\",\"data\":{\"selectedSentence\":0,\"sentences\":[\"" + e + "\"]}}\n\n";
+  replay({ 0, whole.c_str() });
+  runFor(200000);
+  TEST_ASSERT_EQUAL(-1, syncedVersion);
+}
+
+void test_gap_leaves_no_stale_text() {
+  // Slot 1 held text before the list was cut to one, writing slot 3 must not bring it back
+  std::string a = sentence('a'), b = sentence('b'), c = sentence('c');
+  std::string list = "event: put\ndata: {\"path\":\"/sentences\",\"data\":[\"" + a + "\",\"" + b + "\"]}\n\n";
+  replay({ 0, list.c_str() });
+  runFor(200000);
+  TEST_ASSERT_EQUAL(2, totalSentences);
+  std::string cut = "event: put\ndata: {\"path\":\"/sentences\",\"data\":[\"" + a + "\",\"\",\"" + c + "\"]}\n\n";
+  replay({ 0, cut.c_str() });
+  runFor(200000);
+  TEST_ASSERT_EQUAL(1, totalSentences);
+
+  std::string add = "event: put\ndata: {\"path\":\"/sentences/3\",\"data\":\"" + c + "\"}\n\n";
+  replay({ 0, add.c_str() });
+  runFor(200000);
+  TEST_ASSERT_EQUAL(4, totalSentences);
+  for (int i = 1; i < 3; i++) {
+    TEST_ASSERT_EQUAL(0, sentences[i].length);
+    TEST_ASSERT_EQUAL_STRING("", sentences[i].text);
+  }
+  TEST_ASSERT_EQUAL_STRING(c.c_str(), sentences[3].text);
+}
+
+void test_status_write_stays_off_the_stream() {
+  runFor(1000000);
+  uint32_t events = mockRtdb.events;
+  TEST_ASSERT_TRUE(uploadTelemetry());
+  runFor(1000000);
+  TEST_ASSERT_EQUAL(events, mockRtdb.events);
+  TEST_ASSERT_EQUAL_STRING("true", mockRtdb.get("/status/a1b2c3/deviceOnline").c_str());
+  TEST_ASSERT_EQUAL_STRING("null", mockRtdb.get("/display/status").c_str());
+}
+
+void test_resubscribe_after_server_outage() {
+  mockRtdb.online = false;
+  runFor(10000000);
+  TEST_ASSERT_FALSE(streamActive);
+  mockRtdb.online = true;
+
+  // Written while the stream was down, comes with the first put after the resubscribe
+  std::string text = sentence('r');
+  mockRtdb.set("/display/sentences/0", ("\"" + text + "\"").c_str());
+  bool shown = false;
+  Disp.mockOnScan = [&]() { shown |= panelStarts(text); };
+  runFor(120000000);
+  Disp.mockOnScan = nullptr;
+  TEST_ASSERT_TRUE(streamActive);
+  TEST_ASSERT_EQUAL(2, streamStarts);
+  TEST_ASSERT_TRUE(shown);
+}
+
+void test_full_display_put_on_resubscribe() {
+  // The largest /display there is: every sentence at full length in Bangla, its hash, and a
+  // playlist of 16 items with every field set
+  std::string document = "{\"hashes\":[";
+  for (int i = 0; i < 10; i++) document += (i ? ",\"" : "\"") + std::string("9c1f02aa") + "\"";
+  document += "],\"playlist\":[";
+  for (int i = 0; i < 16; i++) {
+    char item[128];
+    snprintf(item, sizeof(item), "%s{\"days\":\"-MTWTF-\",\"dwell\":65535,\"from\":\"00:00\",\"repeat\":255,\"sentence\":%d,\"to\":\"00:00\"}",
+             i ? "," : "", i % 10);
+    document += item;
+  }
+  document += "],\"selectedSentence\":9,\"sentences\":[";
+  std::string texts[10];
+  for (int i = 0; i < 10; i++) {
+    texts[i] = std::to_string(i);
+    for (int c = 1; c < 80; c++) texts[i] += (c % 8) ? "ক" : "০"; // 238 bytes
+    document += (i ? ",\"" : "\"") + texts[i] + "\"";
+  }
+  document += "],\"settings\":{\"scrollSpeed\":40.5,\"updateInterval\":60000},\"updatedAt\":1760000123456,\"version\":1}";
+  TEST_ASSERT_GREATER_THAN(4000, document.size());
+
+  // Written while the stream was down, the first put after the resubscribe is all of it
+  mockRtdb.online = false;
+  runFor(10000000);
+  mockRtdb.set("/display", document.c_str());
+  mockRtdb.online = true;
+  uint32_t starts = streamStarts;
+  while (streamStarts == starts) runFor(1000);
+  uint32_t requests = mockRtdb.requests;
+  runFor(1000000);
+
+  TEST_ASSERT_TRUE(streamActive);
+  TEST_ASSERT_EQUAL(10, totalSentences);
+  TEST_ASSERT_EQUAL(9, selectedSentence);
+  for (int i = 0; i < 10; i++) TEST_ASSERT_EQUAL_STRING(texts[i].c_str(), sentences[i].text);
+  TEST_ASSERT_EQUAL(requests, mockRtdb.requests); // From the put alone, no poll behind it
+}
+
+void test_failed_save_is_retried() {
+  // The first save of a streamed change hits a failing write, the change stays pending and the
+  // next save period writes it
+  std::string text = sentence('s');
+  std::string json = "event: put\ndata: {\"path\":\"/sentences/1\",\"data\":\"" + text + "\"}\n\n";
+  replay({ 0, json.c_str() });
+  runFor(200000);
+  TEST_ASSERT_TRUE(dataChanged);
+  mockFlash.failWrites = 1;
+  runFor(5000000);
+  TEST_ASSERT_EQUAL(0, mockFlash.failWrites);
+  TEST_ASSERT_TRUE(dataChanged);
+  runFor(5000000);
+  TEST_ASSERT_FALSE(dataChanged);
+
+  // What a reboot reads back
+  memset(sentences[1].text, 0, sizeof(sentences[1].text));
+  loadDataFromEEPROM();
+  TEST_ASSERT_EQUAL_STRING(text.c_str(), sentences[1].text);
+}
+
+int main() {
+  std::string first = "{\"sentences\":[\"" + sentence('0') + "\",\"" + sentence('K') + "\"],\"selectedSentence\":0}";
+  mockRtdb.set("/display", first.c_str());
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_stream_starts);
+  RUN_TEST(test_put_selected_sentence);
+  RUN_TEST(test_put_selection);
+  RUN_TEST(test_patch_sentences);
+  RUN_TEST(test_unselected_sentence_keeps_scrolling);
+  RUN_TEST(test_recorded_session);
+  RUN_TEST(test_version_follows_the_stream);
+  RUN_TEST(test_gap_leaves_no_stale_text);
+  RUN_TEST(test_status_write_stays_off_the_stream);
+  RUN_TEST(test_resubscribe_after_server_outage);
+  RUN_TEST(test_full_display_put_on_resubscribe);
+  RUN_TEST(test_failed_save_is_retried);
+  return UNITY_END();
+}
@@ -0,0 +1,164 @@
+// Sync cadence: backoff, jitter and the interval from settings, then a fleet of 100 displays
+// against a mock backend that goes away for half an hour. The displays must come back spread
+// out, not all in the same second, and the peak request rate after the outage is reported.
+// Run with: pio test -e native -f test_sync_cadence
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <Firebase_ESP_Client.h>
+#include <SyncCadence.h>
+#include <random>
+
+// Firmware under test (src/main.cpp)
+extern SyncCadence syncCadence;
+extern bool streamActive;
+
+const int DEVICES = 100;
+const uint64_t OUTAGE_START_MS = 600000;
+const uint64_t OUTAGE_MS = 1800000;
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// CADENCE
+
+void test_backoff_doubles_up_to_the_limit() {
+  SyncCadence cadence;
+  uint32_t expected[] = { 20000, 40000, 80000, 160000, 160000 };
+  for (uint32_t wait : expected) {
+    uint32_t delay = cadence.schedule(false, 0x7FFFFFFF);
+    TEST_ASSERT_UINT32_WITHIN(wait / 5, wait, delay);
+  }
+  TEST_ASSERT_EQUAL(SyncCadence::MAX_SHIFT, cadence.shift);
+  cadence.schedule(true, 0);
+  TEST_ASSERT_EQUAL(0, cadence.shift);
+  TEST_ASSERT_EQUAL(8000, cadence.delay); // Base less 20%
+}
+
+void test_jitter_covers_plus_minus_20_percent() {
+  SyncCadence cadence;
+  std::mt19937 rng(1);
+  uint32_t low = UINT32_MAX, high = 0;
+  for (int i = 0; i < 100000; i++) {
+    uint32_t delay = cadence.schedule(true, rng());
+    low = min(low, delay);
+    high = max(high, delay);
+  }
+  TEST_ASSERT_EQUAL(8000, low);
+  TEST_ASSERT_EQUAL(12000, high);
+}
+
+void test_shorter_interval_applies_right_away() {
+  SyncCadence cadence;
+  cadence.schedule(false, 0);
+  cadence.schedule(false, 0); // Waiting 40 s less jitter
+  TEST_ASSERT_TRUE(cadence.setInterval(2500));
+  TEST_ASSERT_EQUAL(10000, cadence.delay); // 4x the new interval
+  TEST_ASSERT_FALSE(cadence.setInterval(2500));
+  cadence.setInterval(100);
+  TEST_ASSERT_EQUAL(SyncCadence::INTERVAL_MIN, cadence.base);
+  cadence.setInterval(86400000);
+  TEST_ASSERT_EQUAL(SyncCadence::INTERVAL_MAX, cadence.base);
+}
+
+//--------------------------
+// FIRMWARE
+
+void test_interval_from_settings_without_reboot() {
+  TEST_ASSERT_TRUE(streamActive);
+  mockRtdb.set("/display/settings/updateInterval", "30000");
+  runFor(1000000);
+  TEST_ASSERT_EQUAL(30000, syncCadence.base);
+  mockRtdb.update("/display/settings", "{\"updateInterval\":5000}");
+  runFor(1000000);
+  TEST_ASSERT_EQUAL(5000, syncCadence.base);
+}
+
+//--------------------------
+// FLEET
+
+// A display as firebaseTask() drives it: while streaming it sends nothing, a dropped stream is
+// retried after the cadence delay. A failed resubscribe falls back to one poll, which fails too.
+struct Device {
+  SyncCadence cadence;
+  bool streaming = true;
+  uint64_t nextMs = 0;
+};
+
+struct FleetRun {
+  uint32_t peakPerSecond;    // Busiest second after the backend came back
+  uint32_t outageRequests;   // Requests while it was gone
+  uint64_t lastBackMs;       // Last display streaming again, after the outage ended
+};
+
+// jitter false gives every display the same roll, like a fleet without jitter
+FleetRun runFleet(bool jitter) {
+  std::mt19937 rng(17);
+  Device devices[DEVICES];
+  std::vector<uint32_t> perSecond(3600, 0); // One hour
+  FleetRun run = { 0, 0, 0 };
+  uint64_t outageEnd = OUTAGE_START_MS + OUTAGE_MS;
+
+  for (uint64_t now = 0; now < perSecond.size() * 1000ULL; now++) {
+    bool up = now < OUTAGE_START_MS || now >= outageEnd;
+    for (Device& device : devices) {
+      uint32_t roll = jitter ? rng() : 0x40000000;
+      if (device.streaming) {
+        if (up) continue;
+        // The backend drops every stream at once
+        device.streaming = false;
+        device.cadence.schedule(false, roll);
+        device.nextMs = now + device.cadence.delay;
+        continue;
+      }
+      if (now < device.nextMs) continue;
+      uint32_t requests = up ? 1 : 2; // Stream, and the fallback poll when it fails
+      perSecond[now / 1000] += requests;
+      if (!up) run.outageRequests += requests;
+      if (up) {
+        device.streaming = true;
+        device.cadence.schedule(true, roll);
+        run.lastBackMs = max(run.lastBackMs, now - outageEnd);
+      } else {
+        device.cadence.schedule(false, roll);
+        device.nextMs = now + device.cadence.delay;
+      }
+    }
+  }
+  for (size_t second = outageEnd / 1000; second < perSecond.size(); second++) {
+    run.peakPerSecond = max(run.peakPerSecond, perSecond[second]);
+  }
+  for (Device& device : devices) TEST_ASSERT_TRUE(device.streaming);
+  return run;
+}
+
+void test_fleet_comes_back_spread_out() {
+  FleetRun lockstep = runFleet(false);
+  FleetRun fleet = runFleet(true);
+
+  char line[128];
+  snprintf(line, sizeof(line), "%d displays after a %llu min outage: peak %u req/s (%u without jitter), "
+           "%u requests during it, all back after %llu s", DEVICES, (unsigned long long)(OUTAGE_MS / 60000),
+           (unsigned)fleet.peakPerSecond, (unsigned)lockstep.peakPerSecond, (unsigned)fleet.outageRequests,
+           (unsigned long long)(fleet.lastBackMs / 1000));
+  TEST_MESSAGE(line);
+  TEST_ASSERT_EQUAL(DEVICES, lockstep.peakPerSecond);
+  TEST_ASSERT_LESS_OR_EQUAL(DEVICES / 20, fleet.peakPerSecond);
+  // Backed off to one attempt per 160 s or so, a retry every 10 s would be 36000
+  TEST_ASSERT_LESS_THAN(2 * DEVICES * OUTAGE_MS / 128000 + 2 * DEVICES * 5, fleet.outageRequests);
+  // Within the longest wait of the backoff, 16x the interval plus jitter
+  TEST_ASSERT_LESS_OR_EQUAL(16 * SyncCadence::INTERVAL_DEFAULT * 6 / 5, fleet.lastBackMs);
+}
+
+int main() {
+  mockRtdb.set("/display", "{\"sentences\":[\"Cadence\"],\"selectedSentence\":0}");
+  setup();
+  runFor(5000000);
+  UNITY_BEGIN();
+  RUN_TEST(test_backoff_doubles_up_to_the_limit);
+  RUN_TEST(test_jitter_covers_plus_minus_20_percent);
+  RUN_TEST(test_shorter_interval_applies_right_away);
+  RUN_TEST(test_interval_from_settings_without_reboot);
+  RUN_TEST(test_fleet_comes_back_spread_out);
+  return UNITY_END();
+}
@@ -0,0 +1,153 @@
+// Tearing: every scan of the panel is checked against the last frame the renderer finished,
+// through scroll passes, the clock with its blinking colon, status notices and text changes from
+// the stream. A scrolling frame must also be the whole text at one offset, never two half
+// frames. Run with: pio test -e native -f test_tearing
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <Firebase_ESP_Client.h>
+#include <PanelFrame.h>
+#include <TextRender.h>
+
+// Firmware under test (src/main.cpp)
+extern DMDESP Disp;
+extern FrameBuffer<PanelGrid<1, 1>> frame;
+extern bool showClock;
+extern bool statusOverlayActive;
+extern char displayText[];
+void postStatus(const char* text, uint8_t priority, uint32_t ttlMs, uint8_t tag);
+
+using Panel = PanelGrid<1, 1>;
+const uint8_t STATUS_WARNING = 1;
+
+struct Strip {
+  std::string text;
+  uint16_t columns[2048];
+  int width = 0;
+};
+
+struct Watch {
+  Strip texts[2];       // Sentences that may be on the display, the old one while a change lands
+  uint32_t scans = 0;
+  uint32_t torn = 0;    // Panel differs from the finished frame
+  uint32_t mixed = 0;   // Scrolling frame that is not the text at one offset
+  uint32_t textScans = 0, clockScans = 0, statusScans = 0;
+} watch;
+
+void watchText(int slot, const std::string& text) {
+  Strip& strip = watch.texts[slot];
+  strip.text = text;
+  strip.width = renderStrip(text.c_str(), strip.columns, 2048);
+}
+
+bool panelIsFrame() {
+  for (int y = 0; y < Panel::HEIGHT; y++) {
+    for (int x = 0; x < Panel::WIDTH; x++) {
+      if (Disp.mockPixel(x, y) != frame.pixel(x, y)) return false;
+    }
+  }
+  return true;
+}
+
+// The text band is one of the sentences at one offset and nothing is lit outside it
+bool panelIsTextAtOneOffset() {
+  for (int y = 0; y < Panel::HEIGHT; y++) {
+    if (y >= Panel::TEXT_Y && y < Panel::TEXT_Y + Panel::TEXT_HEIGHT) continue;
+    for (int x = 0; x < Panel::WIDTH; x++) {
+      if (Disp.mockPixel(x, y)) return false;
+    }
+  }
+  uint16_t columns[Panel::WIDTH];
+  for (int x = 0; x < Panel::WIDTH; x++) {
+    columns[x] = 0;
+    for (int row = 0; row < Panel::TEXT_HEIGHT; row++) {
+      if (Disp.mockPixel(x, Panel::TEXT_Y + row)) columns[x] |= 1 << row;
+    }
+  }
+  for (const Strip& strip : watch.texts) {
+    for (int offset = 0; offset < strip.width + Panel::WIDTH; offset++) {
+      bool match = true;
+      for (int x = 0; x < Panel::WIDTH && match; x++) {
+        int at = x - Panel::CENTER_X + offset;
+        match = columns[x] == (at >= 0 && at < strip.width ? strip.columns[at] : 0);
+      }
+      if (match) return true;
+    }
+  }
+  return false;
+}
+
+void onScan() {
+  // The clock or a notice stays up after it ends until the next frame is presented
+  static uint32_t heldUntilPresent = 0;
+  static uint32_t* heldKind = nullptr;
+  watch.scans++;
+  if (!panelIsFrame()) watch.torn++;
+  if (statusOverlayActive || showClock) {
+    heldKind = statusOverlayActive ? &watch.statusScans : &watch.clockScans;
+    heldUntilPresent = frame.presents;
+    (*heldKind)++;
+  } else if (heldKind && frame.presents == heldUntilPresent) {
+    (*heldKind)++;
+  } else {
+    heldKind = nullptr;
+    watch.textScans++;
+    if (!panelIsTextAtOneOffset()) watch.mixed++;
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// TESTS
+
+void test_scroll_and_clock() {
+  runFor(40000000); // Two passes and the clock between them
+  TEST_ASSERT_GREATER_THAN(0, watch.textScans);
+  TEST_ASSERT_GREATER_THAN(0, watch.clockScans);
+  TEST_ASSERT_EQUAL(0, watch.torn);
+  TEST_ASSERT_EQUAL(0, watch.mixed);
+}
+
+void test_status_over_scrolling_text() {
+  while (showClock) runFor(1000);
+  runFor(500000);
+  postStatus("Reconnecting WiFi...", STATUS_WARNING, 3000, 0);
+  runFor(10000000);
+  TEST_ASSERT_GREATER_THAN(0, watch.statusScans);
+  TEST_ASSERT_EQUAL(0, watch.torn);
+  TEST_ASSERT_EQUAL(0, watch.mixed);
+}
+
+void test_text_change_mid_scroll() {
+  while (showClock) runFor(1000);
+  runFor(1000000);
+  // The old text until the new one is shaped, never a frame of both
+  std::string next = "A new sentence from the stream";
+  watchText(1, next);
+  mockRtdb.set("/display/sentences/0", ("\"" + next + "\"").c_str());
+  runFor(20000000);
+  TEST_ASSERT_EQUAL_STRING(next.c_str(), displayText);
+  TEST_ASSERT_EQUAL(0, watch.torn);
+  TEST_ASSERT_EQUAL(0, watch.mixed);
+
+  char line[96];
+  snprintf(line, sizeof(line), "%u scans: %u text, %u clock, %u status, %u frames presented", (unsigned)watch.scans,
+           (unsigned)watch.textScans, (unsigned)watch.clockScans, (unsigned)watch.statusScans, (unsigned)frame.presents);
+  TEST_MESSAGE(line);
+}
+
+int main() {
+  std::string text = "Tearing test, every scan is a whole frame";
+  mockRtdb.set("/display", ("{\"sentences\":[\"" + text + "\"],\"selectedSentence\":0}").c_str());
+  setup();
+  watchText(0, text);
+  watchText(1, text);
+  runFor(10000000); // WiFi, SNTP and the stream are up, the boot status notices are gone
+  Disp.mockOnScan = onScan;
+  UNITY_BEGIN();
+  RUN_TEST(test_scroll_and_clock);
+  RUN_TEST(test_status_over_scrolling_text);
+  RUN_TEST(test_text_change_mid_scroll);
+  return UNITY_END();
+}
@@ -0,0 +1,194 @@
+// Timekeeping over simulated days against a mock SNTP source: the drift of a slow crystal is
+// learned, hourly answers with 20 ms of network jitter keep it within tens of ms, offsets are slewed
+// at no more than 500 ppm and never run the clock backwards, large ones are stepped, and the
+// clock survives a reset through the RTC record. Run with: pio test -e native -f test_timekeeping
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <TimeKeeper.h>
+#include <random>
+
+// Firmware under test (src/main.cpp)
+extern TimeKeeper timeKeeper;
+extern struct tm clockLocal;
+extern time_t clockLocalSecond;
+
+const int64_t EPOCH_US = 1760000000LL * 1000000;
+const int64_t HOUR_US = 3600LL * 1000000;
+const int64_t DAY_US = 24 * HOUR_US;
+
+// A crystal ppm slow: local microseconds after t real ones
+uint64_t slowLocal(int64_t t, int ppm) { return 1000000 + t - t * ppm / 1000000; }
+
+struct WeekRun {
+  int64_t maxErrorUs;     // Worst error once the first day is over
+  int64_t outageErrorUs;  // Worst error during the outage
+  int32_t driftPpb;
+};
+
+// A week with hourly answers, +-jitter us of network noise and a 12 hour outage on day 3
+WeekRun runWeek(int ppm, int jitterUs) {
+  std::mt19937 rng(22);
+  TimeKeeper keeper;
+  WeekRun run = { 0, 0, 0 };
+  int64_t lastEpochUs = 0;
+  for (int64_t t = 0; t <= 7 * DAY_US; t += 10000000) {
+    uint64_t localUs = slowLocal(t, ppm);
+    bool outage = (t >= 72 * HOUR_US && t < 84 * HOUR_US);
+    if (t % HOUR_US == 0 && !outage) {
+      int64_t jitter = jitterUs ? (int64_t)(rng() % (2 * jitterUs + 1)) - jitterUs : 0;
+      keeper.sample(EPOCH_US + t + jitter, localUs);
+    }
+    if (localUs - keeper.refLocalUs >= TIME_ANCHOR_US) keeper.anchor(localUs);
+
+    int64_t epochUs = keeper.epochUs(localUs);
+    TEST_ASSERT_TRUE(epochUs > lastEpochUs); // Never backwards
+    lastEpochUs = epochUs;
+    int64_t error = llabs(epochUs - (EPOCH_US + t));
+    if (t >= DAY_US) run.maxErrorUs = max(run.maxErrorUs, error);
+    if (outage) run.outageErrorUs = max(run.outageErrorUs, error);
+  }
+  TEST_ASSERT_EQUAL(0, keeper.steps);
+  run.driftPpb = keeper.driftPpb;
+  return run;
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// DRIFT
+
+void test_week_with_slow_crystal() {
+  WeekRun run = runWeek(30, 20000);
+  TEST_ASSERT_INT32_WITHIN(3000, 30000, run.driftPpb);
+  TEST_ASSERT_LESS_THAN(50000, run.maxErrorUs);
+  // 12 hours without SNTP: without the drift term a 30 ppm crystal is 1.3 s off by then
+  TEST_ASSERT_LESS_THAN(200000, run.outageErrorUs);
+
+  char line[128];
+  snprintf(line, sizeof(line), "Week at 30 ppm, +-20 ms jitter: drift %.2f ppm, max error %lld ms, %lld ms in the outage",
+           run.driftPpb / 1000.0, (long long)(run.maxErrorUs / 1000), (long long)(run.outageErrorUs / 1000));
+  TEST_MESSAGE(line);
+}
+
+void test_drift_estimate_is_limited() {
+  WeekRun exact = runWeek(-80, 0); // A fast crystal, no jitter
+  TEST_ASSERT_INT32_WITHIN(500, -80000, exact.driftPpb);
+
+  // A crystal out of spec at 900 ppm, answers 11 minutes apart so the first offsets are slewed
+  TimeKeeper keeper;
+  for (int64_t t = 0; t <= HOUR_US * 3; t += 660000000) keeper.sample(EPOCH_US + t, slowLocal(t, 900));
+  TEST_ASSERT_EQUAL(TIME_DRIFT_LIMIT_PPB, keeper.driftPpb);
+}
+
+//--------------------------
+// SLEW
+
+void test_offset_is_slewed_not_stepped() {
+  TimeKeeper keeper;
+  keeper.sample(EPOCH_US, 1000000);
+  // Clock 600 ms ahead, too soon after the first answer to say anything about drift
+  const int64_t at = 300000000;
+  keeper.sample(EPOCH_US + at - 600000, 1000000 + at);
+  TEST_ASSERT_EQUAL(-600000, keeper.lastOffsetUs);
+  TEST_ASSERT_EQUAL(0, keeper.steps);
+  TEST_ASSERT_EQUAL(0, keeper.driftPpb);
+
+  // 600 ms at 500 ppm takes 1200 s, the clock slows down but keeps going
+  int64_t last = keeper.epochUs(1000000 + at);
+  for (int64_t t = 1000000; t <= 1500000000; t += 1000000) {
+    int64_t now = keeper.epochUs(1000000 + at + t);
+    TEST_ASSERT_GREATER_OR_EQUAL(1000000 - 1000000 * TIME_SLEW_PPM / 1000000, now - last);
+    TEST_ASSERT_LESS_OR_EQUAL(1000000, now - last);
+    last = now;
+  }
+  TEST_ASSERT_EQUAL(EPOCH_US + at - 600000 + 1500000000, last); // Caught up with SNTP
+}
+
+void test_large_offset_is_stepped() {
+  TimeKeeper keeper;
+  keeper.sample(EPOCH_US, 1000000);
+  keeper.sample(EPOCH_US + HOUR_US + 5000000, 1000000 + HOUR_US);
+  TEST_ASSERT_EQUAL(1, keeper.steps);
+  TEST_ASSERT_EQUAL(EPOCH_US + HOUR_US + 5000000, keeper.epochUs(1000000 + HOUR_US));
+  TEST_ASSERT_EQUAL(0, keeper.driftPpb); // A step says nothing about the crystal
+}
+
+//--------------------------
+// RTC MEMORY
+
+void test_reset_keeps_the_clock() {
+  const uint32_t period = 6 << 12; // 6 us per RTC cycle, Q12
+  TimeKeeper keeper;
+  keeper.sample(EPOCH_US, 1000000);
+  keeper.sample(EPOCH_US + HOUR_US + 300000, 1000000 + HOUR_US); // Slewing when the reset comes
+  RtcTimeRecord record;
+  uint64_t savedAt = 1000000 + HOUR_US + 60000000;
+  keeper.save(record, savedAt, 1000, period);
+
+  // Away 18 s by the RTC counter, booted 300 ms ago
+  TimeKeeper restored;
+  uint64_t gap = restored.restore(record, 300000, 1000 + 3000000);
+  TEST_ASSERT_EQUAL(18000000, gap);
+  TEST_ASSERT_EQUAL(keeper.epochUs(savedAt) + 18000000, restored.epochUs(300000));
+  TEST_ASSERT_EQUAL(keeper.driftPpb, restored.driftPpb);
+  // The rest of the slew carries on after the reset
+  TEST_ASSERT_EQUAL(keeper.slewUs - keeper.slewApplied(savedAt - keeper.refLocalUs), restored.slewUs);
+
+  TimeKeeper rejected;
+  TEST_ASSERT_EQUAL(0, rejected.restore(record, 300000, 1000 + (uint32_t)(2 * HOUR_US / 6))); // Too long
+  record.epochUs++;
+  TEST_ASSERT_EQUAL(0, rejected.restore(record, 300000, 1000 + 3000000)); // crc
+  TEST_ASSERT_EQUAL(0, rejected.epochUs(300000));
+}
+
+//--------------------------
+// FIRMWARE
+
+// Days of virtual time on the firmware with SNTP answering hourly for a crystal 30 ppm slow
+void test_firmware_clock_over_days() {
+  const int DAYS = 2;
+  uint64_t start = mockNowUs;
+  auto serverUs = [&]() { return EPOCH_US + (int64_t)(mockNowUs - start) * 1000030 / 1000000; };
+
+  mockSntpAnswer(serverUs());
+  int64_t maxErrorUs = 0;
+  for (int hour = 0; hour < DAYS * 24; hour++) {
+    for (int minute = 0; minute < 60; minute++) {
+      runFor(60000000);
+      int64_t error = llabs(timeKeeper.epochUs(micros64()) - serverUs());
+      if (hour >= 24) maxErrorUs = max(maxErrorUs, error);
+    }
+    mockSntpAnswer(serverUs());
+  }
+  runFor(1000000);
+
+  // The clock renderer reads the broken-down time timeTick() keeps, in local time (UTC+6)
+  time_t second = serverUs() / 1000000;
+  struct tm expected;
+  localtime_r(&second, &expected);
+  TEST_ASSERT_INT32_WITHIN(1, second, clockLocalSecond);
+  TEST_ASSERT_EQUAL(expected.tm_hour, clockLocal.tm_hour);
+  TEST_ASSERT_EQUAL(expected.tm_min, clockLocal.tm_min);
+  TEST_ASSERT_INT32_WITHIN(3000, 30000, timeKeeper.driftPpb);
+  TEST_ASSERT_LESS_THAN(5000, maxErrorUs); // Second day, the drift estimate has settled
+  TEST_ASSERT_EQUAL(0, timeKeeper.steps);
+
+  char line[96];
+  snprintf(line, sizeof(line), "%d days on the firmware: drift %.2f ppm, max error %lld ms on day 2", DAYS,
+           timeKeeper.driftPpb / 1000.0, (long long)(maxErrorUs / 1000));
+  TEST_MESSAGE(line);
+}
+
+int main() {
+  setup();
+  runFor(10000000); // WiFi is up, SNTP has not answered yet
+  UNITY_BEGIN();
+  RUN_TEST(test_week_with_slow_crystal);
+  RUN_TEST(test_drift_estimate_is_limited);
+  RUN_TEST(test_offset_is_slewed_not_stepped);
+  RUN_TEST(test_large_offset_is_stepped);
+  RUN_TEST(test_reset_keeps_the_clock);
+  RUN_TEST(test_firmware_clock_over_days);
+  return UNITY_END();
+}
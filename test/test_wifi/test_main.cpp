@@ -0,0 +1,129 @@
+// WiFi outages on a fake station and the virtual clock: the reconnect state machine never holds
+// up the panel, short outages end with the stream back, an hour without the access point opens
+// the config portal. Run with: pio test -e native -f test_wifi
+#include <unity.h>
+#include <FirmwareHost.h>
+#include <Firebase_ESP_Client.h>
+#include <WiFiManager.h>
+
+// Firmware under test (src/main.cpp)
+struct TimingMetric {
+  uint32_t count;
+  uint64_t totalUs;
+  uint32_t maxUs;
+};
+extern DMDESP Disp;
+extern WiFiManager wm;
+extern TimingMetric loopMetric;
+extern int wifiState;
+extern unsigned long wifiRetryDelay;
+extern uint32_t wifiDisconnects;
+extern bool firebaseConnected;
+extern bool streamActive;
+extern bool statusOverlayActive;
+
+const int WIFI_STATE_CONNECTED = 0;
+const int WIFI_STATE_PORTAL = 3;
+// Virtual time only moves in delay() and the mocked network, so these catch anything that blocks
+const uint32_t MAX_LOOP_US = 5000; // Longest scheduler task run allowed while the link is down
+const uint32_t MAX_SCAN_GAP_US = 5000;
+
+// Worst task run and worst gap between two panel scans over the run
+struct Stall {
+  uint32_t loopUs;
+  uint64_t scanGapUs;
+};
+
+Stall runWatched(uint64_t us) {
+  loopMetric.maxUs = 0;
+  uint64_t lastScan = mockNowUs, gap = 0;
+  Disp.mockOnScan = [&]() {
+    gap = max(gap, mockNowUs - lastScan);
+    lastScan = mockNowUs;
+  };
+  runFor(us);
+  Disp.mockOnScan = nullptr;
+  return { loopMetric.maxUs, gap };
+}
+
+void report(const char* label, const Stall& stall) {
+  char line[96];
+  snprintf(line, sizeof(line), "%s: worst loop %u us, worst scan gap %llu us", label,
+           (unsigned)stall.loopUs, (unsigned long long)stall.scanGapUs);
+  TEST_MESSAGE(line);
+}
+
+// The access point goes away and the link with it
+void loseAccessPoint() {
+  mockStation.inRange = false;
+  mockStation.drop();
+}
+
+void setUp() {}
+void tearDown() {}
+
+//--------------------------
+// TESTS
+
+void test_boot_connects() {
+  runFor(10000000);
+  TEST_ASSERT_EQUAL(WIFI_STATE_CONNECTED, wifiState);
+  TEST_ASSERT_TRUE(streamActive);
+  TEST_ASSERT_EQUAL(1, mockRtdb.streams.size());
+}
+
+void test_drop_ends_the_stream() {
+  loseAccessPoint();
+  runFor(6000000); // One WiFi check
+  TEST_ASSERT_NOT_EQUAL(WIFI_STATE_CONNECTED, wifiState);
+  TEST_ASSERT_EQUAL(1, wifiDisconnects);
+  TEST_ASSERT_FALSE(firebaseConnected);
+  TEST_ASSERT_FALSE(streamActive);
+  TEST_ASSERT_EQUAL(0, mockRtdb.streams.size());
+  TEST_ASSERT_TRUE(statusOverlayActive);
+}
+
+void test_short_outage() {
+  Stall stall = runWatched(5 * 60000000ULL);
+  report("5 min outage", stall);
+  TEST_ASSERT_LESS_THAN(MAX_LOOP_US, stall.loopUs);
+  TEST_ASSERT_LESS_THAN(MAX_SCAN_GAP_US, stall.scanGapUs);
+  TEST_ASSERT_EQUAL(60000, wifiRetryDelay); // Backed off to the longest pause
+
+  // Back in range: the SDK finds it, the state machine picks it up
+  mockStation.inRange = true;
+  runFor(2 * 60000000ULL);
+  TEST_ASSERT_EQUAL(WIFI_STATE_CONNECTED, wifiState);
+  TEST_ASSERT_TRUE(streamActive);
+  TEST_ASSERT_EQUAL(1, mockRtdb.streams.size());
+}
+
+void test_hour_outage_opens_portal() {
+  loseAccessPoint();
+  Stall stall = runWatched(61 * 60000000ULL);
+  report("61 min outage", stall);
+  TEST_ASSERT_EQUAL(WIFI_STATE_PORTAL, wifiState);
+  TEST_ASSERT_TRUE(wm.getConfigPortalActive());
+  TEST_ASSERT_FALSE(wm.getWiFiIsSaved());
+  TEST_ASSERT_LESS_THAN(MAX_LOOP_US, stall.loopUs);
+  TEST_ASSERT_LESS_THAN(MAX_SCAN_GAP_US, stall.scanGapUs);
+
+  // Someone enters the new network in the portal, the display goes back online
+  mockStation.inRange = true;
+  wm.mockSubmit();
+  // The Firebase requests after that block for their round trip, see test_stream
+  runFor(60000000);
+  TEST_ASSERT_EQUAL(WIFI_STATE_CONNECTED, wifiState);
+  TEST_ASSERT_TRUE(streamActive);
+}
+
+int main() {
+  mockRtdb.set("/display", "{\"sentences\":[\"Hello\"],\"selectedSentence\":0}");
+  setup();
+  UNITY_BEGIN();
+  RUN_TEST(test_boot_connects);
+  RUN_TEST(test_drop_ends_the_stream);
+  RUN_TEST(test_short_outage);
+  RUN_TEST(test_hour_outage_opens_portal);
+  return UNITY_END();
+}